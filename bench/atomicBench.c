@@ -0,0 +1,214 @@
+/**
+ * @file atomicBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares the atomic timespec in timespec_atomic.h against a timespec guarded by a mutex, as thread count grows.
+ *
+ * Usage: timespec_atomic_bench [--csv] [MAX_THREADS]
+ *
+ * For 1, 2, 4, ... up to MAX_THREADS threads (default twice the online CPUs), every thread works on one shared value
+ * for half a second in each of three patterns:
+ *
+ *   publish   thread 0 stores a new time continually and the others load it
+ *   max       every thread raises the value to a time of its own, as for a "latest seen" watermark
+ *   add       every thread adds a duration to the value
+ *
+ * Total and per-thread operations per second are reported for each implementation.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_atomic.h>
+#include <timespec_clock.h>
+
+#define RUN_MS 500
+
+enum pattern
+{
+    PATTERN_PUBLISH,
+    PATTERN_MAX,
+    PATTERN_ADD,
+};
+
+static const char *pattern_names[] = { "publish", "max", "add" };
+
+struct mutex_timespec
+{
+    pthread_mutex_t lock;
+    struct timespec ts;
+};
+
+static struct timespec_atomic atomic_value;
+static struct mutex_timespec mutex_value;
+static enum pattern pattern;
+static bool use_mutex;
+static bool stop;
+
+struct worker
+{
+    pthread_t thread;
+    int index;
+    long ops;
+    struct timespec sink;
+} __attribute__((aligned(64)));
+
+static struct timespec mutex_load(void)
+{
+    pthread_mutex_lock(&mutex_value.lock);
+    struct timespec ts = mutex_value.ts;
+    pthread_mutex_unlock(&mutex_value.lock);
+
+    return ts;
+}
+
+static void mutex_store(struct timespec ts)
+{
+    pthread_mutex_lock(&mutex_value.lock);
+    mutex_value.ts = ts;
+    pthread_mutex_unlock(&mutex_value.lock);
+}
+
+static void mutex_max(struct timespec ts)
+{
+    pthread_mutex_lock(&mutex_value.lock);
+    if(timespec_gt(ts, mutex_value.ts))
+    {
+        mutex_value.ts = ts;
+    }
+    pthread_mutex_unlock(&mutex_value.lock);
+}
+
+static void mutex_add(struct timespec ts)
+{
+    pthread_mutex_lock(&mutex_value.lock);
+    mutex_value.ts = timespec_add(mutex_value.ts, ts);
+    pthread_mutex_unlock(&mutex_value.lock);
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    struct timespec step = { .tv_sec = 0, .tv_nsec = 1 };
+    struct timespec t = { .tv_sec = w->index, .tv_nsec = 0 };
+    bool writer = pattern != PATTERN_PUBLISH || w->index == 0;
+
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        for(int i = 0; i < 64; ++i)
+        {
+            t = timespec_add(t, step);
+
+            if(!writer)
+            {
+                w->sink = use_mutex ? mutex_load() : timespec_atomic_load(&atomic_value);
+            }
+            else if(pattern == PATTERN_PUBLISH)
+            {
+                use_mutex ? mutex_store(t) : timespec_atomic_store(&atomic_value, t);
+            }
+            else if(pattern == PATTERN_MAX)
+            {
+                use_mutex ? mutex_max(t) : (void)(timespec_atomic_fetch_max(&atomic_value, t));
+            }
+            else
+            {
+                use_mutex ? mutex_add(step) : (void)(timespec_atomic_fetch_add(&atomic_value, step));
+            }
+        }
+        w->ops += 64;
+    }
+
+    return NULL;
+}
+
+/* Returns the total operations per second made by nthreads threads. */
+static double run(int nthreads, enum pattern p, bool mutex)
+{
+    struct worker *workers = calloc((size_t)(nthreads), sizeof(*workers));
+    struct timespec zero = { .tv_sec = 0, .tv_nsec = 0 };
+    long ops = 0;
+
+    timespec_atomic_init(&atomic_value, zero);
+    pthread_mutex_init(&mutex_value.lock, NULL);
+    mutex_value.ts = zero;
+
+    pattern = p;
+    use_mutex = mutex;
+    stop = false;
+
+    for(int i = 0; i < nthreads; ++i)
+    {
+        workers[i].index = i;
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+
+    struct timespec until = timespec_add(timespec_now(CLOCK_MONOTONIC), timespec_from_ms(RUN_MS));
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+    {
+    }
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+    for(int i = 0; i < nthreads; ++i)
+    {
+        pthread_join(workers[i].thread, NULL);
+        ops += workers[i].ops;
+    }
+
+    pthread_mutex_destroy(&mutex_value.lock);
+    free(workers);
+
+    return (double)(ops) * 1000.0 / RUN_MS;
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 2 * (int)(sysconf(_SC_NPROCESSORS_ONLN));
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atoi(argv[i]) > 0)
+        {
+            max_threads = atoi(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [MAX_THREADS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if(csv)
+        printf("pattern,threads,implementation,ops_per_sec,ops_per_sec_per_thread\n");
+    else
+        printf("%-8s %-8s %-10s %16s %16s\n", "pattern", "threads", "impl", "ops/sec", "per thread");
+
+    for(int p = PATTERN_PUBLISH; p <= PATTERN_ADD; ++p)
+    {
+        for(int n = 1; n <= max_threads; n = (n * 2 > max_threads && n < max_threads) ? max_threads : n * 2)
+        {
+            for(int m = 0; m < 2; ++m)
+            {
+                double rate = run(n, (enum pattern)(p), m == 1);
+                const char *name = (m == 1) ? "mutex" : "lock-free";
+
+                if(csv)
+                    printf("%s,%d,%s,%.0f,%.0f\n", pattern_names[p], n, name, rate, rate / n);
+                else
+                    printf("%-8s %-8d %-10s %16.0f %16.0f\n", pattern_names[p], n, name, rate, rate / n);
+            }
+        }
+    }
+
+    return 0;
+}
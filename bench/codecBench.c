@@ -0,0 +1,144 @@
+/**
+ * @file codecBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Measures the size and speed of the delta-of-delta timestamp codec in timespec_codec.h.
+ *
+ * Usage: timespec_codec_bench [--csv] [STAMPS]
+ *
+ * STAMPS timestamps (default 10000000) are generated in three patterns: exactly periodic, periodic with 20us of
+ * jitter, and random. For each, the encoded size in bits per stamp is reported along with encode, block decode and
+ * random access throughput.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_codec.h>
+
+#define RANDOM_GETS 1000000
+
+static double seconds_since(struct timespec start)
+{
+    return timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 10000000;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            n = (size_t)(atol(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [STAMPS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec *in = malloc(n * sizeof(*in));
+    timespec_ns *block_ns = malloc(TIMESPEC_CODEC_BLOCK_SIZE * sizeof(*block_ns));
+    struct timespec *block_ts = malloc(TIMESPEC_CODEC_BLOCK_SIZE * sizeof(*block_ts));
+
+    if(in == NULL || block_ns == NULL || block_ts == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    static const char *patterns[] = { "periodic", "jittered", "random" };
+
+    if(csv)
+        printf("pattern,stamps,bits_per_stamp,encode_mstamps_per_sec,decode_ns_mstamps_per_sec,"
+            "decode_timespec_mstamps_per_sec,random_get_ns\n");
+    else
+        printf("%-10s %12s %10s %14s %14s %14s %12s\n", "pattern", "stamps", "bits/stamp",
+            "encode M/s", "decode ns M/s", "decode ts M/s", "get ns/op");
+
+    for(int pattern = 0; pattern < 3; ++pattern)
+    {
+        struct timespec t = { .tv_sec = 1792240496, .tv_nsec = 0 };
+
+        srand(1);
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(pattern == 2)
+            {
+                t.tv_sec  = rand();
+                t.tv_nsec = rand() % 1000000000;
+            }
+            else
+            {
+                t = timespec_add(t, timespec_ns_to_timespec(1000000 + (pattern == 1 ? rand() % 40001 - 20000 : 0)));
+            }
+
+            in[i] = t;
+        }
+
+        struct timespec_codec *codec = timespec_codec_create(TIMESPEC_CODEC_BLOCK_SIZE);
+        struct timespec start = timespec_now(CLOCK_MONOTONIC);
+
+        for(size_t i = 0; i < n; ++i)
+            timespec_codec_append(codec, in[i]);
+        double encode = seconds_since(start);
+
+        size_t blocks = timespec_codec_blocks(codec);
+        long check = 0;
+
+        start = timespec_now(CLOCK_MONOTONIC);
+        for(size_t b = 0; b < blocks; ++b)
+            check += (long)(timespec_codec_decode_block_ns(codec, b, block_ns)) + (long)(block_ns[0]);
+        double decode_ns = seconds_since(start);
+
+        start = timespec_now(CLOCK_MONOTONIC);
+        for(size_t b = 0; b < blocks; ++b)
+            check += (long)(timespec_codec_decode_block(codec, b, block_ts)) + block_ts[0].tv_nsec;
+        double decode_ts = seconds_since(start);
+
+        start = timespec_now(CLOCK_MONOTONIC);
+        for(long i = 0; i < RANDOM_GETS; ++i)
+        {
+            struct timespec one;
+            timespec_codec_get(codec, ((size_t)(rand()) * 7919) % n, &one);
+            check += one.tv_nsec;
+        }
+        double get = seconds_since(start);
+
+        size_t len;
+        timespec_codec_data(codec, &len);
+
+        double bits = (double)(len) * 8 / (double)(n);
+        double mn = (double)(n) / 1e6;
+
+        if(csv)
+            printf("%s,%zu,%.3f,%.1f,%.1f,%.1f,%.1f\n", patterns[pattern], n, bits, mn / encode, mn / decode_ns,
+                mn / decode_ts, get * 1e9 / RANDOM_GETS);
+        else
+            printf("%-10s %12zu %10.3f %14.1f %14.1f %14.1f %12.1f\n", patterns[pattern], n, bits, mn / encode,
+                mn / decode_ns, mn / decode_ts, get * 1e9 / RANDOM_GETS);
+
+        if(check == 42)
+            printf("\n");
+
+        timespec_codec_destroy(codec);
+    }
+
+    free(block_ts);
+    free(block_ns);
+    free(in);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file indexBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares finding the first element at or after a time in a sorted timespec array by binary search against the
+ * search index in timespec_index.h.
+ *
+ * Usage: timespec_index_bench [--csv] [MAX_N]
+ *
+ * Arrays of 1K, 8K, 64K, ... up to MAX_N elements (default 16M; 1G needs 25GB of memory) are each searched for 1M
+ * random times by:
+ *
+ *   branchy    binary search branching on timespec_ge()
+ *   branchless binary search selecting the half with timespec_cmp()
+ *   index      timespec_index_lower_bound()
+ *   batch      timespec_index_lower_bound_batch() with software prefetching
+ *
+ * The time per query in nanoseconds is reported for each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_index.h>
+
+#define QUERIES (1 << 20)
+
+static double seconds_since(struct timespec start)
+{
+    return timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+}
+
+static size_t branchy(const struct timespec *a, size_t n, struct timespec ts)
+{
+    size_t lo = 0, hi = n;
+
+    while(lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if(timespec_ge(a[mid], ts))
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
+static size_t branchless(const struct timespec *a, size_t n, struct timespec ts)
+{
+    const struct timespec *base = a;
+
+    while(n > 1)
+    {
+        size_t half = n / 2;
+
+        base += (timespec_cmp(base[half - 1], ts) < 0) ? half : 0;
+        n -= half;
+    }
+
+    return (size_t)(base - a) + (timespec_cmp(*base, ts) < 0);
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_n = 16 << 20;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            max_n = (size_t)(atol(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [MAX_N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec *queries = malloc(QUERIES * sizeof(*queries));
+    size_t *results = malloc(QUERIES * sizeof(*results));
+    timespec_ns start_ns = timespec_ns_from_timespec(timespec_now(CLOCK_REALTIME));
+    unsigned int seed = 1;
+
+    if(csv)
+        printf("n,method,ns_per_query\n");
+    else
+        printf("%-12s %-12s %12s\n", "n", "method", "ns/query");
+
+    for(size_t n = 1024; n <= max_n; n *= 8)
+    {
+        struct timespec *a = malloc(n * sizeof(*a));
+        timespec_ns t = start_ns;
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            t += rand_r(&seed) % 2000;
+            a[i] = timespec_ns_to_timespec(t);
+        }
+
+        for(size_t i = 0; i < QUERIES; ++i)
+        {
+            queries[i] = timespec_ns_to_timespec(start_ns + (timespec_ns)(((uint64_t)(rand_r(&seed)) << 31
+                | (uint64_t)(rand_r(&seed))) % (uint64_t)(t - start_ns + 1)));
+        }
+
+        struct timespec_index *idx = timespec_index_create(a, n);
+        if(idx == NULL)
+        {
+            perror("timespec_index_create");
+            return 1;
+        }
+
+        const char *names[] = { "branchy", "branchless", "index", "batch" };
+        size_t check = 0;
+
+        for(int method = 0; method < 4; ++method)
+        {
+            struct timespec start = timespec_now(CLOCK_MONOTONIC);
+            size_t sum = 0;
+
+            if(method == 3)
+            {
+                timespec_index_lower_bound_batch(idx, queries, QUERIES, results);
+            }
+
+            for(size_t i = 0; i < QUERIES; ++i)
+            {
+                if(method == 0)
+                    sum += branchy(a, n, queries[i]);
+                else if(method == 1)
+                    sum += branchless(a, n, queries[i]);
+                else if(method == 2)
+                    sum += timespec_index_lower_bound(idx, queries[i]);
+                else
+                    sum += results[i];
+            }
+
+            double ns = seconds_since(start) * 1e9 / QUERIES;
+
+            if(method == 0)
+            {
+                check = sum;
+            }
+            else if(sum != check)
+            {
+                fprintf(stderr, "%s gave different results\n", names[method]);
+                return 1;
+            }
+
+            if(csv)
+                printf("%zu,%s,%.1f\n", n, names[method], ns);
+            else
+                printf("%-12zu %-12s %12.1f\n", n, names[method], ns);
+        }
+
+        timespec_index_destroy(idx);
+        free(a);
+    }
+
+    free(queries);
+    free(results);
+
+    return 0;
+}
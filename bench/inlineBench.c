@@ -0,0 +1,72 @@
+/**
+ * @file inlineBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares the per-call cost of the shared library build of timespec.h against the TIMESPEC_INLINE header-only build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+
+#include "inlineBenchLoops.h"
+
+#define ELEMENTS    4096
+#define REPETITIONS 4096
+
+typedef long (*bench_loop)(const struct timespec *a, const struct timespec *b, size_t n);
+
+static struct timespec a[ELEMENTS];
+static struct timespec b[ELEMENTS];
+
+static double ns_per_call(bench_loop loop, long *sink)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(int r = 0; r < REPETITIONS; ++r)
+    {
+        *sink += loop(a, b, ELEMENTS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return timespec_to_double(timespec_sub(end, start)) * 1e9 / ((double)(ELEMENTS) * REPETITIONS);
+}
+
+int main()
+{
+    static const struct {
+        const char *name;
+        bench_loop library;
+        bench_loop inlined;
+    } benches[] = {
+        { "timespec_lt",        bench_lt_library,        bench_lt_inline        },
+        { "timespec_add",       bench_add_library,       bench_add_inline       },
+        { "timespec_sub",       bench_sub_library,       bench_sub_inline       },
+        { "timespec_normalise", bench_normalise_library, bench_normalise_inline },
+        { "timespec_to_ms",     bench_to_ms_library,     bench_to_ms_inline     },
+    };
+    long sink = 0;
+
+    srand(1);
+    for(size_t i = 0; i < ELEMENTS; ++i)
+    {
+        a[i].tv_sec  = rand() % 100000;
+        a[i].tv_nsec = rand() % 1000000000;
+        b[i].tv_sec  = rand() % 100000;
+        b[i].tv_nsec = rand() % 1000000000;
+    }
+
+    printf("%-20s %14s %14s %10s\n", "function", "library ns", "inline ns", "speedup");
+    for(size_t i = 0; i < sizeof(benches) / sizeof(*benches); ++i)
+    {
+        double library = ns_per_call(benches[i].library, &sink);
+        double inlined = ns_per_call(benches[i].inlined, &sink);
+
+        printf("%-20s %14.3f %14.3f %9.2fx\n", benches[i].name, library, inlined, library / inlined);
+    }
+
+    return (sink == 42);
+}
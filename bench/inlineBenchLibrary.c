@@ -0,0 +1,12 @@
+/**
+ * @file inlineBenchLibrary.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <timespec.h>
+
+#include "inlineBenchLoops.h"
+
+DEFINE_INLINE_BENCH_LOOPS(library)
@@ -0,0 +1,66 @@
+/**
+ * @file inlineBenchLoops.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Benchmark loops shared by the library and inline builds of timespec.h. Each translation unit includes timespec.h in
+ * the mode it wants to measure and then instantiates the loops with DEFINE_INLINE_BENCH_LOOPS(suffix).
+ */
+
+#ifndef INLINE_BENCH_LOOPS_H
+#define INLINE_BENCH_LOOPS_H
+
+#include <stddef.h>
+#include <time.h>
+
+#define DECLARE_INLINE_BENCH_LOOPS(suffix) \
+    long bench_lt_##suffix(const struct timespec *a, const struct timespec *b, size_t n); \
+    long bench_add_##suffix(const struct timespec *a, const struct timespec *b, size_t n); \
+    long bench_sub_##suffix(const struct timespec *a, const struct timespec *b, size_t n); \
+    long bench_normalise_##suffix(const struct timespec *a, const struct timespec *b, size_t n); \
+    long bench_to_ms_##suffix(const struct timespec *a, const struct timespec *b, size_t n);
+
+#define DEFINE_INLINE_BENCH_LOOPS(suffix) \
+    long bench_lt_##suffix(const struct timespec *a, const struct timespec *b, size_t n) \
+    { \
+        long count = 0; \
+        for(size_t i = 0; i < n; ++i) \
+            count += timespec_lt(a[i], b[i]); \
+        return count; \
+    } \
+    long bench_add_##suffix(const struct timespec *a, const struct timespec *b, size_t n) \
+    { \
+        struct timespec acc = { 0, 0 }; \
+        for(size_t i = 0; i < n; ++i) \
+            acc = timespec_add(acc, timespec_add(a[i], b[i])); \
+        return (long)(acc.tv_sec) ^ acc.tv_nsec; \
+    } \
+    long bench_sub_##suffix(const struct timespec *a, const struct timespec *b, size_t n) \
+    { \
+        struct timespec acc = { 0, 0 }; \
+        for(size_t i = 0; i < n; ++i) \
+            acc = timespec_add(acc, timespec_sub(a[i], b[i])); \
+        return (long)(acc.tv_sec) ^ acc.tv_nsec; \
+    } \
+    long bench_normalise_##suffix(const struct timespec *a, const struct timespec *b, size_t n) \
+    { \
+        long acc = 0; \
+        (void)(b); \
+        for(size_t i = 0; i < n; ++i) \
+            acc += timespec_normalise(a[i]).tv_nsec; \
+        return acc; \
+    } \
+    long bench_to_ms_##suffix(const struct timespec *a, const struct timespec *b, size_t n) \
+    { \
+        long acc = 0; \
+        (void)(b); \
+        for(size_t i = 0; i < n; ++i) \
+            acc += timespec_to_ms(a[i]); \
+        return acc; \
+    }
+
+DECLARE_INLINE_BENCH_LOOPS(library)
+DECLARE_INLINE_BENCH_LOOPS(inline)
+
+#endif /* !INLINE_BENCH_LOOPS_H */
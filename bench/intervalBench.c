@@ -0,0 +1,153 @@
+/**
+ * @file intervalBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares finding every overlapping pair among a set of intervals using the interval tree in timespec_interval.h
+ * against comparing every pair with timespec_lt().
+ *
+ * Usage: timespec_interval_bench [--csv] [INTERVALS]
+ *
+ * INTERVALS intervals (default 20000) of up to an hour are spread over a year. The time to count the overlapping
+ * pairs both ways is reported, along with the cost of building the tree, of a stabbing query and of coalescing the
+ * intervals into a disjoint list.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_interval.h>
+
+#define STABS 1000000
+
+static double ms_since(struct timespec start)
+{
+    return timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start)) * 1000;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 20000;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            n = (size_t)(atol(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [INTERVALS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec_interval *intervals = malloc(n * sizeof(*intervals));
+    struct timespec_interval *coalesced = malloc(n * sizeof(*coalesced));
+    struct timespec_interval_tree *tree = timespec_interval_tree_create();
+
+    if(intervals == NULL || coalesced == NULL || tree == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    for(size_t i = 0; i < n; ++i)
+    {
+        intervals[i].start.tv_sec = 1792240496 + rand() % (365 * 86400);
+        intervals[i].start.tv_nsec = rand() % 1000000000;
+        intervals[i].end = timespec_add(intervals[i].start, timespec_from_ms(1 + rand() % 3600000));
+    }
+
+    /* Every pair */
+
+    struct timespec start = timespec_now(CLOCK_MONOTONIC);
+    size_t pairs_brute = 0;
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        for(size_t j = i + 1; j < n; ++j)
+        {
+            if(timespec_lt(intervals[i].start, intervals[j].end) && timespec_gt(intervals[i].end, intervals[j].start))
+            {
+                ++pairs_brute;
+            }
+        }
+    }
+    double brute_ms = ms_since(start);
+
+    /* Tree */
+
+    start = timespec_now(CLOCK_MONOTONIC);
+    for(size_t i = 0; i < n; ++i)
+    {
+        timespec_interval_tree_insert(tree, intervals[i], &intervals[i]);
+    }
+    double build_ms = ms_since(start);
+
+    start = timespec_now(CLOCK_MONOTONIC);
+    size_t overlaps = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        overlaps += timespec_interval_tree_overlap(tree, intervals[i], NULL, NULL);
+    }
+
+    /* Each pair is seen from both ends, and each interval overlaps itself. */
+    size_t pairs_tree = (overlaps - n) / 2;
+    double tree_ms = ms_since(start);
+
+    start = timespec_now(CLOCK_MONOTONIC);
+    size_t stabbed = 0;
+    for(long i = 0; i < STABS; ++i)
+    {
+        struct timespec ts = { .tv_sec = 1792240496 + rand() % (365 * 86400), .tv_nsec = 0 };
+        stabbed += timespec_interval_tree_stab(tree, ts, NULL, NULL);
+    }
+    double stab_ns = ms_since(start) * 1e6 / STABS;
+
+    memcpy(coalesced, intervals, n * sizeof(*coalesced));
+    start = timespec_now(CLOCK_MONOTONIC);
+    size_t disjoint = timespec_interval_coalesce(coalesced, n);
+    double coalesce_ms = ms_since(start);
+
+    if(pairs_tree != pairs_brute)
+    {
+        fprintf(stderr, "The tree found %zu overlapping pairs and the brute force search %zu\n", pairs_tree,
+            pairs_brute);
+        return 1;
+    }
+
+    if(csv)
+    {
+        printf("intervals,pairs,brute_ms,tree_build_ms,tree_pairs_ms,stab_ns,coalesce_ms,disjoint\n");
+        printf("%zu,%zu,%.3f,%.3f,%.3f,%.1f,%.3f,%zu\n", n, pairs_tree, brute_ms, build_ms, tree_ms, stab_ns,
+            coalesce_ms, disjoint);
+    }
+    else
+    {
+        printf("%10s %10s %12s %12s %12s %9s %10s %12s %10s\n", "intervals", "pairs", "brute ms", "build ms",
+            "tree ms", "speedup", "stab ns", "coalesce ms", "disjoint");
+        printf("%10zu %10zu %12.3f %12.3f %12.3f %8.0fx %10.1f %12.3f %10zu\n", n, pairs_tree, brute_ms, build_ms,
+            tree_ms, brute_ms / (build_ms + tree_ms), stab_ns, coalesce_ms, disjoint);
+    }
+
+    if(stabbed == 1)
+    {
+        printf("\n");
+    }
+
+    timespec_interval_tree_destroy(tree);
+    free(coalesced);
+    free(intervals);
+
+    return 0;
+}
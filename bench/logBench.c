@@ -0,0 +1,150 @@
+/**
+ * @file logBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Measures appends to the memory-mapped log in timespec_log.h and compares finding a time range in it with scanning
+ * every record using timespec_ge() and timespec_le().
+ *
+ * Usage: timespec_log_bench [--csv] [RECORDS]
+ *
+ * RECORDS records (default 1000000) of 32 bytes, about 1ms apart, are written to a temporary file. Queries for
+ * random 10ms windows are then answered both ways and reported in ns per query.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_log.h>
+
+#define SEARCH_QUERIES 100000
+#define SCAN_QUERIES   20
+
+static double ns_per_op(struct timespec start, size_t ops)
+{
+    struct timespec elapsed = timespec_sub(timespec_now(CLOCK_MONOTONIC), start);
+
+    return (double)(timespec_ns_from_timespec(elapsed)) / (double)(ops);
+}
+
+int main(int argc, char **argv)
+{
+    char path[] = "/tmp/timespec_log_benchXXXXXX";
+    size_t n = 1000000;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            n = (size_t)(atol(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [RECORDS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int fd = mkstemp(path);
+    if(fd < 0)
+    {
+        fprintf(stderr, "Could not create a temporary file\n");
+        return 1;
+    }
+    close(fd);
+
+    struct timespec_log_writer *writer = timespec_log_writer_open(path, 0);
+    if(writer == NULL)
+    {
+        fprintf(stderr, "Could not open the log\n");
+        unlink(path);
+        return 1;
+    }
+
+    struct timespec origin = { .tv_sec = 1792240496, .tv_nsec = 0 };
+    unsigned char payload[32] = { 0 };
+    timespec_ns t = timespec_ns_from_timespec(origin);
+
+    srand(1);
+
+    struct timespec start = timespec_now(CLOCK_MONOTONIC);
+    for(size_t i = 0; i < n; ++i)
+    {
+        t += 900000 + rand() % 200000;
+        timespec_log_append_ns(writer, t, payload, sizeof(payload));
+    }
+    double append_ns = ns_per_op(start, n);
+
+    struct timespec_log_reader *reader = timespec_log_reader_open(path);
+    struct timespec span = timespec_ns_to_timespec(t - timespec_ns_from_timespec(origin));
+    size_t found_search = 0, found_scan = 0;
+
+    /* Both sets of queries use the same windows. */
+    srand(2);
+    start = timespec_now(CLOCK_MONOTONIC);
+    for(int q = 0; q < SEARCH_QUERIES; ++q)
+    {
+        struct timespec from = timespec_add(origin, timespec_from_double(timespec_to_double(span) * rand() / RAND_MAX));
+        struct timespec to = timespec_add(from, timespec_from_ms(10));
+        const struct timespec_log_record *begin, *end;
+
+        timespec_log_range(reader, from, to, &begin, &end);
+        for(const struct timespec_log_record *r = begin; r != end; r = timespec_log_next(reader, r))
+        {
+            ++found_search;
+        }
+    }
+    double search_ns = ns_per_op(start, SEARCH_QUERIES);
+
+    srand(2);
+    start = timespec_now(CLOCK_MONOTONIC);
+    for(int q = 0; q < SCAN_QUERIES; ++q)
+    {
+        struct timespec from = timespec_add(origin, timespec_from_double(timespec_to_double(span) * rand() / RAND_MAX));
+        struct timespec to = timespec_add(from, timespec_from_ms(10));
+
+        for(const struct timespec_log_record *r = timespec_log_first(reader); r != NULL;
+            r = timespec_log_next(reader, r))
+        {
+            struct timespec time = timespec_ns_to_timespec(r->time);
+
+            if(timespec_ge(time, from) && timespec_le(time, to))
+            {
+                ++found_scan;
+            }
+        }
+    }
+    double scan_ns = ns_per_op(start, SCAN_QUERIES);
+
+    if(csv)
+    {
+        printf("records,append_ns_per_record,search_ns_per_query,scan_ns_per_query\n");
+        printf("%zu,%.3f,%.1f,%.1f\n", n, append_ns, search_ns, scan_ns);
+    }
+    else
+    {
+        printf("%10s %14s %16s %16s %10s\n", "records", "append ns/op", "search ns/query", "scan ns/query",
+            "speedup");
+        printf("%10zu %14.3f %16.1f %16.1f %9.0fx\n", n, append_ns, search_ns, scan_ns, scan_ns / search_ns);
+    }
+
+    if(found_search == 0 || found_scan == 0)
+    {
+        fprintf(stderr, "No records were found\n");
+    }
+
+    timespec_log_reader_close(reader);
+    timespec_log_writer_close(writer);
+    unlink(path);
+
+    return 0;
+}
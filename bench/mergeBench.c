@@ -0,0 +1,195 @@
+/**
+ * @file mergeBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares ways of merging sorted per-core streams of timestamped records into one timeline.
+ *
+ * Usage: timespec_merge_bench [--csv] [RECORDS]
+ *
+ * 16 streams of 32 byte records, RECORDS in total (default 4M), with interleaved timestamps, are merged by:
+ *
+ *   qsort       concatenating the streams and sorting the lot
+ *   linear      scanning every stream head for the earliest record
+ *   loser tree  timespec_merge_create_arrays() on one thread
+ *   parallel N  timespec_merge_parallel() with 2, 4, ... up to twice the online CPUs
+ *
+ * Throughput in millions of records per second is reported for each.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_merge.h>
+
+#define STREAMS 16
+
+struct record
+{
+    struct timespec time;
+    uint64_t payload[2];
+};
+
+static int compare_records(const void *a, const void *b)
+{
+    const struct record *x = a, *y = b;
+
+    return timespec_lt(x->time, y->time) ? -1 : timespec_gt(x->time, y->time);
+}
+
+static double seconds_since(struct timespec start)
+{
+    return timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+}
+
+static void merge_linear(struct record *out, const struct timespec_merge_input *inputs)
+{
+    size_t next[STREAMS] = { 0 };
+
+    for(;;)
+    {
+        const struct record *best = NULL;
+        size_t from = 0;
+
+        for(size_t i = 0; i < STREAMS; ++i)
+        {
+            const struct record *r = (const struct record*)(inputs[i].records) + next[i];
+
+            if(next[i] < inputs[i].count && (best == NULL || timespec_lt(r->time, best->time)))
+            {
+                best = r;
+                from = i;
+            }
+        }
+
+        if(best == NULL)
+        {
+            break;
+        }
+
+        *out++ = *best;
+        ++(next[from]);
+    }
+}
+
+static void merge_tree(struct record *out, const struct timespec_merge_input *inputs)
+{
+    struct timespec_merge *m = timespec_merge_create_arrays(inputs, STREAMS, sizeof(struct record),
+        offsetof(struct record, time), NULL, NULL);
+    const struct record *r;
+
+    while((r = timespec_merge_next(m, NULL)) != NULL)
+    {
+        *out++ = *r;
+    }
+
+    timespec_merge_destroy(m);
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 2 * (int)(sysconf(_SC_NPROCESSORS_ONLN));
+    size_t total = 4 << 20;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            total = (size_t)(atol(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [RECORDS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec_merge_input inputs[STREAMS];
+    struct record *all = malloc(total * sizeof(*all));
+    struct record *out = malloc(total * sizeof(*out));
+    unsigned int seed = 1;
+
+    /* Each core's stream advances by its own random steps. */
+    for(size_t i = 0; i < STREAMS; ++i)
+    {
+        struct record *records = all + i * (total / STREAMS);
+        timespec_ns t = 0;
+
+        inputs[i].records = records;
+        inputs[i].count = (i + 1 < STREAMS) ? total / STREAMS : total - i * (total / STREAMS);
+
+        for(size_t j = 0; j < inputs[i].count; ++j)
+        {
+            t += rand_r(&seed) % 2000;
+            records[j].time = timespec_ns_to_timespec(t);
+            records[j].payload[0] = i;
+            records[j].payload[1] = j;
+        }
+    }
+
+    if(csv)
+        printf("method,threads,records,mrecords_per_sec\n");
+    else
+        printf("%-12s %8s %12s %14s\n", "method", "threads", "records", "Mrecords/sec");
+
+    for(int method = 0; method < 3; ++method)
+    {
+        const char *names[] = { "qsort", "linear", "loser tree" };
+        struct timespec start = timespec_now(CLOCK_MONOTONIC);
+
+        if(method == 0)
+        {
+            memcpy(out, all, total * sizeof(*out));
+            qsort(out, total, sizeof(*out), compare_records);
+        }
+        else if(method == 1)
+        {
+            merge_linear(out, inputs);
+        }
+        else
+        {
+            merge_tree(out, inputs);
+        }
+
+        double rate = (double)(total) / seconds_since(start) / 1e6;
+
+        if(csv)
+            printf("%s,1,%zu,%.2f\n", names[method], total, rate);
+        else
+            printf("%-12s %8d %12zu %14.2f\n", names[method], 1, total, rate);
+    }
+
+    for(int n = 2; n <= max_threads; n = (n * 2 > max_threads && n < max_threads) ? max_threads : n * 2)
+    {
+        struct timespec start = timespec_now(CLOCK_MONOTONIC);
+
+        if(!timespec_merge_parallel(out, inputs, STREAMS, sizeof(struct record), offsetof(struct record, time),
+            (unsigned)(n)))
+        {
+            perror("timespec_merge_parallel");
+            return 1;
+        }
+
+        double rate = (double)(total) / seconds_since(start) / 1e6;
+
+        if(csv)
+            printf("parallel,%d,%zu,%.2f\n", n, total, rate);
+        else
+            printf("%-12s %8d %12zu %14.2f\n", "parallel", n, total, rate);
+    }
+
+    free(all);
+    free(out);
+
+    return 0;
+}
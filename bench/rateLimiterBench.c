@@ -0,0 +1,187 @@
+/**
+ * @file rateLimiterBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares the lock-free rate limiter in timespec_rate_limiter.h against a token bucket guarded by a mutex, as thread
+ * count grows.
+ *
+ * Usage: timespec_rate_limiter_bench [--csv] [MAX_THREADS]
+ *
+ * For 1, 2, 4, ... up to MAX_THREADS threads (default twice the online CPUs), every thread calls try_acquire on one
+ * shared limiter for half a second, reading the time from a cached clock. The limiter allows one token per
+ * nanosecond so most calls succeed and write, the worst case for contention. Total and per-thread throughput are
+ * reported for each implementation.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_rate_limiter.h>
+
+#define RUN_MS 500
+
+struct mutex_bucket
+{
+    pthread_mutex_t lock;
+    struct timespec last;
+    long tokens;
+    long burst;
+};
+
+/* The conventional implementation: refill from the time since the last call, under a lock. */
+static bool mutex_try_acquire(struct mutex_bucket *b, struct timespec now, long n)
+{
+    bool ok = false;
+
+    pthread_mutex_lock(&b->lock);
+
+    struct timespec elapsed = timespec_sub(now, b->last);
+    long refill = (long)(timespec_ns_from_timespec(elapsed));
+
+    if(refill > 0)
+    {
+        b->tokens = (b->tokens + refill > b->burst) ? b->burst : b->tokens + refill;
+        b->last = now;
+    }
+
+    if(b->tokens >= n)
+    {
+        b->tokens -= n;
+        ok = true;
+    }
+
+    pthread_mutex_unlock(&b->lock);
+
+    return ok;
+}
+
+static struct timespec_cached_clock *clock_cache;
+static struct timespec_rate_limiter limiter;
+static struct mutex_bucket bucket;
+static bool use_mutex;
+static bool stop;
+
+struct worker
+{
+    pthread_t thread;
+    long calls;
+    long granted;
+} __attribute__((aligned(64)));
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        for(int i = 0; i < 64; ++i)
+        {
+            bool ok = use_mutex
+                ? mutex_try_acquire(&bucket, timespec_cached_clock_now(clock_cache), 1)
+                : timespec_rate_limiter_try_acquire_ns(&limiter, timespec_cached_clock_now_ns(clock_cache), 1);
+
+            w->granted += ok;
+        }
+        w->calls += 64;
+    }
+
+    return NULL;
+}
+
+/* Returns the total calls per second made by nthreads threads. */
+static double run(int nthreads, bool mutex, double *granted)
+{
+    struct worker *workers = calloc((size_t)(nthreads), sizeof(*workers));
+    struct timespec now = timespec_cached_clock_now(clock_cache);
+    long calls = 0, ok = 0;
+
+    timespec_rate_limiter_init(&limiter, timespec_from_double(1e-9), 1000000, now);
+    pthread_mutex_init(&bucket.lock, NULL);
+    bucket.last = now;
+    bucket.tokens = bucket.burst = 1000000;
+
+    use_mutex = mutex;
+    stop = false;
+
+    for(int i = 0; i < nthreads; ++i)
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+
+    struct timespec until = timespec_add(timespec_now(CLOCK_MONOTONIC), timespec_from_ms(RUN_MS));
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+    {
+    }
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+    for(int i = 0; i < nthreads; ++i)
+    {
+        pthread_join(workers[i].thread, NULL);
+        calls += workers[i].calls;
+        ok += workers[i].granted;
+    }
+
+    pthread_mutex_destroy(&bucket.lock);
+    free(workers);
+
+    *granted = (calls > 0) ? (double)(ok) / (double)(calls) : 0;
+    return (double)(calls) * 1000.0 / RUN_MS;
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 2 * (int)(sysconf(_SC_NPROCESSORS_ONLN));
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atoi(argv[i]) > 0)
+        {
+            max_threads = atoi(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [MAX_THREADS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    clock_cache = timespec_cached_clock_create(CLOCK_MONOTONIC, TIMESPEC_CLOCK_TICKER, timespec_from_double(1e-5));
+    if(clock_cache == NULL)
+    {
+        perror("timespec_cached_clock_create");
+        return 1;
+    }
+
+    if(csv)
+        printf("threads,implementation,calls_per_sec,calls_per_sec_per_thread,granted\n");
+    else
+        printf("%-8s %-10s %16s %16s %8s\n", "threads", "impl", "calls/sec", "per thread", "granted");
+
+    for(int n = 1; n <= max_threads; n = (n * 2 > max_threads && n < max_threads) ? max_threads : n * 2)
+    {
+        for(int m = 0; m < 2; ++m)
+        {
+            double granted;
+            double rate = run(n, m == 1, &granted);
+            const char *name = (m == 1) ? "mutex" : "lock-free";
+
+            if(csv)
+                printf("%d,%s,%.0f,%.0f,%.3f\n", n, name, rate, rate / n, granted);
+            else
+                printf("%-8d %-10s %16.0f %16.0f %7.1f%%\n", n, name, rate, rate / n, granted * 100);
+        }
+    }
+
+    timespec_cached_clock_destroy(clock_cache);
+
+    return 0;
+}
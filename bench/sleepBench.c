@@ -0,0 +1,112 @@
+/**
+ * @file sleepBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Measures the wake-up jitter of timespec_periodic_wait() with spinning disabled, with the default slack and with a
+ * calibrated slack.
+ *
+ * Usage: timespec_sleep_bench [--csv] [ITERATIONS [PERIOD_US]]
+ *
+ * Each mode runs a periodic loop of ITERATIONS (default 2000) periods of PERIOD_US microseconds (default 1000) on
+ * CLOCK_MONOTONIC and records how late each wake-up was in a histogram. The percentiles of lateness are reported
+ * along with the CPU time the thread used, which shows the cost of spinning.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_histogram.h>
+#include <timespec_sleep.h>
+
+static const double percentiles[] = { 50, 90, 99, 99.9, 100 };
+
+#define PERCENTILES (sizeof(percentiles) / sizeof(*percentiles))
+
+static double us(struct timespec ts)
+{
+    return timespec_to_double(ts) * 1e6;
+}
+
+/* Runs the loop, returning the fraction of the elapsed time spent on the CPU. */
+static double run(struct timespec_histogram *h, long iterations, struct timespec period, uint64_t *overruns)
+{
+    struct timespec_periodic p;
+    struct timespec cpu_start = timespec_now(CLOCK_THREAD_CPUTIME_ID);
+    struct timespec start = timespec_now(CLOCK_MONOTONIC);
+
+    timespec_histogram_init(h);
+    timespec_periodic_init(&p, CLOCK_MONOTONIC, period);
+
+    for(long i = 0; i < iterations; ++i)
+    {
+        struct timespec deadline = p.next;
+
+        timespec_periodic_wait(&p);
+        timespec_histogram_record(h, timespec_sub(timespec_now(CLOCK_MONOTONIC), deadline));
+    }
+
+    *overruns = p.overruns;
+
+    struct timespec cpu = timespec_sub(timespec_now(CLOCK_THREAD_CPUTIME_ID), cpu_start);
+    return timespec_to_double(cpu) / timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = 2000;
+    long period_us = 1000;
+    int csv = 0, positional = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0 && positional < 2)
+        {
+            *(positional++ == 0 ? &iterations : &period_us) = atol(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [ITERATIONS [PERIOD_US]]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static struct timespec_histogram h;
+    struct timespec period = timespec_ns_to_timespec(period_us * 1000);
+    struct timespec default_slack = timespec_sleep_get_slack();
+
+    if(csv)
+        printf("mode,slack_us,p50_us,p90_us,p99_us,p99.9_us,max_us,cpu_percent,overruns\n");
+    else
+        printf("%-12s %10s %10s %10s %10s %10s %10s %8s %9s\n", "mode", "slack us",
+            "p50 us", "p90 us", "p99 us", "p99.9 us", "max us", "cpu", "overruns");
+
+    for(int mode = 0; mode < 3; ++mode)
+    {
+        static const char *names[] = { "sleep-only", "default", "calibrated" };
+
+        if(mode == 0)
+            timespec_sleep_set_slack(timespec_from_ms(0));
+        else if(mode == 1)
+            timespec_sleep_set_slack(default_slack);
+        else
+            timespec_sleep_calibrate(CLOCK_MONOTONIC, 200);
+
+        uint64_t overruns;
+        double cpu = run(&h, iterations, period, &overruns);
+
+        printf(csv ? "%s,%.3f" : "%-12s %10.3f", names[mode], us(timespec_sleep_get_slack()));
+        for(size_t i = 0; i < PERCENTILES; ++i)
+            printf(csv ? ",%.3f" : " %10.3f", us(timespec_histogram_percentile(&h, percentiles[i])));
+        printf(csv ? ",%.1f,%llu\n" : " %7.1f%% %9llu\n", cpu * 100, (unsigned long long)(overruns));
+    }
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file sortBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares sorting timespec arrays and timespec-keyed records with qsort() against timespec_sort.h.
+ *
+ * Usage: timespec_sort_bench [--csv] [N]
+ *
+ * N values (default 4M) spread over a day are sorted in three orders:
+ *
+ *   random    shuffled
+ *   jitter    capture order, with 1 in 50 values up to 100us late
+ *   sorted    already in order
+ *
+ * each as bare timespecs and as 32 byte records, by qsort() with a timespec_lt() comparator, by the serial radix
+ * sort, and by the parallel sort with 2, 4, ... up to twice the online CPUs. Millions of elements per second are
+ * reported for each.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_sort.h>
+
+struct record
+{
+    struct timespec time;
+    uint64_t payload[2];
+};
+
+static int compare_times(const void *a, const void *b)
+{
+    const struct timespec *x = a, *y = b;
+
+    return timespec_lt(*x, *y) ? -1 : timespec_gt(*x, *y);
+}
+
+static int compare_records(const void *a, const void *b)
+{
+    const struct record *x = a, *y = b;
+
+    return timespec_lt(x->time, y->time) ? -1 : timespec_gt(x->time, y->time);
+}
+
+static double seconds_since(struct timespec start)
+{
+    return timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+}
+
+static int next_threads(int n, int max_threads)
+{
+    return (n < 2) ? n + 1 : (n * 2 > max_threads && n < max_threads) ? max_threads : n * 2;
+}
+
+static void report(int csv, const char *order, const char *type, const char *method, int threads, size_t n,
+    double seconds)
+{
+    double rate = (double)(n) / seconds / 1e6;
+
+    if(csv)
+        printf("%s,%s,%s,%d,%zu,%.2f\n", order, type, method, threads, n, rate);
+    else
+        printf("%-8s %-8s %-10s %8d %10zu %12.2f\n", order, type, method, threads, n, rate);
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 2 * (int)(sysconf(_SC_NPROCESSORS_ONLN));
+    size_t n = 4 << 20;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            n = (size_t)(atol(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec *input = malloc(n * sizeof(*input));
+    struct timespec *times = malloc(n * sizeof(*times));
+    struct record *records = malloc(n * sizeof(*records));
+    timespec_ns start_ns = timespec_ns_from_timespec(timespec_now(CLOCK_REALTIME));
+    unsigned int seed = 1;
+
+    if(csv)
+        printf("order,type,method,threads,n,melements_per_sec\n");
+    else
+        printf("%-8s %-8s %-10s %8s %10s %12s\n", "order", "type", "method", "threads", "n", "Melem/sec");
+
+    for(int order = 0; order < 3; ++order)
+    {
+        const char *orders[] = { "random", "jitter", "sorted" };
+        timespec_ns step = 86400 * INT64_C(1000000000) / (timespec_ns)(n);
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            timespec_ns late = (order == 1 && rand_r(&seed) % 50 == 0) ? rand_r(&seed) % 100000 : 0;
+
+            input[i] = timespec_ns_to_timespec(start_ns + (timespec_ns)(i) * step - late);
+        }
+
+        for(size_t i = n - 1; order == 0 && i > 0; --i)
+        {
+            size_t j = (size_t)(rand_r(&seed)) % (i + 1);
+            struct timespec t = input[i];
+
+            input[i] = input[j];
+            input[j] = t;
+        }
+
+        for(int type = 0; type < 2; ++type)
+        {
+            const char *types[] = { "timespec", "record" };
+
+            /* 0 is qsort, 1 the serial sort and more the parallel sort. */
+            for(int threads = 0; threads <= max_threads; threads = next_threads(threads, max_threads))
+            {
+                for(size_t i = 0; i < n; ++i)
+                {
+                    times[i] = input[i];
+                    records[i].time = input[i];
+                    records[i].payload[0] = i;
+                }
+
+                struct timespec start = timespec_now(CLOCK_MONOTONIC);
+                const char *method = (threads == 0) ? "qsort" : (threads == 1) ? "radix" : "parallel";
+
+                if(threads == 0 && type == 0)
+                    qsort(times, n, sizeof(*times), compare_times);
+                else if(threads == 0)
+                    qsort(records, n, sizeof(*records), compare_records);
+                else if(threads == 1 && type == 0)
+                    timespec_sort(times, n);
+                else if(threads == 1)
+                    timespec_sort_records(records, n, sizeof(*records), offsetof(struct record, time));
+                else if(type == 0)
+                    timespec_sort_parallel(times, n, (unsigned)(threads));
+                else
+                    timespec_sort_records_parallel(records, n, sizeof(*records), offsetof(struct record, time),
+                        (unsigned)(threads));
+
+                report(csv, orders[order], types[type], method, (threads == 0) ? 1 : threads, n, seconds_since(start));
+
+                if((type == 0) ? timespec_sorted_until(times, n) != n
+                    : timespec_records_sorted_until(records, n, sizeof(*records), offsetof(struct record, time)) != n)
+                {
+                    fprintf(stderr, "%s %s %s: not sorted\n", orders[order], types[type], method);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    free(input);
+    free(times);
+    free(records);
+
+    return 0;
+}
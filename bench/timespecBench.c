@@ -0,0 +1,449 @@
+/**
+ * @file timespecBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Measures the per-call cost of every function in timespec.h over several input distributions, plus the clock readers
+ * in timespec_clock.h, tick conversion in timespec_converter.h and histogram recording. RFC 3339 formatting is also
+ * measured against gmtime_r() and strftime(), both with a new second for every call and with a run of calls from the
+ * same second, as when logging, and so is parsing timestamps of every precision and short durations such as "12.345ms".
+ *
+ * Usage: timespec_bench [--csv | --json] [--filter SUBSTRING] [--min-time MS]
+ *
+ * Each case runs its function over a block of pre-generated inputs until at least --min-time milliseconds have
+ * elapsed, then reports nanoseconds per call and calls per second. The default output is a table; --csv and --json
+ * produce machine-readable output for tracking results between releases.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_converter.h>
+#include <timespec_histogram.h>
+#include <time.h>
+
+#define ELEMENTS 4096
+
+struct bench_data
+{
+    struct timespec ts1[ELEMENTS];
+    struct timespec ts2[ELEMENTS];
+    struct timeval tv[ELEMENTS];
+    double dbl[ELEMENTS];
+    long ms[ELEMENTS];
+    timespec_ns ns1[ELEMENTS];
+    timespec_ns ns2[ELEMENTS];
+    char rfc3339[ELEMENTS][TIMESPEC_RFC3339_MAX];
+    char duration[ELEMENTS][32];
+};
+
+enum bench_dist
+{
+    DIST_NORMALISED   = 1 << 0, /* Normalised values, as returned by clock_gettime() */
+    DIST_MIXED_SIGN   = 1 << 1, /* tv_sec and tv_nsec of differing signs */
+    DIST_HUGE_NSEC    = 1 << 2, /* Whole seconds packed into tv_nsec, worst case for timespec_normalise() */
+    DIST_LARGE_DOUBLE = 1 << 3, /* Doubles far from zero with fractional parts */
+};
+
+#define DIST_ALL (DIST_NORMALISED | DIST_MIXED_SIGN | DIST_HUGE_NSEC | DIST_LARGE_DOUBLE)
+
+static const struct {
+    enum bench_dist dist;
+    const char *name;
+} dists[] = {
+    { DIST_NORMALISED,   "normalised"   },
+    { DIST_MIXED_SIGN,   "mixed_sign"   },
+    { DIST_HUGE_NSEC,    "huge_nsec"    },
+    { DIST_LARGE_DOUBLE, "large_double" },
+};
+
+static long random_range(long lo, long hi)
+{
+    unsigned long r = ((unsigned long)(rand()) << 31) ^ (unsigned long)(rand());
+    return lo + (long)(r % (unsigned long)(hi - lo + 1));
+}
+
+static void generate(struct bench_data *d, enum bench_dist dist)
+{
+    srand(1);
+
+    for(size_t i = 0; i < ELEMENTS; ++i)
+    {
+        struct timespec a, b;
+
+        switch(dist)
+        {
+            case DIST_MIXED_SIGN:
+                a.tv_sec  = random_range(-100000, 100000);
+                a.tv_nsec = random_range(-999999999, 999999999);
+                b.tv_sec  = random_range(-100000, 100000);
+                b.tv_nsec = random_range(-999999999, 999999999);
+                break;
+
+            case DIST_HUGE_NSEC:
+                a.tv_sec  = random_range(-100, 100);
+                a.tv_nsec = random_range(-3000000000000000L, 3000000000000000L);
+                b.tv_sec  = random_range(-100, 100);
+                b.tv_nsec = random_range(-3000000000000000L, 3000000000000000L);
+                break;
+
+            case DIST_LARGE_DOUBLE:
+                a.tv_sec  = random_range(-2000000000L, 2000000000L);
+                a.tv_nsec = random_range(-999999999, 999999999);
+                b.tv_sec  = random_range(-2000000000L, 2000000000L);
+                b.tv_nsec = random_range(-999999999, 999999999);
+                a = timespec_normalise(a);
+                b = timespec_normalise(b);
+                break;
+
+            default:
+                a.tv_sec  = random_range(0, 2000000000L);
+                a.tv_nsec = random_range(0, 999999999);
+                b.tv_sec  = random_range(0, 2000000000L);
+                b.tv_nsec = random_range(0, 999999999);
+                break;
+        }
+
+        d->ts1[i] = a;
+        d->ts2[i] = b;
+        d->tv[i].tv_sec  = a.tv_sec;
+        d->tv[i].tv_usec = (suseconds_t)(dist == DIST_HUGE_NSEC ? a.tv_nsec : a.tv_nsec / 1000);
+        d->dbl[i] = (dist == DIST_LARGE_DOUBLE)
+            ? timespec_to_double(a) : (double)(random_range(-1000000, 1000000)) / 1000;
+        d->ms[i]  = (dist == DIST_HUGE_NSEC) ? a.tv_nsec : random_range(-1000000000L, 1000000000L);
+        d->ns1[i] = timespec_ns_from_timespec(a);
+        d->ns2[i] = timespec_ns_from_timespec(b);
+
+        timespec_to_rfc3339(a, (int)(i % 10), d->rfc3339[i], sizeof(d->rfc3339[i]));
+        snprintf(d->duration[i], sizeof(d->duration[i]), "%ld.%03ld%s",
+            (long)(i % 1000), (long)(a.tv_nsec < 0 ? -a.tv_nsec : a.tv_nsec) % 1000, (i % 2) ? "ms" : "s");
+    }
+}
+
+static long sink_ts(struct timespec ts)
+{
+    return (long)(ts.tv_sec) ^ ts.tv_nsec;
+}
+
+static long sink_tv(struct timeval tv)
+{
+    return (long)(tv.tv_sec) ^ (long)(tv.tv_usec);
+}
+
+typedef long (*bench_fn)(const struct bench_data *d);
+
+#define BENCH(name, expr) \
+    static long bench_##name(const struct bench_data *d) \
+    { \
+        long acc = 0; \
+        (void)(d); \
+        for(size_t i = 0; i < ELEMENTS; ++i) \
+            acc += (long)(expr); \
+        return acc; \
+    }
+
+BENCH(add,                sink_ts(timespec_add(d->ts1[i], d->ts2[i])))
+BENCH(sub,                sink_ts(timespec_sub(d->ts1[i], d->ts2[i])))
+BENCH(add_normalised,     sink_ts(timespec_add_normalised(d->ts1[i], d->ts2[i])))
+BENCH(sub_normalised,     sink_ts(timespec_sub_normalised(d->ts1[i], d->ts2[i])))
+BENCH(eq,                 timespec_eq(d->ts1[i], d->ts2[i]))
+BENCH(gt,                 timespec_gt(d->ts1[i], d->ts2[i]))
+BENCH(ge,                 timespec_ge(d->ts1[i], d->ts2[i]))
+BENCH(lt,                 timespec_lt(d->ts1[i], d->ts2[i]))
+BENCH(le,                 timespec_le(d->ts1[i], d->ts2[i]))
+BENCH(cmp,                timespec_cmp(d->ts1[i], d->ts2[i]))
+BENCH(from_double,        sink_ts(timespec_from_double(d->dbl[i])))
+BENCH(to_double,          timespec_to_double(d->ts1[i]))
+BENCH(from_timeval,       sink_ts(timespec_from_timeval(d->tv[i])))
+BENCH(to_timeval,         sink_tv(timespec_to_timeval(d->ts1[i])))
+BENCH(from_ms,            sink_ts(timespec_from_ms(d->ms[i])))
+BENCH(to_ms,              timespec_to_ms(d->ts1[i]))
+BENCH(normalise,          sink_ts(timespec_normalise(d->ts1[i])))
+BENCH(ns_add,             timespec_ns_add(d->ns1[i], d->ns2[i]))
+BENCH(ns_sub,             timespec_ns_sub(d->ns1[i], d->ns2[i]))
+BENCH(ns_from_timespec,   timespec_ns_from_timespec(d->ts1[i]))
+BENCH(ns_to_timespec,     sink_ts(timespec_ns_to_timespec(d->ns1[i])))
+BENCH(ns_from_double,     timespec_ns_from_double(d->dbl[i]))
+BENCH(ns_to_double,       timespec_ns_to_double(d->ns1[i]))
+BENCH(ns_from_timeval,    timespec_ns_from_timeval(d->tv[i]))
+BENCH(ns_to_timeval,      sink_tv(timespec_ns_to_timeval(d->ns1[i])))
+BENCH(ns_from_ms,         timespec_ns_from_ms(d->ms[i]))
+BENCH(ns_to_ms,           timespec_ns_to_ms(d->ns1[i]))
+
+static struct timespec_cached_clock *ticker_clock;
+static struct timespec_cached_clock *coarse_clock;
+
+BENCH(now,                sink_ts(timespec_now(CLOCK_MONOTONIC)))
+BENCH(cached_ticker,      sink_ts(timespec_cached_clock_now(ticker_clock)))
+BENCH(cached_ticker_ns,   timespec_cached_clock_now_ns(ticker_clock))
+BENCH(cached_coarse,      sink_ts(timespec_cached_clock_now(coarse_clock)))
+
+static struct timespec_converter converter;
+
+/* The same conversion as timespec_converter_to_ticks() using hardware division by a divisor only known at run time. */
+static long divide_to_ticks(struct timespec ts)
+{
+    static volatile int64_t rate[2] = { 90000, 1 };
+    int64_t num = rate[0], den = rate[1];
+    int64_t s = ts.tv_sec * num;
+
+    return (long)(s / den + ((s % den) * 1000000000 + ts.tv_nsec * num) / (den * 1000000000));
+}
+
+BENCH(mul,                sink_ts(timespec_mul(d->ts1[i], d->ms[i])))
+BENCH(div,                sink_ts(timespec_div(d->ts1[i], d->ms[i] | 1)))
+BENCH(scale,              sink_ts(timespec_scale(d->ts1[i], 1001, 30000)))
+BENCH(to_ticks,           timespec_converter_to_ticks(&converter, d->ts1[i]))
+BENCH(to_ticks_divide,    divide_to_ticks(d->ts1[i]))
+BENCH(from_ticks,         sink_ts(timespec_converter_from_ticks(&converter, d->ns1[i] / 1000)))
+
+static long bench_to_ticks_array(const struct bench_data *d)
+{
+    static int64_t ticks[ELEMENTS];
+
+    timespec_converter_to_ticks_array(&converter, ticks, d->ts1, ELEMENTS);
+    return (long)(ticks[0]);
+}
+
+static struct timespec_histogram histogram;
+
+BENCH(histogram_record,   (timespec_histogram_record(&histogram, d->ts1[i]), 0))
+BENCH(histogram_record_ns, (timespec_histogram_record_ns(&histogram, d->ns1[i]), 0))
+
+static long rfc3339(struct timespec ts)
+{
+    char buf[TIMESPEC_RFC3339_MAX];
+
+    return (long)(timespec_to_rfc3339(ts, 6, buf, sizeof(buf))) + buf[18];
+}
+
+static long rfc3339_strftime(struct timespec ts)
+{
+    char buf[TIMESPEC_RFC3339_MAX];
+    struct tm tm;
+
+    gmtime_r(&ts.tv_sec, &tm);
+    size_t len = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    len += (size_t)(snprintf(buf + len, sizeof(buf) - len, ".%06ldZ", ts.tv_nsec / 1000));
+
+    return (long)(len) + buf[18];
+}
+
+static struct timespec same_second(const struct bench_data *d, size_t i)
+{
+    struct timespec ts = { .tv_sec = d->ts1[0].tv_sec, .tv_nsec = d->ts1[i].tv_nsec };
+    return ts;
+}
+
+BENCH(rfc3339,                  rfc3339(d->ts1[i]))
+BENCH(rfc3339_same_second,      rfc3339(same_second(d, i)))
+BENCH(rfc3339_strftime,         rfc3339_strftime(d->ts1[i]))
+BENCH(rfc3339_strftime_same_second, rfc3339_strftime(same_second(d, i)))
+
+static long parse(size_t (*fn)(const char *, size_t, struct timespec *), const char *str)
+{
+    struct timespec ts = { 0, 0 };
+
+    return (long)(fn(str, strlen(str), &ts)) + sink_ts(ts);
+}
+
+BENCH(parse_rfc3339,            parse(timespec_parse_rfc3339, d->rfc3339[i]))
+BENCH(parse_duration,           parse(timespec_parse_duration, d->duration[i]))
+
+/* Formats the whole block in one call; the time is still reported per timestamp. */
+static long bench_rfc3339_array(const struct bench_data *d)
+{
+    static char buf[ELEMENTS * (TIMESPEC_RFC3339_LEN(6) + 1)];
+
+    return (long)(timespec_to_rfc3339_array(d->ts1, ELEMENTS, 6, buf, sizeof(buf))) + buf[18];
+}
+
+static const struct {
+    const char *name;
+    bench_fn fn;
+    unsigned dists;
+} cases[] = {
+    { "timespec_add",              bench_add,              DIST_ALL        },
+    { "timespec_sub",              bench_sub,              DIST_ALL        },
+    { "timespec_add_normalised",   bench_add_normalised,   DIST_NORMALISED },
+    { "timespec_sub_normalised",   bench_sub_normalised,   DIST_NORMALISED },
+    { "timespec_eq",               bench_eq,               DIST_ALL        },
+    { "timespec_gt",               bench_gt,               DIST_ALL        },
+    { "timespec_ge",               bench_ge,               DIST_ALL        },
+    { "timespec_lt",               bench_lt,               DIST_ALL        },
+    { "timespec_le",               bench_le,               DIST_ALL        },
+    { "timespec_cmp",              bench_cmp,              DIST_ALL        },
+    { "timespec_from_double",      bench_from_double,      DIST_NORMALISED | DIST_LARGE_DOUBLE },
+    { "timespec_to_double",        bench_to_double,        DIST_ALL        },
+    { "timespec_from_timeval",     bench_from_timeval,     DIST_ALL        },
+    { "timespec_to_timeval",       bench_to_timeval,       DIST_ALL        },
+    { "timespec_from_ms",          bench_from_ms,          DIST_NORMALISED | DIST_HUGE_NSEC },
+    { "timespec_to_ms",            bench_to_ms,            DIST_ALL        },
+    { "timespec_normalise",        bench_normalise,        DIST_ALL        },
+    { "timespec_ns_add",           bench_ns_add,           DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_ns_sub",           bench_ns_sub,           DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_ns_from_timespec", bench_ns_from_timespec, DIST_ALL        },
+    { "timespec_ns_to_timespec",   bench_ns_to_timespec,   DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_ns_from_double",   bench_ns_from_double,   DIST_NORMALISED | DIST_LARGE_DOUBLE },
+    { "timespec_ns_to_double",     bench_ns_to_double,     DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_ns_from_timeval",  bench_ns_from_timeval,  DIST_ALL        },
+    { "timespec_ns_to_timeval",    bench_ns_to_timeval,    DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_ns_from_ms",       bench_ns_from_ms,       DIST_NORMALISED | DIST_HUGE_NSEC },
+    { "timespec_ns_to_ms",         bench_ns_to_ms,         DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_now",              bench_now,              DIST_NORMALISED },
+    { "timespec_cached_clock_now(ticker)",    bench_cached_ticker,    DIST_NORMALISED },
+    { "timespec_cached_clock_now_ns(ticker)", bench_cached_ticker_ns, DIST_NORMALISED },
+    { "timespec_cached_clock_now(coarse)",    bench_cached_coarse,    DIST_NORMALISED },
+    { "timespec_mul",              bench_mul,              DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_div",              bench_div,              DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_scale",            bench_scale,            DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_converter_to_ticks(90kHz)",       bench_to_ticks,         DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_converter_to_ticks_array(90kHz)", bench_to_ticks_array,   DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "hardware divide to ticks(90kHz)",          bench_to_ticks_divide,  DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_converter_from_ticks(90kHz)",     bench_from_ticks,       DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_histogram_record",    bench_histogram_record,    DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_histogram_record_ns", bench_histogram_record_ns, DIST_NORMALISED | DIST_MIXED_SIGN },
+    { "timespec_to_rfc3339",                    bench_rfc3339,                      DIST_NORMALISED },
+    { "timespec_to_rfc3339(same second)",       bench_rfc3339_same_second,          DIST_NORMALISED },
+    { "timespec_to_rfc3339_array",              bench_rfc3339_array,                DIST_NORMALISED },
+    { "gmtime_r+strftime",                      bench_rfc3339_strftime,             DIST_NORMALISED },
+    { "gmtime_r+strftime(same second)",         bench_rfc3339_strftime_same_second, DIST_NORMALISED },
+    { "timespec_parse_rfc3339",                 bench_parse_rfc3339,                DIST_NORMALISED },
+    { "timespec_parse_duration",                bench_parse_duration,               DIST_NORMALISED },
+};
+
+enum output_format
+{
+    OUTPUT_TABLE,
+    OUTPUT_CSV,
+    OUTPUT_JSON,
+};
+
+static double elapsed_s(struct timespec start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_to_double(timespec_sub(now, start));
+}
+
+/* Runs fn repeatedly for at least min_time seconds, returning nanoseconds per call. */
+static double run_case(bench_fn fn, const struct bench_data *d, double min_time, long *calls, long *sink)
+{
+    struct timespec start;
+    long reps = 0;
+    double elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        *sink += fn(d);
+        ++reps;
+    } while((elapsed = elapsed_s(start)) < min_time);
+
+    *calls = reps * ELEMENTS;
+    return elapsed * 1e9 / (double)(*calls);
+}
+
+int main(int argc, char **argv)
+{
+    static struct bench_data data;
+    enum output_format format = OUTPUT_TABLE;
+    const char *filter = NULL;
+    double min_time = 0.05;
+    long sink = 0;
+    int first = 1;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            format = OUTPUT_CSV;
+        }
+        else if(strcmp(argv[i], "--json") == 0)
+        {
+            format = OUTPUT_JSON;
+        }
+        else if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if(strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            min_time = atof(argv[++i]) / 1000;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv | --json] [--filter SUBSTRING] [--min-time MS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    timespec_histogram_init(&histogram);
+    timespec_converter_init(&converter, 90000, 1);
+    ticker_clock = timespec_cached_clock_create(CLOCK_MONOTONIC, TIMESPEC_CLOCK_TICKER, timespec_from_ms(1));
+    coarse_clock = timespec_cached_clock_create(CLOCK_MONOTONIC, TIMESPEC_CLOCK_COARSE, timespec_from_ms(0));
+    if(ticker_clock == NULL || coarse_clock == NULL)
+    {
+        perror("timespec_cached_clock_create");
+        return 1;
+    }
+
+    switch(format)
+    {
+        case OUTPUT_CSV:
+            printf("function,distribution,calls,ns_per_op,ops_per_sec\n");
+            break;
+        case OUTPUT_JSON:
+            printf("{\"version\":\"%s\",\"results\":[", TIMESPEC_BENCH_VERSION);
+            break;
+        default:
+            printf("%-38s %-14s %12s %14s\n", "function", "distribution", "ns/op", "ops/sec");
+            break;
+    }
+
+    for(size_t di = 0; di < sizeof(dists) / sizeof(*dists); ++di)
+    {
+        generate(&data, dists[di].dist);
+
+        for(size_t ci = 0; ci < sizeof(cases) / sizeof(*cases); ++ci)
+        {
+            if(!(cases[ci].dists & dists[di].dist) || (filter != NULL && strstr(cases[ci].name, filter) == NULL))
+            {
+                continue;
+            }
+
+            long calls;
+            double ns = run_case(cases[ci].fn, &data, min_time, &calls, &sink);
+
+            switch(format)
+            {
+                case OUTPUT_CSV:
+                    printf("%s,%s,%ld,%.3f,%.0f\n", cases[ci].name, dists[di].name, calls, ns, 1e9 / ns);
+                    break;
+                case OUTPUT_JSON:
+                    printf("%s\n{\"function\":\"%s\",\"distribution\":\"%s\",\"calls\":%ld,"
+                        "\"ns_per_op\":%.3f,\"ops_per_sec\":%.0f}",
+                        first ? "" : ",", cases[ci].name, dists[di].name, calls, ns, 1e9 / ns);
+                    break;
+                default:
+                    printf("%-38s %-14s %12.3f %14.0f\n", cases[ci].name, dists[di].name, ns, 1e9 / ns);
+                    break;
+            }
+            first = 0;
+        }
+    }
+
+    if(format == OUTPUT_JSON)
+    {
+        printf("\n]}\n");
+    }
+
+    timespec_cached_clock_destroy(ticker_clock);
+    timespec_cached_clock_destroy(coarse_clock);
+
+    /* Keep the results live so the calls cannot be optimised away. */
+    return (sink == 42);
+}
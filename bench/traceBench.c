@@ -0,0 +1,227 @@
+/**
+ * @file traceBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Measures the cost of tracing a span with timespec_trace.h.
+ *
+ * Usage: timespec_trace_bench [--csv] [MAX_THREADS]
+ *
+ * The first table reports nanoseconds per span on one thread for:
+ *
+ *   clock pair  reading the clock at both ends, the least any timing can cost
+ *   trace       timespec_trace_begin() and timespec_trace_end(), draining every 4096 spans
+ *   scope       the same through TIMESPEC_TRACE_SCOPE()
+ *   disabled    timespec_trace_begin() and timespec_trace_end() on a NULL trace
+ *   fprintf     reading the clock at both ends and printing the duration to /dev/null
+ *
+ * The second has 1, 2, 4, ... up to MAX_THREADS threads (default twice the online CPUs) trace spans for half a
+ * second while a collector thread drains every millisecond, and reports spans per second and the fraction dropped.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_trace.h>
+
+#define RUN_MS 500
+#define SPANS  (1 << 20)
+#define EVENTS (1 << 14)
+
+static struct timespec_trace *trace;
+static bool stop;
+
+struct worker
+{
+    pthread_t thread;
+    long spans;
+} __attribute__((aligned(64)));
+
+static double seconds_since(struct timespec start)
+{
+    return timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+}
+
+static void traced(struct timespec_trace *t, volatile int *sink)
+{
+    TIMESPEC_TRACE_SCOPE(t, "scope");
+    ++(*sink);
+}
+
+/* Returns the nanoseconds per span of one method. */
+static double single(int method, FILE *null)
+{
+    struct timespec_trace *t = (method == 3) ? NULL : trace;
+    volatile int sink = 0;
+    struct timespec start = timespec_now(CLOCK_MONOTONIC);
+
+    for(int i = 0; i < SPANS; ++i)
+    {
+        if(method == 0)
+        {
+            struct timespec begin = timespec_now(CLOCK_MONOTONIC);
+            ++sink;
+            sink += (int)(timespec_now(CLOCK_MONOTONIC).tv_nsec - begin.tv_nsec);
+        }
+        else if(method == 1 || method == 3)
+        {
+            timespec_trace_begin(t, "span");
+            ++sink;
+            timespec_trace_end(t);
+        }
+        else if(method == 2)
+        {
+            traced(t, &sink);
+        }
+        else
+        {
+            struct timespec begin = timespec_now(CLOCK_MONOTONIC);
+            ++sink;
+            fprintf(null, "span %.9f\n", timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), begin)));
+        }
+
+        if((i & 4095) == 4095)
+        {
+            timespec_trace_drain(trace, NULL, NULL);
+        }
+    }
+
+    return seconds_since(start) * 1e9 / SPANS;
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+
+    timespec_trace_name_thread(trace, "worker");
+
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        for(int i = 0; i < 64; ++i)
+        {
+            timespec_trace_begin(trace, "span");
+            timespec_trace_end(trace);
+        }
+        w->spans += 64;
+    }
+
+    return NULL;
+}
+
+static void *collector_main(void *arg)
+{
+    struct timespec ms = timespec_from_ms(1);
+
+    (void)(arg);
+
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        timespec_trace_drain(trace, NULL, NULL);
+        nanosleep(&ms, NULL);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 2 * (int)(sysconf(_SC_NPROCESSORS_ONLN));
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atoi(argv[i]) > 0)
+        {
+            max_threads = atoi(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [MAX_THREADS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    FILE *null = fopen("/dev/null", "w");
+
+    trace = timespec_trace_create(CLOCK_MONOTONIC, EVENTS);
+    if(trace == NULL || null == NULL)
+    {
+        perror("timespec_trace_create");
+        return 1;
+    }
+
+    if(csv)
+        printf("method,ns_per_span\n");
+    else
+        printf("%-12s %12s\n", "method", "ns/span");
+
+    for(int method = 0; method < 5; ++method)
+    {
+        const char *names[] = { "clock pair", "trace", "scope", "disabled", "fprintf" };
+        double ns = single(method, null);
+
+        if(csv)
+            printf("%s,%.1f\n", names[method], ns);
+        else
+            printf("%-12s %12.1f\n", names[method], ns);
+    }
+
+    fclose(null);
+    timespec_trace_destroy(trace);
+
+    if(csv)
+        printf("\nthreads,spans_per_sec,spans_per_sec_per_thread,dropped_fraction\n");
+    else
+        printf("\n%-8s %16s %16s %10s\n", "threads", "spans/sec", "per thread", "dropped");
+
+    for(int n = 1; n <= max_threads; n = (n * 2 > max_threads && n < max_threads) ? max_threads : n * 2)
+    {
+        struct worker *workers = calloc((size_t)(n), sizeof(*workers));
+        pthread_t collector;
+        long spans = 0;
+
+        trace = timespec_trace_create(CLOCK_MONOTONIC, EVENTS);
+        stop = false;
+
+        for(int i = 0; i < n; ++i)
+        {
+            pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+        }
+        pthread_create(&collector, NULL, collector_main, NULL);
+
+        struct timespec until = timespec_add(timespec_now(CLOCK_MONOTONIC), timespec_from_ms(RUN_MS));
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+        {
+        }
+        __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+        for(int i = 0; i < n; ++i)
+        {
+            pthread_join(workers[i].thread, NULL);
+            spans += workers[i].spans;
+        }
+        pthread_join(collector, NULL);
+
+        double rate = (double)(spans) * 1000.0 / RUN_MS;
+        double dropped = (double)(timespec_trace_dropped(trace)) / (double)(spans);
+
+        if(csv)
+            printf("%d,%.0f,%.0f,%.4f\n", n, rate, rate / n, dropped);
+        else
+            printf("%-8d %16.0f %16.0f %9.2f%%\n", n, rate, rate / n, dropped * 100.0);
+
+        timespec_trace_destroy(trace);
+        free(workers);
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file tscBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Measures the cost and error of the calibrated cycle counter in timespec_tsc.h against clock_gettime().
+ *
+ * Usage: timespec_tsc_bench [--csv] [SECONDS]
+ *
+ * First the cost of each way of reading the time is reported in ns per call. Then, for SECONDS (default 2) each, with
+ * and without background recalibration every 100ms, the converted time is compared with CLOCK_MONOTONIC every 10ms
+ * and the mean and largest errors reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_tsc.h>
+
+#define READS 10000000
+
+static struct timespec_tsc *tsc;
+static volatile timespec_ns sink;
+
+static double ns_per_op(struct timespec start, long ops)
+{
+    struct timespec elapsed = timespec_sub(timespec_now(CLOCK_MONOTONIC), start);
+
+    return (double)(timespec_ns_from_timespec(elapsed)) / (double)(ops);
+}
+
+/* Returns the converted time less the midpoint of two surrounding clock reads. */
+static timespec_ns error_now(void)
+{
+    timespec_ns best_window = INT64_MAX, error = 0;
+
+    for(int i = 0; i < 5; ++i)
+    {
+        timespec_ns before = timespec_ns_from_timespec(timespec_now(CLOCK_MONOTONIC));
+        timespec_ns t = timespec_tsc_to_ns(tsc, timespec_tsc_cycles(tsc));
+        timespec_ns after = timespec_ns_from_timespec(timespec_now(CLOCK_MONOTONIC));
+
+        if(after - before < best_window)
+        {
+            best_window = after - before;
+            error = t - (before + (after - before) / 2);
+        }
+    }
+
+    return error;
+}
+
+int main(int argc, char **argv)
+{
+    long seconds = 2;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            seconds = atol(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [SECONDS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec zero = { .tv_sec = 0, .tv_nsec = 0 };
+
+    tsc = timespec_tsc_create(CLOCK_MONOTONIC, zero);
+    if(tsc == NULL)
+    {
+        fprintf(stderr, "Could not calibrate the counter\n");
+        return 1;
+    }
+
+    if(!csv)
+    {
+        printf("Counter %s, calibrated at %.6f GHz\n\n", timespec_tsc_fallback(tsc) ? "unavailable, reading the clock"
+            : "invariant", timespec_tsc_frequency(tsc) / 1e9);
+    }
+
+    /* Cost */
+
+    static const char *methods[] = { "clock_gettime", "tsc_cycles", "tsc_to_ns", "tsc_now" };
+    double cost[4];
+    uint64_t cycles = timespec_tsc_cycles(tsc);
+    struct timespec ts, t;
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(long i = 0; i < READS; ++i)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        sink = ts.tv_nsec;
+    }
+    cost[0] = ns_per_op(t, READS);
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(long i = 0; i < READS; ++i)
+    {
+        sink = (timespec_ns)(timespec_tsc_cycles(tsc));
+    }
+    cost[1] = ns_per_op(t, READS);
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(long i = 0; i < READS; ++i)
+    {
+        sink = timespec_tsc_to_ns(tsc, cycles + (uint64_t)(i));
+    }
+    cost[2] = ns_per_op(t, READS);
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(long i = 0; i < READS; ++i)
+    {
+        sink = timespec_tsc_now(tsc).tv_nsec;
+    }
+    cost[3] = ns_per_op(t, READS);
+
+    if(csv)
+        printf("method,ns_per_call\n");
+    else
+        printf("%-14s %12s\n", "method", "ns/call");
+
+    for(int i = 0; i < 4; ++i)
+    {
+        if(csv)
+            printf("%s,%.3f\n", methods[i], cost[i]);
+        else
+            printf("%-14s %12.3f\n", methods[i], cost[i]);
+    }
+
+    timespec_tsc_destroy(tsc);
+
+    /* Error */
+
+    if(csv)
+        printf("\nrecalibration,samples,mean_error_ns,max_error_ns\n");
+    else
+        printf("\n%-14s %8s %14s %14s\n", "recalibration", "samples", "mean error ns", "max error ns");
+
+    for(int mode = 0; mode < 2; ++mode)
+    {
+        tsc = timespec_tsc_create(CLOCK_MONOTONIC, mode == 0 ? zero : timespec_from_ms(100));
+
+        long samples = seconds * 100;
+        double total = 0;
+        timespec_ns worst = 0;
+        struct timespec next = timespec_now(CLOCK_MONOTONIC);
+
+        for(long i = 0; i < samples; ++i)
+        {
+            next = timespec_add(next, timespec_from_ms(10));
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+            timespec_ns error = error_now();
+            timespec_ns magnitude = (error < 0) ? -error : error;
+
+            total += (double)(magnitude);
+            if(magnitude > worst)
+            {
+                worst = magnitude;
+            }
+        }
+
+        if(csv)
+            printf("%s,%ld,%.1f,%lld\n", mode == 0 ? "none" : "100ms", samples, total / (double)(samples),
+                (long long)(worst));
+        else
+            printf("%-14s %8ld %14.1f %14lld\n", mode == 0 ? "none" : "100ms", samples, total / (double)(samples),
+                (long long)(worst));
+
+        timespec_tsc_destroy(tsc);
+    }
+
+    return 0;
+}
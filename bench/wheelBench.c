@@ -0,0 +1,237 @@
+/**
+ * @file wheelBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares the timing wheel in timespec_wheel.h against a binary heap ordered by timespec_lt().
+ *
+ * Usage: timespec_wheel_bench [--csv] [TIMERS]
+ *
+ * TIMERS timers (default 1000000) are armed with deadlines spread over ten seconds, half of them are cancelled, and
+ * time is then advanced in 1ms steps until the rest have expired. Each phase is reported in ns per timer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_wheel.h>
+
+#define SPAN_MS 10000
+
+struct heap_timer
+{
+    struct timespec deadline;
+    size_t index;
+};
+
+struct heap
+{
+    struct heap_timer **items;
+    size_t count;
+};
+
+static void heap_swap(struct heap *h, size_t a, size_t b)
+{
+    struct heap_timer *t = h->items[a];
+
+    h->items[a] = h->items[b];
+    h->items[b] = t;
+    h->items[a]->index = a;
+    h->items[b]->index = b;
+}
+
+static void heap_up(struct heap *h, size_t i)
+{
+    while(i > 0 && timespec_lt(h->items[i]->deadline, h->items[(i - 1) / 2]->deadline))
+    {
+        heap_swap(h, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_down(struct heap *h, size_t i)
+{
+    for(;;)
+    {
+        size_t smallest = i;
+        size_t l = 2 * i + 1;
+        size_t r = 2 * i + 2;
+
+        if(l < h->count && timespec_lt(h->items[l]->deadline, h->items[smallest]->deadline))
+            smallest = l;
+        if(r < h->count && timespec_lt(h->items[r]->deadline, h->items[smallest]->deadline))
+            smallest = r;
+        if(smallest == i)
+            return;
+
+        heap_swap(h, i, smallest);
+        i = smallest;
+    }
+}
+
+static void heap_push(struct heap *h, struct heap_timer *t)
+{
+    t->index = h->count;
+    h->items[h->count++] = t;
+    heap_up(h, t->index);
+}
+
+static void heap_remove(struct heap *h, struct heap_timer *t)
+{
+    size_t i = t->index;
+
+    if(i != --(h->count))
+    {
+        heap_swap(h, i, h->count);
+        heap_up(h, i);
+        heap_down(h, i);
+    }
+}
+
+static size_t heap_advance(struct heap *h, struct timespec now)
+{
+    size_t expired = 0;
+
+    while(h->count > 0 && timespec_le(h->items[0]->deadline, now))
+    {
+        heap_remove(h, h->items[0]);
+        ++expired;
+    }
+
+    return expired;
+}
+
+static size_t wheel_expired;
+
+static void wheel_callback(struct timespec_timer *timer)
+{
+    (void)(timer);
+    ++wheel_expired;
+}
+
+static double ns_per_op(struct timespec start, size_t ops)
+{
+    struct timespec elapsed = timespec_sub(timespec_now(CLOCK_MONOTONIC), start);
+
+    return (double)(timespec_ns_from_timespec(elapsed)) / (double)(ops);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atol(argv[i]) > 0)
+        {
+            n = (size_t)(atol(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [TIMERS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec origin = { .tv_sec = 0, .tv_nsec = 0 };
+    struct timespec *deadlines = malloc(n * sizeof(*deadlines));
+    struct timespec_timer *wheel_timers = malloc(n * sizeof(*wheel_timers));
+    struct heap_timer *heap_timers = malloc(n * sizeof(*heap_timers));
+    struct heap heap = { malloc(n * sizeof(*heap.items)), 0 };
+    struct timespec_wheel *wheel = timespec_wheel_create(origin, timespec_from_ms(1));
+
+    if(deadlines == NULL || wheel_timers == NULL || heap_timers == NULL || heap.items == NULL || wheel == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    for(size_t i = 0; i < n; ++i)
+    {
+        deadlines[i] = timespec_ns_to_timespec((timespec_ns)(rand() % SPAN_MS) * 1000000 + rand() % 1000000);
+        timespec_timer_init(&wheel_timers[i], wheel_callback);
+    }
+
+    double wheel_ns[3], heap_ns[3];
+    size_t heap_expired = 0;
+    struct timespec t;
+
+    /* Insert */
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(size_t i = 0; i < n; ++i)
+        timespec_wheel_add(wheel, &wheel_timers[i], deadlines[i]);
+    wheel_ns[0] = ns_per_op(t, n);
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(size_t i = 0; i < n; ++i)
+    {
+        heap_timers[i].deadline = deadlines[i];
+        heap_push(&heap, &heap_timers[i]);
+    }
+    heap_ns[0] = ns_per_op(t, n);
+
+    /* Cancel every other timer */
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(size_t i = 0; i < n; i += 2)
+        timespec_wheel_cancel(wheel, &wheel_timers[i]);
+    wheel_ns[1] = ns_per_op(t, (n + 1) / 2);
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(size_t i = 0; i < n; i += 2)
+        heap_remove(&heap, &heap_timers[i]);
+    heap_ns[1] = ns_per_op(t, (n + 1) / 2);
+
+    /* Expire the rest in 1ms steps */
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(long ms = 1; ms <= SPAN_MS + 1; ++ms)
+        timespec_wheel_advance(wheel, timespec_from_ms(ms));
+    wheel_ns[2] = ns_per_op(t, n - (n + 1) / 2);
+
+    t = timespec_now(CLOCK_MONOTONIC);
+    for(long ms = 1; ms <= SPAN_MS + 1; ++ms)
+        heap_expired += heap_advance(&heap, timespec_from_ms(ms));
+    heap_ns[2] = ns_per_op(t, n - (n + 1) / 2);
+
+    if(wheel_expired != n - (n + 1) / 2 || heap_expired != wheel_expired)
+    {
+        fprintf(stderr, "Expired %zu timers from the wheel and %zu from the heap, expected %zu\n",
+            wheel_expired, heap_expired, n - (n + 1) / 2);
+        return 1;
+    }
+
+    static const char *phases[] = { "insert", "cancel", "expire" };
+
+    if(csv)
+        printf("phase,timers,wheel_ns_per_op,heap_ns_per_op\n");
+    else
+        printf("%-8s %10s %16s %16s %10s\n", "phase", "timers", "wheel ns/op", "heap ns/op", "speedup");
+
+    for(int i = 0; i < 3; ++i)
+    {
+        if(csv)
+            printf("%s,%zu,%.3f,%.3f\n", phases[i], n, wheel_ns[i], heap_ns[i]);
+        else
+            printf("%-8s %10zu %16.3f %16.3f %9.2fx\n", phases[i], n, wheel_ns[i], heap_ns[i],
+                heap_ns[i] / wheel_ns[i]);
+    }
+
+    timespec_wheel_destroy(wheel);
+    free(heap.items);
+    free(heap_timers);
+    free(wheel_timers);
+    free(deadlines);
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+/**
+ * @file windowBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares the sliding window counter in timespec_window.h against keeping every timestamp in a queue and evicting
+ * those older than the window, and per-thread windows against one window shared under a mutex.
+ *
+ * Usage: timespec_window_bench [--csv] [MAX_THREADS]
+ *
+ * The first table records two simulated seconds of events at several rates, querying the count over the last second
+ * after every event, and reports the cost per event and the memory held by each method. The second has 1, 2, 4, ...
+ * up to MAX_THREADS threads (default twice the online CPUs) record for half a second at the time of a cached clock,
+ * either into their own window or into one shared window, and reports total and per-thread throughput.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_window.h>
+
+#define RUN_MS  500
+#define BUCKETS 100
+
+/* 100 buckets round up to 128 slots of 16 bytes each. */
+#define WINDOW_BYTES (128 * 16)
+
+/* The conventional implementation: a growable ring of timestamps. */
+struct timestamp_queue
+{
+    struct timespec *times;
+    size_t head;
+    size_t count;
+    size_t capacity;
+};
+
+static void queue_push(struct timestamp_queue *q, struct timespec ts)
+{
+    if(q->count == q->capacity)
+    {
+        size_t capacity = q->capacity ? q->capacity * 2 : 64;
+        struct timespec *times = malloc(capacity * sizeof(*times));
+
+        for(size_t i = 0; i < q->count; ++i)
+        {
+            times[i] = q->times[(q->head + i) % q->capacity];
+        }
+
+        free(q->times);
+        q->times = times;
+        q->head = 0;
+        q->capacity = capacity;
+    }
+
+    q->times[(q->head + q->count++) % q->capacity] = ts;
+}
+
+static size_t queue_count(struct timestamp_queue *q, struct timespec now, struct timespec window)
+{
+    struct timespec from = timespec_sub(now, window);
+
+    while(q->count > 0 && !timespec_lt(from, q->times[q->head]))
+    {
+        q->head = (q->head + 1) % q->capacity;
+        --(q->count);
+    }
+
+    return q->count;
+}
+
+static double seconds_since(struct timespec start)
+{
+    return timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+}
+
+static struct timespec_cached_clock *clock_cache;
+static struct timespec_window *shared_window;
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool use_mutex;
+static bool stop;
+
+struct worker
+{
+    pthread_t thread;
+    struct timespec_window *window;
+    long records;
+} __attribute__((aligned(64)));
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        for(int i = 0; i < 64; ++i)
+        {
+            timespec_ns now = timespec_cached_clock_now_ns(clock_cache);
+
+            if(use_mutex)
+            {
+                pthread_mutex_lock(&shared_lock);
+                timespec_window_record_ns(shared_window, now, 1);
+                pthread_mutex_unlock(&shared_lock);
+            }
+            else
+            {
+                timespec_window_record_ns(w->window, now, 1);
+            }
+        }
+        w->records += 64;
+    }
+
+    return NULL;
+}
+
+/* Returns the total records per second made by nthreads threads. */
+static double run(int nthreads, bool mutex)
+{
+    struct timespec width = timespec_from_ms(10);
+    struct worker *workers = calloc((size_t)(nthreads), sizeof(*workers));
+    long records = 0;
+
+    shared_window = timespec_window_create(width, BUCKETS);
+    use_mutex = mutex;
+    stop = false;
+
+    for(int i = 0; i < nthreads; ++i)
+    {
+        workers[i].window = timespec_window_create(width, BUCKETS);
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+
+    struct timespec until = timespec_add(timespec_now(CLOCK_MONOTONIC), timespec_from_ms(RUN_MS));
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+    {
+    }
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+    struct timespec_window *merged = timespec_window_create(width, BUCKETS);
+
+    for(int i = 0; i < nthreads; ++i)
+    {
+        pthread_join(workers[i].thread, NULL);
+        records += workers[i].records;
+        timespec_window_merge(merged, workers[i].window);
+        timespec_window_destroy(workers[i].window);
+    }
+
+    timespec_window_destroy(merged);
+    timespec_window_destroy(shared_window);
+    free(workers);
+
+    return (double)(records) * 1000.0 / RUN_MS;
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 2 * (int)(sysconf(_SC_NPROCESSORS_ONLN));
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atoi(argv[i]) > 0)
+        {
+            max_threads = atoi(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [MAX_THREADS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct timespec second = { .tv_sec = 1, .tv_nsec = 0 };
+    long rates[] = { 1000, 100000, 1000000 };
+
+    if(csv)
+        printf("events_per_sec,implementation,ns_per_event,bytes\n");
+    else
+        printf("%-14s %-10s %14s %14s\n", "events/sec", "impl", "ns/event", "bytes");
+
+    for(size_t r = 0; r < sizeof(rates) / sizeof(*rates); ++r)
+    {
+        struct timespec step = timespec_div(second, rates[r]);
+        struct timespec t = { .tv_sec = 0, .tv_nsec = 0 };
+        struct timespec_window *w = timespec_window_create(timespec_div(second, BUCKETS), BUCKETS);
+        struct timestamp_queue q = { NULL, 0, 0, 0 };
+        volatile uint64_t sink = 0;
+        size_t bytes = 0;
+
+        /* Run for two simulated seconds so the queue reaches its steady size. */
+        struct timespec start = timespec_now(CLOCK_MONOTONIC);
+        for(long i = 0; i < 2 * rates[r]; ++i)
+        {
+            timespec_ns t_ns = i * 1000000000 / rates[r];
+
+            timespec_window_record_ns(w, t_ns, 1);
+            sink += timespec_window_sum_ns(w, t_ns, 1000000000);
+        }
+        double window_s = seconds_since(start);
+
+        start = timespec_now(CLOCK_MONOTONIC);
+        for(long i = 0; i < 2 * rates[r]; ++i, t = timespec_add(t, step))
+        {
+            queue_push(&q, t);
+            sink += queue_count(&q, t, second);
+            bytes = (q.capacity * sizeof(*q.times) > bytes) ? q.capacity * sizeof(*q.times) : bytes;
+        }
+        double queue_s = seconds_since(start);
+
+        const char *names[] = { "window", "queue" };
+        double times[] = { window_s, queue_s };
+        size_t sizes[] = { WINDOW_BYTES, bytes };
+
+        for(int m = 0; m < 2; ++m)
+        {
+            double per_event = times[m] * 1e9 / (double)(2 * rates[r]);
+
+            if(csv)
+                printf("%ld,%s,%.1f,%zu\n", rates[r], names[m], per_event, sizes[m]);
+            else
+                printf("%-14ld %-10s %14.1f %14zu\n", rates[r], names[m], per_event, sizes[m]);
+        }
+
+        free(q.times);
+        timespec_window_destroy(w);
+    }
+
+    clock_cache = timespec_cached_clock_create(CLOCK_MONOTONIC, TIMESPEC_CLOCK_TICKER, timespec_from_double(1e-5));
+    if(clock_cache == NULL)
+    {
+        perror("timespec_cached_clock_create");
+        return 1;
+    }
+
+    if(csv)
+        printf("\nthreads,implementation,records_per_sec,records_per_sec_per_thread\n");
+    else
+        printf("\n%-8s %-10s %16s %16s\n", "threads", "impl", "records/sec", "per thread");
+
+    for(int n = 1; n <= max_threads; n = (n * 2 > max_threads && n < max_threads) ? max_threads : n * 2)
+    {
+        for(int m = 0; m < 2; ++m)
+        {
+            double rate = run(n, m == 1);
+            const char *name = (m == 1) ? "mutex" : "sharded";
+
+            if(csv)
+                printf("%d,%s,%.0f,%.0f\n", n, name, rate, rate / n);
+            else
+                printf("%-8d %-10s %16.0f %16.0f\n", n, name, rate, rate / n);
+        }
+    }
+
+    timespec_cached_clock_destroy(clock_cache);
+
+    return 0;
+}
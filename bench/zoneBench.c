@@ -0,0 +1,143 @@
+/**
+ * @file zoneBench.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Compares converting times to local time with localtime_r() against timespec_zone.h.
+ *
+ * Usage: timespec_zone_bench [--csv] [MAX_THREADS]
+ *
+ * 1, 2, 4, ... up to MAX_THREADS threads (default twice the online CPUs) each convert 1M random times from the
+ * decade after 2020 to America/New_York time, by:
+ *
+ *   localtime_r      localtime_r() with TZ set to the zone
+ *   timespec_zone    timespec_zone_to_local() on a zone shared by all the threads
+ *
+ * and millions of conversions per second across all threads are reported for each.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_zone.h>
+
+#define CONVERSIONS (1 << 20)
+#define ZONE        "America/New_York"
+
+static struct timespec_zone *zone;
+static struct timespec times[CONVERSIONS];
+
+struct worker
+{
+    pthread_t thread;
+    bool use_zone;
+    long sum;
+};
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    struct timespec_local local;
+    struct tm tm;
+
+    for(int i = 0; i < CONVERSIONS; ++i)
+    {
+        if(w->use_zone)
+        {
+            timespec_zone_to_local(zone, times[i], &local);
+            w->sum += local.tm.tm_hour;
+        }
+        else
+        {
+            localtime_r(&times[i].tv_sec, &tm);
+            w->sum += tm.tm_hour;
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 2 * (int)(sysconf(_SC_NPROCESSORS_ONLN));
+    int csv = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(atoi(argv[i]) > 0)
+        {
+            max_threads = atoi(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [MAX_THREADS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    zone = timespec_zone_load(ZONE);
+    if(zone == NULL)
+    {
+        perror("timespec_zone_load");
+        return 1;
+    }
+
+    setenv("TZ", ":" ZONE, 1);
+    tzset();
+
+    unsigned int seed = 1;
+
+    for(int i = 0; i < CONVERSIONS; ++i)
+    {
+        times[i].tv_sec = 1577836800 + ((time_t)(rand_r(&seed)) << 15 | rand_r(&seed)) % (3653 * 86400);
+        times[i].tv_nsec = rand_r(&seed) % 1000000000;
+    }
+
+    struct worker *workers = calloc((size_t)(max_threads), sizeof(*workers));
+
+    if(csv)
+        printf("method,threads,mconversions_per_sec\n");
+    else
+        printf("%-16s %8s %16s\n", "method", "threads", "Mconv/sec");
+
+    for(int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        for(int method = 0; method < 2; ++method)
+        {
+            const char *name = (method == 0) ? "localtime_r" : "timespec_zone";
+            struct timespec start = timespec_now(CLOCK_MONOTONIC);
+
+            for(int i = 0; i < threads; ++i)
+            {
+                workers[i].use_zone = method == 1;
+                pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+            }
+            for(int i = 0; i < threads; ++i)
+            {
+                pthread_join(workers[i].thread, NULL);
+            }
+
+            double seconds = timespec_to_double(timespec_sub(timespec_now(CLOCK_MONOTONIC), start));
+            double rate = (double)(threads) * CONVERSIONS / seconds / 1e6;
+
+            if(csv)
+                printf("%s,%d,%.2f\n", name, threads, rate);
+            else
+                printf("%-16s %8d %16.2f\n", name, threads, rate);
+        }
+    }
+
+    free(workers);
+    timespec_zone_destroy(zone);
+
+    return 0;
+}
@@ -31,30 +31,82 @@
 #define DAN_TIMESPEC_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <sys/time.h>
 #include <time.h>
 
+/* Define TIMESPEC_INLINE before including this header to have every function
+ * defined static inline in the including translation unit instead of being
+ * called in the timespec library. Semantics are identical in both modes.
+*/
+#ifdef TIMESPEC_INLINE
+#define TIMESPEC_API static inline
+#else
+#define TIMESPEC_API
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-struct timespec timespec_add(struct timespec ts1, struct timespec ts2);
-struct timespec timespec_sub(struct timespec ts1, struct timespec ts2);
+/* Signed count of nanoseconds, covering roughly +/-292 years. */
+typedef int64_t timespec_ns;
+
+#define TIMESPEC_NS_MAX INT64_MAX
+#define TIMESPEC_NS_MIN INT64_MIN
+
+/* Length of an RFC 3339 timestamp with the given number of fractional digits,
+ * and the buffer size needed for any precision including the NUL.
+*/
+#define TIMESPEC_RFC3339_LEN(precision) ((size_t)(20 + ((precision) > 0 ? (precision) + 1 : 0)))
+#define TIMESPEC_RFC3339_MAX 31
 
-bool timespec_eq(struct timespec ts1, struct timespec ts2);
-bool timespec_gt(struct timespec ts1, struct timespec ts2);
-bool timespec_ge(struct timespec ts1, struct timespec ts2);
-bool timespec_lt(struct timespec ts1, struct timespec ts2);
-bool timespec_le(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API struct timespec timespec_add(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API struct timespec timespec_sub(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API struct timespec timespec_add_normalised(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API struct timespec timespec_sub_normalised(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API struct timespec timespec_mul(struct timespec ts, int64_t n);
+TIMESPEC_API struct timespec timespec_div(struct timespec ts, int64_t d);
+TIMESPEC_API struct timespec timespec_scale(struct timespec ts, int64_t num, int64_t den);
 
-struct timespec timespec_from_double(double s);
-double timespec_to_double(struct timespec ts);
-struct timespec timespec_from_timeval(struct timeval tv);
-struct timeval timespec_to_timeval(struct timespec ts);
-struct timespec timespec_from_ms(long milliseconds);
-long timespec_to_ms(struct timespec ts);
+TIMESPEC_API bool timespec_eq(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API bool timespec_gt(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API bool timespec_ge(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API bool timespec_lt(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API bool timespec_le(struct timespec ts1, struct timespec ts2);
+TIMESPEC_API int timespec_cmp(struct timespec ts1, struct timespec ts2);
 
-struct timespec timespec_normalise(struct timespec ts);
+TIMESPEC_API struct timespec timespec_from_double(double s);
+TIMESPEC_API double timespec_to_double(struct timespec ts);
+TIMESPEC_API struct timespec timespec_from_timeval(struct timeval tv);
+TIMESPEC_API struct timeval timespec_to_timeval(struct timespec ts);
+TIMESPEC_API struct timespec timespec_from_ms(long milliseconds);
+TIMESPEC_API long timespec_to_ms(struct timespec ts);
+TIMESPEC_API size_t timespec_to_rfc3339(struct timespec ts, int precision, char *buf, size_t len);
+TIMESPEC_API size_t timespec_to_rfc3339_array(const struct timespec *ts, size_t n, int precision, char *buf,
+	size_t len);
+TIMESPEC_API size_t timespec_parse_rfc3339(const char *str, size_t len, struct timespec *ts);
+TIMESPEC_API size_t timespec_parse_duration(const char *str, size_t len, struct timespec *ts);
+
+TIMESPEC_API struct timespec timespec_normalise(struct timespec ts);
+
+TIMESPEC_API timespec_ns timespec_ns_add(timespec_ns ns1, timespec_ns ns2);
+TIMESPEC_API timespec_ns timespec_ns_sub(timespec_ns ns1, timespec_ns ns2);
+
+TIMESPEC_API timespec_ns timespec_ns_from_timespec(struct timespec ts);
+TIMESPEC_API struct timespec timespec_ns_to_timespec(timespec_ns ns);
+TIMESPEC_API timespec_ns timespec_ns_from_double(double s);
+TIMESPEC_API double timespec_ns_to_double(timespec_ns ns);
+TIMESPEC_API timespec_ns timespec_ns_from_timeval(struct timeval tv);
+TIMESPEC_API struct timeval timespec_ns_to_timeval(timespec_ns ns);
+TIMESPEC_API timespec_ns timespec_ns_from_ms(long milliseconds);
+TIMESPEC_API long timespec_ns_to_ms(timespec_ns ns);
+
+#ifdef TIMESPEC_INLINE
+#include "timespec_impl.h"
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,299 @@
+/**
+ * @file timespec.hpp
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * A C++ value type over struct timespec.
+ *
+ * Everything here is constexpr and defined in this header, so expressions over
+ * constant intervals fold at compile time and nothing calls into the timespec
+ * library. Values are always held normalised according to the rules in
+ * timespec_normalise(), with the same results bit for bit, so they compare
+ * and convert exactly like the C functions.
+*/
+
+#ifndef DAN_TIMESPEC_HPP
+#define DAN_TIMESPEC_HPP
+
+#if __cplusplus < 201402L
+#error "timespec.hpp requires C++14 or later"
+#endif
+
+#include <chrono>
+#include <sys/time.h>
+#include <time.h>
+
+#if __cplusplus > 201703L && defined(__cpp_impl_three_way_comparison)
+#include <compare>
+#define TIMESPEC_THREE_WAY_COMPARISON
+#endif
+
+#include "timespec.h"
+
+namespace dan
+{
+
+class timespec_value
+{
+public:
+	/** \fn constexpr timespec_value::timespec_value()
+	 *  \brief Constructs a zero interval.
+	*/
+	constexpr timespec_value() : sec_(0), nsec_(0)
+	{
+	}
+
+	/** \fn constexpr timespec_value::timespec_value(time_t sec, long nsec)
+	 *  \brief Constructs a value from seconds and nanoseconds, normalising it.
+	*/
+	constexpr timespec_value(time_t sec, long nsec) : sec_(sec), nsec_(nsec)
+	{
+		normalise();
+	}
+
+	/** \fn constexpr timespec_value::timespec_value(const struct timespec &ts)
+	 *  \brief Converts a timespec, normalising it.
+	*/
+	constexpr timespec_value(const struct timespec &ts) : timespec_value(ts.tv_sec, ts.tv_nsec)
+	{
+	}
+
+	/** \fn constexpr timespec_value::timespec_value(std::chrono::duration<Rep, Period> d)
+	 *  \brief Converts a std::chrono duration.
+	 *
+	 * Durations finer than a nanosecond are truncated towards zero.
+	*/
+	template<class Rep, class Period>
+	constexpr timespec_value(std::chrono::duration<Rep, Period> d) :
+		sec_(static_cast<time_t>(std::chrono::duration_cast<std::chrono::seconds>(d).count())),
+		nsec_(static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			d - std::chrono::duration_cast<std::chrono::seconds>(d)).count()))
+	{
+	}
+
+	/** \fn constexpr timespec_value::timespec_value(std::chrono::time_point<Clock, Duration> tp)
+	 *  \brief Converts a std::chrono time point to the time since its clock's epoch.
+	 *
+	 * With libstdc++ and libc++ system_clock shares its epoch with
+	 * CLOCK_REALTIME and steady_clock with CLOCK_MONOTONIC.
+	*/
+	template<class Clock, class Duration>
+	constexpr timespec_value(std::chrono::time_point<Clock, Duration> tp) : timespec_value(tp.time_since_epoch())
+	{
+	}
+
+	/** \fn static constexpr timespec_value timespec_value::from_timeval(const struct timeval &tv)
+	 *  \brief Converts a timeval, as timespec_from_timeval() does.
+	*/
+	static constexpr timespec_value from_timeval(const struct timeval &tv)
+	{
+		return timespec_value(tv.tv_sec, static_cast<long>(tv.tv_usec) * 1000);
+	}
+
+	/** \fn static constexpr timespec_value timespec_value::from_ns(timespec_ns ns)
+	 *  \brief Converts a timespec_ns, as timespec_ns_to_timespec() does.
+	*/
+	static constexpr timespec_value from_ns(timespec_ns ns)
+	{
+		return timespec_value(static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000));
+	}
+
+	constexpr time_t sec() const
+	{
+		return sec_;
+	}
+
+	constexpr long nsec() const
+	{
+		return nsec_;
+	}
+
+	/** \fn constexpr struct timespec timespec_value::to_timespec() const
+	 *  \brief Returns the value as a normalised timespec.
+	*/
+	constexpr struct timespec to_timespec() const
+	{
+		struct timespec ts{};
+
+		ts.tv_sec  = sec_;
+		ts.tv_nsec = nsec_;
+
+		return ts;
+	}
+
+	/* Lets a value be passed straight to the C API. */
+	constexpr operator struct timespec() const
+	{
+		return to_timespec();
+	}
+
+	/** \fn constexpr struct timeval timespec_value::to_timeval() const
+	 *  \brief Returns the value as a timeval, as timespec_to_timeval() does.
+	*/
+	constexpr struct timeval to_timeval() const
+	{
+		struct timeval tv{};
+
+		tv.tv_sec  = sec_;
+		tv.tv_usec = static_cast<suseconds_t>(nsec_ / 1000);
+
+		return tv;
+	}
+
+	/** \fn constexpr timespec_ns timespec_value::to_ns() const
+	 *  \brief Returns the value as a timespec_ns, as timespec_ns_from_timespec() does.
+	 *
+	 * Values outside the range of timespec_ns saturate.
+	*/
+	constexpr timespec_ns to_ns() const
+	{
+		timespec_ns r = 0;
+
+		if(__builtin_mul_overflow(static_cast<timespec_ns>(sec_), timespec_ns(1000000000), &r)
+			|| __builtin_add_overflow(r, static_cast<timespec_ns>(nsec_), &r))
+		{
+			return (sec_ < 0) ? TIMESPEC_NS_MIN : TIMESPEC_NS_MAX;
+		}
+
+		return r;
+	}
+
+	/** \fn constexpr Duration timespec_value::to_duration() const
+	 *  \brief Returns the value as a std::chrono duration, truncated towards zero.
+	*/
+	template<class Duration = std::chrono::nanoseconds>
+	constexpr Duration to_duration() const
+	{
+		return std::chrono::duration_cast<Duration>(std::chrono::seconds(sec_))
+			+ std::chrono::duration_cast<Duration>(std::chrono::nanoseconds(nsec_));
+	}
+
+	/** \fn constexpr std::chrono::time_point<Clock, Duration> timespec_value::to_time_point() const
+	 *  \brief Returns the time point this far after the epoch of Clock.
+	*/
+	template<class Clock, class Duration = typename Clock::duration>
+	constexpr std::chrono::time_point<Clock, Duration> to_time_point() const
+	{
+		return std::chrono::time_point<Clock, Duration>(to_duration<Duration>());
+	}
+
+	constexpr timespec_value &operator+=(const timespec_value &ts)
+	{
+		sec_  += ts.sec_;
+		nsec_ += ts.nsec_;
+		normalise_carry();
+
+		return *this;
+	}
+
+	constexpr timespec_value &operator-=(const timespec_value &ts)
+	{
+		sec_  -= ts.sec_;
+		nsec_ -= ts.nsec_;
+		normalise_carry();
+
+		return *this;
+	}
+
+	friend constexpr timespec_value operator+(timespec_value ts1, const timespec_value &ts2)
+	{
+		return ts1 += ts2;
+	}
+
+	friend constexpr timespec_value operator-(timespec_value ts1, const timespec_value &ts2)
+	{
+		return ts1 -= ts2;
+	}
+
+	/* Negating both fields of a normalised value leaves it normalised. */
+	friend constexpr timespec_value operator-(const timespec_value &ts)
+	{
+		timespec_value r;
+
+		r.sec_  = -ts.sec_;
+		r.nsec_ = -ts.nsec_;
+
+		return r;
+	}
+
+	/* Normalised values order by seconds and then nanoseconds, as in
+	 * timespec_lt() and friends.
+	*/
+	friend constexpr bool operator==(const timespec_value &ts1, const timespec_value &ts2)
+	{
+		return ts1.sec_ == ts2.sec_ && ts1.nsec_ == ts2.nsec_;
+	}
+
+	friend constexpr bool operator!=(const timespec_value &ts1, const timespec_value &ts2)
+	{
+		return !(ts1 == ts2);
+	}
+
+	friend constexpr bool operator<(const timespec_value &ts1, const timespec_value &ts2)
+	{
+		return ts1.sec_ < ts2.sec_ || (ts1.sec_ == ts2.sec_ && ts1.nsec_ < ts2.nsec_);
+	}
+
+	friend constexpr bool operator<=(const timespec_value &ts1, const timespec_value &ts2)
+	{
+		return !(ts2 < ts1);
+	}
+
+	friend constexpr bool operator>(const timespec_value &ts1, const timespec_value &ts2)
+	{
+		return ts2 < ts1;
+	}
+
+	friend constexpr bool operator>=(const timespec_value &ts1, const timespec_value &ts2)
+	{
+		return !(ts1 < ts2);
+	}
+
+#ifdef TIMESPEC_THREE_WAY_COMPARISON
+	friend constexpr std::strong_ordering operator<=>(const timespec_value &ts1, const timespec_value &ts2)
+	{
+		return (ts1.sec_ != ts2.sec_) ? (ts1.sec_ <=> ts2.sec_) : (ts1.nsec_ <=> ts2.nsec_);
+	}
+#endif
+
+private:
+	time_t sec_;
+	long nsec_;
+
+	/* The same steps as timespec_normalise(): flatten surplus nanoseconds
+	 * into seconds, then give tv_nsec the sign of tv_sec.
+	*/
+	constexpr void normalise()
+	{
+		sec_  += nsec_ / 1000000000;
+		nsec_  = nsec_ % 1000000000;
+		fix_sign();
+	}
+
+	/* timespec_normalise_carry(), for the sum or difference of two
+	 * normalised values.
+	*/
+	constexpr void normalise_carry()
+	{
+		long over  = (nsec_ >= 1000000000);
+		long under = (nsec_ <= -1000000000);
+
+		sec_  += over - under;
+		nsec_ -= (over - under) * 1000000000;
+		fix_sign();
+	}
+
+	constexpr void fix_sign()
+	{
+		long borrow = (nsec_ < 0 && sec_ > 0);
+		long carry  = (nsec_ > 0 && sec_ < 0);
+
+		sec_  += carry - borrow;
+		nsec_ += (borrow - carry) * 1000000000;
+	}
+};
+
+} /* namespace dan */
+
+#endif /* !DAN_TIMESPEC_HPP */
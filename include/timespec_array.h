@@ -0,0 +1,39 @@
+/**
+ * @file timespec_array.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_ARRAY_H
+#define DAN_TIMESPEC_ARRAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum timespec_array_impl
+{
+	TIMESPEC_ARRAY_SCALAR,
+	TIMESPEC_ARRAY_SSE2,
+	TIMESPEC_ARRAY_AVX2,
+};
+
+void timespec_add_array(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset);
+void timespec_sub_array(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset);
+void timespec_diff_array(struct timespec *out, const struct timespec *ts1, const struct timespec *ts2, size_t n);
+void timespec_lt_mask(uint64_t *mask, const struct timespec *in, size_t n, struct timespec threshold);
+
+enum timespec_array_impl timespec_array_get_impl(void);
+bool timespec_array_set_impl(enum timespec_array_impl impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_ARRAY_H */
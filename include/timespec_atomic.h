@@ -0,0 +1,44 @@
+/**
+ * @file timespec_atomic.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_ATOMIC_H
+#define DAN_TIMESPEC_ATOMIC_H
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct timespec_atomic
+{
+	/* Aligned so that 32-bit targets can still access it in one operation. */
+	timespec_ns ns __attribute__((aligned(8)));
+};
+
+void timespec_atomic_init(struct timespec_atomic *a, struct timespec ts);
+
+struct timespec timespec_atomic_load(const struct timespec_atomic *a);
+timespec_ns timespec_atomic_load_ns(const struct timespec_atomic *a);
+void timespec_atomic_store(struct timespec_atomic *a, struct timespec ts);
+void timespec_atomic_store_ns(struct timespec_atomic *a, timespec_ns ns);
+
+struct timespec timespec_atomic_exchange(struct timespec_atomic *a, struct timespec ts);
+bool timespec_atomic_compare_exchange(struct timespec_atomic *a, struct timespec *expected, struct timespec desired);
+
+struct timespec timespec_atomic_fetch_max(struct timespec_atomic *a, struct timespec ts);
+struct timespec timespec_atomic_fetch_min(struct timespec_atomic *a, struct timespec ts);
+struct timespec timespec_atomic_fetch_add(struct timespec_atomic *a, struct timespec duration);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_ATOMIC_H */
@@ -0,0 +1,41 @@
+/**
+ * @file timespec_clock.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_CLOCK_H
+#define DAN_TIMESPEC_CLOCK_H
+
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum timespec_clock_mode
+{
+	TIMESPEC_CLOCK_TICKER, /* Background thread publishes the time every resolution */
+	TIMESPEC_CLOCK_COARSE, /* Read the kernel's CLOCK_*_COARSE equivalent of the clock */
+};
+
+struct timespec_cached_clock;
+
+struct timespec timespec_now(clockid_t clock);
+
+struct timespec_cached_clock *timespec_cached_clock_create(clockid_t clock, enum timespec_clock_mode mode,
+	struct timespec resolution);
+void timespec_cached_clock_destroy(struct timespec_cached_clock *cc);
+
+struct timespec timespec_cached_clock_now(const struct timespec_cached_clock *cc);
+timespec_ns timespec_cached_clock_now_ns(const struct timespec_cached_clock *cc);
+struct timespec timespec_cached_clock_staleness(const struct timespec_cached_clock *cc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_CLOCK_H */
@@ -0,0 +1,47 @@
+/**
+ * @file timespec_codec.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_CODEC_H
+#define DAN_TIMESPEC_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default number of timestamps per independently decodable block. */
+#define TIMESPEC_CODEC_BLOCK_SIZE 1024
+
+struct timespec_codec;
+
+struct timespec_codec *timespec_codec_create(uint32_t block_size);
+struct timespec_codec *timespec_codec_load(const void *buf, size_t len);
+void timespec_codec_destroy(struct timespec_codec *codec);
+
+bool timespec_codec_append(struct timespec_codec *codec, struct timespec ts);
+bool timespec_codec_append_ns(struct timespec_codec *codec, timespec_ns ns);
+
+const void *timespec_codec_data(const struct timespec_codec *codec, size_t *len);
+size_t timespec_codec_count(const struct timespec_codec *codec);
+size_t timespec_codec_blocks(const struct timespec_codec *codec);
+
+size_t timespec_codec_decode_block(const struct timespec_codec *codec, size_t block, struct timespec *out);
+size_t timespec_codec_decode_block_ns(const struct timespec_codec *codec, size_t block, timespec_ns *out);
+size_t timespec_codec_decode(const struct timespec_codec *codec, size_t first, struct timespec *out, size_t n);
+bool timespec_codec_get(const struct timespec_codec *codec, size_t index, struct timespec *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_CODEC_H */
@@ -0,0 +1,58 @@
+/**
+ * @file timespec_converter.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_CONVERTER_H
+#define DAN_TIMESPEC_CONVERTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Precomputed reciprocal of a fixed divisor. */
+struct timespec_reciprocal
+{
+	uint64_t divisor;
+	uint64_t mult;
+	unsigned shift;
+};
+
+/* Converts between timespecs and ticks of a clock running at a fixed rate,
+ * such as microseconds, a 90kHz media clock or CPU cycles. Initialise it with
+ * timespec_converter_init(); afterwards it is read-only and may be shared
+ * between threads. The fields are private.
+*/
+struct timespec_converter
+{
+	uint64_t num;
+	uint64_t den;
+	struct timespec_reciprocal by_num;
+	struct timespec_reciprocal by_den;
+	struct timespec_reciprocal by_den_ns;
+};
+
+bool timespec_converter_init(struct timespec_converter *conv, uint32_t num, uint32_t den);
+
+int64_t timespec_converter_to_ticks(const struct timespec_converter *conv, struct timespec ts);
+struct timespec timespec_converter_from_ticks(const struct timespec_converter *conv, int64_t ticks);
+
+void timespec_converter_to_ticks_array(const struct timespec_converter *conv, int64_t *out,
+	const struct timespec *in, size_t n);
+void timespec_converter_from_ticks_array(const struct timespec_converter *conv, struct timespec *out,
+	const int64_t *in, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_CONVERTER_H */
@@ -0,0 +1,64 @@
+/**
+ * @file timespec_histogram.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_HISTOGRAM_H
+#define DAN_TIMESPEC_HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Each power of two is split into 2^SUB_BITS buckets, giving a relative error
+ * below 1/128. Durations of 2^MAX_BITS ns (about 4.9 hours) or more share the
+ * top bucket, although the exact maximum is still kept.
+*/
+#define TIMESPEC_HISTOGRAM_SUB_BITS 7
+#define TIMESPEC_HISTOGRAM_MAX_BITS 44
+#define TIMESPEC_HISTOGRAM_BUCKETS \
+	((TIMESPEC_HISTOGRAM_MAX_BITS - TIMESPEC_HISTOGRAM_SUB_BITS + 1) << TIMESPEC_HISTOGRAM_SUB_BITS)
+
+/* Upper bound on the size of a serialised histogram. */
+#define TIMESPEC_HISTOGRAM_SERIALISED_MAX (32 + TIMESPEC_HISTOGRAM_BUCKETS * 12)
+
+/* Fixed-size latency histogram. May be allocated statically or per-thread;
+ * initialise it with timespec_histogram_init(). The fields are private.
+*/
+struct timespec_histogram
+{
+	uint64_t min;
+	uint64_t max;
+	uint64_t counts[TIMESPEC_HISTOGRAM_BUCKETS];
+};
+
+void timespec_histogram_init(struct timespec_histogram *h);
+
+void timespec_histogram_record(struct timespec_histogram *h, struct timespec duration);
+void timespec_histogram_record_ns(struct timespec_histogram *h, timespec_ns duration);
+
+void timespec_histogram_merge(struct timespec_histogram *dst, const struct timespec_histogram *src);
+void timespec_histogram_drain(struct timespec_histogram *dst, struct timespec_histogram *src);
+
+uint64_t timespec_histogram_count(const struct timespec_histogram *h);
+struct timespec timespec_histogram_min(const struct timespec_histogram *h);
+struct timespec timespec_histogram_max(const struct timespec_histogram *h);
+struct timespec timespec_histogram_percentile(const struct timespec_histogram *h, double percentile);
+
+size_t timespec_histogram_serialise(const struct timespec_histogram *h, void *buf, size_t len);
+bool timespec_histogram_deserialise(struct timespec_histogram *h, const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_HISTOGRAM_H */
@@ -0,0 +1,1126 @@
+/* Functions for working with timespec structures
+ * Written by Daniel Collins (2017)
+ * 
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+*/
+
+/** \file timespec_impl.h
+ *  \brief Definitions of the functions declared in timespec.h.
+ *
+ * This file is compiled into the timespec library by timespec.c, or included
+ * directly by timespec.h when TIMESPEC_INLINE is defined, in which case every
+ * function is defined static inline in the including translation unit. It
+ * should not be included directly.
+*/
+
+#ifndef DAN_TIMESPEC_IMPL_H
+#define DAN_TIMESPEC_IMPL_H
+
+#ifndef DAN_TIMESPEC_H
+#error "Include timespec.h rather than timespec_impl.h"
+#endif
+
+/* Applies rules 2 and 3 of timespec_normalise() to a timespec whose tv_nsec
+ * is already within (-1,000,000,000, 1,000,000,000).
+*/
+static inline struct timespec timespec_fix_sign(struct timespec ts)
+{
+	/* Positive seconds with negative nanoseconds borrow a second, negative
+	 * seconds with positive nanoseconds give one back. At most one of these
+	 * is set, and both are computed without branching.
+	*/
+	long borrow = (ts.tv_nsec < 0 && ts.tv_sec > 0);
+	long carry  = (ts.tv_nsec > 0 && ts.tv_sec < 0);
+	
+	ts.tv_sec  += carry - borrow;
+	ts.tv_nsec += (borrow - carry) * 1000000000;
+	
+	return ts;
+}
+
+/* Normalises a timespec whose tv_nsec is within (-2,000,000,000,
+ * 2,000,000,000), as produced by adding or subtracting two normalised values.
+*/
+static inline struct timespec timespec_normalise_carry(struct timespec ts)
+{
+	long over  = (ts.tv_nsec >= 1000000000);
+	long under = (ts.tv_nsec <= -1000000000);
+	
+	ts.tv_sec  += over - under;
+	ts.tv_nsec -= (over - under) * 1000000000;
+	
+	return timespec_fix_sign(ts);
+}
+
+/** \fn struct timespec timespec_add(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns the result of adding two timespec structures.
+*/
+TIMESPEC_API struct timespec timespec_add(struct timespec ts1, struct timespec ts2)
+{
+	/* Normalise inputs to prevent tv_nsec rollover if whole-second values
+	 * are packed in it.
+	*/
+	ts1 = timespec_normalise(ts1);
+	ts2 = timespec_normalise(ts2);
+	
+	return timespec_add_normalised(ts1, ts2);
+}
+
+/** \fn struct timespec timespec_sub(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns the result of subtracting ts2 from ts1.
+*/
+TIMESPEC_API struct timespec timespec_sub(struct timespec ts1, struct timespec ts2)
+{
+	/* Normalise inputs to prevent tv_nsec rollover if whole-second values
+	 * are packed in it.
+	*/
+	ts1 = timespec_normalise(ts1);
+	ts2 = timespec_normalise(ts2);
+	
+	return timespec_sub_normalised(ts1, ts2);
+}
+
+/** \fn struct timespec timespec_add_normalised(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns the result of adding two normalised timespec structures.
+ *
+ * Faster equivalent of timespec_add() for callers which can guarantee both
+ * inputs are already normalised (e.g. values returned by clock_gettime() or
+ * by other functions in this library). The result is unspecified if either
+ * input is not normalised.
+*/
+TIMESPEC_API struct timespec timespec_add_normalised(struct timespec ts1, struct timespec ts2)
+{
+	ts1.tv_sec  += ts2.tv_sec;
+	ts1.tv_nsec += ts2.tv_nsec;
+	
+	return timespec_normalise_carry(ts1);
+}
+
+/** \fn struct timespec timespec_sub_normalised(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns the result of subtracting normalised ts2 from normalised ts1.
+ *
+ * Faster equivalent of timespec_sub() for callers which can guarantee both
+ * inputs are already normalised. The result is unspecified if either input
+ * is not normalised.
+*/
+TIMESPEC_API struct timespec timespec_sub_normalised(struct timespec ts1, struct timespec ts2)
+{
+	ts1.tv_sec  -= ts2.tv_sec;
+	ts1.tv_nsec -= ts2.tv_nsec;
+	
+	return timespec_normalise_carry(ts1);
+}
+
+/* Stores the 128-bit product of a and b in hi and lo. */
+static inline void timespec_mul64(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 p = (unsigned __int128)(a) * b;
+	
+	*hi = (uint64_t)(p >> 64);
+	*lo = (uint64_t)(p);
+#else
+	uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+	uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+	uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+	uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+	
+	*hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	*lo = (mid << 32) | (ll & 0xFFFFFFFF);
+#endif
+}
+
+/* Divides the 128-bit value hi:lo by d, which must be greater than hi so the
+ * quotient fits in 64 bits. Returns the quotient and stores the remainder.
+*/
+static inline uint64_t timespec_div128(uint64_t hi, uint64_t lo, uint64_t d, uint64_t *rem)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 n = ((unsigned __int128)(hi) << 64) | lo;
+	
+	*rem = (uint64_t)(n % d);
+	return (uint64_t)(n / d);
+#else
+	uint64_t q = 0;
+	
+	for(int i = 63; i >= 0; --i)
+	{
+		/* hi < d throughout, so shifting it left loses at most the top bit,
+		 * in which case the shifted value certainly exceeds d.
+		*/
+		bool top = (hi >> 63) != 0;
+		
+		hi = (hi << 1) | (lo >> 63);
+		lo <<= 1;
+		
+		if(top || hi >= d)
+		{
+			hi -= d;
+			q |= (uint64_t)(1) << i;
+		}
+	}
+	
+	*rem = hi;
+	return q;
+#endif
+}
+
+/** \fn struct timespec timespec_scale(struct timespec ts, int64_t num, int64_t den)
+ *  \brief Returns ts multiplied by the ratio num / den.
+ *
+ * The result is exact, computed with 128-bit intermediates, and truncated
+ * towards zero to a whole nanosecond. Results which do not fit in a time_t,
+ * including any non-zero ts divided by zero, saturate to the largest value
+ * of the appropriate sign. The result is normalised.
+*/
+TIMESPEC_API struct timespec timespec_scale(struct timespec ts, int64_t num, int64_t den)
+{
+	ts = timespec_normalise(ts);
+	
+	bool negative = ((ts.tv_sec < 0 || ts.tv_nsec < 0) != (num < 0)) != (den < 0);
+	
+	/* Work on magnitudes, INT64_MIN included. */
+	uint64_t s = (ts.tv_sec < 0) ? -(uint64_t)(ts.tv_sec) : (uint64_t)(ts.tv_sec);
+	uint64_t n = (uint64_t)(ts.tv_nsec < 0 ? -ts.tv_nsec : ts.tv_nsec);
+	uint64_t a = (num < 0) ? -(uint64_t)(num) : (uint64_t)(num);
+	uint64_t b = (den < 0) ? -(uint64_t)(den) : (uint64_t)(den);
+	
+	uint64_t x_hi, x_lo, y_hi, y_lo, y_rem, z_rem, w_hi, w_lo;
+	uint64_t sec_max = (uint64_t)(((time_t)(1) << (sizeof(time_t) * 8 - 2)) - 1) * 2 + 1;
+	
+	if((s == 0 && n == 0) || a == 0)
+	{
+		ts.tv_sec  = 0;
+		ts.tv_nsec = 0;
+		return ts;
+	}
+	
+	/* (s * 1e9 + n) * a / b is rewritten as ((s * a + y_q) * 1e9 + y_rem) / b
+	 * where y_q and y_rem are the quotient and remainder of n * a / 1e9, so
+	 * every intermediate fits in 128 bits.
+	*/
+	timespec_mul64(s, a, &x_hi, &x_lo);
+	timespec_mul64(n, a, &y_hi, &y_lo);
+	
+	uint64_t y_q = timespec_div128(y_hi, y_lo, 1000000000, &y_rem);
+	
+	x_lo += y_q;
+	x_hi += (x_lo < y_q);
+	
+	uint64_t sec = 0;
+	
+	if(b != 0 && x_hi < b)
+	{
+		sec = timespec_div128(x_hi, x_lo, b, &z_rem);
+	}
+	
+	if(b == 0 || x_hi >= b || sec > sec_max)
+	{
+		ts.tv_sec  = (time_t)(sec_max);
+		ts.tv_nsec = 999999999;
+	}
+	else
+	{
+		timespec_mul64(z_rem, 1000000000, &w_hi, &w_lo);
+		w_lo += y_rem;
+		w_hi += (w_lo < y_rem);
+		
+		ts.tv_sec  = (time_t)(sec);
+		ts.tv_nsec = (long)(timespec_div128(w_hi, w_lo, b, &z_rem));
+	}
+	
+	if(negative)
+	{
+		ts.tv_sec  = -ts.tv_sec;
+		ts.tv_nsec = -ts.tv_nsec;
+	}
+	
+	return ts;
+}
+
+/** \fn struct timespec timespec_mul(struct timespec ts, int64_t n)
+ *  \brief Returns ts multiplied by n.
+ *
+ * Saturates rather than overflowing. See timespec_scale().
+*/
+TIMESPEC_API struct timespec timespec_mul(struct timespec ts, int64_t n)
+{
+	return timespec_scale(ts, n, 1);
+}
+
+/** \fn struct timespec timespec_div(struct timespec ts, int64_t d)
+ *  \brief Returns ts divided by d, truncated towards zero to a nanosecond.
+ *
+ * See timespec_scale().
+*/
+TIMESPEC_API struct timespec timespec_div(struct timespec ts, int64_t d)
+{
+	return timespec_scale(ts, 1, d);
+}
+
+/** \fn bool timespec_eq(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns true if the two timespec structures are equal.
+*/
+TIMESPEC_API bool timespec_eq(struct timespec ts1, struct timespec ts2)
+{
+	return (ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec == ts2.tv_nsec);
+}
+
+/** \fn bool timespec_gt(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns true if ts1 is greater than ts2.
+*/
+TIMESPEC_API bool timespec_gt(struct timespec ts1, struct timespec ts2)
+{
+	return (ts1.tv_sec > ts2.tv_sec || (ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec > ts2.tv_nsec));
+}
+
+/** \fn bool timespec_ge(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns true if ts1 is greater than or equal to ts2.
+*/
+TIMESPEC_API bool timespec_ge(struct timespec ts1, struct timespec ts2)
+{
+	return (ts1.tv_sec > ts2.tv_sec || (ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec >= ts2.tv_nsec));
+}
+
+/** \fn bool timespec_lt(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns true if ts1 is less than ts2.
+*/
+TIMESPEC_API bool timespec_lt(struct timespec ts1, struct timespec ts2)
+{
+	return (ts1.tv_sec < ts2.tv_sec || (ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec < ts2.tv_nsec));
+}
+
+/** \fn bool timespec_le(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns true if ts1 is less than or equal to ts2.
+*/
+TIMESPEC_API bool timespec_le(struct timespec ts1, struct timespec ts2)
+{
+	return (ts1.tv_sec < ts2.tv_sec || (ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec <= ts2.tv_nsec));
+}
+
+/** \fn int timespec_cmp(struct timespec ts1, struct timespec ts2)
+ *  \brief Returns -1, 0 or 1 as ts1 is less than, equal to or greater than ts2.
+ *
+ * Suitable for qsort() and bsearch() style comparators. Both fields are
+ * compared without branching, so the result costs the same whatever the
+ * order of the inputs.
+*/
+TIMESPEC_API int timespec_cmp(struct timespec ts1, struct timespec ts2)
+{
+	int sec  = (ts1.tv_sec > ts2.tv_sec) - (ts1.tv_sec < ts2.tv_sec);
+	int nsec = (ts1.tv_nsec > ts2.tv_nsec) - (ts1.tv_nsec < ts2.tv_nsec);
+	
+	return (sec != 0) ? sec : nsec;
+}
+
+/** \fn struct timespec timespec_from_double(double s)
+ *  \brief Converts a fractional number of seconds to a timespec.
+*/
+TIMESPEC_API struct timespec timespec_from_double(double s)
+{
+	struct timespec ts = {
+		.tv_sec  = (time_t)(s),
+		.tv_nsec = (long)((s - (long)(s)) * 1000000000),
+	};
+	
+	return timespec_normalise(ts);
+}
+
+/** \fn double timespec_to_double(struct timespec ts)
+ *  \brief Converts a timespec to a fractional number of seconds.
+*/
+TIMESPEC_API double timespec_to_double(struct timespec ts)
+{
+	return ((double)(ts.tv_sec) + ((double)(ts.tv_nsec) / 1000000000));
+}
+
+/** \fn struct timespec timespec_from_timeval(struct timeval tv)
+ *  \brief Converts a timeval to a timespec.
+*/
+TIMESPEC_API struct timespec timespec_from_timeval(struct timeval tv)
+{
+	struct timespec ts = {
+		.tv_sec  = tv.tv_sec,
+		.tv_nsec = tv.tv_usec * 1000
+	};
+	
+	return timespec_normalise(ts);
+}
+
+/** \fn struct timeval timespec_to_timeval(struct timespec ts)
+ *  \brief Converts a timespec to a timeval.
+*/
+TIMESPEC_API struct timeval timespec_to_timeval(struct timespec ts)
+{
+	ts = timespec_normalise(ts);
+	
+	struct timeval tv = {
+		.tv_sec  = ts.tv_sec,
+		.tv_usec = ts.tv_nsec / 1000,
+	};
+	
+	return tv;
+}
+
+/** \fn struct timespec timespec_from_ms(long milliseconds)
+ *  \brief Converts an integer number of milliseconds to a timespec.
+*/
+TIMESPEC_API struct timespec timespec_from_ms(long milliseconds)
+{
+	struct timespec ts = {
+		.tv_sec  = (milliseconds / 1000),
+		.tv_nsec = (milliseconds % 1000) * 1000000,
+	};
+	
+	return timespec_normalise(ts);
+}
+
+/** \fn long timespec_to_ms(struct timespec ts)
+ *  \brief Converts a timespec to an integer number of milliseconds.
+*/
+TIMESPEC_API long timespec_to_ms(struct timespec ts)
+{
+	return (ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/** \fn struct timespec timespec_normalise(struct timespec ts)
+ *  \brief Normalises a timespec structure.
+ *
+ * Returns a normalised version of a timespec structure, according to the
+ * following rules:
+ *
+ * 1) If tv_nsec is >=1,000,000,000 or <=-1,000,000,000, flatten the surplus
+ *    nanoseconds into the tv_sec field.
+ *
+ * 2) If tv_sec is >0 and tv_nsec is <0, decrement tv_sec and roll tv_nsec up
+ *    to represent the same value on the positive side of the new tv_sec.
+ *
+ * 3) If tv_sec is <0 and tv_nsec is >0, increment tv_sec and roll tv_nsec down
+ *    to represent the same value on the negative side of the new tv_sec.
+ *
+ * Runs in constant time regardless of the magnitude of tv_nsec.
+*/
+TIMESPEC_API struct timespec timespec_normalise(struct timespec ts)
+{
+	/* Flatten any surplus nanoseconds in one step rather than looping, so
+	 * the cost does not depend on how many whole seconds tv_nsec carries.
+	 * The divisor is constant so this compiles to a multiply and shift.
+	*/
+	ts.tv_sec  += ts.tv_nsec / 1000000000;
+	ts.tv_nsec  = ts.tv_nsec % 1000000000;
+	
+	return timespec_fix_sign(ts);
+}
+
+/* Returns the saturated result of a * b + c. */
+static inline timespec_ns timespec_ns_mul_add(int64_t a, int64_t b, int64_t c)
+{
+	int64_t r;
+	
+	if(__builtin_mul_overflow(a, b, &r))
+	{
+		return ((a < 0) != (b < 0)) ? TIMESPEC_NS_MIN : TIMESPEC_NS_MAX;
+	}
+	
+	if(__builtin_add_overflow(r, c, &r))
+	{
+		return (c < 0) ? TIMESPEC_NS_MIN : TIMESPEC_NS_MAX;
+	}
+	
+	return r;
+}
+
+/** \fn timespec_ns timespec_ns_add(timespec_ns ns1, timespec_ns ns2)
+ *  \brief Returns the result of adding two timespec_ns values.
+ *
+ * Saturates at TIMESPEC_NS_MIN and TIMESPEC_NS_MAX rather than overflowing.
+*/
+TIMESPEC_API timespec_ns timespec_ns_add(timespec_ns ns1, timespec_ns ns2)
+{
+	timespec_ns r;
+	
+	if(__builtin_add_overflow(ns1, ns2, &r))
+	{
+		return (ns2 < 0) ? TIMESPEC_NS_MIN : TIMESPEC_NS_MAX;
+	}
+	
+	return r;
+}
+
+/** \fn timespec_ns timespec_ns_sub(timespec_ns ns1, timespec_ns ns2)
+ *  \brief Returns the result of subtracting ns2 from ns1.
+ *
+ * Saturates at TIMESPEC_NS_MIN and TIMESPEC_NS_MAX rather than overflowing.
+*/
+TIMESPEC_API timespec_ns timespec_ns_sub(timespec_ns ns1, timespec_ns ns2)
+{
+	timespec_ns r;
+	
+	if(__builtin_sub_overflow(ns1, ns2, &r))
+	{
+		return (ns2 < 0) ? TIMESPEC_NS_MAX : TIMESPEC_NS_MIN;
+	}
+	
+	return r;
+}
+
+/** \fn timespec_ns timespec_ns_from_timespec(struct timespec ts)
+ *  \brief Converts a timespec to a timespec_ns.
+ *
+ * Values outside the range of timespec_ns (roughly +/-292 years) saturate.
+*/
+TIMESPEC_API timespec_ns timespec_ns_from_timespec(struct timespec ts)
+{
+	/* Once normalised tv_nsec has the same sign as tv_sec, so saturating
+	 * the multiplication cannot be undone by the addition.
+	*/
+	ts = timespec_normalise(ts);
+	
+	return timespec_ns_mul_add(ts.tv_sec, 1000000000, ts.tv_nsec);
+}
+
+/** \fn struct timespec timespec_ns_to_timespec(timespec_ns ns)
+ *  \brief Converts a timespec_ns to a normalised timespec.
+*/
+TIMESPEC_API struct timespec timespec_ns_to_timespec(timespec_ns ns)
+{
+	struct timespec ts = {
+		.tv_sec  = (time_t)(ns / 1000000000),
+		.tv_nsec = (long)(ns % 1000000000),
+	};
+	
+	return ts;
+}
+
+/** \fn timespec_ns timespec_ns_from_double(double s)
+ *  \brief Converts a fractional number of seconds to a timespec_ns.
+ *
+ * Rounds the same way as timespec_from_double(). Values outside the range of
+ * timespec_ns saturate and NaN converts to zero.
+*/
+TIMESPEC_API timespec_ns timespec_ns_from_double(double s)
+{
+	if(s != s)
+	{
+		return 0;
+	}
+	else if(s >= 9223372037.0)
+	{
+		return TIMESPEC_NS_MAX;
+	}
+	else if(s <= -9223372037.0)
+	{
+		return TIMESPEC_NS_MIN;
+	}
+	
+	return timespec_ns_mul_add((int64_t)(s), 1000000000, (int64_t)((s - (double)((int64_t)(s))) * 1000000000));
+}
+
+/** \fn double timespec_ns_to_double(timespec_ns ns)
+ *  \brief Converts a timespec_ns to a fractional number of seconds.
+*/
+TIMESPEC_API double timespec_ns_to_double(timespec_ns ns)
+{
+	return ((double)(ns / 1000000000) + ((double)(ns % 1000000000) / 1000000000));
+}
+
+/** \fn timespec_ns timespec_ns_from_timeval(struct timeval tv)
+ *  \brief Converts a timeval to a timespec_ns.
+ *
+ * Values outside the range of timespec_ns saturate.
+*/
+TIMESPEC_API timespec_ns timespec_ns_from_timeval(struct timeval tv)
+{
+	return timespec_ns_from_timespec(timespec_from_timeval(tv));
+}
+
+/** \fn struct timeval timespec_ns_to_timeval(timespec_ns ns)
+ *  \brief Converts a timespec_ns to a timeval.
+*/
+TIMESPEC_API struct timeval timespec_ns_to_timeval(timespec_ns ns)
+{
+	struct timeval tv = {
+		.tv_sec  = (time_t)(ns / 1000000000),
+		.tv_usec = (suseconds_t)((ns % 1000000000) / 1000),
+	};
+	
+	return tv;
+}
+
+/** \fn timespec_ns timespec_ns_from_ms(long milliseconds)
+ *  \brief Converts an integer number of milliseconds to a timespec_ns.
+ *
+ * Values outside the range of timespec_ns saturate.
+*/
+TIMESPEC_API timespec_ns timespec_ns_from_ms(long milliseconds)
+{
+	return timespec_ns_mul_add(milliseconds, 1000000, 0);
+}
+
+/** \fn long timespec_ns_to_ms(timespec_ns ns)
+ *  \brief Converts a timespec_ns to an integer number of milliseconds.
+*/
+TIMESPEC_API long timespec_ns_to_ms(timespec_ns ns)
+{
+	return (long)(ns / 1000000);
+}
+
+/* Writes the two digit decimal representation of v (0 to 99) to p. */
+static inline void timespec_put2(char *p, unsigned v)
+{
+	p[0] = (char)('0' + v / 10);
+	p[1] = (char)('0' + v % 10);
+}
+
+/* Converts days since 1970-01-01 to a proleptic Gregorian calendar date,
+ * using only integer arithmetic (Howard Hinnant's civil_from_days).
+*/
+static inline void timespec_civil_from_days(int64_t z, int64_t *y, unsigned *m, unsigned *d)
+{
+	z += 719468;
+	
+	int64_t  era = (z >= 0 ? z : z - 146096) / 146097;
+	unsigned doe = (unsigned)(z - era * 146097);
+	unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	unsigned mp  = (5 * doy + 2) / 153;
+	
+	*d = doy - (153 * mp + 2) / 5 + 1;
+	*m = (mp < 10) ? mp + 3 : mp - 9;
+	*y = (int64_t)(yoe) + era * 400 + (*m <= 2);
+}
+
+/* Writes "YYYY-MM-DDTHH:MM:SS" for sec seconds since the epoch to p. Returns
+ * false if the year is outside 0000 to 9999.
+*/
+static inline bool timespec_put_rfc3339_seconds(char *p, int64_t sec)
+{
+	int64_t days = sec / 86400;
+	int64_t rem  = sec % 86400;
+	int64_t year;
+	unsigned month, day;
+	
+	if(rem < 0)
+	{
+		rem += 86400;
+		--days;
+	}
+	
+	timespec_civil_from_days(days, &year, &month, &day);
+	if(year < 0 || year > 9999)
+	{
+		return false;
+	}
+	
+	timespec_put2(p, (unsigned)(year / 100));
+	timespec_put2(p + 2, (unsigned)(year % 100));
+	p[4] = '-';
+	timespec_put2(p + 5, month);
+	p[7] = '-';
+	timespec_put2(p + 8, day);
+	p[10] = 'T';
+	timespec_put2(p + 11, (unsigned)(rem / 3600));
+	p[13] = ':';
+	timespec_put2(p + 14, (unsigned)(rem / 60 % 60));
+	p[16] = ':';
+	timespec_put2(p + 17, (unsigned)(rem % 60));
+	
+	return true;
+}
+
+/** \fn size_t timespec_to_rfc3339(struct timespec ts, int precision, char *buf, size_t len)
+ *  \brief Formats a timespec as an RFC 3339 UTC timestamp.
+ *
+ * Writes a NUL-terminated string such as "2026-10-17T12:34:56.123Z" to buf,
+ * with precision (0 to 9) fractional digits, truncated rather than rounded.
+ * ts is taken as seconds since the epoch; negative values are before it.
+ *
+ * The output is always TIMESPEC_RFC3339_LEN(precision) characters long, and a
+ * buffer of TIMESPEC_RFC3339_MAX bytes fits any precision. Returns the length
+ * written excluding the NUL, or 0 if buf is too small or the year is outside
+ * 0000 to 9999.
+ *
+ * The date and time of day are cached per thread and reused while the whole
+ * second is unchanged, so consecutive timestamps from the same second only
+ * cost the fractional digits.
+*/
+TIMESPEC_API size_t timespec_to_rfc3339(struct timespec ts, int precision, char *buf, size_t len)
+{
+	static __thread struct {
+		bool valid;
+		int64_t sec;
+		char text[19];
+	} cache;
+	
+	if(precision < 0)
+	{
+		precision = 0;
+	}
+	else if(precision > 9)
+	{
+		precision = 9;
+	}
+	
+	size_t out_len = TIMESPEC_RFC3339_LEN(precision);
+	if(len <= out_len)
+	{
+		return 0;
+	}
+	
+	/* Count down from the second before for negative fractions, so the
+	 * fractional digits always count up from a whole second.
+	*/
+	ts = timespec_normalise(ts);
+	if(ts.tv_nsec < 0)
+	{
+		--(ts.tv_sec);
+		ts.tv_nsec += 1000000000;
+	}
+	
+	if(!cache.valid || cache.sec != (int64_t)(ts.tv_sec))
+	{
+		cache.valid = timespec_put_rfc3339_seconds(cache.text, ts.tv_sec);
+		cache.sec   = ts.tv_sec;
+		
+		if(!cache.valid)
+		{
+			return 0;
+		}
+	}
+	
+	memcpy(buf, cache.text, sizeof(cache.text));
+	
+	char *p = buf + sizeof(cache.text);
+	if(precision > 0)
+	{
+		char digits[10];
+		unsigned long frac = (unsigned long)(ts.tv_nsec);
+		
+		digits[0] = '.';
+		for(int i = 9; i > 0; i -= 2)
+		{
+			/* Fill pairs from the right; the leading digit is written last. */
+			if(i == 1)
+			{
+				digits[1] = (char)('0' + frac);
+			}
+			else
+			{
+				timespec_put2(digits + i - 1, (unsigned)(frac % 100));
+				frac /= 100;
+			}
+		}
+		
+		memcpy(p, digits, (size_t)(precision) + 1);
+		p += precision + 1;
+	}
+	
+	p[0] = 'Z';
+	p[1] = '\0';
+	
+	return out_len;
+}
+
+/** \fn size_t timespec_to_rfc3339_array(const struct timespec *ts, size_t n, int precision, char *buf, size_t len)
+ *  \brief Formats an array of timespecs as RFC 3339 UTC timestamps.
+ *
+ * Writes n NUL-terminated strings, as timespec_to_rfc3339() would, back to
+ * back into buf. Each takes TIMESPEC_RFC3339_LEN(precision) + 1 bytes, so
+ * string i starts at that multiple of i. Returns the total bytes written, or
+ * 0 (possibly after writing some strings) if buf is too small or any
+ * timestamp cannot be formatted.
+*/
+TIMESPEC_API size_t timespec_to_rfc3339_array(const struct timespec *ts, size_t n, int precision, char *buf,
+	size_t len)
+{
+	size_t stride = TIMESPEC_RFC3339_LEN(precision < 0 ? 0 : precision > 9 ? 9 : precision) + 1;
+	
+	if(n > len / stride)
+	{
+		return 0;
+	}
+	
+	for(size_t i = 0; i < n; ++i)
+	{
+		if(timespec_to_rfc3339(ts[i], precision, buf + i * stride, stride) == 0)
+		{
+			return 0;
+		}
+	}
+	
+	return n * stride;
+}
+
+/* Parses up to max (at most 19) decimal digits from p, storing their value.
+ * Returns the number of digits parsed. Runs of eight digits are converted a
+ * word at a time on little-endian targets.
+*/
+static inline size_t timespec_parse_digits(const char *p, size_t len, size_t max, uint64_t *value)
+{
+	uint64_t v = 0;
+	size_t i = 0;
+	
+	if(max > len)
+	{
+		max = len;
+	}
+	
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	while(max - i >= 8)
+	{
+		uint64_t w;
+		memcpy(&w, p + i, sizeof(w));
+		
+		/* Every byte is '0' to '9' if its high nibble is 3 and adding 6
+		 * does not carry into it.
+		*/
+		if((w & 0xF0F0F0F0F0F0F0F0ULL) != 0x3030303030303030ULL
+			|| ((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) != 0x3030303030303030ULL)
+		{
+			break;
+		}
+		
+		/* Combine adjacent digits into pairs, pairs into fours, then fours
+		 * into the eight digit value.
+		*/
+		w -= 0x3030303030303030ULL;
+		w = (w * 10 + (w >> 8)) & 0x00FF00FF00FF00FFULL;
+		w = (w * 100 + (w >> 16)) & 0x0000FFFF0000FFFFULL;
+		w = (w * 10000 + (w >> 32)) & 0xFFFFFFFFULL;
+		
+		v = v * 100000000 + w;
+		i += 8;
+	}
+#endif
+	
+	for(; i < max && p[i] >= '0' && p[i] <= '9'; ++i)
+	{
+		v = v * 10 + (uint64_t)(p[i] - '0');
+	}
+	
+	*value = v;
+	return i;
+}
+
+/* Parses exactly two digits, returning -1 if either is not a digit. */
+static inline int timespec_parse2(const char *p)
+{
+	if(p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9')
+	{
+		return -1;
+	}
+	
+	return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+/* Parses a fraction after the decimal point as nanoseconds, truncating any
+ * digits past the ninth. Returns the number of characters consumed.
+*/
+static inline size_t timespec_parse_fraction(const char *p, size_t len, long *nsec)
+{
+	static const long scale[10] = {
+		1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1,
+	};
+	
+	uint64_t v;
+	size_t n = timespec_parse_digits(p, len, 9, &v);
+	size_t i = n;
+	
+	while(i < len && p[i] >= '0' && p[i] <= '9')
+	{
+		++i;
+	}
+	
+	*nsec = (long)(v) * scale[n];
+	return i;
+}
+
+/* Converts a proleptic Gregorian calendar date to days since 1970-01-01,
+ * the inverse of timespec_civil_from_days().
+*/
+static inline int64_t timespec_days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+	y -= (m <= 2);
+	
+	int64_t  era = (y >= 0 ? y : y - 399) / 400;
+	unsigned yoe = (unsigned)(y - era * 400);
+	unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	
+	return era * 146097 + (int64_t)(doe) - 719468;
+}
+
+/** \fn size_t timespec_parse_rfc3339(const char *str, size_t len, struct timespec *ts)
+ *  \brief Parses an RFC 3339 timestamp into a normalised timespec.
+ *
+ * Accepts "YYYY-MM-DDTHH:MM:SS", an optional fraction of any length, and a
+ * "Z" or "+HH:MM"/"-HH:MM" offset, reading at most len characters of str.
+ * The separators "t", "z" and a space in place of "T" are also accepted.
+ * Fractions are truncated to nanoseconds and a leap second (":60") is taken
+ * as the first second of the next minute. No locale or floating point is
+ * involved, so the result is exact.
+ *
+ * Returns the number of characters parsed, so a timestamp may be followed by
+ * other text, or 0 if str does not start with a valid timestamp, in which
+ * case ts is not modified.
+*/
+TIMESPEC_API size_t timespec_parse_rfc3339(const char *str, size_t len, struct timespec *ts)
+{
+	static const unsigned char month_days[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	
+	if(len < 20 || str[4] != '-' || str[7] != '-' || str[13] != ':' || str[16] != ':'
+		|| (str[10] != 'T' && str[10] != 't' && str[10] != ' '))
+	{
+		return 0;
+	}
+	
+	int year_hi = timespec_parse2(str);
+	int year_lo = timespec_parse2(str + 2);
+	int month   = timespec_parse2(str + 5);
+	int day     = timespec_parse2(str + 8);
+	int hour    = timespec_parse2(str + 11);
+	int minute  = timespec_parse2(str + 14);
+	int second  = timespec_parse2(str + 17);
+	
+	if(year_hi < 0 || year_lo < 0 || month < 1 || month > 12 || day < 1 || day > month_days[month - 1]
+		|| hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60)
+	{
+		return 0;
+	}
+	
+	int year = year_hi * 100 + year_lo;
+	
+	if(month == 2 && day == 29 && (year % 4 != 0 || (year % 100 == 0 && year % 400 != 0)))
+	{
+		return 0;
+	}
+	
+	size_t i = 19;
+	long nsec = 0;
+	
+	if(str[i] == '.')
+	{
+		size_t n = timespec_parse_fraction(str + i + 1, len - i - 1, &nsec);
+		if(n == 0)
+		{
+			return 0;
+		}
+		
+		i += n + 1;
+	}
+	
+	long offset = 0;
+	
+	if(i < len && (str[i] == 'Z' || str[i] == 'z'))
+	{
+		++i;
+	}
+	else if(i + 6 <= len && (str[i] == '+' || str[i] == '-') && str[i + 3] == ':')
+	{
+		int off_hour   = timespec_parse2(str + i + 1);
+		int off_minute = timespec_parse2(str + i + 4);
+		
+		if(off_hour < 0 || off_hour > 23 || off_minute < 0 || off_minute > 59)
+		{
+			return 0;
+		}
+		
+		offset = (off_hour * 60 + off_minute) * 60;
+		if(str[i] == '-')
+		{
+			offset = -offset;
+		}
+		
+		i += 6;
+	}
+	else
+	{
+		return 0;
+	}
+	
+	int64_t days = timespec_days_from_civil(year, (unsigned)(month), (unsigned)(day));
+	
+	ts->tv_sec  = (time_t)(days * 86400 + (hour * 60 + minute) * 60 + second - offset);
+	ts->tv_nsec = nsec;
+	*ts = timespec_fix_sign(*ts);
+	
+	return i;
+}
+
+/** \fn size_t timespec_parse_duration(const char *str, size_t len, struct timespec *ts)
+ *  \brief Parses a duration such as "1.5s", "250ms" or "1h30m" into a normalised timespec.
+ *
+ * A duration is an optional sign followed by one or more decimal numbers,
+ * each with an optional fraction of one or more digits and one of the units
+ * "h", "m", "s", "ms", "us" (or "\xC2\xB5s"), and "ns". A bare "0" is also
+ * accepted. Parts below a nanosecond are truncated. No locale or floating
+ * point is involved.
+ *
+ * Returns the number of characters parsed, or 0 if str does not start with a
+ * valid duration or it overflows time_t, in which case ts is not modified.
+*/
+TIMESPEC_API size_t timespec_parse_duration(const char *str, size_t len, struct timespec *ts)
+{
+	size_t i = 0;
+	bool negative = false;
+	
+	if(i < len && (str[i] == '+' || str[i] == '-'))
+	{
+		negative = (str[i] == '-');
+		++i;
+	}
+	
+	int64_t sec  = 0;
+	int64_t nsec = 0;
+	size_t parts = 0;
+	
+	while(i < len)
+	{
+		uint64_t whole;
+		long frac = 0;
+		size_t n = timespec_parse_digits(str + i, len - i, 18, &whole);
+		size_t f = 0;
+		
+		if(n < len - i && str[i + n] >= '0' && str[i + n] <= '9')
+		{
+			/* More than 18 integer digits overflows any unit. */
+			return 0;
+		}
+		
+		if(n < len - i && str[i + n] == '.')
+		{
+			f = timespec_parse_fraction(str + i + n + 1, len - i - n - 1, &frac) + 1;
+		}
+		
+		if(n > 0 && f == 1)
+		{
+			/* "1.s": a '.' with no digits after it. */
+			return 0;
+		}
+		
+		if(n == 0 && f <= 1)
+		{
+			break;
+		}
+		
+		size_t u = i + n + f;
+		int64_t unit_sec = 0;
+		int64_t unit_ns  = 0;
+		
+		if(u + 1 < len && str[u] == 'm' && str[u + 1] == 's')
+		{
+			unit_ns = 1000000;
+			u += 2;
+		}
+		else if(u + 1 < len && str[u] == 'u' && str[u + 1] == 's')
+		{
+			unit_ns = 1000;
+			u += 2;
+		}
+		else if(u + 2 < len && str[u] == '\xC2' && str[u + 1] == '\xB5' && str[u + 2] == 's')
+		{
+			unit_ns = 1000;
+			u += 3;
+		}
+		else if(u + 1 < len && str[u] == 'n' && str[u + 1] == 's')
+		{
+			unit_ns = 1;
+			u += 2;
+		}
+		else if(u < len && str[u] == 'h')
+		{
+			unit_sec = 3600;
+			u += 1;
+		}
+		else if(u < len && str[u] == 'm')
+		{
+			unit_sec = 60;
+			u += 1;
+		}
+		else if(u < len && str[u] == 's')
+		{
+			unit_sec = 1;
+			u += 1;
+		}
+		else if(parts == 0 && n == 1 && f == 0 && whole == 0)
+		{
+			/* A bare zero needs no unit. */
+			i = u;
+			parts = 1;
+			break;
+		}
+		else
+		{
+			return 0;
+		}
+		
+		if(unit_sec != 0)
+		{
+			/* frac is in billionths, so frac * unit_sec is in nanoseconds. */
+			int64_t add;
+			
+			if(__builtin_mul_overflow((int64_t)(whole), unit_sec, &add) || __builtin_add_overflow(sec, add, &sec))
+			{
+				return 0;
+			}
+			
+			nsec += frac * unit_sec;
+		}
+		else
+		{
+			int64_t per_sec = 1000000000 / unit_ns;
+			
+			if(__builtin_add_overflow(sec, (int64_t)(whole / (uint64_t)(per_sec)), &sec))
+			{
+				return 0;
+			}
+			
+			nsec += (int64_t)(whole % (uint64_t)(per_sec)) * unit_ns + frac / per_sec;
+		}
+		
+		/* Keep nsec small so it cannot overflow however many parts there are. */
+		if(__builtin_add_overflow(sec, nsec / 1000000000, &sec))
+		{
+			return 0;
+		}
+		nsec %= 1000000000;
+		
+		i = u;
+		++parts;
+	}
+	
+	if(parts == 0 || (int64_t)((time_t)(sec)) != sec)
+	{
+		return 0;
+	}
+	
+	ts->tv_sec  = (time_t)(negative ? -sec : sec);
+	ts->tv_nsec = (long)(negative ? -nsec : nsec);
+	
+	return i;
+}
+
+#endif /* !DAN_TIMESPEC_IMPL_H */
@@ -0,0 +1,35 @@
+/**
+ * @file timespec_index.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_INDEX_H
+#define DAN_TIMESPEC_INDEX_H
+
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct timespec_index;
+
+struct timespec_index *timespec_index_create(const struct timespec *sorted, size_t n);
+void timespec_index_destroy(struct timespec_index *idx);
+size_t timespec_index_size(const struct timespec_index *idx);
+
+size_t timespec_index_lower_bound(const struct timespec_index *idx, struct timespec ts);
+size_t timespec_index_upper_bound(const struct timespec_index *idx, struct timespec ts);
+size_t timespec_index_range(const struct timespec_index *idx, struct timespec from, struct timespec to, size_t *first);
+
+void timespec_index_lower_bound_batch(const struct timespec_index *idx, const struct timespec *ts, size_t n,
+	size_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_INDEX_H */
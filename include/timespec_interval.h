@@ -0,0 +1,63 @@
+/**
+ * @file timespec_interval.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_INTERVAL_H
+#define DAN_TIMESPEC_INTERVAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The half-open range [start, end). */
+struct timespec_interval
+{
+	struct timespec start;
+	struct timespec end;
+};
+
+struct timespec_interval_tree;
+struct timespec_interval_set;
+
+struct timespec_interval_tree *timespec_interval_tree_create(void);
+void timespec_interval_tree_destroy(struct timespec_interval_tree *tree);
+
+bool timespec_interval_tree_insert(struct timespec_interval_tree *tree, struct timespec_interval interval, void *data);
+bool timespec_interval_tree_remove(struct timespec_interval_tree *tree, struct timespec_interval interval, void *data);
+size_t timespec_interval_tree_count(const struct timespec_interval_tree *tree);
+
+size_t timespec_interval_tree_stab(const struct timespec_interval_tree *tree, struct timespec ts,
+	bool (*visit)(struct timespec_interval interval, void *data, void *arg), void *arg);
+size_t timespec_interval_tree_overlap(const struct timespec_interval_tree *tree, struct timespec_interval interval,
+	bool (*visit)(struct timespec_interval interval, void *data, void *arg), void *arg);
+
+struct timespec_interval_set *timespec_interval_set_create(void);
+void timespec_interval_set_destroy(struct timespec_interval_set *set);
+
+bool timespec_interval_set_add(struct timespec_interval_set *set, struct timespec_interval interval);
+bool timespec_interval_set_remove(struct timespec_interval_set *set, struct timespec_interval interval);
+bool timespec_interval_set_contains(const struct timespec_interval_set *set, struct timespec ts);
+size_t timespec_interval_set_count(const struct timespec_interval_set *set);
+struct timespec_interval timespec_interval_set_get(const struct timespec_interval_set *set, size_t index);
+
+struct timespec_interval_set *timespec_interval_set_union(const struct timespec_interval_set *a,
+	const struct timespec_interval_set *b);
+struct timespec_interval_set *timespec_interval_set_intersection(const struct timespec_interval_set *a,
+	const struct timespec_interval_set *b);
+
+size_t timespec_interval_coalesce(struct timespec_interval *intervals, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_INTERVAL_H */
@@ -0,0 +1,69 @@
+/**
+ * @file timespec_log.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_LOG_H
+#define DAN_TIMESPEC_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default page size of a new log. A record payload may be up to the page size less 16 bytes, so logs of larger
+ * records need larger pages, at the cost of scanning more of a page when searching.
+*/
+#define TIMESPEC_LOG_PAGE_SIZE 4096
+
+/* A record as it lies in the mapped file. */
+struct timespec_log_record
+{
+	timespec_ns time;
+
+	/* Length of data in bytes. */
+	uint32_t size;
+
+	uint32_t flags;
+
+	/* The payload, aligned to 16 bytes. */
+	unsigned char data[];
+};
+
+struct timespec_log_writer;
+struct timespec_log_reader;
+
+struct timespec_log_writer *timespec_log_writer_open(const char *path, uint32_t page_size);
+void timespec_log_writer_close(struct timespec_log_writer *writer);
+bool timespec_log_writer_sync(struct timespec_log_writer *writer);
+
+bool timespec_log_append(struct timespec_log_writer *writer, struct timespec time, const void *data, size_t size);
+bool timespec_log_append_ns(struct timespec_log_writer *writer, timespec_ns time, const void *data, size_t size);
+
+struct timespec_log_reader *timespec_log_reader_open(const char *path);
+void timespec_log_reader_close(struct timespec_log_reader *reader);
+bool timespec_log_reader_refresh(struct timespec_log_reader *reader);
+
+const struct timespec_log_record *timespec_log_first(const struct timespec_log_reader *reader);
+const struct timespec_log_record *timespec_log_next(const struct timespec_log_reader *reader,
+	const struct timespec_log_record *record);
+const struct timespec_log_record *timespec_log_lower_bound(const struct timespec_log_reader *reader,
+	struct timespec time);
+const struct timespec_log_record *timespec_log_upper_bound(const struct timespec_log_reader *reader,
+	struct timespec time);
+bool timespec_log_range(const struct timespec_log_reader *reader, struct timespec from, struct timespec to,
+	const struct timespec_log_record **begin, const struct timespec_log_record **end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_LOG_H */
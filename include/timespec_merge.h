@@ -0,0 +1,56 @@
+/**
+ * @file timespec_merge.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_MERGE_H
+#define DAN_TIMESPEC_MERGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A sorted stream of records, each holding a struct timespec key at the same
+ * offset. next returns the following record, or NULL at the end; the record
+ * must stay valid until next is called again.
+*/
+struct timespec_merge_stream
+{
+	const void *(*next)(void *arg);
+	void *arg;
+};
+
+/* A sorted array of count records. */
+struct timespec_merge_input
+{
+	const void *records;
+	size_t count;
+};
+
+struct timespec_merge;
+
+struct timespec_merge *timespec_merge_create(const struct timespec_merge_stream *streams, size_t k, size_t key_offset);
+struct timespec_merge *timespec_merge_create_arrays(const struct timespec_merge_input *inputs, size_t k,
+	size_t record_size, size_t key_offset, const struct timespec *from, const struct timespec *to);
+void timespec_merge_destroy(struct timespec_merge *m);
+
+const void *timespec_merge_next(struct timespec_merge *m, size_t *stream);
+
+void timespec_merge_split(const struct timespec_merge_input *inputs, size_t k, size_t record_size, size_t key_offset,
+	struct timespec *bounds, size_t parts);
+bool timespec_merge_parallel(void *out, const struct timespec_merge_input *inputs, size_t k, size_t record_size,
+	size_t key_offset, unsigned threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_MERGE_H */
@@ -0,0 +1,47 @@
+/**
+ * @file timespec_rate_limiter.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_RATE_LIMITER_H
+#define DAN_TIMESPEC_RATE_LIMITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Token bucket rate limiter, safe to share between threads without a lock.
+ * May be allocated statically or embedded in another structure; initialise
+ * it with timespec_rate_limiter_init(). The fields are private.
+*/
+struct timespec_rate_limiter
+{
+	/* Theoretical arrival time of the next token, the only mutable state. */
+	timespec_ns tat;
+
+	timespec_ns interval;
+	timespec_ns capacity;
+};
+
+bool timespec_rate_limiter_init(struct timespec_rate_limiter *rl, struct timespec interval, uint32_t burst,
+	struct timespec now);
+
+bool timespec_rate_limiter_try_acquire(struct timespec_rate_limiter *rl, struct timespec now, uint32_t n);
+bool timespec_rate_limiter_try_acquire_ns(struct timespec_rate_limiter *rl, timespec_ns now, uint32_t n);
+
+struct timespec timespec_rate_limiter_wait(const struct timespec_rate_limiter *rl, struct timespec now, uint32_t n);
+uint32_t timespec_rate_limiter_available(const struct timespec_rate_limiter *rl, struct timespec now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_RATE_LIMITER_H */
@@ -0,0 +1,44 @@
+/**
+ * @file timespec_sleep.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_SLEEP_H
+#define DAN_TIMESPEC_SLEEP_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Periodic loop state. Initialise it with timespec_periodic_init(). The
+ * fields may be read but should only be changed through the functions below.
+*/
+struct timespec_periodic
+{
+	clockid_t clock;
+	struct timespec period;
+	struct timespec next;
+	uint64_t overruns;
+};
+
+int timespec_sleep_until(clockid_t clock, struct timespec deadline);
+
+struct timespec timespec_sleep_get_slack(void);
+void timespec_sleep_set_slack(struct timespec slack);
+struct timespec timespec_sleep_calibrate(clockid_t clock, unsigned samples);
+
+int timespec_periodic_init(struct timespec_periodic *p, clockid_t clock, struct timespec period);
+uint64_t timespec_periodic_wait(struct timespec_periodic *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_SLEEP_H */
@@ -0,0 +1,33 @@
+/**
+ * @file timespec_sort.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_SORT_H
+#define DAN_TIMESPEC_SORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool timespec_sort(struct timespec *a, size_t n);
+bool timespec_sort_parallel(struct timespec *a, size_t n, unsigned threads);
+bool timespec_sort_records(void *records, size_t n, size_t record_size, size_t key_offset);
+bool timespec_sort_records_parallel(void *records, size_t n, size_t record_size, size_t key_offset, unsigned threads);
+
+size_t timespec_sorted_until(const struct timespec *a, size_t n);
+size_t timespec_records_sorted_until(const void *records, size_t n, size_t record_size, size_t key_offset);
+size_t timespec_descents(const struct timespec *a, size_t n);
+size_t timespec_records_descents(const void *records, size_t n, size_t record_size, size_t key_offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_SORT_H */
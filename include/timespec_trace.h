@@ -0,0 +1,66 @@
+/**
+ * @file timespec_trace.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_TRACE_H
+#define DAN_TIMESPEC_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct timespec_trace;
+
+struct timespec_trace_event
+{
+	timespec_ns time;
+	const char *name;  /* NULL for the end of a span */
+	uint32_t thread;   /* Numbered from 1 in the order threads first record */
+	char phase;        /* 'B' begin, 'E' end or 'i' instant, as in the Chrome trace format */
+};
+
+struct timespec_trace_scope
+{
+	struct timespec_trace *trace;
+};
+
+struct timespec_trace *timespec_trace_create(clockid_t clock, uint32_t events_per_thread);
+void timespec_trace_destroy(struct timespec_trace *t);
+
+bool timespec_trace_begin(struct timespec_trace *t, const char *name);
+void timespec_trace_end(struct timespec_trace *t);
+bool timespec_trace_instant(struct timespec_trace *t, const char *name);
+bool timespec_trace_name_thread(struct timespec_trace *t, const char *name);
+
+struct timespec_trace_scope timespec_trace_scope_begin(struct timespec_trace *t, const char *name);
+void timespec_trace_scope_end(struct timespec_trace_scope *scope);
+
+size_t timespec_trace_drain(struct timespec_trace *t,
+	void (*visit)(const struct timespec_trace_event *event, void *arg), void *arg);
+uint64_t timespec_trace_dropped(struct timespec_trace *t);
+bool timespec_trace_export(struct timespec_trace *t, FILE *f);
+
+#define TIMESPEC_TRACE_CAT_(a, b) a##b
+#define TIMESPEC_TRACE_CAT(a, b) TIMESPEC_TRACE_CAT_(a, b)
+
+/* Traces a span from here to the end of the enclosing block. */
+#define TIMESPEC_TRACE_SCOPE(t, name) \
+	struct timespec_trace_scope TIMESPEC_TRACE_CAT(timespec_trace_scope_, __LINE__) \
+		__attribute__((cleanup(timespec_trace_scope_end), unused)) = timespec_trace_scope_begin((t), (name))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_TRACE_H */
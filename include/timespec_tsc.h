@@ -0,0 +1,40 @@
+/**
+ * @file timespec_tsc.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_TSC_H
+#define DAN_TIMESPEC_TSC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct timespec_tsc;
+
+struct timespec_tsc *timespec_tsc_create(clockid_t clock, struct timespec recalibrate_period);
+void timespec_tsc_destroy(struct timespec_tsc *tsc);
+bool timespec_tsc_fallback(const struct timespec_tsc *tsc);
+
+uint64_t timespec_tsc_cycles(const struct timespec_tsc *tsc);
+timespec_ns timespec_tsc_to_ns(const struct timespec_tsc *tsc, uint64_t cycles);
+struct timespec timespec_tsc_to_timespec(const struct timespec_tsc *tsc, uint64_t cycles);
+struct timespec timespec_tsc_now(const struct timespec_tsc *tsc);
+
+bool timespec_tsc_recalibrate(struct timespec_tsc *tsc);
+struct timespec timespec_tsc_error(const struct timespec_tsc *tsc);
+double timespec_tsc_frequency(const struct timespec_tsc *tsc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_TSC_H */
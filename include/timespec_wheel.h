@@ -0,0 +1,48 @@
+/**
+ * @file timespec_wheel.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_WHEEL_H
+#define DAN_TIMESPEC_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Intrusive timer node. Embed one in each object needing a timeout and
+ * initialise it with timespec_timer_init(); the fields are private.
+*/
+struct timespec_timer
+{
+	struct timespec_timer *next;
+	struct timespec_timer **pprev;
+	uint64_t expires;
+	void (*callback)(struct timespec_timer *timer);
+};
+
+struct timespec_wheel;
+
+struct timespec_wheel *timespec_wheel_create(struct timespec start, struct timespec tick);
+void timespec_wheel_destroy(struct timespec_wheel *wheel);
+
+void timespec_timer_init(struct timespec_timer *timer, void (*callback)(struct timespec_timer *timer));
+bool timespec_timer_pending(const struct timespec_timer *timer);
+
+void timespec_wheel_add(struct timespec_wheel *wheel, struct timespec_timer *timer, struct timespec deadline);
+bool timespec_wheel_cancel(struct timespec_wheel *wheel, struct timespec_timer *timer);
+size_t timespec_wheel_advance(struct timespec_wheel *wheel, struct timespec now);
+size_t timespec_wheel_count(const struct timespec_wheel *wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_WHEEL_H */
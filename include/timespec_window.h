@@ -0,0 +1,40 @@
+/**
+ * @file timespec_window.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_WINDOW_H
+#define DAN_TIMESPEC_WINDOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct timespec_window;
+
+struct timespec_window *timespec_window_create(struct timespec bucket_width, uint32_t buckets);
+void timespec_window_destroy(struct timespec_window *w);
+struct timespec timespec_window_span(const struct timespec_window *w);
+
+bool timespec_window_record(struct timespec_window *w, struct timespec now, uint64_t n);
+bool timespec_window_record_ns(struct timespec_window *w, timespec_ns now, uint64_t n);
+
+uint64_t timespec_window_sum(const struct timespec_window *w, struct timespec now, struct timespec window);
+uint64_t timespec_window_sum_ns(const struct timespec_window *w, timespec_ns now, timespec_ns window);
+double timespec_window_rate(const struct timespec_window *w, struct timespec now, struct timespec window);
+
+bool timespec_window_merge(struct timespec_window *dst, const struct timespec_window *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_WINDOW_H */
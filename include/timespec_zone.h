@@ -0,0 +1,47 @@
+/**
+ * @file timespec_zone.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#ifndef DAN_TIMESPEC_ZONE_H
+#define DAN_TIMESPEC_ZONE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A time broken down into the fields of a time zone's wall clock. */
+struct timespec_local
+{
+	/* The standard fields, as from localtime_r(); any extensions are zero. */
+	struct tm tm;
+	long nsec;
+
+	/* Seconds east of UTC. */
+	int32_t utc_offset;
+
+	/* Abbreviation, such as "EST", valid as long as the zone. */
+	const char *abbrev;
+};
+
+struct timespec_zone;
+
+struct timespec_zone *timespec_zone_load(const char *name);
+struct timespec_zone *timespec_zone_parse(const void *buf, size_t len);
+void timespec_zone_destroy(struct timespec_zone *zone);
+
+bool timespec_zone_to_local(const struct timespec_zone *zone, struct timespec ts, struct timespec_local *out);
+int32_t timespec_zone_offset(const struct timespec_zone *zone, struct timespec ts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !DAN_TIMESPEC_ZONE_H */
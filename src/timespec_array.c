@@ -0,0 +1,501 @@
+/**
+ * @file timespec_array.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Batched versions of timespec_add(), timespec_sub() and timespec_lt() for
+ * arrays of timespec structures.
+ *
+ * Each function produces exactly the same result for every element as the
+ * corresponding single-value function. On x86-64 the work is done by SSE2 or
+ * AVX2 kernels selected at runtime; these handle groups of elements whose
+ * inputs are already normalised (the common case) in vector registers, and
+ * hand any group containing a non-normalised input to the scalar functions.
+ * Other platforms always use the scalar kernels.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_array.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define TIMESPEC_ARRAY_X86 1
+#include <immintrin.h>
+#endif
+
+struct timespec_array_kernels
+{
+	enum timespec_array_impl impl;
+
+	/* out[i] = timespec_add(in[i], offset), offset is normalised. */
+	void (*add)(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset);
+
+	/* out[i] = timespec_sub(ts1[i], ts2[i]) */
+	void (*diff)(struct timespec *out, const struct timespec *ts1, const struct timespec *ts2, size_t n);
+
+	/* Bit i set if timespec_lt(in[i], threshold), n <= 64. */
+	uint64_t (*lt_bits)(const struct timespec *in, size_t n, struct timespec threshold);
+};
+
+static void scalar_add(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset)
+{
+	for(size_t i = 0; i < n; ++i)
+	{
+		out[i] = timespec_add(in[i], offset);
+	}
+}
+
+static void scalar_diff(struct timespec *out, const struct timespec *ts1, const struct timespec *ts2, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+	{
+		out[i] = timespec_sub(ts1[i], ts2[i]);
+	}
+}
+
+static uint64_t scalar_lt_bits(const struct timespec *in, size_t n, struct timespec threshold)
+{
+	uint64_t bits = 0;
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		bits |= (uint64_t)(timespec_lt(in[i], threshold)) << i;
+	}
+
+	return bits;
+}
+
+static const struct timespec_array_kernels scalar_kernels = {
+	TIMESPEC_ARRAY_SCALAR, scalar_add, scalar_diff, scalar_lt_bits
+};
+
+#ifdef TIMESPEC_ARRAY_X86
+
+/* SSE2 kernels. Two timespecs are deinterleaved into a vector of tv_sec and a
+ * vector of tv_nsec values. SSE2 has no 64-bit compare so it is emulated.
+*/
+
+static inline __m128i sse2_gt(__m128i a, __m128i b)
+{
+	/* High dwords decide unless they are equal, in which case the borrow out
+	 * of the unsigned low dword subtraction b - a does.
+	*/
+	__m128i r = _mm_and_si128(_mm_cmpeq_epi32(a, b), _mm_sub_epi64(b, a));
+	r = _mm_or_si128(r, _mm_cmpgt_epi32(a, b));
+
+	return _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 3, 1, 1));
+}
+
+static inline __m128i sse2_eq(__m128i a, __m128i b)
+{
+	__m128i r = _mm_cmpeq_epi32(a, b);
+
+	return _mm_and_si128(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+/* Returns an all-ones lane for each normalised (sec, nsec) pair. */
+static inline __m128i sse2_normalised(__m128i sec, __m128i nsec)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i in_range = _mm_and_si128(
+		sse2_gt(nsec, _mm_set1_epi64x(-1000000000)),
+		sse2_gt(_mm_set1_epi64x(1000000000), nsec));
+	__m128i mixed = _mm_or_si128(
+		_mm_and_si128(sse2_gt(zero, nsec), sse2_gt(sec, zero)),
+		_mm_and_si128(sse2_gt(nsec, zero), sse2_gt(zero, sec)));
+
+	return _mm_andnot_si128(mixed, in_range);
+}
+
+/* Vector equivalent of timespec_normalise_carry(). */
+static inline void sse2_normalise_carry(__m128i *sec, __m128i *nsec)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i nsec_per_sec = _mm_set1_epi64x(1000000000);
+
+	__m128i over  = sse2_gt(*nsec, _mm_set1_epi64x(999999999));
+	__m128i under = sse2_gt(_mm_set1_epi64x(-999999999), *nsec);
+
+	*sec  = _mm_add_epi64(_mm_sub_epi64(*sec, over), under);
+	*nsec = _mm_add_epi64(_mm_sub_epi64(*nsec, _mm_and_si128(over, nsec_per_sec)),
+		_mm_and_si128(under, nsec_per_sec));
+
+	__m128i borrow = _mm_and_si128(sse2_gt(zero, *nsec), sse2_gt(*sec, zero));
+	__m128i carry  = _mm_and_si128(sse2_gt(*nsec, zero), sse2_gt(zero, *sec));
+
+	*sec  = _mm_add_epi64(_mm_sub_epi64(*sec, carry), borrow);
+	*nsec = _mm_sub_epi64(_mm_add_epi64(*nsec, _mm_and_si128(borrow, nsec_per_sec)),
+		_mm_and_si128(carry, nsec_per_sec));
+}
+
+static void sse2_add(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset)
+{
+	const __m128i off_sec  = _mm_set1_epi64x(offset.tv_sec);
+	const __m128i off_nsec = _mm_set1_epi64x(offset.tv_nsec);
+	size_t i = 0;
+
+	for(; i + 2 <= n; i += 2)
+	{
+		__m128i v0 = _mm_loadu_si128((const __m128i*)(&in[i]));
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(&in[i + 1]));
+		__m128i sec  = _mm_unpacklo_epi64(v0, v1);
+		__m128i nsec = _mm_unpackhi_epi64(v0, v1);
+
+		if(_mm_movemask_epi8(sse2_normalised(sec, nsec)) != 0xFFFF)
+		{
+			scalar_add(&out[i], &in[i], 2, offset);
+			continue;
+		}
+
+		sec  = _mm_add_epi64(sec, off_sec);
+		nsec = _mm_add_epi64(nsec, off_nsec);
+		sse2_normalise_carry(&sec, &nsec);
+
+		_mm_storeu_si128((__m128i*)(&out[i]), _mm_unpacklo_epi64(sec, nsec));
+		_mm_storeu_si128((__m128i*)(&out[i + 1]), _mm_unpackhi_epi64(sec, nsec));
+	}
+
+	scalar_add(&out[i], &in[i], n - i, offset);
+}
+
+static void sse2_diff(struct timespec *out, const struct timespec *ts1, const struct timespec *ts2, size_t n)
+{
+	size_t i = 0;
+
+	for(; i + 2 <= n; i += 2)
+	{
+		__m128i a0 = _mm_loadu_si128((const __m128i*)(&ts1[i]));
+		__m128i a1 = _mm_loadu_si128((const __m128i*)(&ts1[i + 1]));
+		__m128i b0 = _mm_loadu_si128((const __m128i*)(&ts2[i]));
+		__m128i b1 = _mm_loadu_si128((const __m128i*)(&ts2[i + 1]));
+		__m128i a_sec  = _mm_unpacklo_epi64(a0, a1);
+		__m128i a_nsec = _mm_unpackhi_epi64(a0, a1);
+		__m128i b_sec  = _mm_unpacklo_epi64(b0, b1);
+		__m128i b_nsec = _mm_unpackhi_epi64(b0, b1);
+
+		__m128i valid = _mm_and_si128(sse2_normalised(a_sec, a_nsec), sse2_normalised(b_sec, b_nsec));
+		if(_mm_movemask_epi8(valid) != 0xFFFF)
+		{
+			scalar_diff(&out[i], &ts1[i], &ts2[i], 2);
+			continue;
+		}
+
+		__m128i sec  = _mm_sub_epi64(a_sec, b_sec);
+		__m128i nsec = _mm_sub_epi64(a_nsec, b_nsec);
+		sse2_normalise_carry(&sec, &nsec);
+
+		_mm_storeu_si128((__m128i*)(&out[i]), _mm_unpacklo_epi64(sec, nsec));
+		_mm_storeu_si128((__m128i*)(&out[i + 1]), _mm_unpackhi_epi64(sec, nsec));
+	}
+
+	scalar_diff(&out[i], &ts1[i], &ts2[i], n - i);
+}
+
+static uint64_t sse2_lt_bits(const struct timespec *in, size_t n, struct timespec threshold)
+{
+	const __m128i th_sec  = _mm_set1_epi64x(threshold.tv_sec);
+	const __m128i th_nsec = _mm_set1_epi64x(threshold.tv_nsec);
+	uint64_t bits = 0;
+	size_t i = 0;
+
+	for(; i + 2 <= n; i += 2)
+	{
+		__m128i v0 = _mm_loadu_si128((const __m128i*)(&in[i]));
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(&in[i + 1]));
+		__m128i sec  = _mm_unpacklo_epi64(v0, v1);
+		__m128i nsec = _mm_unpackhi_epi64(v0, v1);
+
+		__m128i lt = _mm_or_si128(sse2_gt(th_sec, sec),
+			_mm_and_si128(sse2_eq(sec, th_sec), sse2_gt(th_nsec, nsec)));
+
+		bits |= (uint64_t)(_mm_movemask_pd(_mm_castsi128_pd(lt))) << i;
+	}
+
+	if(i < n)
+	{
+		bits |= scalar_lt_bits(&in[i], n - i, threshold) << i;
+	}
+
+	return bits;
+}
+
+static const struct timespec_array_kernels sse2_kernels = {
+	TIMESPEC_ARRAY_SSE2, sse2_add, sse2_diff, sse2_lt_bits
+};
+
+/* AVX2 kernels. Four timespecs are deinterleaved at a time; unpacking within
+ * 128-bit lanes leaves the elements in the order 0, 2, 1, 3, which the
+ * re-interleaving undoes and lt_bits accounts for.
+*/
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2_normalised(__m256i sec, __m256i nsec)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	__m256i in_range = _mm256_and_si256(
+		_mm256_cmpgt_epi64(nsec, _mm256_set1_epi64x(-1000000000)),
+		_mm256_cmpgt_epi64(_mm256_set1_epi64x(1000000000), nsec));
+	__m256i mixed = _mm256_or_si256(
+		_mm256_and_si256(_mm256_cmpgt_epi64(zero, nsec), _mm256_cmpgt_epi64(sec, zero)),
+		_mm256_and_si256(_mm256_cmpgt_epi64(nsec, zero), _mm256_cmpgt_epi64(zero, sec)));
+
+	return _mm256_andnot_si256(mixed, in_range);
+}
+
+AVX2 static inline void avx2_normalise_carry(__m256i *sec, __m256i *nsec)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i nsec_per_sec = _mm256_set1_epi64x(1000000000);
+
+	__m256i over  = _mm256_cmpgt_epi64(*nsec, _mm256_set1_epi64x(999999999));
+	__m256i under = _mm256_cmpgt_epi64(_mm256_set1_epi64x(-999999999), *nsec);
+
+	*sec  = _mm256_add_epi64(_mm256_sub_epi64(*sec, over), under);
+	*nsec = _mm256_add_epi64(_mm256_sub_epi64(*nsec, _mm256_and_si256(over, nsec_per_sec)),
+		_mm256_and_si256(under, nsec_per_sec));
+
+	__m256i borrow = _mm256_and_si256(_mm256_cmpgt_epi64(zero, *nsec), _mm256_cmpgt_epi64(*sec, zero));
+	__m256i carry  = _mm256_and_si256(_mm256_cmpgt_epi64(*nsec, zero), _mm256_cmpgt_epi64(zero, *sec));
+
+	*sec  = _mm256_add_epi64(_mm256_sub_epi64(*sec, carry), borrow);
+	*nsec = _mm256_sub_epi64(_mm256_add_epi64(*nsec, _mm256_and_si256(borrow, nsec_per_sec)),
+		_mm256_and_si256(carry, nsec_per_sec));
+}
+
+AVX2 static void avx2_add(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset)
+{
+	const __m256i off_sec  = _mm256_set1_epi64x(offset.tv_sec);
+	const __m256i off_nsec = _mm256_set1_epi64x(offset.tv_nsec);
+	size_t i = 0;
+
+	for(; i + 4 <= n; i += 4)
+	{
+		__m256i v0 = _mm256_loadu_si256((const __m256i*)(&in[i]));
+		__m256i v1 = _mm256_loadu_si256((const __m256i*)(&in[i + 2]));
+		__m256i sec  = _mm256_unpacklo_epi64(v0, v1);
+		__m256i nsec = _mm256_unpackhi_epi64(v0, v1);
+
+		if(_mm256_movemask_epi8(avx2_normalised(sec, nsec)) != -1)
+		{
+			scalar_add(&out[i], &in[i], 4, offset);
+			continue;
+		}
+
+		sec  = _mm256_add_epi64(sec, off_sec);
+		nsec = _mm256_add_epi64(nsec, off_nsec);
+		avx2_normalise_carry(&sec, &nsec);
+
+		_mm256_storeu_si256((__m256i*)(&out[i]), _mm256_unpacklo_epi64(sec, nsec));
+		_mm256_storeu_si256((__m256i*)(&out[i + 2]), _mm256_unpackhi_epi64(sec, nsec));
+	}
+
+	sse2_add(&out[i], &in[i], n - i, offset);
+}
+
+AVX2 static void avx2_diff(struct timespec *out, const struct timespec *ts1, const struct timespec *ts2, size_t n)
+{
+	size_t i = 0;
+
+	for(; i + 4 <= n; i += 4)
+	{
+		__m256i a0 = _mm256_loadu_si256((const __m256i*)(&ts1[i]));
+		__m256i a1 = _mm256_loadu_si256((const __m256i*)(&ts1[i + 2]));
+		__m256i b0 = _mm256_loadu_si256((const __m256i*)(&ts2[i]));
+		__m256i b1 = _mm256_loadu_si256((const __m256i*)(&ts2[i + 2]));
+		__m256i a_sec  = _mm256_unpacklo_epi64(a0, a1);
+		__m256i a_nsec = _mm256_unpackhi_epi64(a0, a1);
+		__m256i b_sec  = _mm256_unpacklo_epi64(b0, b1);
+		__m256i b_nsec = _mm256_unpackhi_epi64(b0, b1);
+
+		__m256i valid = _mm256_and_si256(avx2_normalised(a_sec, a_nsec), avx2_normalised(b_sec, b_nsec));
+		if(_mm256_movemask_epi8(valid) != -1)
+		{
+			scalar_diff(&out[i], &ts1[i], &ts2[i], 4);
+			continue;
+		}
+
+		__m256i sec  = _mm256_sub_epi64(a_sec, b_sec);
+		__m256i nsec = _mm256_sub_epi64(a_nsec, b_nsec);
+		avx2_normalise_carry(&sec, &nsec);
+
+		_mm256_storeu_si256((__m256i*)(&out[i]), _mm256_unpacklo_epi64(sec, nsec));
+		_mm256_storeu_si256((__m256i*)(&out[i + 2]), _mm256_unpackhi_epi64(sec, nsec));
+	}
+
+	sse2_diff(&out[i], &ts1[i], &ts2[i], n - i);
+}
+
+AVX2 static uint64_t avx2_lt_bits(const struct timespec *in, size_t n, struct timespec threshold)
+{
+	const __m256i th_sec  = _mm256_set1_epi64x(threshold.tv_sec);
+	const __m256i th_nsec = _mm256_set1_epi64x(threshold.tv_nsec);
+	uint64_t bits = 0;
+	size_t i = 0;
+
+	for(; i + 4 <= n; i += 4)
+	{
+		__m256i v0 = _mm256_loadu_si256((const __m256i*)(&in[i]));
+		__m256i v1 = _mm256_loadu_si256((const __m256i*)(&in[i + 2]));
+		__m256i sec  = _mm256_unpacklo_epi64(v0, v1);
+		__m256i nsec = _mm256_unpackhi_epi64(v0, v1);
+
+		__m256i lt = _mm256_or_si256(_mm256_cmpgt_epi64(th_sec, sec),
+			_mm256_and_si256(_mm256_cmpeq_epi64(sec, th_sec), _mm256_cmpgt_epi64(th_nsec, nsec)));
+
+		/* Lanes hold elements 0, 2, 1, 3; swap the middle two bits back. */
+		unsigned m = (unsigned)(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+		m = (m & 9u) | ((m & 2u) << 1) | ((m & 4u) >> 1);
+
+		bits |= (uint64_t)(m) << i;
+	}
+
+	if(i < n)
+	{
+		bits |= sse2_lt_bits(&in[i], n - i, threshold) << i;
+	}
+
+	return bits;
+}
+
+#undef AVX2
+
+static const struct timespec_array_kernels avx2_kernels = {
+	TIMESPEC_ARRAY_AVX2, avx2_add, avx2_diff, avx2_lt_bits
+};
+
+#endif /* TIMESPEC_ARRAY_X86 */
+
+static const struct timespec_array_kernels *active_kernels = NULL;
+
+static const struct timespec_array_kernels *kernels_for(enum timespec_array_impl impl)
+{
+	switch(impl)
+	{
+		case TIMESPEC_ARRAY_SCALAR:
+			return &scalar_kernels;
+
+#ifdef TIMESPEC_ARRAY_X86
+		case TIMESPEC_ARRAY_SSE2:
+			return &sse2_kernels;
+
+		case TIMESPEC_ARRAY_AVX2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+
+		default:
+			return NULL;
+	}
+}
+
+static const struct timespec_array_kernels *kernels(void)
+{
+	const struct timespec_array_kernels *k = __atomic_load_n(&active_kernels, __ATOMIC_ACQUIRE);
+
+	if(k == NULL)
+	{
+		/* Pick the best supported implementation. Racing initialisations all
+		 * store the same pointer so no locking is needed.
+		*/
+		k = kernels_for(TIMESPEC_ARRAY_AVX2);
+		if(k == NULL)
+		{
+			k = kernels_for(TIMESPEC_ARRAY_SSE2);
+		}
+		if(k == NULL)
+		{
+			k = &scalar_kernels;
+		}
+
+		__atomic_store_n(&active_kernels, k, __ATOMIC_RELEASE);
+	}
+
+	return k;
+}
+
+/** \fn void timespec_add_array(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset)
+ *  \brief Sets out[i] to timespec_add(in[i], offset) for n elements.
+ *
+ * out may be the same array as in.
+*/
+void timespec_add_array(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset)
+{
+	kernels()->add(out, in, n, timespec_normalise(offset));
+}
+
+/** \fn void timespec_sub_array(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset)
+ *  \brief Sets out[i] to timespec_sub(in[i], offset) for n elements.
+ *
+ * out may be the same array as in.
+*/
+void timespec_sub_array(struct timespec *out, const struct timespec *in, size_t n, struct timespec offset)
+{
+	offset = timespec_normalise(offset);
+	offset.tv_sec  = -offset.tv_sec;
+	offset.tv_nsec = -offset.tv_nsec;
+
+	kernels()->add(out, in, n, offset);
+}
+
+/** \fn void timespec_diff_array(struct timespec *out, const struct timespec *ts1, const struct timespec *ts2, size_t n)
+ *  \brief Sets out[i] to timespec_sub(ts1[i], ts2[i]) for n elements.
+ *
+ * out may be the same array as ts1 or ts2.
+*/
+void timespec_diff_array(struct timespec *out, const struct timespec *ts1, const struct timespec *ts2, size_t n)
+{
+	kernels()->diff(out, ts1, ts2, n);
+}
+
+/** \fn void timespec_lt_mask(uint64_t *mask, const struct timespec *in, size_t n, struct timespec threshold)
+ *  \brief Sets bit i of mask if timespec_lt(in[i], threshold) for n elements.
+ *
+ * Element i maps to bit (i % 64) of mask[i / 64]; mask must hold (n + 63) / 64
+ * words. Unused bits in the final word are cleared.
+*/
+void timespec_lt_mask(uint64_t *mask, const struct timespec *in, size_t n, struct timespec threshold)
+{
+	const struct timespec_array_kernels *k = kernels();
+
+	for(size_t i = 0; i < n; i += 64)
+	{
+		size_t count = (n - i < 64) ? (n - i) : 64;
+
+		mask[i / 64] = k->lt_bits(&in[i], count, threshold);
+	}
+}
+
+/** \fn enum timespec_array_impl timespec_array_get_impl(void)
+ *  \brief Returns the implementation currently used by the array functions.
+*/
+enum timespec_array_impl timespec_array_get_impl(void)
+{
+	return kernels()->impl;
+}
+
+/** \fn bool timespec_array_set_impl(enum timespec_array_impl impl)
+ *  \brief Forces the array functions to use a particular implementation.
+ *
+ * Returns false, leaving the current implementation in place, if impl is not
+ * supported by this CPU or build. Intended for testing and benchmarking.
+*/
+bool timespec_array_set_impl(enum timespec_array_impl impl)
+{
+	const struct timespec_array_kernels *k = kernels_for(impl);
+
+	if(k == NULL)
+	{
+		return false;
+	}
+
+	__atomic_store_n(&active_kernels, k, __ATOMIC_RELEASE);
+	return true;
+}
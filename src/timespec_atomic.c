@@ -0,0 +1,150 @@
+/**
+ * @file timespec_atomic.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * A timespec which can be shared between threads without a lock.
+ *
+ * Two-word timespec values cannot be read or written atomically without a
+ * double-width compare-and-swap, whose loads are writes that bounce the
+ * cache line between readers, or a sequence lock, which makes writers
+ * exclude each other. Like the cached clock, this instead keeps the time
+ * as a timespec_ns in one 64-bit word, which every supported target loads
+ * and stores atomically with plain instructions. Readers never write, so
+ * any number of them can poll a value without slowing its publisher, and
+ * the read-modify-write operations are a single compare-and-swap.
+ *
+ * The cost is range: values more than about 292 years from the epoch
+ * saturate, as with timespec_ns_from_timespec().
+ *
+ * Stores have release and loads acquire ordering, so everything a thread
+ * wrote before publishing a time is visible to a thread which reads it.
+*/
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_atomic.h"
+
+/** \fn void timespec_atomic_init(struct timespec_atomic *a, struct timespec ts)
+ *  \brief Initialises an atomic timespec before it is shared.
+*/
+void timespec_atomic_init(struct timespec_atomic *a, struct timespec ts)
+{
+	a->ns = timespec_ns_from_timespec(ts);
+}
+
+/** \fn struct timespec timespec_atomic_load(const struct timespec_atomic *a)
+ *  \brief Returns the value of an atomic timespec, normalised.
+*/
+struct timespec timespec_atomic_load(const struct timespec_atomic *a)
+{
+	return timespec_ns_to_timespec(__atomic_load_n(&a->ns, __ATOMIC_ACQUIRE));
+}
+
+/** \fn timespec_ns timespec_atomic_load_ns(const struct timespec_atomic *a)
+ *  \brief Returns the value of an atomic timespec as a timespec_ns.
+*/
+timespec_ns timespec_atomic_load_ns(const struct timespec_atomic *a)
+{
+	return __atomic_load_n(&a->ns, __ATOMIC_ACQUIRE);
+}
+
+/** \fn void timespec_atomic_store(struct timespec_atomic *a, struct timespec ts)
+ *  \brief Sets the value of an atomic timespec.
+*/
+void timespec_atomic_store(struct timespec_atomic *a, struct timespec ts)
+{
+	__atomic_store_n(&a->ns, timespec_ns_from_timespec(ts), __ATOMIC_RELEASE);
+}
+
+/** \fn void timespec_atomic_store_ns(struct timespec_atomic *a, timespec_ns ns)
+ *  \brief Sets the value of an atomic timespec from a timespec_ns.
+*/
+void timespec_atomic_store_ns(struct timespec_atomic *a, timespec_ns ns)
+{
+	__atomic_store_n(&a->ns, ns, __ATOMIC_RELEASE);
+}
+
+/** \fn struct timespec timespec_atomic_exchange(struct timespec_atomic *a, struct timespec ts)
+ *  \brief Sets the value of an atomic timespec and returns the old value.
+*/
+struct timespec timespec_atomic_exchange(struct timespec_atomic *a, struct timespec ts)
+{
+	return timespec_ns_to_timespec(__atomic_exchange_n(&a->ns, timespec_ns_from_timespec(ts), __ATOMIC_ACQ_REL));
+}
+
+/** \fn bool timespec_atomic_compare_exchange(struct timespec_atomic *a, struct timespec *expected, struct timespec desired)
+ *  \brief Sets an atomic timespec to desired if it equals *expected.
+ *
+ * Values are compared with timespec_eq() semantics, so expected need not be
+ * normalised. Returns true if the value was replaced; otherwise returns false
+ * and sets *expected to the current value.
+*/
+bool timespec_atomic_compare_exchange(struct timespec_atomic *a, struct timespec *expected, struct timespec desired)
+{
+	timespec_ns old = timespec_ns_from_timespec(*expected);
+
+	if(__atomic_compare_exchange_n(&a->ns, &old, timespec_ns_from_timespec(desired), false, __ATOMIC_ACQ_REL,
+		__ATOMIC_ACQUIRE))
+	{
+		return true;
+	}
+
+	*expected = timespec_ns_to_timespec(old);
+
+	return false;
+}
+
+/** \fn struct timespec timespec_atomic_fetch_max(struct timespec_atomic *a, struct timespec ts)
+ *  \brief Raises an atomic timespec to ts if ts is later, and returns the old value.
+ *
+ * For "latest seen" watermarks updated by many threads: the value only ever
+ * moves forward, whatever order the updates arrive in.
+*/
+struct timespec timespec_atomic_fetch_max(struct timespec_atomic *a, struct timespec ts)
+{
+	timespec_ns ns = timespec_ns_from_timespec(ts);
+	timespec_ns old = __atomic_load_n(&a->ns, __ATOMIC_ACQUIRE);
+
+	while(ns > old && !__atomic_compare_exchange_n(&a->ns, &old, ns, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+	}
+
+	return timespec_ns_to_timespec(old);
+}
+
+/** \fn struct timespec timespec_atomic_fetch_min(struct timespec_atomic *a, struct timespec ts)
+ *  \brief Lowers an atomic timespec to ts if ts is earlier, and returns the old value.
+*/
+struct timespec timespec_atomic_fetch_min(struct timespec_atomic *a, struct timespec ts)
+{
+	timespec_ns ns = timespec_ns_from_timespec(ts);
+	timespec_ns old = __atomic_load_n(&a->ns, __ATOMIC_ACQUIRE);
+
+	while(ns < old && !__atomic_compare_exchange_n(&a->ns, &old, ns, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+	}
+
+	return timespec_ns_to_timespec(old);
+}
+
+/** \fn struct timespec timespec_atomic_fetch_add(struct timespec_atomic *a, struct timespec duration)
+ *  \brief Adds a duration to an atomic timespec and returns the old value.
+ *
+ * Saturates like timespec_ns_add() rather than overflowing.
+*/
+struct timespec timespec_atomic_fetch_add(struct timespec_atomic *a, struct timespec duration)
+{
+	timespec_ns ns = timespec_ns_from_timespec(duration);
+	timespec_ns old = __atomic_load_n(&a->ns, __ATOMIC_ACQUIRE);
+
+	while(!__atomic_compare_exchange_n(&a->ns, &old, timespec_ns_add(old, ns), true, __ATOMIC_ACQ_REL,
+		__ATOMIC_ACQUIRE))
+	{
+	}
+
+	return timespec_ns_to_timespec(old);
+}
@@ -0,0 +1,261 @@
+/**
+ * @file timespec_clock.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Clock readers returning timespec structures.
+ *
+ * timespec_now() is a thin wrapper around clock_gettime(). A cached clock
+ * trades precision for read cost: the current time is kept in a single 64-bit
+ * slot (as a timespec_ns) that readers fetch with one atomic load, either
+ * published by a background ticker thread or taken from the kernel's coarse
+ * clocks, which are updated once per scheduler tick and read without a
+ * hardware counter access.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_clock.h"
+
+struct timespec_cached_clock
+{
+	/* Published reading, alone on its cache line so the ticker's writes do
+	 * not invalidate anything else readers touch.
+	*/
+	timespec_ns now __attribute__((aligned(64)));
+
+	/* Largest observed gap between two publications. */
+	timespec_ns staleness __attribute__((aligned(64)));
+
+	clockid_t clock;
+	enum timespec_clock_mode mode;
+	struct timespec resolution;
+	bool stop;
+	pthread_t thread;
+};
+
+static void *ticker_main(void *arg)
+{
+	struct timespec_cached_clock *cc = arg;
+	struct timespec next = timespec_now(CLOCK_MONOTONIC);
+	timespec_ns last = __atomic_load_n(&cc->now, __ATOMIC_RELAXED);
+
+	while(!__atomic_load_n(&cc->stop, __ATOMIC_ACQUIRE))
+	{
+		/* Pace on absolute monotonic deadlines so the period does not drift
+		 * by the time spent publishing, whatever clock is being cached.
+		*/
+		next = timespec_add_normalised(next, cc->resolution);
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+		{
+		}
+
+		timespec_ns now = timespec_ns_from_timespec(timespec_now(cc->clock));
+		timespec_ns gap = timespec_ns_sub(now, last);
+
+		__atomic_store_n(&cc->now, now, __ATOMIC_RELEASE);
+		if(gap > __atomic_load_n(&cc->staleness, __ATOMIC_RELAXED))
+		{
+			__atomic_store_n(&cc->staleness, gap, __ATOMIC_RELAXED);
+		}
+		last = now;
+
+		/* If the thread was descheduled for more than a period, restart the
+		 * schedule from now rather than publishing a burst to catch up.
+		*/
+		struct timespec mono = timespec_now(CLOCK_MONOTONIC);
+		if(timespec_gt(mono, timespec_add_normalised(next, cc->resolution)))
+		{
+			next = mono;
+		}
+	}
+
+	return NULL;
+}
+
+static bool coarse_clock(clockid_t clock, clockid_t *coarse)
+{
+	switch(clock)
+	{
+#ifdef CLOCK_REALTIME_COARSE
+		case CLOCK_REALTIME:
+			*coarse = CLOCK_REALTIME_COARSE;
+			return true;
+#endif
+
+#ifdef CLOCK_MONOTONIC_COARSE
+		case CLOCK_MONOTONIC:
+			*coarse = CLOCK_MONOTONIC_COARSE;
+			return true;
+#endif
+
+		default:
+			return false;
+	}
+}
+
+/** \fn struct timespec timespec_now(clockid_t clock)
+ *  \brief Returns the current time of the given clock.
+ *
+ * Returns a zero timespec and sets errno if the clock cannot be read.
+*/
+struct timespec timespec_now(clockid_t clock)
+{
+	struct timespec ts;
+
+	if(clock_gettime(clock, &ts) != 0)
+	{
+		ts.tv_sec  = 0;
+		ts.tv_nsec = 0;
+	}
+
+	return ts;
+}
+
+/** \fn struct timespec_cached_clock *timespec_cached_clock_create(clockid_t clock, enum timespec_clock_mode mode, struct timespec resolution)
+ *  \brief Creates a cached reader for a clock.
+ *
+ * In TIMESPEC_CLOCK_TICKER mode a background thread reads clock every
+ * resolution and publishes the result. In TIMESPEC_CLOCK_COARSE mode no thread
+ * is started and reads use the coarse variant of clock, which must be
+ * CLOCK_REALTIME or CLOCK_MONOTONIC; resolution is ignored.
+ *
+ * Returns NULL and sets errno on failure.
+*/
+struct timespec_cached_clock *timespec_cached_clock_create(clockid_t clock, enum timespec_clock_mode mode,
+	struct timespec resolution)
+{
+	struct timespec_cached_clock *cc;
+	struct timespec ts;
+	void *mem;
+	int err;
+
+	resolution = timespec_normalise(resolution);
+
+	if(clock_gettime(clock, &ts) != 0)
+	{
+		return NULL;
+	}
+
+	if(posix_memalign(&mem, 64, sizeof(*cc)) != 0)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+	cc = mem;
+
+	cc->clock = clock;
+	cc->mode = mode;
+	cc->resolution = resolution;
+	cc->stop = false;
+	cc->now = timespec_ns_from_timespec(ts);
+	cc->staleness = 0;
+
+	switch(mode)
+	{
+		case TIMESPEC_CLOCK_TICKER:
+			if(resolution.tv_sec < 0 || (resolution.tv_sec == 0 && resolution.tv_nsec <= 0))
+			{
+				err = EINVAL;
+				break;
+			}
+
+			cc->staleness = timespec_ns_from_timespec(resolution);
+			err = pthread_create(&cc->thread, NULL, ticker_main, cc);
+			break;
+
+		case TIMESPEC_CLOCK_COARSE:
+			if(!coarse_clock(clock, &cc->clock) || clock_getres(cc->clock, &ts) != 0)
+			{
+				err = EINVAL;
+				break;
+			}
+
+			cc->resolution = ts;
+			cc->staleness = timespec_ns_from_timespec(ts);
+			err = 0;
+			break;
+
+		default:
+			err = EINVAL;
+			break;
+	}
+
+	if(err != 0)
+	{
+		free(cc);
+		errno = err;
+		return NULL;
+	}
+
+	return cc;
+}
+
+/** \fn void timespec_cached_clock_destroy(struct timespec_cached_clock *cc)
+ *  \brief Stops and frees a cached clock. NULL is ignored.
+*/
+void timespec_cached_clock_destroy(struct timespec_cached_clock *cc)
+{
+	if(cc == NULL)
+	{
+		return;
+	}
+
+	if(cc->mode == TIMESPEC_CLOCK_TICKER)
+	{
+		__atomic_store_n(&cc->stop, true, __ATOMIC_RELEASE);
+		pthread_join(cc->thread, NULL);
+	}
+
+	free(cc);
+}
+
+/** \fn timespec_ns timespec_cached_clock_now_ns(const struct timespec_cached_clock *cc)
+ *  \brief Returns the cached time as a timespec_ns.
+ *
+ * The value lags the real time of the clock by at most the bound returned by
+ * timespec_cached_clock_staleness(). Safe to call from any number of threads.
+*/
+timespec_ns timespec_cached_clock_now_ns(const struct timespec_cached_clock *cc)
+{
+	if(cc->mode == TIMESPEC_CLOCK_COARSE)
+	{
+		return timespec_ns_from_timespec(timespec_now(cc->clock));
+	}
+
+	return __atomic_load_n(&cc->now, __ATOMIC_ACQUIRE);
+}
+
+/** \fn struct timespec timespec_cached_clock_now(const struct timespec_cached_clock *cc)
+ *  \brief Returns the cached time as a timespec.
+ *
+ * See timespec_cached_clock_now_ns().
+*/
+struct timespec timespec_cached_clock_now(const struct timespec_cached_clock *cc)
+{
+	if(cc->mode == TIMESPEC_CLOCK_COARSE)
+	{
+		return timespec_now(cc->clock);
+	}
+
+	return timespec_ns_to_timespec(__atomic_load_n(&cc->now, __ATOMIC_ACQUIRE));
+}
+
+/** \fn struct timespec timespec_cached_clock_staleness(const struct timespec_cached_clock *cc)
+ *  \brief Returns how far the cached time may lag the clock.
+ *
+ * For a ticker this is the largest gap observed so far between two
+ * publications, which is never less than the configured resolution and grows
+ * if the ticker thread is delayed. For a coarse clock it is the resolution
+ * reported by clock_getres().
+*/
+struct timespec timespec_cached_clock_staleness(const struct timespec_cached_clock *cc)
+{
+	return timespec_ns_to_timespec(__atomic_load_n(&cc->staleness, __ATOMIC_RELAXED));
+}
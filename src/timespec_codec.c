@@ -0,0 +1,630 @@
+/**
+ * @file timespec_codec.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Delta-of-delta compression of timestamp sequences, after the timestamp
+ * encoding in Facebook's Gorilla time series database.
+ *
+ * Timestamps are stored as timespec_ns. Within a block, the first is stored
+ * whole and every later one as the change in the interval since the previous
+ * one (the delta of the delta), zigzag encoded and written with a prefix code:
+ *
+ *     0                   unchanged interval
+ *     10    + 7 bits      |dod| below 2^6
+ *     110   + 12 bits     below 2^11 (about 2us)
+ *     1110  + 18 bits     below 2^17 (about 130us)
+ *     11110 + 32 bits     below 2^31 (about 2s)
+ *     11111 + 64 bits     anything else
+ *
+ * so perfectly periodic stamps cost one bit each and ones with tens of
+ * microseconds of jitter under three bytes. Arithmetic is modulo 2^64, so
+ * any sequence round trips exactly.
+ *
+ * The stream is a header followed by blocks, each starting on a byte
+ * boundary with its own header, so any block can be decoded without the
+ * ones before it:
+ *
+ *     stream: "TSC1", block size (u32)
+ *     block:  count (u32), payload bytes (u32), first timestamp (i64), payload
+ *
+ * All integers are little-endian; the payload is a big-endian bit stream.
+ * Every append leaves the stream complete, so it can be written out at any
+ * time and appended to again after timespec_codec_load().
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_codec.h"
+
+#define STREAM_HEADER 8
+#define BLOCK_HEADER  16
+
+/* Longest code, rounded up to bytes. */
+#define MAX_CODE 9
+
+/* Zero bytes kept after the data, so the decoder can always load whole words. */
+#define PAD 16
+
+static const unsigned char magic[4] = { 'T', 'S', 'C', '1' };
+
+struct block_info
+{
+	size_t offset;
+	uint32_t count;
+};
+
+struct timespec_codec
+{
+	unsigned char *data;
+	size_t len;
+	size_t cap;
+
+	struct block_info *blocks;
+	size_t nblocks;
+	size_t blocks_cap;
+
+	uint32_t block_size;
+	size_t count;
+
+	/* Encoder state for the last block. */
+	size_t bit;
+	uint64_t prev;
+	uint64_t prev_delta;
+};
+
+static inline uint32_t get_le32(const unsigned char *p)
+{
+	return (uint32_t)(p[0]) | (uint32_t)(p[1]) << 8 | (uint32_t)(p[2]) << 16 | (uint32_t)(p[3]) << 24;
+}
+
+static inline void put_le32(unsigned char *p, uint32_t v)
+{
+	for(int i = 0; i < 4; ++i)
+	{
+		p[i] = (unsigned char)(v >> (8 * i));
+	}
+}
+
+static inline uint64_t get_le64(const unsigned char *p)
+{
+	return (uint64_t)(get_le32(p)) | (uint64_t)(get_le32(p + 4)) << 32;
+}
+
+static inline void put_le64(unsigned char *p, uint64_t v)
+{
+	put_le32(p, (uint32_t)(v));
+	put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint64_t get_be64(const unsigned char *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline void put_be64(unsigned char *p, uint64_t v)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	v = __builtin_bswap64(v);
+#endif
+	memcpy(p, &v, sizeof(v));
+}
+
+static bool reserve(struct timespec_codec *codec, size_t bytes)
+{
+	if(codec->len + bytes <= codec->cap)
+	{
+		return true;
+	}
+
+	size_t cap = (codec->cap * 2 > codec->len + bytes) ? codec->cap * 2 : codec->len + bytes;
+	unsigned char *data = realloc(codec->data, cap + PAD);
+
+	if(data == NULL)
+	{
+		return false;
+	}
+
+	memset(data + codec->cap, 0, cap + PAD - codec->cap);
+	codec->data = data;
+	codec->cap = cap;
+
+	return true;
+}
+
+static bool add_block(struct timespec_codec *codec, size_t offset, uint32_t count)
+{
+	if(codec->nblocks == codec->blocks_cap)
+	{
+		size_t cap = codec->blocks_cap ? codec->blocks_cap * 2 : 16;
+		struct block_info *blocks = realloc(codec->blocks, cap * sizeof(*blocks));
+
+		if(blocks == NULL)
+		{
+			return false;
+		}
+
+		codec->blocks = blocks;
+		codec->blocks_cap = cap;
+	}
+
+	codec->blocks[codec->nblocks].offset = offset;
+	codec->blocks[codec->nblocks].count = count;
+	++(codec->nblocks);
+
+	return true;
+}
+
+/* Writes the low n bits of v (n at most 56) at the current bit position,
+ * into bytes which are still zero.
+*/
+static inline void write_bits(struct timespec_codec *codec, uint64_t v, unsigned n)
+{
+	unsigned char *p = codec->data + codec->bit / 8;
+	unsigned shift = (unsigned)(codec->bit % 8);
+
+	put_be64(p, get_be64(p) | v << (64 - n - shift));
+	codec->bit += n;
+}
+
+/* Decodes values [from, from + n) of a block into ns or ts, whichever is not
+ * NULL. If end is not NULL the payload is checked against the block's stated
+ * length as it is read, and the bit position reached is stored in *end;
+ * returns the number decoded, which is short if the payload is corrupt.
+*/
+static inline size_t decode_range(const struct timespec_codec *codec, size_t block, size_t from, size_t n,
+	timespec_ns *ns, struct timespec *ts, size_t *end, uint64_t *last_delta)
+{
+	const unsigned char *header = codec->data + codec->blocks[block].offset;
+	const unsigned char *p = header + BLOCK_HEADER;
+	size_t limit = (size_t)(get_le32(header + 4)) * 8;
+	uint64_t v = get_le64(header + 8);
+	uint64_t delta = 0;
+	size_t pos = 0;
+	size_t out = 0;
+
+	for(size_t i = 0; i < from + n; ++i)
+	{
+		if(i > 0)
+		{
+			if(end != NULL && pos >= limit)
+			{
+				break;
+			}
+
+			uint64_t w = get_be64(p + pos / 8) << (pos % 8);
+			unsigned ones = (~w == 0) ? 64 : (unsigned)(__builtin_clzll(~w));
+			uint64_t zz;
+
+			switch(ones)
+			{
+				case 0:
+					zz = 0;
+					pos += 1;
+					break;
+
+				case 1:
+					zz = (w << 2) >> (64 - 7);
+					pos += 2 + 7;
+					break;
+
+				case 2:
+					zz = (w << 3) >> (64 - 12);
+					pos += 3 + 12;
+					break;
+
+				case 3:
+					zz = (w << 4) >> (64 - 18);
+					pos += 4 + 18;
+					break;
+
+				case 4:
+					zz = (w << 5) >> (64 - 32);
+					pos += 5 + 32;
+					break;
+
+				default:
+					pos += 5;
+					zz = (get_be64(p + pos / 8) << (pos % 8)) >> 32 << 32;
+					pos += 32;
+					zz |= (get_be64(p + pos / 8) << (pos % 8)) >> 32;
+					pos += 32;
+					break;
+			}
+
+			if(end != NULL && pos > limit)
+			{
+				break;
+			}
+
+			delta += (zz >> 1) ^ -(zz & 1);
+			v += delta;
+		}
+
+		if(i >= from)
+		{
+			if(ns != NULL)
+			{
+				ns[out] = (timespec_ns)(v);
+			}
+			else
+			{
+				ts[out] = timespec_ns_to_timespec((timespec_ns)(v));
+			}
+
+			++out;
+		}
+	}
+
+	if(end != NULL)
+	{
+		*end = pos;
+		*last_delta = delta;
+	}
+
+	return out;
+}
+
+/** \fn struct timespec_codec *timespec_codec_create(uint32_t block_size)
+ *  \brief Creates an empty timestamp stream.
+ *
+ * Timestamps are grouped into blocks of block_size, each of which can be
+ * decoded on its own; TIMESPEC_CODEC_BLOCK_SIZE is a reasonable default.
+ * Smaller blocks make random access cheaper at some cost in size. Returns
+ * NULL and sets errno on failure.
+*/
+struct timespec_codec *timespec_codec_create(uint32_t block_size)
+{
+	struct timespec_codec *codec;
+
+	if(block_size == 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	codec = calloc(1, sizeof(*codec));
+	if(codec == NULL)
+	{
+		return NULL;
+	}
+
+	codec->block_size = block_size;
+	if(!reserve(codec, STREAM_HEADER + BLOCK_HEADER + MAX_CODE))
+	{
+		free(codec);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	memcpy(codec->data, magic, sizeof(magic));
+	put_le32(codec->data + 4, block_size);
+	codec->len = STREAM_HEADER;
+	codec->bit = STREAM_HEADER * 8;
+
+	return codec;
+}
+
+/** \fn struct timespec_codec *timespec_codec_load(const void *buf, size_t len)
+ *  \brief Creates a stream from bytes previously returned by timespec_codec_data().
+ *
+ * The bytes are copied and fully validated. More timestamps may be appended
+ * to the result. Returns NULL and sets errno to EINVAL if buf is not a valid
+ * stream, or ENOMEM.
+*/
+struct timespec_codec *timespec_codec_load(const void *buf, size_t len)
+{
+	const unsigned char *in = buf;
+	struct timespec_codec *codec;
+
+	if(len < STREAM_HEADER || memcmp(in, magic, sizeof(magic)) != 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	codec = timespec_codec_create(get_le32(in + 4));
+	if(codec == NULL)
+	{
+		return NULL;
+	}
+
+	if(!reserve(codec, len))
+	{
+		timespec_codec_destroy(codec);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	memcpy(codec->data, in, len);
+	codec->len = len;
+	codec->bit = len * 8;
+
+	size_t offset = STREAM_HEADER;
+
+	while(offset < len)
+	{
+		if(len - offset < BLOCK_HEADER)
+		{
+			break;
+		}
+
+		uint32_t count = get_le32(codec->data + offset);
+		size_t bytes = get_le32(codec->data + offset + 4);
+		size_t end, got;
+		timespec_ns last;
+
+		/* Only the last block may be partly filled. */
+		if(count == 0 || count > codec->block_size || (codec->nblocks > 0
+			&& codec->blocks[codec->nblocks - 1].count != codec->block_size)
+			|| bytes > len - offset - BLOCK_HEADER || !add_block(codec, offset, count))
+		{
+			break;
+		}
+
+		/* Decoding the last value checks the whole payload and recovers
+		 * the state needed to append more.
+		*/
+		got = decode_range(codec, codec->nblocks - 1, count - 1, 1, &last, NULL, &end, &codec->prev_delta);
+		if(got != 1 || (end + 7) / 8 != bytes)
+		{
+			break;
+		}
+
+		/* Appending ORs codes into the last byte, so its unused bits must be clear. */
+		if(end % 8 != 0 && (codec->data[offset + BLOCK_HEADER + end / 8] & (0xff >> (end % 8))) != 0)
+		{
+			break;
+		}
+
+		codec->prev = (uint64_t)(last);
+		codec->bit = (offset + BLOCK_HEADER) * 8 + end;
+		codec->count += count;
+		offset += BLOCK_HEADER + bytes;
+	}
+
+	if(offset != len)
+	{
+		timespec_codec_destroy(codec);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return codec;
+}
+
+/** \fn void timespec_codec_destroy(struct timespec_codec *codec)
+ *  \brief Frees a timestamp stream. NULL is ignored.
+*/
+void timespec_codec_destroy(struct timespec_codec *codec)
+{
+	if(codec == NULL)
+	{
+		return;
+	}
+
+	free(codec->blocks);
+	free(codec->data);
+	free(codec);
+}
+
+/** \fn bool timespec_codec_append_ns(struct timespec_codec *codec, timespec_ns ns)
+ *  \brief Appends a timestamp to a stream.
+ *
+ * Timestamps need not be in order, although ordered, evenly spaced ones
+ * compress best. Returns false and sets errno to ENOMEM on failure, leaving
+ * the stream unchanged.
+*/
+bool timespec_codec_append_ns(struct timespec_codec *codec, timespec_ns ns)
+{
+	uint64_t v = (uint64_t)(ns);
+
+	if(codec->count % codec->block_size == 0)
+	{
+		size_t offset = (codec->bit + 7) / 8;
+
+		codec->len = offset;
+		if(!reserve(codec, BLOCK_HEADER + MAX_CODE) || !add_block(codec, offset, 0))
+		{
+			errno = ENOMEM;
+			return false;
+		}
+
+		put_le32(codec->data + offset, 0);
+		put_le32(codec->data + offset + 4, 0);
+		put_le64(codec->data + offset + 8, v);
+
+		codec->bit = (offset + BLOCK_HEADER) * 8;
+		codec->prev_delta = 0;
+	}
+	else
+	{
+		if(!reserve(codec, MAX_CODE))
+		{
+			errno = ENOMEM;
+			return false;
+		}
+
+		uint64_t delta = v - codec->prev;
+		uint64_t dod = delta - codec->prev_delta;
+		uint64_t zz = (dod << 1) ^ -(dod >> 63);
+
+		if(zz == 0)
+		{
+			write_bits(codec, 0, 1);
+		}
+		else if(zz < ((uint64_t)(1) << 7))
+		{
+			write_bits(codec, (uint64_t)(0x2) << 7 | zz, 2 + 7);
+		}
+		else if(zz < ((uint64_t)(1) << 12))
+		{
+			write_bits(codec, (uint64_t)(0x6) << 12 | zz, 3 + 12);
+		}
+		else if(zz < ((uint64_t)(1) << 18))
+		{
+			write_bits(codec, (uint64_t)(0xE) << 18 | zz, 4 + 18);
+		}
+		else if(zz < ((uint64_t)(1) << 32))
+		{
+			write_bits(codec, (uint64_t)(0x1E) << 32 | zz, 5 + 32);
+		}
+		else
+		{
+			write_bits(codec, 0x1F, 5);
+			write_bits(codec, zz >> 32, 32);
+			write_bits(codec, zz & 0xFFFFFFFF, 32);
+		}
+
+		codec->prev_delta = delta;
+	}
+
+	/* Keep the block header current so the stream is always complete. */
+	struct block_info *block = &codec->blocks[codec->nblocks - 1];
+	size_t payload = codec->bit - (block->offset + BLOCK_HEADER) * 8;
+
+	++(block->count);
+	put_le32(codec->data + block->offset, block->count);
+	put_le32(codec->data + block->offset + 4, (uint32_t)((payload + 7) / 8));
+
+	codec->prev = v;
+	codec->len = (codec->bit + 7) / 8;
+	++(codec->count);
+
+	return true;
+}
+
+/** \fn bool timespec_codec_append(struct timespec_codec *codec, struct timespec ts)
+ *  \brief Appends a timestamp to a stream.
+ *
+ * The timestamp is stored normalised, so decoding returns exactly
+ * timespec_normalise(ts). Returns false and sets errno to ERANGE if ts is
+ * outside the range of timespec_ns (about 292 years either side of zero), or
+ * ENOMEM, leaving the stream unchanged.
+*/
+bool timespec_codec_append(struct timespec_codec *codec, struct timespec ts)
+{
+	timespec_ns ns;
+
+	ts = timespec_normalise(ts);
+	if(__builtin_mul_overflow((timespec_ns)(ts.tv_sec), (timespec_ns)(1000000000), &ns)
+		|| __builtin_add_overflow(ns, (timespec_ns)(ts.tv_nsec), &ns))
+	{
+		errno = ERANGE;
+		return false;
+	}
+
+	return timespec_codec_append_ns(codec, ns);
+}
+
+/** \fn const void *timespec_codec_data(const struct timespec_codec *codec, size_t *len)
+ *  \brief Returns the encoded stream and stores its length in bytes in len.
+ *
+ * The pointer is valid until the next append or the stream is destroyed.
+*/
+const void *timespec_codec_data(const struct timespec_codec *codec, size_t *len)
+{
+	*len = codec->len;
+	return codec->data;
+}
+
+/** \fn size_t timespec_codec_count(const struct timespec_codec *codec)
+ *  \brief Returns the number of timestamps in a stream.
+*/
+size_t timespec_codec_count(const struct timespec_codec *codec)
+{
+	return codec->count;
+}
+
+/** \fn size_t timespec_codec_blocks(const struct timespec_codec *codec)
+ *  \brief Returns the number of blocks in a stream.
+ *
+ * Every block holds the block size given to timespec_codec_create() except
+ * the last, which may hold fewer.
+*/
+size_t timespec_codec_blocks(const struct timespec_codec *codec)
+{
+	return codec->nblocks;
+}
+
+/** \fn size_t timespec_codec_decode_block_ns(const struct timespec_codec *codec, size_t block, timespec_ns *out)
+ *  \brief Decodes every timestamp in a block into out, returning how many.
+ *
+ * out must have room for the block size. Returns 0 if block is out of range.
+*/
+size_t timespec_codec_decode_block_ns(const struct timespec_codec *codec, size_t block, timespec_ns *out)
+{
+	if(block >= codec->nblocks)
+	{
+		return 0;
+	}
+
+	return decode_range(codec, block, 0, codec->blocks[block].count, out, NULL, NULL, NULL);
+}
+
+/** \fn size_t timespec_codec_decode_block(const struct timespec_codec *codec, size_t block, struct timespec *out)
+ *  \brief Decodes every timestamp in a block into out, returning how many.
+ *
+ * See timespec_codec_decode_block_ns().
+*/
+size_t timespec_codec_decode_block(const struct timespec_codec *codec, size_t block, struct timespec *out)
+{
+	if(block >= codec->nblocks)
+	{
+		return 0;
+	}
+
+	return decode_range(codec, block, 0, codec->blocks[block].count, NULL, out, NULL, NULL);
+}
+
+/** \fn size_t timespec_codec_decode(const struct timespec_codec *codec, size_t first, struct timespec *out, size_t n)
+ *  \brief Decodes up to n timestamps starting from index first into out.
+ *
+ * Only the blocks covering the range are decoded. Returns the number
+ * decoded, which is less than n if the stream ends first.
+*/
+size_t timespec_codec_decode(const struct timespec_codec *codec, size_t first, struct timespec *out, size_t n)
+{
+	size_t done = 0;
+
+	while(done < n && first + done < codec->count)
+	{
+		size_t index = first + done;
+		size_t block = index / codec->block_size;
+		size_t from = index % codec->block_size;
+		size_t want = codec->blocks[block].count - from;
+
+		if(want > n - done)
+		{
+			want = n - done;
+		}
+
+		done += decode_range(codec, block, from, want, NULL, out + done, NULL, NULL);
+	}
+
+	return done;
+}
+
+/** \fn bool timespec_codec_get(const struct timespec_codec *codec, size_t index, struct timespec *out)
+ *  \brief Decodes the timestamp at index. Returns false if it is out of range.
+ *
+ * Costs at most one block decode.
+*/
+bool timespec_codec_get(const struct timespec_codec *codec, size_t index, struct timespec *out)
+{
+	return timespec_codec_decode(codec, index, out, 1) == 1;
+}
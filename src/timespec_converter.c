@@ -0,0 +1,249 @@
+/**
+ * @file timespec_converter.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Conversion between timespecs and ticks of an arbitrary fixed-rate clock.
+ *
+ * The rate is a ratio of ticks per second, so converting is a multiply and a
+ * divide by a divisor which is only known at run time and so cannot be
+ * strength-reduced by the compiler. Instead each divisor's reciprocal is
+ * computed once when the converter is initialised, and every division is
+ * then a 64x64->128-bit multiply and shift giving the exact quotient
+ * (Granlund and Montgomery, "Division by Invariant Integers using
+ * Multiplication"). The conversion is split so every dividend stays below
+ * 2^63, which the reciprocals are exact for.
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_converter.h"
+
+#define NSEC_PER_SEC 1000000000
+
+/* Returns the high 64 bits of the product of a and b. */
+static inline uint64_t mul_hi(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 p = (unsigned __int128)(a) * b;
+	return (uint64_t)(p >> 64);
+#else
+	uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+	uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+	uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+	uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+
+	return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/* Sets up r so that divide() is exact for divisor d (at least 1) and any
+ * dividend below 2^63: mult = ceil(2^(63 + shift) / d) where 2^shift >= d.
+*/
+static void reciprocal_init(struct timespec_reciprocal *r, uint64_t d)
+{
+	unsigned shift = 0;
+
+	while(shift < 64 && ((uint64_t)(1) << shift) < d)
+	{
+		++shift;
+	}
+
+	/* Long division of 2^(63 + shift) by d, one bit at a time. This only
+	 * happens on initialisation.
+	*/
+	uint64_t q = 0, rem = 0;
+
+	for(int bit = 63 + (int)(shift); bit >= 0; --bit)
+	{
+		bool top = (rem >> 63) != 0;
+
+		rem = (rem << 1) | (bit == 63 + (int)(shift));
+		if(top || rem >= d)
+		{
+			rem -= d;
+			if(bit < 64)
+			{
+				q |= (uint64_t)(1) << bit;
+			}
+		}
+	}
+
+	r->divisor = d;
+	r->mult = q + (rem != 0);
+	r->shift = shift;
+}
+
+static inline uint64_t divide(const struct timespec_reciprocal *r, uint64_t n)
+{
+	/* (n * mult) >> (63 + shift), where shift is only zero for a divisor of one. */
+	return (r->shift == 0) ? n : mul_hi(n, r->mult) >> (r->shift - 1);
+}
+
+static inline uint64_t time_t_max(void)
+{
+	return (uint64_t)(((time_t)(1) << (sizeof(time_t) * 8 - 2)) - 1) * 2 + 1;
+}
+
+static inline int64_t to_ticks(const struct timespec_converter *conv, struct timespec ts)
+{
+	if(ts.tv_nsec < 0 || ts.tv_nsec >= NSEC_PER_SEC || (ts.tv_sec < 0 && ts.tv_nsec != 0))
+	{
+		ts = timespec_normalise(ts);
+	}
+
+	bool negative = (ts.tv_sec < 0 || ts.tv_nsec < 0);
+	uint64_t s = negative ? -(uint64_t)(ts.tv_sec) : (uint64_t)(ts.tv_sec);
+	uint64_t n = (uint64_t)(negative ? -ts.tv_nsec : ts.tv_nsec);
+
+	if(s > (uint64_t)(INT64_MAX))
+	{
+		return negative ? -INT64_MAX : INT64_MAX;
+	}
+
+	/* s * num / den, plus n * num / (den * 1e9), carrying each remainder
+	 * down so the total is truncated only once. With a whole number of
+	 * ticks per second s * num needs no division at all.
+	*/
+	if(conv->den == 1)
+	{
+		uint64_t ticks;
+
+		if(__builtin_mul_overflow(s, conv->num, &ticks)
+			|| __builtin_add_overflow(ticks, divide(&conv->by_den_ns, n * conv->num), &ticks)
+			|| ticks > (uint64_t)(INT64_MAX))
+		{
+			ticks = INT64_MAX;
+		}
+
+		return negative ? -(int64_t)(ticks) : (int64_t)(ticks);
+	}
+
+	uint64_t q1 = divide(&conv->by_den, s);
+	uint64_t t  = (s - q1 * conv->den) * conv->num;
+	uint64_t q2 = divide(&conv->by_den, t);
+	uint64_t w  = (t - q2 * conv->den) * NSEC_PER_SEC + n * conv->num;
+	uint64_t q3 = divide(&conv->by_den_ns, w);
+
+	uint64_t ticks;
+
+	if(__builtin_mul_overflow(q1, conv->num, &ticks) || __builtin_add_overflow(ticks, q2 + q3, &ticks)
+		|| ticks > (uint64_t)(INT64_MAX))
+	{
+		ticks = INT64_MAX;
+	}
+
+	return negative ? -(int64_t)(ticks) : (int64_t)(ticks);
+}
+
+static inline struct timespec from_ticks(const struct timespec_converter *conv, int64_t ticks)
+{
+	struct timespec ts;
+
+	/* INT64_MIN is taken as INT64_MIN + 1 so its magnitude fits. */
+	bool negative = (ticks < 0);
+	uint64_t t = negative ? (uint64_t)(-(ticks + (ticks == INT64_MIN))) : (uint64_t)(ticks);
+
+	uint64_t q1 = divide(&conv->by_num, t);
+	uint64_t u  = (t - q1 * conv->num) * conv->den;
+	uint64_t q2 = divide(&conv->by_num, u);
+	uint64_t r2 = u - q2 * conv->num;
+	uint64_t sec;
+
+	if(__builtin_mul_overflow(q1, conv->den, &sec) || __builtin_add_overflow(sec, q2, &sec) || sec > time_t_max())
+	{
+		ts.tv_sec  = (time_t)(time_t_max());
+		ts.tv_nsec = NSEC_PER_SEC - 1;
+	}
+	else
+	{
+		ts.tv_sec  = (time_t)(sec);
+		ts.tv_nsec = (long)(divide(&conv->by_num, r2 * NSEC_PER_SEC));
+	}
+
+	if(negative)
+	{
+		ts.tv_sec  = -ts.tv_sec;
+		ts.tv_nsec = -ts.tv_nsec;
+	}
+
+	return ts;
+}
+
+/** \fn bool timespec_converter_init(struct timespec_converter *conv, uint32_t num, uint32_t den)
+ *  \brief Initialises a converter for a clock of num / den ticks per second.
+ *
+ * For example (1000000, 1) converts to microseconds, (90000, 1) to a 90kHz
+ * media clock and (30000, 1001) to NTSC frames. num and den must be non-zero
+ * and their product no more than 2^62. Returns false and sets errno to EINVAL
+ * otherwise.
+*/
+bool timespec_converter_init(struct timespec_converter *conv, uint32_t num, uint32_t den)
+{
+	if(num == 0 || den == 0 || (uint64_t)(num) * den > ((uint64_t)(1) << 62))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	conv->num = num;
+	conv->den = den;
+
+	reciprocal_init(&conv->by_num, num);
+	reciprocal_init(&conv->by_den, den);
+	reciprocal_init(&conv->by_den_ns, (uint64_t)(den) * NSEC_PER_SEC);
+
+	return true;
+}
+
+/** \fn int64_t timespec_converter_to_ticks(const struct timespec_converter *conv, struct timespec ts)
+ *  \brief Converts a timespec to a whole number of ticks, truncated towards zero.
+ *
+ * The result is exact and no division instructions are used. Results beyond
+ * the range of int64_t saturate.
+*/
+int64_t timespec_converter_to_ticks(const struct timespec_converter *conv, struct timespec ts)
+{
+	return to_ticks(conv, ts);
+}
+
+/** \fn struct timespec timespec_converter_from_ticks(const struct timespec_converter *conv, int64_t ticks)
+ *  \brief Converts a number of ticks to a normalised timespec, truncated towards zero.
+ *
+ * The result is exact to the nanosecond and no division instructions are
+ * used. Results beyond the range of time_t saturate.
+*/
+struct timespec timespec_converter_from_ticks(const struct timespec_converter *conv, int64_t ticks)
+{
+	return from_ticks(conv, ticks);
+}
+
+/** \fn void timespec_converter_to_ticks_array(const struct timespec_converter *conv, int64_t *out, const struct timespec *in, size_t n)
+ *  \brief Converts n timespecs to ticks, as timespec_converter_to_ticks().
+*/
+void timespec_converter_to_ticks_array(const struct timespec_converter *conv, int64_t *out,
+	const struct timespec *in, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+	{
+		out[i] = to_ticks(conv, in[i]);
+	}
+}
+
+/** \fn void timespec_converter_from_ticks_array(const struct timespec_converter *conv, struct timespec *out, const int64_t *in, size_t n)
+ *  \brief Converts n tick counts to timespecs, as timespec_converter_from_ticks().
+*/
+void timespec_converter_from_ticks_array(const struct timespec_converter *conv, struct timespec *out,
+	const int64_t *in, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+	{
+		out[i] = from_ticks(conv, in[i]);
+	}
+}
@@ -0,0 +1,375 @@
+/**
+ * @file timespec_histogram.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Log-linear latency histogram for timespec durations.
+ *
+ * Durations are bucketed in nanoseconds: values below 2^SUB_BITS have a bucket
+ * each, and every power of two above that is split into 2^SUB_BITS equal
+ * buckets, so recording is a count-leading-zeros, a shift and an increment.
+ *
+ * All counters are updated with relaxed atomic operations, so one histogram
+ * per thread can be recorded into while another thread merges or drains it
+ * into a shared histogram, without locks and without losing counts.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_histogram.h"
+
+#define SUB_BUCKETS ((uint64_t)(1) << TIMESPEC_HISTOGRAM_SUB_BITS)
+#define TOP_VALUE   (((uint64_t)(1) << TIMESPEC_HISTOGRAM_MAX_BITS) - 1)
+
+static const unsigned char magic[4] = { 'T', 'S', 'H', '1' };
+
+static inline size_t bucket_of(uint64_t v)
+{
+	if(v > TOP_VALUE)
+	{
+		v = TOP_VALUE;
+	}
+
+	if(v < SUB_BUCKETS)
+	{
+		return (size_t)(v);
+	}
+
+	unsigned shift = (unsigned)(63 - __builtin_clzll(v)) - TIMESPEC_HISTOGRAM_SUB_BITS;
+	return (size_t)(shift * SUB_BUCKETS + (v >> shift));
+}
+
+/* Returns the largest value which maps to bucket. */
+static inline uint64_t bucket_highest(size_t bucket)
+{
+	if(bucket < 2 * SUB_BUCKETS)
+	{
+		return bucket;
+	}
+
+	unsigned shift = (unsigned)(bucket / SUB_BUCKETS) - 1;
+	uint64_t top = bucket - shift * SUB_BUCKETS;
+
+	return ((top + 1) << shift) - 1;
+}
+
+static void atomic_min(uint64_t *p, uint64_t v)
+{
+	uint64_t cur = __atomic_load_n(p, __ATOMIC_RELAXED);
+
+	while(v < cur && !__atomic_compare_exchange_n(p, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+
+static void atomic_max(uint64_t *p, uint64_t v)
+{
+	uint64_t cur = __atomic_load_n(p, __ATOMIC_RELAXED);
+
+	while(v > cur && !__atomic_compare_exchange_n(p, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+
+/** \fn void timespec_histogram_init(struct timespec_histogram *h)
+ *  \brief Initialises (or resets) a histogram to empty.
+*/
+void timespec_histogram_init(struct timespec_histogram *h)
+{
+	memset(h->counts, 0, sizeof(h->counts));
+	h->min = UINT64_MAX;
+	h->max = 0;
+}
+
+/** \fn void timespec_histogram_record_ns(struct timespec_histogram *h, timespec_ns duration)
+ *  \brief Records a duration in nanoseconds. Negative durations count as zero.
+*/
+void timespec_histogram_record_ns(struct timespec_histogram *h, timespec_ns duration)
+{
+	uint64_t v = (duration > 0) ? (uint64_t)(duration) : 0;
+
+	__atomic_fetch_add(&h->counts[bucket_of(v)], 1, __ATOMIC_RELAXED);
+	atomic_min(&h->min, v);
+	atomic_max(&h->max, v);
+}
+
+/** \fn void timespec_histogram_record(struct timespec_histogram *h, struct timespec duration)
+ *  \brief Records a duration, typically the result of timespec_sub(end, start).
+ *
+ * Negative durations count as zero.
+*/
+void timespec_histogram_record(struct timespec_histogram *h, struct timespec duration)
+{
+	timespec_histogram_record_ns(h, timespec_ns_from_timespec(duration));
+}
+
+/** \fn void timespec_histogram_merge(struct timespec_histogram *dst, const struct timespec_histogram *src)
+ *  \brief Adds the contents of src to dst, leaving src unchanged.
+ *
+ * Safe while other threads record into either histogram or merge into dst.
+*/
+void timespec_histogram_merge(struct timespec_histogram *dst, const struct timespec_histogram *src)
+{
+	for(size_t i = 0; i < TIMESPEC_HISTOGRAM_BUCKETS; ++i)
+	{
+		uint64_t n = __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+
+		if(n != 0)
+		{
+			__atomic_fetch_add(&dst->counts[i], n, __ATOMIC_RELAXED);
+		}
+	}
+
+	atomic_min(&dst->min, __atomic_load_n(&src->min, __ATOMIC_RELAXED));
+	atomic_max(&dst->max, __atomic_load_n(&src->max, __ATOMIC_RELAXED));
+}
+
+/** \fn void timespec_histogram_drain(struct timespec_histogram *dst, struct timespec_histogram *src)
+ *  \brief Moves the counts in src into dst, leaving src empty.
+ *
+ * Intended for periodically folding per-thread histograms into a shared one.
+ * Safe while the owning thread keeps recording into src: every count ends up
+ * in exactly one of the two. src's minimum and maximum are also reset, so a
+ * value recorded during the drain may be missing from src's min and max
+ * although it is still counted.
+*/
+void timespec_histogram_drain(struct timespec_histogram *dst, struct timespec_histogram *src)
+{
+	atomic_min(&dst->min, __atomic_exchange_n(&src->min, UINT64_MAX, __ATOMIC_RELAXED));
+	atomic_max(&dst->max, __atomic_exchange_n(&src->max, 0, __ATOMIC_RELAXED));
+
+	for(size_t i = 0; i < TIMESPEC_HISTOGRAM_BUCKETS; ++i)
+	{
+		if(__atomic_load_n(&src->counts[i], __ATOMIC_RELAXED) != 0)
+		{
+			__atomic_fetch_add(&dst->counts[i], __atomic_exchange_n(&src->counts[i], 0, __ATOMIC_RELAXED),
+				__ATOMIC_RELAXED);
+		}
+	}
+}
+
+/** \fn uint64_t timespec_histogram_count(const struct timespec_histogram *h)
+ *  \brief Returns the number of recorded durations.
+*/
+uint64_t timespec_histogram_count(const struct timespec_histogram *h)
+{
+	uint64_t total = 0;
+
+	for(size_t i = 0; i < TIMESPEC_HISTOGRAM_BUCKETS; ++i)
+	{
+		total += __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+	}
+
+	return total;
+}
+
+/** \fn struct timespec timespec_histogram_min(const struct timespec_histogram *h)
+ *  \brief Returns the exact smallest recorded duration, or zero if empty.
+*/
+struct timespec timespec_histogram_min(const struct timespec_histogram *h)
+{
+	uint64_t min = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+
+	return timespec_ns_to_timespec(min == UINT64_MAX ? 0 : (timespec_ns)(min));
+}
+
+/** \fn struct timespec timespec_histogram_max(const struct timespec_histogram *h)
+ *  \brief Returns the exact largest recorded duration, or zero if empty.
+*/
+struct timespec timespec_histogram_max(const struct timespec_histogram *h)
+{
+	return timespec_ns_to_timespec((timespec_ns)(__atomic_load_n(&h->max, __ATOMIC_RELAXED)));
+}
+
+/** \fn struct timespec timespec_histogram_percentile(const struct timespec_histogram *h, double percentile)
+ *  \brief Returns the duration at or below which percentile % of recorded durations fall.
+ *
+ * percentile is in the range 0 to 100, e.g. 99.9. The result is the largest
+ * value in the matching bucket, limited to the recorded minimum and maximum,
+ * so it is within 1/128 of the true value. Percentiles 0 and 100 are the exact
+ * minimum and maximum. Returns zero if empty.
+*/
+struct timespec timespec_histogram_percentile(const struct timespec_histogram *h, double percentile)
+{
+	uint64_t total = timespec_histogram_count(h);
+	uint64_t min = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+	uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+
+	if(total == 0)
+	{
+		return timespec_ns_to_timespec(0);
+	}
+
+	if(percentile <= 0)
+	{
+		return timespec_ns_to_timespec((timespec_ns)(min));
+	}
+	else if(percentile > 100)
+	{
+		percentile = 100;
+	}
+
+	/* Rank of the requested value, counting from one. */
+	double exact = percentile / 100 * (double)(total);
+	uint64_t rank = (uint64_t)(exact);
+	if((double)(rank) < exact || rank == 0)
+	{
+		++rank;
+	}
+
+	uint64_t seen = 0;
+	uint64_t value = max;
+	for(size_t i = 0; i < TIMESPEC_HISTOGRAM_BUCKETS; ++i)
+	{
+		seen += __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+		if(seen >= rank)
+		{
+			value = bucket_highest(i);
+			break;
+		}
+	}
+
+	if(value > max)
+	{
+		value = max;
+	}
+	if(value < min)
+	{
+		value = min;
+	}
+
+	return timespec_ns_to_timespec((timespec_ns)(value));
+}
+
+static unsigned char *put_varint(unsigned char *p, const unsigned char *end, uint64_t v)
+{
+	do {
+		if(p == NULL || p >= end)
+		{
+			return NULL;
+		}
+
+		*p++ = (unsigned char)((v & 0x7F) | (v > 0x7F ? 0x80 : 0));
+		v >>= 7;
+	} while(v != 0);
+
+	return p;
+}
+
+static const unsigned char *get_varint(const unsigned char *p, const unsigned char *end, uint64_t *v)
+{
+	*v = 0;
+
+	for(unsigned shift = 0; p != NULL && p < end && shift < 64; shift += 7)
+	{
+		unsigned char byte = *p++;
+
+		*v |= (uint64_t)(byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+		{
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+/** \fn size_t timespec_histogram_serialise(const struct timespec_histogram *h, void *buf, size_t len)
+ *  \brief Writes a portable snapshot of h to buf.
+ *
+ * Returns the number of bytes written, or 0 if len is too small. A buffer of
+ * TIMESPEC_HISTOGRAM_SERIALISED_MAX bytes is always large enough. The format
+ * is a four byte magic, the bucket layout, then the minimum, maximum and the
+ * non-empty buckets as (index delta, count) pairs up to the end of the
+ * buffer, all as LEB128 varints.
+*/
+size_t timespec_histogram_serialise(const struct timespec_histogram *h, void *buf, size_t len)
+{
+	const unsigned char *end = (unsigned char*)(buf) + len;
+	unsigned char *p = buf;
+
+	if(len < sizeof(magic) + 2)
+	{
+		return 0;
+	}
+
+	memcpy(p, magic, sizeof(magic));
+	p += sizeof(magic);
+	*p++ = TIMESPEC_HISTOGRAM_SUB_BITS;
+	*p++ = TIMESPEC_HISTOGRAM_MAX_BITS;
+
+	p = put_varint(p, end, __atomic_load_n(&h->min, __ATOMIC_RELAXED));
+	p = put_varint(p, end, __atomic_load_n(&h->max, __ATOMIC_RELAXED));
+
+	size_t next = 0;
+	for(size_t i = 0; i < TIMESPEC_HISTOGRAM_BUCKETS; ++i)
+	{
+		uint64_t count = __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+
+		if(count != 0)
+		{
+			p = put_varint(p, end, i - next);
+			p = put_varint(p, end, count);
+			next = i + 1;
+		}
+	}
+
+	return (p == NULL) ? 0 : (size_t)(p - (unsigned char*)(buf));
+}
+
+/** \fn bool timespec_histogram_deserialise(struct timespec_histogram *h, const void *buf, size_t len)
+ *  \brief Replaces the contents of h with a snapshot written by timespec_histogram_serialise().
+ *
+ * Returns false, leaving h empty, if buf is malformed or was written with a
+ * different bucket layout.
+*/
+bool timespec_histogram_deserialise(struct timespec_histogram *h, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	const unsigned char *end = p + len;
+	uint64_t min, max, delta, count;
+	size_t next = 0;
+
+	timespec_histogram_init(h);
+
+	if(len < sizeof(magic) + 2 || memcmp(p, magic, sizeof(magic)) != 0
+		|| p[4] != TIMESPEC_HISTOGRAM_SUB_BITS || p[5] != TIMESPEC_HISTOGRAM_MAX_BITS)
+	{
+		return false;
+	}
+	p += sizeof(magic) + 2;
+
+	p = get_varint(p, end, &min);
+	p = get_varint(p, end, &max);
+
+	while(p != NULL && p != end)
+	{
+		p = get_varint(p, end, &delta);
+		p = get_varint(p, end, &count);
+
+		if(p == NULL || delta >= TIMESPEC_HISTOGRAM_BUCKETS - next)
+		{
+			p = NULL;
+			break;
+		}
+
+		next += (size_t)(delta);
+		h->counts[next++] = count;
+	}
+
+	if(p != end)
+	{
+		timespec_histogram_init(h);
+		return false;
+	}
+
+	h->min = min;
+	h->max = max;
+	return true;
+}
@@ -0,0 +1,371 @@
+/**
+ * @file timespec_index.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Static search index over a sorted timespec array.
+ *
+ * Binary search over a large array misses the cache on nearly every probe,
+ * and its branch on each comparison is unpredictable. This index is a static
+ * B+ tree instead: nodes of 16 keys, two cache lines, and 17 children, laid
+ * out layer by layer with the leaves first. The leaf layer is the sorted
+ * keys themselves, so the position of a key is the answer to a query, and
+ * each layer above holds, for every child but the first, the smallest key
+ * below it. A query touches one node per layer, about log17(n) of them
+ * rather than log2(n), and within a node counts the keys less than its own
+ * without branching, which also gives the child to descend into.
+ *
+ * Keys are mapped to unsigned 64 bit integers which order the same way, as
+ * in timespec_key.h, from the earliest tv_sec in the array. The leaves are
+ * padded with UINT64_MAX, above any key, so the padding is never counted.
+ * Arrays spanning more than about 584 years do not fit 64 bit keys, and are
+ * searched with a branchless binary search over a copy instead.
+ *
+ * Batched queries descend together a layer at a time, prefetching each
+ * query's next node while the others are compared, so their cache misses
+ * overlap instead of following one after another.
+ *
+ * Values must be normalised, as returned by clock_gettime() and this library.
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Comparisons are the inner loop of the fallback search, so have them inlined here. */
+#define TIMESPEC_INLINE
+#include "timespec.h"
+#include "timespec_index.h"
+#include "timespec_key.h"
+
+/* Keys per node. */
+#define B 16
+
+/* Layers needed for 2^64 keys, with some to spare. */
+#define MAX_HEIGHT 20
+
+/* Queries descending together in a batch. */
+#define BATCH 16
+
+struct timespec_index
+{
+	size_t n;
+	time_t min_sec;
+	uint64_t range;
+
+	/* Offset of each layer in keys, from the leaves up to the root. */
+	unsigned height;
+	size_t offsets[MAX_HEIGHT + 1];
+
+	/* NULL if the array spans too long for 64 bit keys. */
+	uint64_t *keys;
+
+	/* Copy of the array searched when there are no keys. */
+	struct timespec *sorted;
+};
+
+/* Nodes needed for m keys; the leaf layer has one even when empty. */
+static size_t layer_blocks(size_t m)
+{
+	return (m == 0) ? 1 : (m + B - 1) / B;
+}
+
+/* Keys in the layer above one of m keys. */
+static size_t parent_keys(size_t m)
+{
+	return (layer_blocks(m) + B) / (B + 1) * B;
+}
+
+/* Key for a query, clamped below or above every key when the query is
+ * outside the seconds the array covers.
+*/
+static inline uint64_t query_key(const struct timespec_index *idx, struct timespec ts)
+{
+	if(ts.tv_sec < idx->min_sec)
+	{
+		return 0;
+	}
+	else if((uint64_t)(ts.tv_sec) - (uint64_t)(idx->min_sec) > idx->range)
+	{
+		return UINT64_MAX - 1;
+	}
+
+	return timespec_key(ts, idx->min_sec);
+}
+
+/* Number of keys in a node less than key. */
+static inline size_t node_rank(const uint64_t *node, uint64_t key)
+{
+	size_t rank = 0;
+
+	for(size_t j = 0; j < B; ++j)
+	{
+		rank += (node[j] < key);
+	}
+
+	return rank;
+}
+
+/* Position of the first key not less than key. */
+static inline size_t search(const struct timespec_index *idx, uint64_t key)
+{
+	size_t k = 0;
+
+	for(unsigned h = idx->height - 1; h > 0; --h)
+	{
+		k = k * (B + 1) + node_rank(idx->keys + idx->offsets[h] + k, key) * B;
+	}
+
+	k += node_rank(idx->keys + k, key);
+
+	return (k < idx->n) ? k : idx->n;
+}
+
+/* Branchless binary search for the first element not less than ts, or
+ * greater than it if upper is set.
+*/
+static size_t search_sorted(const struct timespec *a, size_t n, struct timespec ts, bool upper)
+{
+	const struct timespec *base = a;
+	int bias = upper ? 1 : 0;
+
+	if(n == 0)
+	{
+		return 0;
+	}
+
+	while(n > 1)
+	{
+		size_t half = n / 2;
+
+		base += (timespec_cmp(base[half - 1], ts) < bias) ? half : 0;
+		n -= half;
+	}
+
+	return (size_t)(base - a) + (timespec_cmp(*base, ts) < bias);
+}
+
+/** \fn struct timespec_index *timespec_index_create(const struct timespec *sorted, size_t n)
+ *  \brief Builds a search index over n sorted timespecs.
+ *
+ * The index holds its own copy of the keys, about 8.5 bytes per element, so
+ * the array need not outlive it. Returns NULL and sets errno on failure,
+ * including EINVAL if the array is not sorted.
+*/
+struct timespec_index *timespec_index_create(const struct timespec *sorted, size_t n)
+{
+	struct timespec_index *idx;
+	void *mem;
+
+	for(size_t i = 1; i < n; ++i)
+	{
+		if(timespec_lt(sorted[i], sorted[i - 1]))
+		{
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	if(n > SIZE_MAX / (2 * sizeof(uint64_t)))
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	idx = calloc(1, sizeof(*idx));
+	if(idx == NULL)
+	{
+		return NULL;
+	}
+
+	idx->n = n;
+	idx->min_sec = (n > 0) ? sorted[0].tv_sec : 0;
+	idx->range = (n > 0) ? (uint64_t)(sorted[n - 1].tv_sec) - (uint64_t)(idx->min_sec) : 0;
+
+	if(idx->range > RANGE_64)
+	{
+		idx->sorted = malloc(n * sizeof(*sorted));
+		if(idx->sorted == NULL)
+		{
+			free(idx);
+			return NULL;
+		}
+
+		memcpy(idx->sorted, sorted, n * sizeof(*sorted));
+
+		return idx;
+	}
+
+	for(size_t m = n; ; m = parent_keys(m))
+	{
+		idx->offsets[idx->height + 1] = idx->offsets[idx->height] + layer_blocks(m) * B;
+		++(idx->height);
+
+		if(m <= B)
+		{
+			break;
+		}
+	}
+
+	if(posix_memalign(&mem, 64, idx->offsets[idx->height] * sizeof(uint64_t)) != 0)
+	{
+		free(idx);
+		errno = ENOMEM;
+		return NULL;
+	}
+	idx->keys = mem;
+
+	for(size_t i = 0; i < idx->offsets[1]; ++i)
+	{
+		idx->keys[i] = (i < n) ? timespec_key(sorted[i], idx->min_sec) : UINT64_MAX;
+	}
+
+	/* Each key above the leaves is the first leaf key under the child to
+	 * its right: step to that child, then always to the leftmost below it.
+	*/
+	for(unsigned h = 1; h < idx->height; ++h)
+	{
+		for(size_t i = 0; i < idx->offsets[h + 1] - idx->offsets[h]; ++i)
+		{
+			size_t k = i / B * (B + 1) + i % B + 1;
+
+			for(unsigned l = 1; l < h; ++l)
+			{
+				k *= B + 1;
+			}
+
+			idx->keys[idx->offsets[h] + i] = (k * B < n) ? idx->keys[k * B] : UINT64_MAX;
+		}
+	}
+
+	return idx;
+}
+
+/** \fn void timespec_index_destroy(struct timespec_index *idx)
+ *  \brief Frees a search index. NULL is ignored.
+*/
+void timespec_index_destroy(struct timespec_index *idx)
+{
+	if(idx != NULL)
+	{
+		free(idx->keys);
+		free(idx->sorted);
+		free(idx);
+	}
+}
+
+/** \fn size_t timespec_index_size(const struct timespec_index *idx)
+ *  \brief Returns the number of elements indexed.
+*/
+size_t timespec_index_size(const struct timespec_index *idx)
+{
+	return idx->n;
+}
+
+/** \fn size_t timespec_index_lower_bound(const struct timespec_index *idx, struct timespec ts)
+ *  \brief Returns the position of the first element at or after ts.
+ *
+ * Returns the number of elements if every element is before ts.
+*/
+size_t timespec_index_lower_bound(const struct timespec_index *idx, struct timespec ts)
+{
+	if(idx->keys == NULL)
+	{
+		return search_sorted(idx->sorted, idx->n, ts, false);
+	}
+
+	return search(idx, query_key(idx, ts));
+}
+
+/** \fn size_t timespec_index_upper_bound(const struct timespec_index *idx, struct timespec ts)
+ *  \brief Returns the position of the first element after ts.
+*/
+size_t timespec_index_upper_bound(const struct timespec_index *idx, struct timespec ts)
+{
+	if(idx->keys == NULL)
+	{
+		return search_sorted(idx->sorted, idx->n, ts, true);
+	}
+
+	/* Keys are integers, so the first greater is the first not less than one more. */
+	return search(idx, query_key(idx, ts) + 1);
+}
+
+/** \fn size_t timespec_index_range(const struct timespec_index *idx, struct timespec from, struct timespec to, size_t *first)
+ *  \brief Returns the number of elements in [from, to).
+ *
+ * If first is not NULL the position of the first of them is stored there.
+*/
+size_t timespec_index_range(const struct timespec_index *idx, struct timespec from, struct timespec to, size_t *first)
+{
+	size_t begin = timespec_index_lower_bound(idx, from);
+	size_t end = timespec_index_lower_bound(idx, to);
+
+	if(first != NULL)
+	{
+		*first = begin;
+	}
+
+	return (end > begin) ? end - begin : 0;
+}
+
+/** \fn void timespec_index_lower_bound_batch(const struct timespec_index *idx, const struct timespec *ts, size_t n, size_t *out)
+ *  \brief Finds the lower bound of each of n times, storing them in out.
+ *
+ * Gives the same results as timespec_index_lower_bound() on each, but runs
+ * groups of queries through the tree together with software prefetching,
+ * which is several times faster when the index is larger than the cache.
+*/
+void timespec_index_lower_bound_batch(const struct timespec_index *idx, const struct timespec *ts, size_t n,
+	size_t *out)
+{
+	if(idx->keys == NULL)
+	{
+		for(size_t i = 0; i < n; ++i)
+		{
+			out[i] = search_sorted(idx->sorted, idx->n, ts[i], false);
+		}
+
+		return;
+	}
+
+	for(size_t from = 0; from < n; from += BATCH)
+	{
+		size_t count = (n - from < BATCH) ? n - from : BATCH;
+		uint64_t keys[BATCH];
+		size_t k[BATCH];
+
+		for(size_t j = 0; j < count; ++j)
+		{
+			keys[j] = query_key(idx, ts[from + j]);
+			k[j] = 0;
+		}
+
+		for(unsigned h = idx->height - 1; h > 0; --h)
+		{
+			const uint64_t *layer = idx->keys + idx->offsets[h];
+			const uint64_t *below = idx->keys + idx->offsets[h - 1];
+
+			for(size_t j = 0; j < count; ++j)
+			{
+				k[j] = k[j] * (B + 1) + node_rank(layer + k[j], keys[j]) * B;
+
+				/* Both cache lines of the next node. */
+				__builtin_prefetch(below + k[j]);
+				__builtin_prefetch(below + k[j] + B / 2);
+			}
+		}
+
+		for(size_t j = 0; j < count; ++j)
+		{
+			size_t rank = k[j] + node_rank(idx->keys + k[j], keys[j]);
+
+			out[from + j] = (rank < idx->n) ? rank : idx->n;
+		}
+	}
+}
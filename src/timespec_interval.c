@@ -0,0 +1,902 @@
+/**
+ * @file timespec_interval.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Interval tree and interval set over half-open timespec ranges.
+ *
+ * The tree is an AVL tree ordered by start time, in which every node also
+ * holds the latest end time in its subtree, so stabbing and overlap queries
+ * can skip any subtree which ends too early and run in O(log n + k) for k
+ * results. Nodes live in one array and link to each other by 32-bit index,
+ * with index 0 as the empty tree and removed nodes kept on a free list, so
+ * the tree stays compact and is freed in one go.
+ *
+ * The set is a sorted array of disjoint intervals, with touching intervals
+ * merged, so membership is a binary search and union and intersection of
+ * two sets are a single merge pass.
+ *
+ * Both hold times as timespec_ns, so cannot hold times more than about 292
+ * years from the epoch.
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_interval.h"
+
+#define NIL 0
+
+struct node
+{
+	timespec_ns start;
+	timespec_ns end;
+
+	/* Latest end in the subtree rooted here. */
+	timespec_ns max;
+
+	void *data;
+	uint32_t left;
+	uint32_t right;
+	int height;
+};
+
+struct timespec_interval_tree
+{
+	/* nodes[0] is a sentinel standing for the empty tree. */
+	struct node *nodes;
+	uint32_t capacity;
+	uint32_t used;
+
+	/* Removed nodes, linked through left. */
+	uint32_t free;
+
+	uint32_t root;
+	size_t count;
+};
+
+struct range
+{
+	timespec_ns start;
+	timespec_ns end;
+};
+
+struct timespec_interval_set
+{
+	struct range *ranges;
+	size_t count;
+	size_t capacity;
+};
+
+/* Context for the recursive queries. */
+struct query
+{
+	const struct node *nodes;
+	timespec_ns start;
+	timespec_ns end;
+	bool (*visit)(struct timespec_interval interval, void *data, void *arg);
+	void *arg;
+	size_t visited;
+};
+
+static bool to_ns(struct timespec ts, timespec_ns *ns)
+{
+	ts = timespec_normalise(ts);
+	if(__builtin_mul_overflow((timespec_ns)(ts.tv_sec), (timespec_ns)(1000000000), ns)
+		|| __builtin_add_overflow(*ns, (timespec_ns)(ts.tv_nsec), ns))
+	{
+		errno = ERANGE;
+		return false;
+	}
+
+	return true;
+}
+
+static bool range_of(struct timespec_interval interval, struct range *range)
+{
+	return to_ns(interval.start, &range->start) && to_ns(interval.end, &range->end);
+}
+
+static struct timespec_interval interval_of(timespec_ns start, timespec_ns end)
+{
+	struct timespec_interval interval = {
+		.start = timespec_ns_to_timespec(start),
+		.end   = timespec_ns_to_timespec(end),
+	};
+
+	return interval;
+}
+
+/* Orders by start, then end, then data, so equal intervals with different
+ * data can be told apart on removal.
+*/
+static int compare(const struct node *a, const struct node *b)
+{
+	if(a->start != b->start)
+	{
+		return (a->start < b->start) ? -1 : 1;
+	}
+
+	if(a->end != b->end)
+	{
+		return (a->end < b->end) ? -1 : 1;
+	}
+
+	if(a->data != b->data)
+	{
+		return ((uintptr_t)(a->data) < (uintptr_t)(b->data)) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static void update(struct node *nodes, uint32_t n)
+{
+	struct node *node = &nodes[n];
+	int lh = nodes[node->left].height, rh = nodes[node->right].height;
+	timespec_ns lm = nodes[node->left].max, rm = nodes[node->right].max;
+
+	node->height = 1 + ((lh > rh) ? lh : rh);
+	node->max = node->end;
+	if(lm > node->max)
+	{
+		node->max = lm;
+	}
+	if(rm > node->max)
+	{
+		node->max = rm;
+	}
+}
+
+static uint32_t rotate_left(struct node *nodes, uint32_t n)
+{
+	uint32_t r = nodes[n].right;
+
+	nodes[n].right = nodes[r].left;
+	nodes[r].left = n;
+	update(nodes, n);
+	update(nodes, r);
+
+	return r;
+}
+
+static uint32_t rotate_right(struct node *nodes, uint32_t n)
+{
+	uint32_t l = nodes[n].left;
+
+	nodes[n].left = nodes[l].right;
+	nodes[l].right = n;
+	update(nodes, n);
+	update(nodes, l);
+
+	return l;
+}
+
+/* Restores the AVL balance of the subtree rooted at n and returns its new root. */
+static uint32_t rebalance(struct node *nodes, uint32_t n)
+{
+	update(nodes, n);
+
+	int balance = nodes[nodes[n].left].height - nodes[nodes[n].right].height;
+
+	if(balance > 1)
+	{
+		uint32_t l = nodes[n].left;
+
+		if(nodes[nodes[l].left].height < nodes[nodes[l].right].height)
+		{
+			nodes[n].left = rotate_left(nodes, l);
+		}
+		return rotate_right(nodes, n);
+	}
+
+	if(balance < -1)
+	{
+		uint32_t r = nodes[n].right;
+
+		if(nodes[nodes[r].right].height < nodes[nodes[r].left].height)
+		{
+			nodes[n].right = rotate_right(nodes, r);
+		}
+		return rotate_left(nodes, n);
+	}
+
+	return n;
+}
+
+static uint32_t insert_node(struct node *nodes, uint32_t n, uint32_t added)
+{
+	if(n == NIL)
+	{
+		return added;
+	}
+
+	if(compare(&nodes[added], &nodes[n]) < 0)
+	{
+		nodes[n].left = insert_node(nodes, nodes[n].left, added);
+	}
+	else
+	{
+		nodes[n].right = insert_node(nodes, nodes[n].right, added);
+	}
+
+	return rebalance(nodes, n);
+}
+
+/* Unlinks the leftmost node of the subtree at n into *min. */
+static uint32_t remove_min(struct node *nodes, uint32_t n, uint32_t *min)
+{
+	if(nodes[n].left == NIL)
+	{
+		*min = n;
+		return nodes[n].right;
+	}
+
+	nodes[n].left = remove_min(nodes, nodes[n].left, min);
+
+	return rebalance(nodes, n);
+}
+
+/* Unlinks the node matching key into *removed, which is left NIL if there is none. */
+static uint32_t remove_node(struct node *nodes, uint32_t n, const struct node *key, uint32_t *removed)
+{
+	if(n == NIL)
+	{
+		return NIL;
+	}
+
+	int c = compare(key, &nodes[n]);
+
+	if(c < 0)
+	{
+		nodes[n].left = remove_node(nodes, nodes[n].left, key, removed);
+	}
+	else if(c > 0)
+	{
+		nodes[n].right = remove_node(nodes, nodes[n].right, key, removed);
+	}
+	else
+	{
+		*removed = n;
+		if(nodes[n].left == NIL || nodes[n].right == NIL)
+		{
+			return nodes[n].left | nodes[n].right;
+		}
+
+		uint32_t successor;
+		uint32_t right = remove_min(nodes, nodes[n].right, &successor);
+
+		nodes[successor].left = nodes[n].left;
+		nodes[successor].right = right;
+		n = successor;
+	}
+
+	return rebalance(nodes, n);
+}
+
+/* Visits every interval in the subtree at n overlapping [q->start, q->end).
+ * Returns false if the visitor asked to stop.
+*/
+static bool query_node(struct query *q, uint32_t n)
+{
+	while(n != NIL)
+	{
+		const struct node *node = &q->nodes[n];
+
+		if(node->max <= q->start)
+		{
+			/* Everything here ends too early. */
+			return true;
+		}
+
+		if(!query_node(q, node->left))
+		{
+			return false;
+		}
+
+		if(node->start >= q->end)
+		{
+			/* This and everything to the right starts too late. */
+			return true;
+		}
+
+		if(node->end > q->start)
+		{
+			++(q->visited);
+			if(q->visit != NULL && !q->visit(interval_of(node->start, node->end), node->data, q->arg))
+			{
+				return false;
+			}
+		}
+
+		n = node->right;
+	}
+
+	return true;
+}
+
+/** \fn struct timespec_interval_tree *timespec_interval_tree_create(void)
+ *  \brief Creates an empty interval tree.
+ *
+ * Returns NULL and sets errno on failure.
+*/
+struct timespec_interval_tree *timespec_interval_tree_create(void)
+{
+	struct timespec_interval_tree *tree = calloc(1, sizeof(*tree));
+
+	if(tree == NULL)
+	{
+		return NULL;
+	}
+
+	tree->capacity = 64;
+	tree->nodes = malloc(tree->capacity * sizeof(*(tree->nodes)));
+	if(tree->nodes == NULL)
+	{
+		free(tree);
+		return NULL;
+	}
+
+	tree->nodes[NIL].height = 0;
+	tree->nodes[NIL].max = INT64_MIN;
+	tree->nodes[NIL].left = NIL;
+	tree->nodes[NIL].right = NIL;
+	tree->used = 1;
+
+	return tree;
+}
+
+/** \fn void timespec_interval_tree_destroy(struct timespec_interval_tree *tree)
+ *  \brief Frees an interval tree. NULL is ignored.
+*/
+void timespec_interval_tree_destroy(struct timespec_interval_tree *tree)
+{
+	if(tree == NULL)
+	{
+		return;
+	}
+
+	free(tree->nodes);
+	free(tree);
+}
+
+/** \fn bool timespec_interval_tree_insert(struct timespec_interval_tree *tree, struct timespec_interval interval, void *data)
+ *  \brief Adds an interval, with a pointer for the caller's use, in O(log n).
+ *
+ * The same interval may be added any number of times. Returns false and
+ * sets errno to EINVAL if the interval is empty, ERANGE if it is outside the
+ * range of timespec_ns, or ENOMEM.
+*/
+bool timespec_interval_tree_insert(struct timespec_interval_tree *tree, struct timespec_interval interval, void *data)
+{
+	struct range range;
+	uint32_t n;
+
+	if(!range_of(interval, &range))
+	{
+		return false;
+	}
+
+	if(range.end <= range.start)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if(tree->free != NIL)
+	{
+		n = tree->free;
+		tree->free = tree->nodes[n].left;
+	}
+	else
+	{
+		if(tree->used == tree->capacity)
+		{
+			if(tree->capacity > UINT32_MAX / 2)
+			{
+				errno = ENOMEM;
+				return false;
+			}
+
+			struct node *nodes = realloc(tree->nodes, 2 * (size_t)(tree->capacity) * sizeof(*nodes));
+			if(nodes == NULL)
+			{
+				errno = ENOMEM;
+				return false;
+			}
+
+			tree->nodes = nodes;
+			tree->capacity *= 2;
+		}
+
+		n = tree->used++;
+	}
+
+	struct node *node = &tree->nodes[n];
+
+	node->start = range.start;
+	node->end = range.end;
+	node->max = range.end;
+	node->data = data;
+	node->left = NIL;
+	node->right = NIL;
+	node->height = 1;
+
+	tree->root = insert_node(tree->nodes, tree->root, n);
+	++(tree->count);
+
+	return true;
+}
+
+/** \fn bool timespec_interval_tree_remove(struct timespec_interval_tree *tree, struct timespec_interval interval, void *data)
+ *  \brief Removes one interval added with the same data, in O(log n).
+ *
+ * Returns false if there is none, setting errno to ERANGE if the interval
+ * could never have been added.
+*/
+bool timespec_interval_tree_remove(struct timespec_interval_tree *tree, struct timespec_interval interval, void *data)
+{
+	struct range range;
+	struct node key;
+	uint32_t removed = NIL;
+
+	if(!range_of(interval, &range))
+	{
+		return false;
+	}
+
+	key.start = range.start;
+	key.end = range.end;
+	key.data = data;
+
+	tree->root = remove_node(tree->nodes, tree->root, &key, &removed);
+	if(removed == NIL)
+	{
+		return false;
+	}
+
+	tree->nodes[removed].left = tree->free;
+	tree->free = removed;
+	--(tree->count);
+
+	return true;
+}
+
+/** \fn size_t timespec_interval_tree_count(const struct timespec_interval_tree *tree)
+ *  \brief Returns the number of intervals in a tree.
+*/
+size_t timespec_interval_tree_count(const struct timespec_interval_tree *tree)
+{
+	return tree->count;
+}
+
+/** \fn size_t timespec_interval_tree_stab(const struct timespec_interval_tree *tree, struct timespec ts, bool (*visit)(struct timespec_interval interval, void *data, void *arg), void *arg)
+ *  \brief Finds the intervals containing ts.
+ *
+ * Calls visit, if not NULL, for each in order of start time, stopping early
+ * if it returns false. Returns the number visited. O(log n + k).
+*/
+size_t timespec_interval_tree_stab(const struct timespec_interval_tree *tree, struct timespec ts,
+	bool (*visit)(struct timespec_interval interval, void *data, void *arg), void *arg)
+{
+	struct query q = { tree->nodes, 0, 0, visit, arg, 0 };
+	timespec_ns ns = timespec_ns_from_timespec(ts);
+
+	if(ns == INT64_MAX)
+	{
+		/* No interval can end after it. */
+		return 0;
+	}
+
+	q.start = ns;
+	q.end = ns + 1;
+	query_node(&q, tree->root);
+
+	return q.visited;
+}
+
+/** \fn size_t timespec_interval_tree_overlap(const struct timespec_interval_tree *tree, struct timespec_interval interval, bool (*visit)(struct timespec_interval interval, void *data, void *arg), void *arg)
+ *  \brief Finds the intervals overlapping interval.
+ *
+ * Intervals which only touch it at one end do not overlap it. Calls visit
+ * as for timespec_interval_tree_stab(). O(log n + k).
+*/
+size_t timespec_interval_tree_overlap(const struct timespec_interval_tree *tree, struct timespec_interval interval,
+	bool (*visit)(struct timespec_interval interval, void *data, void *arg), void *arg)
+{
+	struct query q = { tree->nodes, timespec_ns_from_timespec(interval.start), timespec_ns_from_timespec(interval.end),
+		visit, arg, 0 };
+
+	if(q.end > q.start)
+	{
+		query_node(&q, tree->root);
+	}
+
+	return q.visited;
+}
+
+static bool set_reserve(struct timespec_interval_set *set, size_t count)
+{
+	if(count <= set->capacity)
+	{
+		return true;
+	}
+
+	size_t capacity = (set->capacity > 0) ? set->capacity : 16;
+	while(capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	struct range *ranges = realloc(set->ranges, capacity * sizeof(*ranges));
+	if(ranges == NULL)
+	{
+		errno = ENOMEM;
+		return false;
+	}
+
+	set->ranges = ranges;
+	set->capacity = capacity;
+
+	return true;
+}
+
+/* Returns the index of the first range ending at or after ns. */
+static size_t first_ending_from(const struct timespec_interval_set *set, timespec_ns ns)
+{
+	size_t lo = 0, hi = set->count;
+
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if(set->ranges[mid].end < ns)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/* Appends a range to a set being built in order, merging it with the last if they touch. */
+static void set_push(struct timespec_interval_set *set, timespec_ns start, timespec_ns end)
+{
+	if(set->count > 0 && set->ranges[set->count - 1].end >= start)
+	{
+		if(end > set->ranges[set->count - 1].end)
+		{
+			set->ranges[set->count - 1].end = end;
+		}
+		return;
+	}
+
+	set->ranges[set->count].start = start;
+	set->ranges[set->count].end = end;
+	++(set->count);
+}
+
+/** \fn struct timespec_interval_set *timespec_interval_set_create(void)
+ *  \brief Creates an empty interval set.
+ *
+ * Returns NULL and sets errno on failure.
+*/
+struct timespec_interval_set *timespec_interval_set_create(void)
+{
+	return calloc(1, sizeof(struct timespec_interval_set));
+}
+
+/** \fn void timespec_interval_set_destroy(struct timespec_interval_set *set)
+ *  \brief Frees an interval set. NULL is ignored.
+*/
+void timespec_interval_set_destroy(struct timespec_interval_set *set)
+{
+	if(set == NULL)
+	{
+		return;
+	}
+
+	free(set->ranges);
+	free(set);
+}
+
+/** \fn bool timespec_interval_set_add(struct timespec_interval_set *set, struct timespec_interval interval)
+ *  \brief Adds every time in interval to a set.
+ *
+ * Intervals it overlaps or touches are merged with it. Empty intervals are
+ * ignored. Returns false and sets errno to ERANGE if it is outside the
+ * range of timespec_ns, or ENOMEM.
+*/
+bool timespec_interval_set_add(struct timespec_interval_set *set, struct timespec_interval interval)
+{
+	struct range range;
+
+	if(!range_of(interval, &range))
+	{
+		return false;
+	}
+
+	if(range.end <= range.start)
+	{
+		return true;
+	}
+
+	/* Ranges [i, j) touch the new one and are replaced by their union with it. */
+	size_t i = first_ending_from(set, range.start);
+	size_t j = i;
+
+	while(j < set->count && set->ranges[j].start <= range.end)
+	{
+		++j;
+	}
+
+	if(i == j && !set_reserve(set, set->count + 1))
+	{
+		return false;
+	}
+
+	if(i < j)
+	{
+		if(set->ranges[i].start < range.start)
+		{
+			range.start = set->ranges[i].start;
+		}
+		if(set->ranges[j - 1].end > range.end)
+		{
+			range.end = set->ranges[j - 1].end;
+		}
+	}
+
+	memmove(&set->ranges[i + 1], &set->ranges[j], (set->count - j) * sizeof(*(set->ranges)));
+	set->ranges[i] = range;
+	set->count = set->count + 1 - (j - i);
+
+	return true;
+}
+
+/** \fn bool timespec_interval_set_remove(struct timespec_interval_set *set, struct timespec_interval interval)
+ *  \brief Removes every time in interval from a set.
+ *
+ * Returns false and sets errno as for timespec_interval_set_add().
+*/
+bool timespec_interval_set_remove(struct timespec_interval_set *set, struct timespec_interval interval)
+{
+	struct range range;
+
+	if(!range_of(interval, &range))
+	{
+		return false;
+	}
+
+	if(range.end <= range.start)
+	{
+		return true;
+	}
+
+	/* Ranges [i, j) overlap the removed one. */
+	size_t i = first_ending_from(set, range.start + 1);
+	size_t j = i;
+
+	while(j < set->count && set->ranges[j].start < range.end)
+	{
+		++j;
+	}
+
+	if(i == j)
+	{
+		return true;
+	}
+
+	/* What is left of the first and last, at most two pieces. */
+	struct range pieces[2];
+	size_t n = 0;
+
+	if(set->ranges[i].start < range.start)
+	{
+		pieces[n].start = set->ranges[i].start;
+		pieces[n].end = range.start;
+		++n;
+	}
+	if(set->ranges[j - 1].end > range.end)
+	{
+		pieces[n].start = range.end;
+		pieces[n].end = set->ranges[j - 1].end;
+		++n;
+	}
+
+	if(n > j - i && !set_reserve(set, set->count + 1))
+	{
+		return false;
+	}
+
+	memmove(&set->ranges[i + n], &set->ranges[j], (set->count - j) * sizeof(*(set->ranges)));
+	memcpy(&set->ranges[i], pieces, n * sizeof(*pieces));
+	set->count = set->count + n - (j - i);
+
+	return true;
+}
+
+/** \fn bool timespec_interval_set_contains(const struct timespec_interval_set *set, struct timespec ts)
+ *  \brief Returns true if ts is in a set. O(log n).
+*/
+bool timespec_interval_set_contains(const struct timespec_interval_set *set, struct timespec ts)
+{
+	timespec_ns ns = timespec_ns_from_timespec(ts);
+
+	if(ns == INT64_MAX)
+	{
+		return false;
+	}
+
+	size_t i = first_ending_from(set, ns + 1);
+
+	return i < set->count && set->ranges[i].start <= ns;
+}
+
+/** \fn size_t timespec_interval_set_count(const struct timespec_interval_set *set)
+ *  \brief Returns the number of disjoint intervals making up a set.
+*/
+size_t timespec_interval_set_count(const struct timespec_interval_set *set)
+{
+	return set->count;
+}
+
+/** \fn struct timespec_interval timespec_interval_set_get(const struct timespec_interval_set *set, size_t index)
+ *  \brief Returns one of the intervals making up a set.
+ *
+ * They are in order, do not overlap or touch, and are never empty. index
+ * must be less than timespec_interval_set_count().
+*/
+struct timespec_interval timespec_interval_set_get(const struct timespec_interval_set *set, size_t index)
+{
+	return interval_of(set->ranges[index].start, set->ranges[index].end);
+}
+
+/** \fn struct timespec_interval_set *timespec_interval_set_union(const struct timespec_interval_set *a, const struct timespec_interval_set *b)
+ *  \brief Returns a new set of the times in either a or b. O(n + m).
+ *
+ * Returns NULL and sets errno on failure.
+*/
+struct timespec_interval_set *timespec_interval_set_union(const struct timespec_interval_set *a,
+	const struct timespec_interval_set *b)
+{
+	struct timespec_interval_set *set = timespec_interval_set_create();
+
+	if(set == NULL || !set_reserve(set, a->count + b->count))
+	{
+		timespec_interval_set_destroy(set);
+		return NULL;
+	}
+
+	size_t i = 0, j = 0;
+
+	while(i < a->count || j < b->count)
+	{
+		const struct range *r;
+
+		if(j == b->count || (i < a->count && a->ranges[i].start <= b->ranges[j].start))
+		{
+			r = &a->ranges[i++];
+		}
+		else
+		{
+			r = &b->ranges[j++];
+		}
+
+		set_push(set, r->start, r->end);
+	}
+
+	return set;
+}
+
+/** \fn struct timespec_interval_set *timespec_interval_set_intersection(const struct timespec_interval_set *a, const struct timespec_interval_set *b)
+ *  \brief Returns a new set of the times in both a and b. O(n + m).
+ *
+ * Returns NULL and sets errno on failure.
+*/
+struct timespec_interval_set *timespec_interval_set_intersection(const struct timespec_interval_set *a,
+	const struct timespec_interval_set *b)
+{
+	struct timespec_interval_set *set = timespec_interval_set_create();
+
+	if(set == NULL || !set_reserve(set, a->count + b->count))
+	{
+		timespec_interval_set_destroy(set);
+		return NULL;
+	}
+
+	size_t i = 0, j = 0;
+
+	while(i < a->count && j < b->count)
+	{
+		timespec_ns start = (a->ranges[i].start > b->ranges[j].start) ? a->ranges[i].start : b->ranges[j].start;
+		timespec_ns end = (a->ranges[i].end < b->ranges[j].end) ? a->ranges[i].end : b->ranges[j].end;
+
+		if(start < end)
+		{
+			/* Pieces of disjoint sets never touch, so no merging is needed. */
+			set->ranges[set->count].start = start;
+			set->ranges[set->count].end = end;
+			++(set->count);
+		}
+
+		if(a->ranges[i].end < b->ranges[j].end)
+		{
+			++i;
+		}
+		else
+		{
+			++j;
+		}
+	}
+
+	return set;
+}
+
+static int compare_starts(const void *a, const void *b)
+{
+	const struct timespec_interval *x = a, *y = b;
+
+	if(timespec_lt(x->start, y->start))
+	{
+		return -1;
+	}
+
+	return timespec_gt(x->start, y->start);
+}
+
+/** \fn size_t timespec_interval_coalesce(struct timespec_interval *intervals, size_t n)
+ *  \brief Merges overlapping and touching intervals in an array.
+ *
+ * The array is rewritten in place as the smallest sorted list of disjoint
+ * intervals covering the same times, with empty intervals dropped, and the
+ * new length returned. O(n log n). Unlike the tree and set this works on
+ * any timespec values.
+*/
+size_t timespec_interval_coalesce(struct timespec_interval *intervals, size_t n)
+{
+	size_t out = 0;
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		intervals[i].start = timespec_normalise(intervals[i].start);
+		intervals[i].end = timespec_normalise(intervals[i].end);
+
+		if(timespec_gt(intervals[i].end, intervals[i].start))
+		{
+			intervals[out++] = intervals[i];
+		}
+	}
+
+	qsort(intervals, out, sizeof(*intervals), compare_starts);
+
+	n = out;
+	out = 0;
+	for(size_t i = 0; i < n; ++i)
+	{
+		if(out > 0 && timespec_ge(intervals[out - 1].end, intervals[i].start))
+		{
+			if(timespec_gt(intervals[i].end, intervals[out - 1].end))
+			{
+				intervals[out - 1].end = intervals[i].end;
+			}
+		}
+		else
+		{
+			intervals[out++] = intervals[i];
+		}
+	}
+
+	return out;
+}
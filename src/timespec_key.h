@@ -0,0 +1,59 @@
+/**
+ * @file timespec_key.h
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Mapping of timespecs to unsigned 64 bit keys which order the same way,
+ * shared by the radix sort and the search index. Not installed.
+ *
+ * A key is the nanoseconds since the second before the earliest tv_sec of a
+ * set of values, min_sec, so that negative values, whose tv_nsec is negative,
+ * still map above zero. That fits in 64 bits for any set spanning less than
+ * about 584 years, with UINT64_MAX left above every key.
+*/
+
+#ifndef DAN_TIMESPEC_KEY_H
+#define DAN_TIMESPEC_KEY_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define NSEC_PER_SEC UINT64_C(1000000000)
+
+/* Widest range of seconds from min_sec whose keys fit in 64 bits, below UINT64_MAX. */
+#define RANGE_64 (UINT64_MAX / NSEC_PER_SEC - 2)
+
+static inline uint64_t timespec_key(struct timespec ts, time_t min_sec)
+{
+	return ((uint64_t)(ts.tv_sec) - (uint64_t)(min_sec) + 1) * NSEC_PER_SEC + (uint64_t)(ts.tv_nsec);
+}
+
+/* Inverse of timespec_key(), giving a normalised value. */
+static inline struct timespec timespec_from_key(uint64_t key, time_t min_sec)
+{
+	uint64_t sec = key / NSEC_PER_SEC;
+	struct timespec ts;
+
+	if(sec == 0)
+	{
+		/* Less than min_sec, so only reached when it is not positive. */
+		ts.tv_sec = min_sec;
+		ts.tv_nsec = (long)(key) - (long)(NSEC_PER_SEC);
+	}
+	else
+	{
+		ts.tv_sec = (time_t)((uint64_t)(min_sec) + sec - 1);
+		ts.tv_nsec = (long)(key % NSEC_PER_SEC);
+
+		if(ts.tv_sec < 0 && ts.tv_nsec > 0)
+		{
+			++(ts.tv_sec);
+			ts.tv_nsec -= (long)(NSEC_PER_SEC);
+		}
+	}
+
+	return ts;
+}
+
+#endif /* !DAN_TIMESPEC_KEY_H */
@@ -0,0 +1,675 @@
+/**
+ * @file timespec_log.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Append-only log of timestamped records, read in place through mmap().
+ *
+ * The file is divided into fixed-size pages. The first holds the header:
+ *
+ *     magic (u64), page size (u32), reserved (u32), committed length (u64)
+ *
+ * and the rest hold records, each a struct timespec_log_record followed by
+ * its payload padded to 16 bytes. Records are in non-decreasing time order
+ * and never cross a page boundary; when one does not fit in what is left of
+ * a page the rest is filled with a padding record and it starts on the
+ * next. Every page therefore starts with a record, and the first records of
+ * the pages form a sparse time index that costs nothing to maintain: the
+ * pages can be binary searched by the time at their start, so finding a time
+ * touches O(log n) pages and then scans part of one.
+ *
+ * Integers are in the byte order of the host which wrote the file; the magic
+ * number does not match when read on a host of the other order.
+ *
+ * Only bytes below the committed length are ever read. The single writer
+ * fills records in through a shared mapping and then publishes the new
+ * length with a release store, so readers in other threads or processes that
+ * load it with acquire ordering always see complete records.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "timespec.h"
+#include "timespec_log.h"
+
+#define LOG_MAGIC     UINT64_C(0x31474f4c53544d54) /* "TMTSLOG1" on little-endian hosts */
+#define MIN_PAGE_SIZE 256
+#define MAX_PAGE_SIZE (UINT32_C(1) << 30)
+
+#define RECORD_HEADER ((uint64_t)(sizeof(struct timespec_log_record)))
+#define FLAG_PAD      UINT32_C(1)
+
+/* Pages the writer grows the file by at a time, at least. */
+#define GROW_PAGES 64
+
+struct log_header
+{
+	uint64_t magic;
+	uint32_t page_size;
+	uint32_t reserved;
+
+	/* Bytes of the file holding complete records, counted from the start
+	 * of the file, so never less than one page.
+	*/
+	uint64_t committed;
+};
+
+struct timespec_log_writer
+{
+	int fd;
+	unsigned char *map;
+	uint64_t capacity;
+
+	uint64_t page_size;
+	uint64_t end;
+	timespec_ns last;
+};
+
+struct timespec_log_reader
+{
+	int fd;
+	unsigned char *map;
+	uint64_t mapped;
+
+	uint64_t page_size;
+
+	/* Committed length as of the last refresh. */
+	uint64_t end;
+};
+
+static uint64_t record_length(uint32_t size)
+{
+	return RECORD_HEADER + (((uint64_t)(size) + 15) & ~(uint64_t)(15));
+}
+
+static struct log_header *header_of(unsigned char *map)
+{
+	return (struct log_header *)(void *)(map);
+}
+
+static bool valid_page_size(uint64_t page_size)
+{
+	return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE && (page_size & (page_size - 1)) == 0;
+}
+
+/* Checks the header of a mapped file of size bytes and returns its page
+ * size, or 0 if it is not a valid log. The committed length is not checked
+ * against the size, as a writer may be extending the file.
+*/
+static uint64_t check_header(unsigned char *map, uint64_t size)
+{
+	struct log_header *header = header_of(map);
+
+	if(size < sizeof(*header) || header->magic != LOG_MAGIC || !valid_page_size(header->page_size))
+	{
+		return 0;
+	}
+
+	uint64_t committed = __atomic_load_n(&header->committed, __ATOMIC_ACQUIRE);
+
+	if(committed < header->page_size || committed % 16 != 0)
+	{
+		return 0;
+	}
+
+	return header->page_size;
+}
+
+static unsigned char *map_file(int fd, uint64_t size, int prot)
+{
+	void *map;
+
+	if(size > SIZE_MAX)
+	{
+		errno = EFBIG;
+		return NULL;
+	}
+
+	map = mmap(NULL, (size_t)(size), prot, MAP_SHARED, fd, 0);
+	if(map == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	return map;
+}
+
+/* Returns the record at offset, skipping a padding record at the end of a
+ * page, or NULL at the end of the committed data or if the record found
+ * would run past it.
+*/
+static const struct timespec_log_record *record_at(const unsigned char *map, uint64_t page_size, uint64_t end,
+	uint64_t offset)
+{
+	for(;;)
+	{
+		if(offset + RECORD_HEADER > end)
+		{
+			return NULL;
+		}
+
+		const struct timespec_log_record *record = (const void *)(map + offset);
+		uint64_t next = offset + record_length(record->size);
+
+		if(next > end || next > (offset | (page_size - 1)) + 1)
+		{
+			/* Corrupt: runs off the data or across a page. */
+			return NULL;
+		}
+
+		if(!(record->flags & FLAG_PAD))
+		{
+			return record;
+		}
+
+		offset = next;
+	}
+}
+
+/* Finds the first record with a time at or after (or, if strict, after) ns. */
+static const struct timespec_log_record *search(const struct timespec_log_reader *reader, timespec_ns ns,
+	bool strict)
+{
+	uint64_t pages = (reader->end - 1) / reader->page_size;
+	uint64_t lo = 1, hi = pages + 1;
+
+	/* Find the first page whose first record is at or after the bound. Every
+	 * record in the pages before it, except perhaps the last of them, is
+	 * before it.
+	*/
+	while(lo < hi)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+		const struct timespec_log_record *first = (const void *)(reader->map + mid * reader->page_size);
+
+		if(strict ? first->time > ns : first->time >= ns)
+		{
+			hi = mid;
+		}
+		else
+		{
+			lo = mid + 1;
+		}
+	}
+
+	uint64_t offset = (lo > 1 ? lo - 1 : 1) * reader->page_size;
+	const struct timespec_log_record *record = record_at(reader->map, reader->page_size, reader->end, offset);
+
+	while(record != NULL && (strict ? record->time <= ns : record->time < ns))
+	{
+		record = timespec_log_next(reader, record);
+	}
+
+	return record;
+}
+
+static bool grow(struct timespec_log_writer *writer, uint64_t needed)
+{
+	uint64_t capacity = writer->capacity;
+
+	while(capacity < needed)
+	{
+		capacity += (capacity > GROW_PAGES * writer->page_size) ? capacity : GROW_PAGES * writer->page_size;
+	}
+
+	if(capacity > (uint64_t)(INT64_MAX) || ftruncate(writer->fd, (off_t)(capacity)) != 0)
+	{
+		return false;
+	}
+
+	unsigned char *map = map_file(writer->fd, capacity, PROT_READ | PROT_WRITE);
+	if(map == NULL)
+	{
+		return false;
+	}
+
+	if(writer->map != NULL)
+	{
+		munmap(writer->map, (size_t)(writer->capacity));
+	}
+	writer->map = map;
+	writer->capacity = capacity;
+
+	return true;
+}
+
+/** \fn struct timespec_log_writer *timespec_log_writer_open(const char *path, uint32_t page_size)
+ *  \brief Opens a log for appending, creating it if necessary.
+ *
+ * page_size, a power of two from 256 bytes to 1GB, is used only when the
+ * log is created; 0 selects TIMESPEC_LOG_PAGE_SIZE. An existing log keeps
+ * its own page size and is appended to after its last committed record.
+ *
+ * Only one writer may have a log open at a time; returns NULL with errno
+ * set to EBUSY if another has it. Returns NULL and sets errno on any other
+ * failure, including EINVAL if the file exists but is not a log.
+*/
+struct timespec_log_writer *timespec_log_writer_open(const char *path, uint32_t page_size)
+{
+	struct timespec_log_writer *writer;
+	struct stat st;
+	int err;
+
+	if(page_size == 0)
+	{
+		page_size = TIMESPEC_LOG_PAGE_SIZE;
+	}
+
+	if(!valid_page_size(page_size))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	writer = calloc(1, sizeof(*writer));
+	if(writer == NULL)
+	{
+		return NULL;
+	}
+
+	writer->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if(writer->fd < 0)
+	{
+		free(writer);
+		return NULL;
+	}
+
+	if(flock(writer->fd, LOCK_EX | LOCK_NB) != 0)
+	{
+		err = (errno == EWOULDBLOCK) ? EBUSY : errno;
+		goto fail;
+	}
+
+	if(fstat(writer->fd, &st) != 0)
+	{
+		err = errno;
+		goto fail;
+	}
+
+	if(st.st_size == 0)
+	{
+		/* New log: an empty header page with the magic number written last,
+		 * so a crash part way leaves a file that is rejected.
+		*/
+		writer->page_size = page_size;
+		if(!grow(writer, page_size))
+		{
+			err = errno;
+			goto fail;
+		}
+
+		struct log_header *header = header_of(writer->map);
+		header->page_size = page_size;
+		header->committed = page_size;
+		__atomic_store_n(&header->magic, LOG_MAGIC, __ATOMIC_RELEASE);
+
+		writer->end = page_size;
+		writer->last = INT64_MIN;
+
+		return writer;
+	}
+
+	writer->map = map_file(writer->fd, (uint64_t)(st.st_size), PROT_READ | PROT_WRITE);
+	if(writer->map == NULL)
+	{
+		err = errno;
+		goto fail;
+	}
+	writer->capacity = (uint64_t)(st.st_size);
+
+	writer->page_size = check_header(writer->map, writer->capacity);
+	if(writer->page_size == 0 || header_of(writer->map)->committed > writer->capacity)
+	{
+		err = EINVAL;
+		goto fail;
+	}
+
+	/* Anything past the committed length is the tail of an append that
+	 * never completed, or space grown in advance, and is overwritten.
+	*/
+	writer->end = header_of(writer->map)->committed;
+	writer->last = INT64_MIN;
+
+	/* Recover the time of the last record from the last page. */
+	if(writer->end > writer->page_size)
+	{
+		uint64_t offset = (writer->end - 1) / writer->page_size * writer->page_size;
+		const struct timespec_log_record *record;
+
+		while((record = record_at(writer->map, writer->page_size, writer->end, offset)) != NULL)
+		{
+			writer->last = record->time;
+			offset = (uint64_t)((const unsigned char *)(record) - writer->map) + record_length(record->size);
+		}
+	}
+
+	return writer;
+
+	fail:
+	if(writer->map != NULL)
+	{
+		munmap(writer->map, (size_t)(writer->capacity));
+	}
+	close(writer->fd);
+	free(writer);
+	errno = err;
+	return NULL;
+}
+
+/** \fn void timespec_log_writer_close(struct timespec_log_writer *writer)
+ *  \brief Closes a log writer. NULL is ignored.
+ *
+ * Space grown in advance is trimmed from the file. The log is not synced
+ * to disk; call timespec_log_writer_sync() first if that matters.
+*/
+void timespec_log_writer_close(struct timespec_log_writer *writer)
+{
+	if(writer == NULL)
+	{
+		return;
+	}
+
+	munmap(writer->map, (size_t)(writer->capacity));
+	if(ftruncate(writer->fd, (off_t)(writer->end)) != 0)
+	{
+		/* Harmless, the excess is ignored and reused on the next open. */
+	}
+	close(writer->fd);
+	free(writer);
+}
+
+/** \fn bool timespec_log_writer_sync(struct timespec_log_writer *writer)
+ *  \brief Writes every committed record to disk.
+ *
+ * The records are flushed before the header, so after a crash the log holds
+ * every record committed before the last successful sync and possibly some
+ * after. Returns false and sets errno on failure.
+*/
+bool timespec_log_writer_sync(struct timespec_log_writer *writer)
+{
+	/* msync() works in whole memory pages, which may be larger than log
+	 * pages; if the header shares its memory page with records they can
+	 * only be flushed together.
+	*/
+	uint64_t memory_page = (uint64_t)(sysconf(_SC_PAGESIZE));
+	uint64_t data = writer->page_size / memory_page * memory_page;
+
+	if(data != 0 && writer->end > data && msync(writer->map + data, (size_t)(writer->end - data), MS_SYNC) != 0)
+	{
+		return false;
+	}
+
+	return msync(writer->map, (size_t)(data != 0 ? data : writer->end), MS_SYNC) == 0;
+}
+
+/** \fn bool timespec_log_append(struct timespec_log_writer *writer, struct timespec time, const void *data, size_t size)
+ *  \brief Appends a record to a log.
+ *
+ * Times must not go backwards. Returns false and sets errno to EINVAL if
+ * time is before the last record's or size is more than the page size less
+ * 16 bytes, or to ERANGE if time is outside the range of timespec_ns.
+*/
+bool timespec_log_append(struct timespec_log_writer *writer, struct timespec time, const void *data, size_t size)
+{
+	timespec_ns ns;
+
+	time = timespec_normalise(time);
+	if(__builtin_mul_overflow((timespec_ns)(time.tv_sec), (timespec_ns)(1000000000), &ns)
+		|| __builtin_add_overflow(ns, (timespec_ns)(time.tv_nsec), &ns))
+	{
+		errno = ERANGE;
+		return false;
+	}
+
+	return timespec_log_append_ns(writer, ns, data, size);
+}
+
+/** \fn bool timespec_log_append_ns(struct timespec_log_writer *writer, timespec_ns time, const void *data, size_t size)
+ *  \brief Appends a record with a timespec_ns time to a log.
+ *
+ * See timespec_log_append(). The record is visible to readers once this
+ * returns.
+*/
+bool timespec_log_append_ns(struct timespec_log_writer *writer, timespec_ns time, const void *data, size_t size)
+{
+	uint64_t page = writer->page_size;
+	uint64_t offset = writer->end;
+
+	if(time < writer->last || size > page - RECORD_HEADER)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	uint64_t length = record_length((uint32_t)(size));
+	uint64_t room = page - offset % page;
+	uint64_t pad = (length > room) ? room : 0;
+
+	if(offset + pad + length > writer->capacity && !grow(writer, offset + pad + length))
+	{
+		return false;
+	}
+
+	if(pad != 0)
+	{
+		struct timespec_log_record *filler = (void *)(writer->map + offset);
+
+		filler->time = writer->last;
+		filler->size = (uint32_t)(pad - RECORD_HEADER);
+		filler->flags = FLAG_PAD;
+		offset += pad;
+	}
+
+	struct timespec_log_record *record = (void *)(writer->map + offset);
+
+	record->time = time;
+	record->size = (uint32_t)(size);
+	record->flags = 0;
+	memcpy(record->data, data, size);
+
+	writer->end = offset + length;
+	writer->last = time;
+	__atomic_store_n(&header_of(writer->map)->committed, writer->end, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/** \fn struct timespec_log_reader *timespec_log_reader_open(const char *path)
+ *  \brief Opens a log for reading.
+ *
+ * The reader sees the records committed when it was opened; call
+ * timespec_log_reader_refresh() to see later ones. Returns NULL and sets
+ * errno on failure, including EINVAL if the file is not a log.
+*/
+struct timespec_log_reader *timespec_log_reader_open(const char *path)
+{
+	struct timespec_log_reader *reader;
+
+	reader = calloc(1, sizeof(*reader));
+	if(reader == NULL)
+	{
+		return NULL;
+	}
+
+	reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(reader->fd < 0)
+	{
+		free(reader);
+		return NULL;
+	}
+
+	if(!timespec_log_reader_refresh(reader))
+	{
+		int err = errno;
+
+		close(reader->fd);
+		free(reader);
+		errno = err;
+		return NULL;
+	}
+
+	return reader;
+}
+
+/** \fn void timespec_log_reader_close(struct timespec_log_reader *reader)
+ *  \brief Closes a log reader. NULL is ignored.
+*/
+void timespec_log_reader_close(struct timespec_log_reader *reader)
+{
+	if(reader == NULL)
+	{
+		return;
+	}
+
+	if(reader->map != NULL)
+	{
+		munmap(reader->map, (size_t)(reader->mapped));
+	}
+	close(reader->fd);
+	free(reader);
+}
+
+/** \fn bool timespec_log_reader_refresh(struct timespec_log_reader *reader)
+ *  \brief Makes records committed since the reader was opened or last
+ *         refreshed visible to it.
+ *
+ * If the file has grown past the reader's mapping it is mapped again, which
+ * invalidates every record pointer obtained from the reader. Returns false
+ * and sets errno on failure, leaving the reader as it was.
+*/
+bool timespec_log_reader_refresh(struct timespec_log_reader *reader)
+{
+	if(reader->map != NULL)
+	{
+		uint64_t committed = __atomic_load_n(&header_of(reader->map)->committed, __ATOMIC_ACQUIRE);
+
+		if(committed <= reader->mapped)
+		{
+			reader->end = committed;
+			return true;
+		}
+	}
+
+	struct stat st;
+
+	if(fstat(reader->fd, &st) != 0)
+	{
+		return false;
+	}
+
+	if(st.st_size < (off_t)(sizeof(struct log_header)))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	unsigned char *map = map_file(reader->fd, (uint64_t)(st.st_size), PROT_READ);
+	if(map == NULL)
+	{
+		return false;
+	}
+
+	uint64_t page_size = check_header(map, (uint64_t)(st.st_size));
+	if(page_size == 0)
+	{
+		munmap(map, (size_t)(st.st_size));
+		errno = EINVAL;
+		return false;
+	}
+
+	if(reader->map != NULL)
+	{
+		munmap(reader->map, (size_t)(reader->mapped));
+	}
+
+	reader->map = map;
+	reader->mapped = (uint64_t)(st.st_size);
+	reader->page_size = page_size;
+
+	/* check_header() saw a committed length within the file, but it may
+	 * have advanced since; take one which is known to be mapped.
+	*/
+	uint64_t committed = __atomic_load_n(&header_of(map)->committed, __ATOMIC_ACQUIRE);
+	reader->end = (committed <= reader->mapped) ? committed : reader->end;
+
+	if(reader->end < page_size)
+	{
+		reader->end = page_size;
+	}
+
+	return true;
+}
+
+/** \fn const struct timespec_log_record *timespec_log_first(const struct timespec_log_reader *reader)
+ *  \brief Returns the first record of a log, or NULL if it is empty.
+*/
+const struct timespec_log_record *timespec_log_first(const struct timespec_log_reader *reader)
+{
+	return record_at(reader->map, reader->page_size, reader->end, reader->page_size);
+}
+
+/** \fn const struct timespec_log_record *timespec_log_next(const struct timespec_log_reader *reader, const struct timespec_log_record *record)
+ *  \brief Returns the record after record, or NULL if it was the last.
+*/
+const struct timespec_log_record *timespec_log_next(const struct timespec_log_reader *reader,
+	const struct timespec_log_record *record)
+{
+	uint64_t offset = (uint64_t)((const unsigned char *)(record) - reader->map) + record_length(record->size);
+
+	return record_at(reader->map, reader->page_size, reader->end, offset);
+}
+
+/** \fn const struct timespec_log_record *timespec_log_lower_bound(const struct timespec_log_reader *reader, struct timespec time)
+ *  \brief Returns the first record at or after time, or NULL if there is none.
+*/
+const struct timespec_log_record *timespec_log_lower_bound(const struct timespec_log_reader *reader,
+	struct timespec time)
+{
+	return search(reader, timespec_ns_from_timespec(time), false);
+}
+
+/** \fn const struct timespec_log_record *timespec_log_upper_bound(const struct timespec_log_reader *reader, struct timespec time)
+ *  \brief Returns the first record after time, or NULL if there is none.
+*/
+const struct timespec_log_record *timespec_log_upper_bound(const struct timespec_log_reader *reader,
+	struct timespec time)
+{
+	return search(reader, timespec_ns_from_timespec(time), true);
+}
+
+/** \fn bool timespec_log_range(const struct timespec_log_reader *reader, struct timespec from, struct timespec to, const struct timespec_log_record **begin, const struct timespec_log_record **end)
+ *  \brief Finds the records with times from from to to inclusive.
+ *
+ * Sets begin to the first and end to the record after the last, or NULL
+ * if the last is the end of the log, so they can be visited with:
+ *
+ *     for(r = begin; r != end; r = timespec_log_next(reader, r))
+ *
+ * Returns false, with begin equal to end, if there are no such records.
+*/
+bool timespec_log_range(const struct timespec_log_reader *reader, struct timespec from, struct timespec to,
+	const struct timespec_log_record **begin, const struct timespec_log_record **end)
+{
+	*begin = timespec_log_lower_bound(reader, from);
+	*end = timespec_log_upper_bound(reader, to);
+
+	if(*begin == NULL || (*end != NULL && *end <= *begin))
+	{
+		*begin = *end;
+		return false;
+	}
+
+	return true;
+}
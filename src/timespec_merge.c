@@ -0,0 +1,513 @@
+/**
+ * @file timespec_merge.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * K-way merge of sorted timespec-keyed record streams.
+ *
+ * The merge is a loser tree: each internal node remembers the stream which
+ * lost the comparison there, and the overall winner sits above the root, so
+ * replacing the winner's record replays one path of log2(k) comparisons
+ * against the stored losers without looking at siblings. Records with equal
+ * keys come out in stream order, so the merge is stable and deterministic.
+ *
+ * Only the current record of each stream is held, so inputs can be generated
+ * or read on the fly. For sorted arrays, which may be memory-mapped files,
+ * the key space can be split into time ranges holding similar numbers of
+ * records; each range merges independently into its own known region of the
+ * output, so ranges can be merged on separate threads with the same result
+ * as a serial merge.
+ *
+ * Keys must be normalised, as returned by clock_gettime() and this library.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The comparisons are the inner loop, so have timespec_lt() inlined here. */
+#define TIMESPEC_INLINE
+#include "timespec.h"
+#include "timespec_merge.h"
+
+#define NONE SIZE_MAX
+
+struct leaf
+{
+	const void *record;
+	struct timespec key;
+};
+
+struct array_stream
+{
+	const char *next;
+	const char *end;
+	size_t record_size;
+};
+
+struct timespec_merge
+{
+	size_t k;
+	size_t key_offset;
+
+	/* Stream whose record was returned last, advanced on the next call so
+	 * the record stays valid until then.
+	*/
+	size_t pending;
+
+	struct timespec_merge_stream *streams;
+	struct leaf *leaves;
+
+	/* tree[0] is the winning stream, tree[1..k-1] the loser at each node
+	 * above leaves k..2k-1.
+	*/
+	size_t *tree;
+};
+
+static const void *array_next(void *arg)
+{
+	struct array_stream *a = arg;
+
+	if(a->next == a->end)
+	{
+		return NULL;
+	}
+
+	const void *record = a->next;
+	a->next += a->record_size;
+
+	return record;
+}
+
+static inline struct timespec key_of(const void *record, size_t key_offset)
+{
+	struct timespec key;
+
+	memcpy(&key, (const char*)(record) + key_offset, sizeof(key));
+
+	return key;
+}
+
+/* Returns true if stream a's record comes before stream b's. Ended streams
+ * come last, equal keys in stream order.
+*/
+static inline bool before(const struct timespec_merge *m, size_t a, size_t b)
+{
+	const struct leaf *x = &m->leaves[a], *y = &m->leaves[b];
+
+	if(x->record == NULL || y->record == NULL)
+	{
+		return y->record == NULL && (x->record != NULL || a < b);
+	}
+	else if(timespec_lt(x->key, y->key))
+	{
+		return true;
+	}
+	else if(timespec_lt(y->key, x->key))
+	{
+		return false;
+	}
+
+	return a < b;
+}
+
+static void load(struct timespec_merge *m, size_t i)
+{
+	struct leaf *leaf = &m->leaves[i];
+
+	leaf->record = m->streams[i].next(m->streams[i].arg);
+	if(leaf->record != NULL)
+	{
+		leaf->key = key_of(leaf->record, m->key_offset);
+	}
+}
+
+/* Fills in the losers below node and returns the winner. */
+static size_t build(struct timespec_merge *m, size_t node)
+{
+	if(node >= m->k)
+	{
+		return node - m->k;
+	}
+
+	size_t left = build(m, 2 * node);
+	size_t right = build(m, 2 * node + 1);
+
+	if(before(m, right, left))
+	{
+		m->tree[node] = left;
+		return right;
+	}
+
+	m->tree[node] = right;
+	return left;
+}
+
+/* Plays stream winner's new record up from its leaf against the losers. */
+static void replay(struct timespec_merge *m, size_t winner)
+{
+	for(size_t node = (winner + m->k) / 2; node > 0; node /= 2)
+	{
+		if(before(m, m->tree[node], winner))
+		{
+			size_t loser = winner;
+
+			winner = m->tree[node];
+			m->tree[node] = loser;
+		}
+	}
+
+	m->tree[0] = winner;
+}
+
+/* Allocates a merge of k streams with extra bytes after it for the caller. */
+static struct timespec_merge *allocate(size_t k, size_t key_offset, size_t extra)
+{
+	size_t n = (k > 0) ? k : 1;
+	struct timespec_merge *m = calloc(1, sizeof(*m) + n * (sizeof(*m->streams) + sizeof(*m->leaves)
+		+ sizeof(*m->tree)) + extra);
+
+	if(m == NULL)
+	{
+		return NULL;
+	}
+
+	m->k = k;
+	m->key_offset = key_offset;
+	m->pending = NONE;
+	m->leaves = (struct leaf*)(m + 1);
+	m->streams = (struct timespec_merge_stream*)(m->leaves + n);
+	m->tree = (size_t*)(m->streams + n);
+
+	return m;
+}
+
+static void start(struct timespec_merge *m)
+{
+	for(size_t i = 0; i < m->k; ++i)
+	{
+		load(m, i);
+	}
+
+	if(m->k > 0)
+	{
+		m->tree[0] = build(m, 1);
+	}
+}
+
+/* Returns the index of the first record whose key is not before t. */
+static size_t lower_bound(const struct timespec_merge_input *input, size_t record_size, size_t key_offset,
+	struct timespec t)
+{
+	const char *records = input->records;
+	size_t lo = 0, hi = input->count;
+
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if(timespec_lt(key_of(records + mid * record_size, key_offset), t))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/** \fn struct timespec_merge *timespec_merge_create(const struct timespec_merge_stream *streams, size_t k, size_t key_offset)
+ *  \brief Creates a merge of k sorted streams.
+ *
+ * Each record holds its struct timespec key key_offset bytes from its start,
+ * and may be unaligned. The first record of every stream is read here.
+ * Returns NULL and sets errno on failure.
+*/
+struct timespec_merge *timespec_merge_create(const struct timespec_merge_stream *streams, size_t k, size_t key_offset)
+{
+	struct timespec_merge *m = allocate(k, key_offset, 0);
+
+	if(m == NULL)
+	{
+		return NULL;
+	}
+
+	memcpy(m->streams, streams, k * sizeof(*streams));
+	start(m);
+
+	return m;
+}
+
+/** \fn struct timespec_merge *timespec_merge_create_arrays(const struct timespec_merge_input *inputs, size_t k, size_t record_size, size_t key_offset, const struct timespec *from, const struct timespec *to)
+ *  \brief Creates a merge of k sorted arrays of record_size byte records.
+ *
+ * Only records with keys in [*from, *to) are merged; either may be NULL for
+ * no limit. The arrays are read in place and must outlive the merge. Returns
+ * NULL and sets errno on failure.
+*/
+struct timespec_merge *timespec_merge_create_arrays(const struct timespec_merge_input *inputs, size_t k,
+	size_t record_size, size_t key_offset, const struct timespec *from, const struct timespec *to)
+{
+	struct timespec_merge *m;
+
+	if(record_size < sizeof(struct timespec) || key_offset > record_size - sizeof(struct timespec))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	m = allocate(k, key_offset, k * sizeof(struct array_stream));
+	if(m == NULL)
+	{
+		return NULL;
+	}
+
+	struct array_stream *arrays = (struct array_stream*)(m->tree + ((k > 0) ? k : 1));
+
+	for(size_t i = 0; i < k; ++i)
+	{
+		const char *records = inputs[i].records;
+		size_t begin = (from != NULL) ? lower_bound(&inputs[i], record_size, key_offset, *from) : 0;
+		size_t end = (to != NULL) ? lower_bound(&inputs[i], record_size, key_offset, *to) : inputs[i].count;
+
+		arrays[i].next = records + begin * record_size;
+		arrays[i].end = records + ((end > begin) ? end : begin) * record_size;
+		arrays[i].record_size = record_size;
+
+		m->streams[i].next = array_next;
+		m->streams[i].arg = &arrays[i];
+	}
+
+	start(m);
+
+	return m;
+}
+
+/** \fn void timespec_merge_destroy(struct timespec_merge *m)
+ *  \brief Frees a merge. NULL is ignored.
+*/
+void timespec_merge_destroy(struct timespec_merge *m)
+{
+	free(m);
+}
+
+/** \fn const void *timespec_merge_next(struct timespec_merge *m, size_t *stream)
+ *  \brief Returns the next record in key order, or NULL when every stream has ended.
+ *
+ * If stream is not NULL it is set to the index of the stream the record came
+ * from. The record stays valid until the next call.
+*/
+const void *timespec_merge_next(struct timespec_merge *m, size_t *stream)
+{
+	if(m->k == 0)
+	{
+		return NULL;
+	}
+
+	if(m->pending != NONE)
+	{
+		load(m, m->pending);
+		replay(m, m->pending);
+		m->pending = NONE;
+	}
+
+	size_t winner = m->tree[0];
+	const void *record = m->leaves[winner].record;
+
+	if(record != NULL)
+	{
+		m->pending = winner;
+		if(stream != NULL)
+		{
+			*stream = winner;
+		}
+	}
+
+	return record;
+}
+
+/** \fn void timespec_merge_split(const struct timespec_merge_input *inputs, size_t k, size_t record_size, size_t key_offset, struct timespec *bounds, size_t parts)
+ *  \brief Splits the keys of k sorted arrays into parts ranges of similar sizes.
+ *
+ * Sets bounds[0..parts-2] so that range p holds the records with keys in
+ * [bounds[p-1], bounds[p]), the first and last ranges being unbounded below
+ * and above. Records with equal keys always fall in the same range, so with
+ * many equal keys some ranges may be larger than others or empty.
+*/
+void timespec_merge_split(const struct timespec_merge_input *inputs, size_t k, size_t record_size, size_t key_offset,
+	struct timespec *bounds, size_t parts)
+{
+	timespec_ns first = TIMESPEC_NS_MAX, last = TIMESPEC_NS_MIN;
+	size_t total = 0;
+
+	for(size_t i = 0; i < k; ++i)
+	{
+		const char *records = inputs[i].records;
+
+		if(inputs[i].count > 0)
+		{
+			timespec_ns lo = timespec_ns_from_timespec(key_of(records, key_offset));
+			timespec_ns hi = timespec_ns_from_timespec(key_of(records + (inputs[i].count - 1) * record_size,
+				key_offset));
+
+			first = (lo < first) ? lo : first;
+			last = (hi > last) ? hi : last;
+			total += inputs[i].count;
+		}
+	}
+
+	for(size_t p = 1; p < parts; ++p)
+	{
+		/* total * p / parts without overflowing. */
+		size_t target = total / parts * p + total % parts * p / parts;
+		timespec_ns lo = first, hi = last;
+
+		if(total == 0)
+		{
+			bounds[p - 1] = timespec_ns_to_timespec(0);
+			continue;
+		}
+
+		/* Find the earliest time with at least target records before it. */
+		while(lo < hi)
+		{
+			timespec_ns mid = lo + (timespec_ns)(((uint64_t)(hi) - (uint64_t)(lo)) / 2);
+			struct timespec t = timespec_ns_to_timespec(mid);
+			size_t count = 0;
+
+			for(size_t i = 0; i < k; ++i)
+			{
+				count += lower_bound(&inputs[i], record_size, key_offset, t);
+			}
+
+			if(count >= target)
+			{
+				hi = mid;
+			}
+			else
+			{
+				lo = mid + 1;
+			}
+		}
+
+		bounds[p - 1] = timespec_ns_to_timespec(lo);
+	}
+}
+
+struct job
+{
+	pthread_t thread;
+	struct timespec_merge *merge;
+	char *out;
+	size_t record_size;
+};
+
+static void *run_job(void *arg)
+{
+	struct job *job = arg;
+	const void *record;
+
+	while((record = timespec_merge_next(job->merge, NULL)) != NULL)
+	{
+		memcpy(job->out, record, job->record_size);
+		job->out += job->record_size;
+	}
+
+	return NULL;
+}
+
+/** \fn bool timespec_merge_parallel(void *out, const struct timespec_merge_input *inputs, size_t k, size_t record_size, size_t key_offset, unsigned threads)
+ *  \brief Merges k sorted arrays into out using up to threads threads.
+ *
+ * out must hold the total number of records and not overlap the inputs. The
+ * keys are split into one time range per thread with timespec_merge_split(),
+ * and each range is merged directly into its place in out, giving the same
+ * result as a serial merge. Returns false and sets errno on failure.
+*/
+bool timespec_merge_parallel(void *out, const struct timespec_merge_input *inputs, size_t k, size_t record_size,
+	size_t key_offset, unsigned threads)
+{
+	size_t parts = (threads > 0) ? threads : 1;
+	struct timespec *bounds = malloc(parts * sizeof(*bounds));
+	struct job *jobs = calloc(parts, sizeof(*jobs));
+	bool ok = (bounds != NULL && jobs != NULL);
+
+	if(record_size < sizeof(struct timespec) || key_offset > record_size - sizeof(struct timespec))
+	{
+		errno = EINVAL;
+		ok = false;
+	}
+
+	if(ok)
+	{
+		timespec_merge_split(inputs, k, record_size, key_offset, bounds, parts);
+	}
+
+	/* Create every merge before starting any thread, so failure leaves out
+	 * untouched.
+	*/
+	for(size_t p = 0; ok && p < parts; ++p)
+	{
+		const struct timespec *from = (p > 0) ? &bounds[p - 1] : NULL;
+		const struct timespec *to = (p + 1 < parts) ? &bounds[p] : NULL;
+		size_t offset = 0;
+
+		for(size_t i = 0; from != NULL && i < k; ++i)
+		{
+			offset += lower_bound(&inputs[i], record_size, key_offset, *from);
+		}
+
+		jobs[p].merge = timespec_merge_create_arrays(inputs, k, record_size, key_offset, from, to);
+		jobs[p].out = (char*)(out) + offset * record_size;
+		jobs[p].record_size = record_size;
+		ok = (jobs[p].merge != NULL);
+	}
+
+	if(ok)
+	{
+		bool *started = calloc(parts, sizeof(*started));
+
+		/* If a thread cannot be started its range is merged here instead. */
+		for(size_t p = 1; started != NULL && p < parts; ++p)
+		{
+			started[p] = (pthread_create(&jobs[p].thread, NULL, run_job, &jobs[p]) == 0);
+		}
+
+		for(size_t p = 0; p < parts; ++p)
+		{
+			if(started == NULL || !started[p])
+			{
+				run_job(&jobs[p]);
+			}
+		}
+
+		for(size_t p = 1; p < parts; ++p)
+		{
+			if(started != NULL && started[p])
+			{
+				pthread_join(jobs[p].thread, NULL);
+			}
+		}
+
+		free(started);
+	}
+
+	for(size_t p = 0; jobs != NULL && p < parts; ++p)
+	{
+		timespec_merge_destroy(jobs[p].merge);
+	}
+
+	free(jobs);
+	free(bounds);
+
+	return ok;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file timespec_rate_limiter.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Lock-free token bucket using the generic cell rate algorithm (GCRA).
+ *
+ * Rather than a token count and a refill time, which would need updating
+ * together, the whole bucket is described by one value: the theoretical
+ * arrival time (TAT) at which the bucket would next be empty if one token were
+ * taken every interval. A request for n tokens at time now is allowed if
+ *
+ *     max(TAT, now) + n * interval - now <= burst * interval
+ *
+ * and then moves TAT forward by n * interval. Since TAT is a single 64-bit
+ * timespec_ns, acquiring is one atomic load, the comparison above and one
+ * compare-and-swap, retried only if another thread won the race. Rejected
+ * requests never write, so a flooded limiter does not bounce its cache line
+ * between cores.
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_rate_limiter.h"
+
+/* Returns the TAT after taking n tokens at now, or false if they are not
+ * available yet.
+*/
+static inline bool take(const struct timespec_rate_limiter *rl, timespec_ns tat, timespec_ns now, uint32_t n,
+	timespec_ns *next)
+{
+	timespec_ns cost;
+
+	if(__builtin_mul_overflow(rl->interval, (timespec_ns)(n), &cost) || cost > rl->capacity)
+	{
+		return false;
+	}
+
+	if(tat < now)
+	{
+		tat = now;
+	}
+
+	*next = timespec_ns_add(tat, cost);
+	return timespec_ns_sub(*next, now) <= rl->capacity;
+}
+
+/** \fn bool timespec_rate_limiter_init(struct timespec_rate_limiter *rl, struct timespec interval, uint32_t burst, struct timespec now)
+ *  \brief Initialises a rate limiter allowing one token every interval.
+ *
+ * Up to burst tokens accumulate while the limiter is idle, and the bucket
+ * starts full at now. For a rate of N tokens per period, pass
+ * timespec_div(period, N) as the interval. now may come from any clock, but
+ * every later call must use the same one; CLOCK_MONOTONIC is usual.
+ *
+ * Returns false and sets errno to EINVAL if interval is not positive or burst
+ * is zero.
+*/
+bool timespec_rate_limiter_init(struct timespec_rate_limiter *rl, struct timespec interval, uint32_t burst,
+	struct timespec now)
+{
+	timespec_ns interval_ns = timespec_ns_from_timespec(interval);
+
+	if(interval_ns <= 0 || burst == 0)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	rl->interval = interval_ns;
+	if(__builtin_mul_overflow(interval_ns, (timespec_ns)(burst), &rl->capacity))
+	{
+		rl->capacity = TIMESPEC_NS_MAX;
+	}
+
+	__atomic_store_n(&rl->tat, timespec_ns_from_timespec(now), __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/** \fn bool timespec_rate_limiter_try_acquire_ns(struct timespec_rate_limiter *rl, timespec_ns now, uint32_t n)
+ *  \brief Takes n tokens if they are available at now. Returns false if not.
+ *
+ * Safe to call from any number of threads at once. Never blocks: a request
+ * which cannot be met returns false immediately without taking any tokens.
+*/
+bool timespec_rate_limiter_try_acquire_ns(struct timespec_rate_limiter *rl, timespec_ns now, uint32_t n)
+{
+	timespec_ns tat = __atomic_load_n(&rl->tat, __ATOMIC_RELAXED);
+	timespec_ns next;
+
+	do {
+		if(!take(rl, tat, now, n, &next))
+		{
+			return false;
+		}
+	} while(!__atomic_compare_exchange_n(&rl->tat, &tat, next, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	return true;
+}
+
+/** \fn bool timespec_rate_limiter_try_acquire(struct timespec_rate_limiter *rl, struct timespec now, uint32_t n)
+ *  \brief Takes n tokens if they are available at now. Returns false if not.
+ *
+ * See timespec_rate_limiter_try_acquire_ns().
+*/
+bool timespec_rate_limiter_try_acquire(struct timespec_rate_limiter *rl, struct timespec now, uint32_t n)
+{
+	return timespec_rate_limiter_try_acquire_ns(rl, timespec_ns_from_timespec(now), n);
+}
+
+/** \fn struct timespec timespec_rate_limiter_wait(const struct timespec_rate_limiter *rl, struct timespec now, uint32_t n)
+ *  \brief Returns how long from now until n tokens will be available.
+ *
+ * Returns zero if they are available already. Other threads may take tokens
+ * in the meantime, so this is a lower bound. Requests larger than the burst
+ * can never succeed and return the largest representable time.
+*/
+struct timespec timespec_rate_limiter_wait(const struct timespec_rate_limiter *rl, struct timespec now, uint32_t n)
+{
+	timespec_ns now_ns = timespec_ns_from_timespec(now);
+	timespec_ns tat = __atomic_load_n(&rl->tat, __ATOMIC_RELAXED);
+	timespec_ns cost;
+
+	if(__builtin_mul_overflow(rl->interval, (timespec_ns)(n), &cost) || cost > rl->capacity)
+	{
+		return timespec_ns_to_timespec(TIMESPEC_NS_MAX);
+	}
+
+	/* Allowed once max(tat, t) + cost - t <= capacity, i.e. t >= tat + cost - capacity. */
+	timespec_ns wait = timespec_ns_sub(timespec_ns_add(tat, cost - rl->capacity), now_ns);
+
+	return timespec_ns_to_timespec(wait > 0 ? wait : 0);
+}
+
+/** \fn uint32_t timespec_rate_limiter_available(const struct timespec_rate_limiter *rl, struct timespec now)
+ *  \brief Returns the number of tokens which could be taken at now.
+*/
+uint32_t timespec_rate_limiter_available(const struct timespec_rate_limiter *rl, struct timespec now)
+{
+	timespec_ns now_ns = timespec_ns_from_timespec(now);
+	timespec_ns tat = __atomic_load_n(&rl->tat, __ATOMIC_RELAXED);
+	timespec_ns used = (tat > now_ns) ? timespec_ns_sub(tat, now_ns) : 0;
+
+	if(used >= rl->capacity)
+	{
+		return 0;
+	}
+
+	return (uint32_t)((rl->capacity - used) / rl->interval);
+}
@@ -0,0 +1,197 @@
+/**
+ * @file timespec_sleep.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Precise sleeping to absolute deadlines.
+ *
+ * clock_nanosleep() typically wakes tens of microseconds after the deadline,
+ * depending on timer slack, interrupt latency and scheduling. To wake closer
+ * to the deadline the wait is split in two: the thread sleeps in the kernel
+ * until a configurable slack before the deadline, then spins reading the
+ * clock, with a pause instruction between reads to spare the sibling
+ * hyperthread and the memory bus, until the deadline passes. The slack trades
+ * CPU time for precision; timespec_sleep_calibrate() sets it from the wake-up
+ * latency measured on the running system.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_clock.h"
+#include "timespec_histogram.h"
+#include "timespec_sleep.h"
+
+#define DEFAULT_SLACK_NS 50000
+
+static timespec_ns slack_ns = DEFAULT_SLACK_NS;
+
+static inline void cpu_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+	__asm__ __volatile__("yield" ::: "memory");
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/** \fn int timespec_sleep_until(clockid_t clock, struct timespec deadline)
+ *  \brief Sleeps until clock reaches deadline, waking as close to it as possible.
+ *
+ * Sleeps with clock_nanosleep(TIMER_ABSTIME) until the slack before deadline,
+ * then spins for the rest. Signals do not cut the wait short. Returns
+ * immediately if deadline has passed.
+ *
+ * Returns 0, or an error number from clock_nanosleep() (such as EINVAL for a
+ * clock which cannot be slept on) without having waited.
+*/
+int timespec_sleep_until(clockid_t clock, struct timespec deadline)
+{
+	struct timespec wake = timespec_sub(deadline,
+		timespec_ns_to_timespec(__atomic_load_n(&slack_ns, __ATOMIC_RELAXED)));
+	int err;
+
+	while((err = clock_nanosleep(clock, TIMER_ABSTIME, &wake, NULL)) == EINTR)
+	{
+	}
+
+	if(err != 0)
+	{
+		return err;
+	}
+
+	while(timespec_lt(timespec_now(clock), deadline))
+	{
+		cpu_relax();
+	}
+
+	return 0;
+}
+
+/** \fn struct timespec timespec_sleep_get_slack(void)
+ *  \brief Returns how long before a deadline timespec_sleep_until() starts spinning.
+*/
+struct timespec timespec_sleep_get_slack(void)
+{
+	return timespec_ns_to_timespec(__atomic_load_n(&slack_ns, __ATOMIC_RELAXED));
+}
+
+/** \fn void timespec_sleep_set_slack(struct timespec slack)
+ *  \brief Sets how long before a deadline timespec_sleep_until() starts spinning.
+ *
+ * The default is 50us. Zero disables spinning, leaving precision to the
+ * kernel; negative values are taken as zero. Applies to every thread.
+*/
+void timespec_sleep_set_slack(struct timespec slack)
+{
+	timespec_ns ns = timespec_ns_from_timespec(slack);
+
+	__atomic_store_n(&slack_ns, (ns > 0) ? ns : 0, __ATOMIC_RELAXED);
+}
+
+/** \fn struct timespec timespec_sleep_calibrate(clockid_t clock, unsigned samples)
+ *  \brief Measures clock_nanosleep() wake-up latency and sets the slack to cover it.
+ *
+ * Sleeps samples times (for about 1ms each) and sets the slack to the 99th
+ * percentile of how late clock_nanosleep() woke, plus a quarter for margin.
+ * Run it on the thread and CPU which will sleep, under representative load.
+ * Returns the new slack, or sets errno and returns a zero timespec without
+ * changing the slack if clock cannot be slept on or memory is short.
+*/
+struct timespec timespec_sleep_calibrate(clockid_t clock, unsigned samples)
+{
+	struct timespec zero = { .tv_sec = 0, .tv_nsec = 0 };
+	struct timespec_histogram *h = malloc(sizeof(*h));
+
+	if(h == NULL)
+	{
+		return zero;
+	}
+
+	timespec_histogram_init(h);
+
+	for(unsigned i = 0; i < samples; ++i)
+	{
+		struct timespec deadline = timespec_add(timespec_now(clock), timespec_from_ms(1));
+		int err;
+
+		while((err = clock_nanosleep(clock, TIMER_ABSTIME, &deadline, NULL)) == EINTR)
+		{
+		}
+
+		if(err != 0)
+		{
+			free(h);
+			errno = err;
+			return zero;
+		}
+
+		timespec_histogram_record(h, timespec_sub(timespec_now(clock), deadline));
+	}
+
+	struct timespec p99 = timespec_histogram_percentile(h, 99);
+	free(h);
+
+	timespec_sleep_set_slack(timespec_add(p99, timespec_div(p99, 4)));
+
+	return timespec_sleep_get_slack();
+}
+
+/** \fn int timespec_periodic_init(struct timespec_periodic *p, clockid_t clock, struct timespec period)
+ *  \brief Starts a periodic loop on clock, with the first deadline one period from now.
+ *
+ * Returns 0, or EINVAL if period is not positive or clock cannot be read.
+*/
+int timespec_periodic_init(struct timespec_periodic *p, clockid_t clock, struct timespec period)
+{
+	struct timespec now;
+
+	period = timespec_normalise(period);
+	if(period.tv_sec < 0 || (period.tv_sec == 0 && period.tv_nsec <= 0) || clock_gettime(clock, &now) != 0)
+	{
+		return EINVAL;
+	}
+
+	p->clock = clock;
+	p->period = period;
+	p->next = timespec_add_normalised(now, period);
+	p->overruns = 0;
+
+	return 0;
+}
+
+/** \fn uint64_t timespec_periodic_wait(struct timespec_periodic *p)
+ *  \brief Sleeps until the next deadline of a periodic loop and schedules the one after.
+ *
+ * Deadlines are absolute multiples of the period from the start, so time
+ * spent in the loop body does not accumulate as drift. Deadlines already
+ * passed when this is called are skipped rather than run back to back; a
+ * call exactly at the deadline is on time. Returns how many were skipped,
+ * which is also added to p->overruns.
+*/
+uint64_t timespec_periodic_wait(struct timespec_periodic *p)
+{
+	struct timespec now = timespec_now(p->clock);
+	uint64_t missed = 0;
+
+	if(timespec_gt(now, p->next))
+	{
+		/* Skip straight to the first deadline at or after now. */
+		struct timespec late = timespec_sub_normalised(now, p->next);
+
+		missed = (uint64_t)((timespec_ns_from_timespec(late) - 1) / timespec_ns_from_timespec(p->period)) + 1;
+		p->next = timespec_add_normalised(p->next, timespec_mul(p->period, (int64_t)(missed)));
+		p->overruns += missed;
+	}
+
+	timespec_sleep_until(p->clock, p->next);
+	p->next = timespec_add_normalised(p->next, p->period);
+
+	return missed;
+}
@@ -0,0 +1,627 @@
+/**
+ * @file timespec_sort.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Radix sorting of timespec arrays and timespec-keyed records.
+ *
+ * Each value is mapped to an unsigned key which orders the same way, as in
+ * timespec_key.h. That fits in 64 bits for any input spanning less than about
+ * 584 years, and the key is then sorted by LSD radix in passes of 11 bits,
+ * only as many as the range needs, skipping any pass in which every key has
+ * the same digit. A wider input is sorted as a 95 bit key instead: by tv_nsec first, then
+ * stably by seconds since the earliest.
+ *
+ * Timespec arrays are sorted as bare keys and rebuilt from them. Records are
+ * sorted as keys paired with their original positions, which are used to
+ * gather the records in order at the end, so each record is moved once
+ * however many passes are made. Ties keep their original order.
+ *
+ * Input already in order is detected by the first scan and left untouched.
+ * Input with few descents, such as capture data with a little jitter, is
+ * split into the greedy non-decreasing subsequence, which stays in place,
+ * and the rest, which is radix sorted on its own and merged back in.
+ *
+ * The parallel sort radix sorts one slice per thread and merges the sorted
+ * slices with timespec_merge_parallel().
+ *
+ * Values must be normalised, as returned by clock_gettime() and this library.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The comparisons are in the scanning loops, so have timespec_lt() inlined here. */
+#define TIMESPEC_INLINE
+#include "timespec.h"
+#include "timespec_key.h"
+#include "timespec_merge.h"
+#include "timespec_sort.h"
+
+#define DIGIT_BITS 11
+#define DIGITS     (1 << DIGIT_BITS)
+#define MAX_PASSES ((64 + DIGIT_BITS - 1) / DIGIT_BITS)
+
+/* Inputs with at most one descent in this many elements take the nearly sorted path. */
+#define NEARLY_SORTED 16
+
+/* Fewest elements worth sorting on a thread of their own. */
+#define MIN_PER_THREAD (1 << 16)
+
+struct source
+{
+	char *base;
+	size_t n;
+	size_t record_size;
+	size_t key_offset;
+};
+
+struct work
+{
+	void *block;
+	size_t *counts;
+	uint64_t *keys;
+	uint64_t *keys_tmp;
+
+	/* Original positions, or NULL when sorting bare keys. */
+	uint64_t *index;
+	uint64_t *index_tmp;
+
+	/* Records gathered into order. */
+	char *records;
+};
+
+struct job
+{
+	pthread_t thread;
+	struct source source;
+	bool plain;
+	bool ok;
+	int error;
+};
+
+static inline struct timespec key_at(const struct source *s, size_t i)
+{
+	struct timespec ts;
+
+	memcpy(&ts, s->base + i * s->record_size + s->key_offset, sizeof(ts));
+
+	return ts;
+}
+
+static inline uint64_t digit(uint64_t key, unsigned shift)
+{
+	return (key >> shift) & (DIGITS - 1);
+}
+
+static bool valid_layout(size_t record_size, size_t key_offset)
+{
+	if(record_size < sizeof(struct timespec) || key_offset > record_size - sizeof(struct timespec))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	return true;
+}
+
+static bool work_alloc(struct work *w, const struct source *s, bool indexed)
+{
+	size_t arrays = indexed ? 4 : 2;
+	size_t records = indexed ? s->record_size : 0;
+
+	if(s->n > (SIZE_MAX - MAX_PASSES * DIGITS * sizeof(size_t)) / (arrays * sizeof(uint64_t) + records))
+	{
+		errno = ENOMEM;
+		return false;
+	}
+
+	w->block = malloc(MAX_PASSES * DIGITS * sizeof(size_t) + s->n * (arrays * sizeof(uint64_t) + records));
+	if(w->block == NULL)
+	{
+		return false;
+	}
+
+	w->counts = w->block;
+	w->keys = (uint64_t*)(w->counts + MAX_PASSES * DIGITS);
+	w->keys_tmp = w->keys + s->n;
+	w->index = indexed ? w->keys_tmp + s->n : NULL;
+	w->index_tmp = indexed ? w->index + s->n : NULL;
+	w->records = indexed ? (char*)(w->keys + arrays * s->n) : NULL;
+
+	return true;
+}
+
+/* LSD radix sort of n keys no greater than max, moving the index alongside
+ * unless it is NULL. Each pass scatters into the scratch arrays and the
+ * pointers are swapped, so the result is always left in *keys and *index.
+*/
+static void radix(uint64_t **keys, uint64_t **index, uint64_t **keys_tmp, uint64_t **index_tmp, size_t n, uint64_t max,
+	size_t *counts)
+{
+	unsigned bits = (max == 0) ? 0 : 64 - (unsigned)(__builtin_clzll(max));
+	unsigned passes = (bits + DIGIT_BITS - 1) / DIGIT_BITS;
+
+	if(n < 2)
+	{
+		return;
+	}
+
+	/* Count every pass's digits in one read of the keys. */
+	memset(counts, 0, passes * DIGITS * sizeof(*counts));
+	for(size_t i = 0; i < n; ++i)
+	{
+		uint64_t key = (*keys)[i];
+
+		for(unsigned p = 0; p < passes; ++p)
+		{
+			++(counts[p * DIGITS + digit(key, p * DIGIT_BITS)]);
+		}
+	}
+
+	for(unsigned p = 0; p < passes; ++p)
+	{
+		size_t *offsets = counts + p * DIGITS;
+		unsigned shift = p * DIGIT_BITS;
+		const uint64_t *in = *keys;
+		uint64_t *out = *keys_tmp;
+		size_t sum = 0;
+
+		if(offsets[digit(in[0], shift)] == n)
+		{
+			continue;
+		}
+
+		for(size_t d = 0; d < DIGITS; ++d)
+		{
+			size_t count = offsets[d];
+
+			offsets[d] = sum;
+			sum += count;
+		}
+
+		if(*index == NULL)
+		{
+			for(size_t i = 0; i < n; ++i)
+			{
+				out[offsets[digit(in[i], shift)]++] = in[i];
+			}
+		}
+		else
+		{
+			const uint64_t *in_index = *index;
+			uint64_t *out_index = *index_tmp;
+
+			for(size_t i = 0; i < n; ++i)
+			{
+				size_t to = offsets[digit(in[i], shift)]++;
+
+				out[to] = in[i];
+				out_index[to] = in_index[i];
+			}
+
+			*index = out_index;
+			*index_tmp = (uint64_t*)(in_index);
+		}
+
+		*keys = out;
+		*keys_tmp = (uint64_t*)(in);
+	}
+}
+
+/* Sorts nearly sorted keys by keeping the greedy non-decreasing subsequence
+ * in place and radix sorting the rest, then merging the two from the end so
+ * no kept key is overwritten before it is read.
+*/
+static void sort_nearly_sorted(struct work *w, size_t n)
+{
+	uint64_t *keys = w->keys, *index = w->index;
+	uint64_t *rest = w->keys_tmp, *rest_index = w->index_tmp;
+	uint64_t rest_max = 0;
+	size_t kept = 0, m = 0;
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		if(kept == 0 || keys[i] >= keys[kept - 1])
+		{
+			keys[kept] = keys[i];
+			if(index != NULL)
+			{
+				index[kept] = index[i];
+			}
+			++kept;
+		}
+		else
+		{
+			rest[m] = keys[i];
+			if(index != NULL)
+			{
+				rest_index[m] = index[i];
+			}
+			rest_max = (keys[i] > rest_max) ? keys[i] : rest_max;
+			++m;
+		}
+	}
+
+	/* The space after the kept keys is exactly big enough for scratch. */
+	uint64_t *sorted = rest, *sorted_index = rest_index;
+	uint64_t *scratch = keys + kept, *scratch_index = (index != NULL) ? index + kept : NULL;
+
+	radix(&sorted, &sorted_index, &scratch, &scratch_index, m, rest_max, w->counts);
+	if(sorted != rest)
+	{
+		memcpy(rest, sorted, m * sizeof(*rest));
+		if(index != NULL)
+		{
+			memcpy(rest_index, sorted_index, m * sizeof(*rest_index));
+		}
+	}
+
+	/* A key only goes to the rest when it is below one already kept, so it
+	 * follows every kept key equal to it, and taking the rest first on ties
+	 * keeps the sort stable.
+	*/
+	for(size_t i = kept, j = m, to = n; j > 0; )
+	{
+		--to;
+		if(i > 0 && keys[i - 1] > rest[j - 1])
+		{
+			--i;
+			keys[to] = keys[i];
+			if(index != NULL)
+			{
+				index[to] = index[i];
+			}
+		}
+		else
+		{
+			--j;
+			keys[to] = rest[j];
+			if(index != NULL)
+			{
+				index[to] = rest_index[j];
+			}
+		}
+	}
+}
+
+/* Sorts s on the calling thread. Plain sources are timespec arrays, which
+ * are rebuilt from their keys rather than gathered.
+*/
+static bool sort_source(const struct source *s, bool plain)
+{
+	struct timespec prev;
+	time_t min_sec, max_sec;
+	size_t descents = 0;
+	struct work w;
+
+	if(s->n < 2)
+	{
+		return true;
+	}
+
+	prev = key_at(s, 0);
+	min_sec = max_sec = prev.tv_sec;
+
+	for(size_t i = 1; i < s->n; ++i)
+	{
+		struct timespec ts = key_at(s, i);
+
+		descents += timespec_lt(ts, prev);
+		min_sec = (ts.tv_sec < min_sec) ? ts.tv_sec : min_sec;
+		max_sec = (ts.tv_sec > max_sec) ? ts.tv_sec : max_sec;
+		prev = ts;
+	}
+
+	if(descents == 0)
+	{
+		return true;
+	}
+
+	uint64_t range = (uint64_t)(max_sec) - (uint64_t)(min_sec);
+	bool wide = range > RANGE_64;
+
+	if(!work_alloc(&w, s, !plain || wide))
+	{
+		return false;
+	}
+
+	if(!wide)
+	{
+		uint64_t max = 0;
+
+		for(size_t i = 0; i < s->n; ++i)
+		{
+			struct timespec ts = key_at(s, i);
+			uint64_t key = timespec_key(ts, min_sec);
+
+			w.keys[i] = key;
+			max = (key > max) ? key : max;
+		}
+
+		for(size_t i = 0; w.index != NULL && i < s->n; ++i)
+		{
+			w.index[i] = i;
+		}
+
+		if(descents <= s->n / NEARLY_SORTED)
+		{
+			sort_nearly_sorted(&w, s->n);
+		}
+		else
+		{
+			radix(&w.keys, &w.index, &w.keys_tmp, &w.index_tmp, s->n, max, w.counts);
+		}
+	}
+	else
+	{
+		/* Within a second tv_nsec orders as a signed number. */
+		for(size_t i = 0; i < s->n; ++i)
+		{
+			w.keys[i] = (uint64_t)(key_at(s, i).tv_nsec) + (NSEC_PER_SEC - 1);
+			w.index[i] = i;
+		}
+
+		radix(&w.keys, &w.index, &w.keys_tmp, &w.index_tmp, s->n, 2 * NSEC_PER_SEC - 2, w.counts);
+
+		for(size_t i = 0; i < s->n; ++i)
+		{
+			w.keys[i] = (uint64_t)(key_at(s, (size_t)(w.index[i])).tv_sec) - (uint64_t)(min_sec);
+		}
+
+		radix(&w.keys, &w.index, &w.keys_tmp, &w.index_tmp, s->n, range, w.counts);
+	}
+
+	if(w.index == NULL)
+	{
+		struct timespec *a = (struct timespec*)(s->base);
+
+		for(size_t i = 0; i < s->n; ++i)
+		{
+			a[i] = timespec_from_key(w.keys[i], min_sec);
+		}
+	}
+	else
+	{
+		for(size_t i = 0; i < s->n; ++i)
+		{
+			memcpy(w.records + i * s->record_size, s->base + w.index[i] * s->record_size, s->record_size);
+		}
+
+		memcpy(s->base, w.records, s->n * s->record_size);
+	}
+
+	free(w.block);
+
+	return true;
+}
+
+static size_t sorted_until(const struct source *s)
+{
+	for(size_t i = 1; i < s->n; ++i)
+	{
+		if(timespec_lt(key_at(s, i), key_at(s, i - 1)))
+		{
+			return i;
+		}
+	}
+
+	return s->n;
+}
+
+static size_t descents(const struct source *s)
+{
+	size_t count = 0;
+
+	for(size_t i = 1; i < s->n; ++i)
+	{
+		count += timespec_lt(key_at(s, i), key_at(s, i - 1));
+	}
+
+	return count;
+}
+
+static void *run_job(void *arg)
+{
+	struct job *job = arg;
+
+	job->ok = sort_source(&job->source, job->plain);
+	job->error = job->ok ? 0 : errno;
+
+	return NULL;
+}
+
+static bool sort_parallel(const struct source *s, bool plain, unsigned threads)
+{
+	size_t parts = (threads > 0) ? threads : 1;
+
+	if(parts > s->n / MIN_PER_THREAD)
+	{
+		parts = s->n / MIN_PER_THREAD;
+	}
+
+	if(parts <= 1)
+	{
+		return sort_source(s, plain);
+	}
+	else if(sorted_until(s) == s->n)
+	{
+		return true;
+	}
+
+	void *out = (s->n <= SIZE_MAX / s->record_size) ? malloc(s->n * s->record_size) : NULL;
+	struct timespec_merge_input *inputs = malloc(parts * sizeof(*inputs));
+	struct job *jobs = calloc(parts, sizeof(*jobs));
+	bool *started = calloc(parts, sizeof(*started));
+	bool ok = (out != NULL && inputs != NULL && jobs != NULL && started != NULL);
+
+	for(size_t p = 0; ok && p < parts; ++p)
+	{
+		size_t from = s->n / parts * p, to = (p + 1 < parts) ? s->n / parts * (p + 1) : s->n;
+
+		jobs[p].source = *s;
+		jobs[p].source.base = s->base + from * s->record_size;
+		jobs[p].source.n = to - from;
+		jobs[p].plain = plain;
+
+		inputs[p].records = jobs[p].source.base;
+		inputs[p].count = to - from;
+	}
+
+	if(ok)
+	{
+		/* If a thread cannot be started its slice is sorted here instead. */
+		for(size_t p = 1; p < parts; ++p)
+		{
+			started[p] = (pthread_create(&jobs[p].thread, NULL, run_job, &jobs[p]) == 0);
+		}
+
+		for(size_t p = 0; p < parts; ++p)
+		{
+			if(!started[p])
+			{
+				run_job(&jobs[p]);
+			}
+		}
+
+		for(size_t p = 1; p < parts; ++p)
+		{
+			if(started[p])
+			{
+				pthread_join(jobs[p].thread, NULL);
+			}
+		}
+
+		for(size_t p = 0; p < parts; ++p)
+		{
+			if(ok && !jobs[p].ok)
+			{
+				errno = jobs[p].error;
+				ok = false;
+			}
+		}
+	}
+	else
+	{
+		errno = ENOMEM;
+	}
+
+	if(ok && timespec_merge_parallel(out, inputs, parts, s->record_size, s->key_offset, (unsigned)(parts)))
+	{
+		memcpy(s->base, out, s->n * s->record_size);
+	}
+	else
+	{
+		ok = false;
+	}
+
+	free(started);
+	free(jobs);
+	free(inputs);
+	free(out);
+
+	return ok;
+}
+
+/** \fn bool timespec_sort(struct timespec *a, size_t n)
+ *  \brief Sorts an array of n timespecs into ascending order.
+ *
+ * Runs in time linear in n, and in one pass over input which is already
+ * sorted. Needs 16 bytes of scratch memory per element. Returns false and
+ * sets errno if that cannot be allocated, leaving the array unchanged.
+*/
+bool timespec_sort(struct timespec *a, size_t n)
+{
+	struct source s = { (char*)(a), n, sizeof(*a), 0 };
+
+	return sort_source(&s, true);
+}
+
+/** \fn bool timespec_sort_parallel(struct timespec *a, size_t n, unsigned threads)
+ *  \brief Sorts an array of n timespecs using up to threads threads.
+ *
+ * Each thread sorts a slice of at least 65536 elements, and the slices are
+ * merged in parallel. Needs a copy of the array in addition to the scratch
+ * memory of timespec_sort(). Returns false and sets errno on failure, when
+ * the array holds the same values in an unspecified order.
+*/
+bool timespec_sort_parallel(struct timespec *a, size_t n, unsigned threads)
+{
+	struct source s = { (char*)(a), n, sizeof(*a), 0 };
+
+	return sort_parallel(&s, true, threads);
+}
+
+/** \fn bool timespec_sort_records(void *records, size_t n, size_t record_size, size_t key_offset)
+ *  \brief Sorts n records by the timespec at key_offset in each.
+ *
+ * The sort is stable, and the key may be unaligned. Needs 32 bytes of scratch
+ * memory per record plus a copy of the records. Returns false and sets errno
+ * on failure, leaving the records unchanged.
+*/
+bool timespec_sort_records(void *records, size_t n, size_t record_size, size_t key_offset)
+{
+	struct source s = { records, n, record_size, key_offset };
+
+	return valid_layout(record_size, key_offset) && sort_source(&s, false);
+}
+
+/** \fn bool timespec_sort_records_parallel(void *records, size_t n, size_t record_size, size_t key_offset, unsigned threads)
+ *  \brief Stably sorts n records by their timespec keys using up to threads threads.
+*/
+bool timespec_sort_records_parallel(void *records, size_t n, size_t record_size, size_t key_offset, unsigned threads)
+{
+	struct source s = { records, n, record_size, key_offset };
+
+	return valid_layout(record_size, key_offset) && sort_parallel(&s, false, threads);
+}
+
+/** \fn size_t timespec_sorted_until(const struct timespec *a, size_t n)
+ *  \brief Returns the length of the longest sorted prefix of a, which is n if it is all sorted.
+*/
+size_t timespec_sorted_until(const struct timespec *a, size_t n)
+{
+	struct source s = { (char*)(a), n, sizeof(*a), 0 };
+
+	return sorted_until(&s);
+}
+
+/** \fn size_t timespec_records_sorted_until(const void *records, size_t n, size_t record_size, size_t key_offset)
+ *  \brief Returns the length of the longest prefix of records sorted by their timespec keys.
+*/
+size_t timespec_records_sorted_until(const void *records, size_t n, size_t record_size, size_t key_offset)
+{
+	struct source s = { (char*)(records), n, record_size, key_offset };
+
+	return sorted_until(&s);
+}
+
+/** \fn size_t timespec_descents(const struct timespec *a, size_t n)
+ *  \brief Returns the number of elements less than the one before them.
+ *
+ * Zero means the array is sorted; one more than the count is the number of
+ * ascending runs, a measure of how far from sorted it is.
+*/
+size_t timespec_descents(const struct timespec *a, size_t n)
+{
+	struct source s = { (char*)(a), n, sizeof(*a), 0 };
+
+	return descents(&s);
+}
+
+/** \fn size_t timespec_records_descents(const void *records, size_t n, size_t record_size, size_t key_offset)
+ *  \brief Returns the number of records whose key is less than the one before.
+*/
+size_t timespec_records_descents(const void *records, size_t n, size_t record_size, size_t key_offset)
+{
+	struct source s = { (char*)(records), n, record_size, key_offset };
+
+	return descents(&s);
+}
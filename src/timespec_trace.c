@@ -0,0 +1,563 @@
+/**
+ * @file timespec_trace.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Span tracing into per-thread ring buffers.
+ *
+ * Each thread which records into a trace gets its own power-of-two ring of
+ * fixed-size events the first time it does so, and finds it again through a
+ * thread-local cache, so recording takes no lock and allocates nothing. The
+ * ring has one producer, its thread, and one consumer, whichever thread is
+ * draining: the producer fills a slot and publishes it by advancing head
+ * with a release store, the consumer frees slots by advancing tail, and each
+ * loads the other's index with acquire ordering. The producer only reloads
+ * tail when its cached copy says the ring is full.
+ *
+ * A full ring drops new events rather than overwriting old ones. So that a
+ * recorded begin is never left without its end, a begin is only recorded if
+ * there is room for its end and the end of every span still open, and ends
+ * always have room. Which nesting levels were recorded is kept in a bit mask,
+ * so the end of a dropped span is dropped too.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "timespec.h"
+#include "timespec_clock.h"
+#include "timespec_trace.h"
+
+#define MAX_EVENTS (UINT32_C(1) << 30)
+
+/* Nesting levels tracked in the recorded mask; deeper spans are dropped. */
+#define MAX_DEPTH 64
+
+struct entry
+{
+	timespec_ns time;
+	const char *name;
+	char phase;
+};
+
+struct buffer
+{
+	/* Written only by the owning thread. */
+	uint64_t head;
+	uint64_t tail_cache;
+	uint64_t recorded;
+	uint32_t depth;
+	uint32_t open;
+	uint64_t dropped;
+
+	/* Written only by the collector. */
+	uint64_t tail __attribute__((aligned(64)));
+
+	/* Set when the buffer is registered, and the name under the lock. */
+	pthread_t owner;
+	uint32_t thread;
+	const char *name;
+
+	struct entry entries[];
+};
+
+struct timespec_trace
+{
+	uint64_t id;
+	clockid_t clock;
+	uint32_t mask;
+
+	/* Guards the list of buffers, and serialises draining. */
+	pthread_mutex_t lock;
+	struct buffer **buffers;
+	uint32_t count;
+	uint32_t allocated;
+};
+
+/* Traces are told apart by id rather than address, which may be reused. */
+static uint64_t next_id = 1;
+
+static __thread struct {
+	uint64_t id;
+	struct buffer *buffer;
+} cache;
+
+/* Finds or creates the calling thread's buffer with the lock held. */
+static struct buffer *register_thread(struct timespec_trace *t)
+{
+	pthread_t self = pthread_self();
+	struct buffer *b;
+	void *mem;
+
+	for(uint32_t i = 0; i < t->count; ++i)
+	{
+		if(pthread_equal(t->buffers[i]->owner, self))
+		{
+			return t->buffers[i];
+		}
+	}
+
+	if(t->count == t->allocated)
+	{
+		uint32_t allocated = t->allocated ? t->allocated * 2 : 8;
+		struct buffer **buffers = realloc(t->buffers, allocated * sizeof(*buffers));
+
+		if(buffers == NULL)
+		{
+			return NULL;
+		}
+
+		t->buffers = buffers;
+		t->allocated = allocated;
+	}
+
+	if(posix_memalign(&mem, 64, sizeof(*b) + (t->mask + 1) * sizeof(struct entry)) != 0)
+	{
+		return NULL;
+	}
+	b = mem;
+
+	b->head = 0;
+	b->tail_cache = 0;
+	b->recorded = 0;
+	b->depth = 0;
+	b->open = 0;
+	b->dropped = 0;
+	b->tail = 0;
+	b->owner = self;
+	b->thread = t->count + 1;
+	b->name = NULL;
+
+	t->buffers[t->count++] = b;
+
+	return b;
+}
+
+static struct buffer *buffer_of(struct timespec_trace *t)
+{
+	struct buffer *b;
+
+	if(cache.id == t->id)
+	{
+		return cache.buffer;
+	}
+
+	pthread_mutex_lock(&t->lock);
+	b = register_thread(t);
+	pthread_mutex_unlock(&t->lock);
+
+	if(b != NULL)
+	{
+		cache.id = t->id;
+		cache.buffer = b;
+	}
+
+	return b;
+}
+
+/* Whether n more events fit, along with the ends of the spans still open. */
+static bool has_room(const struct timespec_trace *t, struct buffer *b, uint32_t n)
+{
+	uint64_t need = b->head - b->tail_cache + b->open + n;
+
+	if(need <= (uint64_t)(t->mask) + 1)
+	{
+		return true;
+	}
+
+	b->tail_cache = __atomic_load_n(&b->tail, __ATOMIC_ACQUIRE);
+
+	return b->head - b->tail_cache + b->open + n <= (uint64_t)(t->mask) + 1;
+}
+
+static void put(const struct timespec_trace *t, struct buffer *b, const char *name, char phase)
+{
+	struct entry *e = &b->entries[b->head & t->mask];
+
+	e->time = timespec_ns_from_timespec(timespec_now(t->clock));
+	e->name = name;
+	e->phase = phase;
+
+	__atomic_store_n(&b->head, b->head + 1, __ATOMIC_RELEASE);
+}
+
+static void drop(struct buffer *b)
+{
+	__atomic_store_n(&b->dropped, b->dropped + 1, __ATOMIC_RELAXED);
+}
+
+/** \fn struct timespec_trace *timespec_trace_create(clockid_t clock, uint32_t events_per_thread)
+ *  \brief Creates a trace with no events.
+ *
+ * Events are timestamped with clock, and each thread which records gets a
+ * ring of events_per_thread events, rounded up to a power of two, of 24 bytes
+ * each. Returns NULL and sets errno on failure.
+*/
+struct timespec_trace *timespec_trace_create(clockid_t clock, uint32_t events_per_thread)
+{
+	struct timespec_trace *t;
+	struct timespec ts;
+	uint32_t size = 2;
+	int err;
+
+	if(events_per_thread == 0 || events_per_thread > MAX_EVENTS)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if(clock_gettime(clock, &ts) != 0)
+	{
+		return NULL;
+	}
+
+	while(size < events_per_thread)
+	{
+		size *= 2;
+	}
+
+	t = calloc(1, sizeof(*t));
+	if(t == NULL)
+	{
+		return NULL;
+	}
+
+	err = pthread_mutex_init(&t->lock, NULL);
+	if(err != 0)
+	{
+		free(t);
+		errno = err;
+		return NULL;
+	}
+
+	t->id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+	t->clock = clock;
+	t->mask = size - 1;
+
+	return t;
+}
+
+/** \fn void timespec_trace_destroy(struct timespec_trace *t)
+ *  \brief Frees a trace and every thread's events. NULL is ignored.
+ *
+ * No thread may be recording into the trace.
+*/
+void timespec_trace_destroy(struct timespec_trace *t)
+{
+	if(t == NULL)
+	{
+		return;
+	}
+
+	for(uint32_t i = 0; i < t->count; ++i)
+	{
+		free(t->buffers[i]);
+	}
+
+	pthread_mutex_destroy(&t->lock);
+	free(t->buffers);
+	free(t);
+}
+
+/** \fn bool timespec_trace_begin(struct timespec_trace *t, const char *name)
+ *  \brief Begins a span on the calling thread.
+ *
+ * name is kept by pointer, so must stay valid until the events have been
+ * drained; a string literal is usual. Spans on a thread must nest, each
+ * ended by timespec_trace_end(). Returns false, and the span and its end are
+ * not recorded, if the thread's ring is full, the span is nested more than 64
+ * deep or the thread could not be registered. A NULL trace records nothing.
+*/
+bool timespec_trace_begin(struct timespec_trace *t, const char *name)
+{
+	struct buffer *b;
+
+	if(t == NULL || (b = buffer_of(t)) == NULL)
+	{
+		return false;
+	}
+
+	if(b->depth >= MAX_DEPTH || !has_room(t, b, 2))
+	{
+		if(b->depth < MAX_DEPTH)
+		{
+			b->recorded &= ~(UINT64_C(1) << b->depth);
+		}
+
+		++(b->depth);
+		drop(b);
+
+		return false;
+	}
+
+	put(t, b, name, 'B');
+
+	b->recorded |= UINT64_C(1) << b->depth;
+	++(b->depth);
+	++(b->open);
+
+	return true;
+}
+
+/** \fn void timespec_trace_end(struct timespec_trace *t)
+ *  \brief Ends the innermost open span on the calling thread.
+ *
+ * The end of a recorded span is always recorded. Ends without a span are
+ * ignored.
+*/
+void timespec_trace_end(struct timespec_trace *t)
+{
+	struct buffer *b;
+
+	if(t == NULL || (b = buffer_of(t)) == NULL || b->depth == 0)
+	{
+		return;
+	}
+
+	--(b->depth);
+
+	if(b->depth < MAX_DEPTH && (b->recorded & (UINT64_C(1) << b->depth)) != 0)
+	{
+		--(b->open);
+		put(t, b, NULL, 'E');
+	}
+}
+
+/** \fn bool timespec_trace_instant(struct timespec_trace *t, const char *name)
+ *  \brief Records a point in time on the calling thread.
+ *
+ * Returns false if the event was dropped.
+*/
+bool timespec_trace_instant(struct timespec_trace *t, const char *name)
+{
+	struct buffer *b;
+
+	if(t == NULL || (b = buffer_of(t)) == NULL)
+	{
+		return false;
+	}
+
+	if(!has_room(t, b, 1))
+	{
+		drop(b);
+		return false;
+	}
+
+	put(t, b, name, 'i');
+
+	return true;
+}
+
+/** \fn bool timespec_trace_name_thread(struct timespec_trace *t, const char *name)
+ *  \brief Names the calling thread in exported traces.
+ *
+ * name is kept by pointer. Also registers the thread, so it can be called
+ * at thread start to keep the allocation out of the first span. Returns
+ * false if the thread could not be registered.
+*/
+bool timespec_trace_name_thread(struct timespec_trace *t, const char *name)
+{
+	struct buffer *b;
+
+	if(t == NULL || (b = buffer_of(t)) == NULL)
+	{
+		return false;
+	}
+
+	pthread_mutex_lock(&t->lock);
+	b->name = name;
+	pthread_mutex_unlock(&t->lock);
+
+	return true;
+}
+
+/** \fn struct timespec_trace_scope timespec_trace_scope_begin(struct timespec_trace *t, const char *name)
+ *  \brief Begins a span ended by timespec_trace_scope_end().
+ *
+ * Used by TIMESPEC_TRACE_SCOPE(), which ends the span when the enclosing
+ * block is left by any path.
+*/
+struct timespec_trace_scope timespec_trace_scope_begin(struct timespec_trace *t, const char *name)
+{
+	struct timespec_trace_scope scope = { .trace = t };
+
+	timespec_trace_begin(t, name);
+
+	return scope;
+}
+
+/** \fn void timespec_trace_scope_end(struct timespec_trace_scope *scope)
+ *  \brief Ends a span begun by timespec_trace_scope_begin().
+*/
+void timespec_trace_scope_end(struct timespec_trace_scope *scope)
+{
+	timespec_trace_end(scope->trace);
+}
+
+/** \fn size_t timespec_trace_drain(struct timespec_trace *t, void (*visit)(const struct timespec_trace_event *event, void *arg), void *arg)
+ *  \brief Removes every recorded event, passing each to visit.
+ *
+ * Events come thread by thread, in the order each thread recorded them.
+ * May run while other threads record; their events recorded after the drain
+ * started may be left for the next one. visit may be NULL to discard the
+ * events, and must not record into the trace. Returns the number of events.
+*/
+size_t timespec_trace_drain(struct timespec_trace *t,
+	void (*visit)(const struct timespec_trace_event *event, void *arg), void *arg)
+{
+	size_t n = 0;
+
+	pthread_mutex_lock(&t->lock);
+
+	for(uint32_t i = 0; i < t->count; ++i)
+	{
+		struct buffer *b = t->buffers[i];
+		uint64_t head = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+
+		for(uint64_t tail = b->tail; tail != head; ++tail)
+		{
+			const struct entry *e = &b->entries[tail & t->mask];
+			struct timespec_trace_event event = {
+				.time = e->time,
+				.name = e->name,
+				.thread = b->thread,
+				.phase = e->phase,
+			};
+
+			if(visit != NULL)
+			{
+				visit(&event, arg);
+			}
+		}
+
+		n += (size_t)(head - b->tail);
+		__atomic_store_n(&b->tail, head, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&t->lock);
+
+	return n;
+}
+
+/** \fn uint64_t timespec_trace_dropped(struct timespec_trace *t)
+ *  \brief Returns the number of begin and instant events dropped so far.
+*/
+uint64_t timespec_trace_dropped(struct timespec_trace *t)
+{
+	uint64_t dropped = 0;
+
+	pthread_mutex_lock(&t->lock);
+
+	for(uint32_t i = 0; i < t->count; ++i)
+	{
+		dropped += __atomic_load_n(&t->buffers[i]->dropped, __ATOMIC_RELAXED);
+	}
+
+	pthread_mutex_unlock(&t->lock);
+
+	return dropped;
+}
+
+struct exporter
+{
+	FILE *f;
+	long pid;
+	bool first;
+};
+
+static void put_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+
+	for(; *s != '\0'; ++s)
+	{
+		unsigned char c = (unsigned char)(*s);
+
+		if(c == '"' || c == '\\')
+		{
+			fputc('\\', f);
+			fputc(c, f);
+		}
+		else if(c < 0x20)
+		{
+			fprintf(f, "\\u%04x", c);
+		}
+		else{
+			fputc(c, f);
+		}
+	}
+
+	fputc('"', f);
+}
+
+static void put_separator(struct exporter *x)
+{
+	fputs(x->first ? "\n" : ",\n", x->f);
+	x->first = false;
+}
+
+static void export_event(const struct timespec_trace_event *event, void *arg)
+{
+	struct exporter *x = arg;
+	uint64_t ns = (event->time < 0) ? -(uint64_t)(event->time) : (uint64_t)(event->time);
+
+	put_separator(x);
+	fputc('{', x->f);
+
+	if(event->name != NULL)
+	{
+		fputs("\"name\":", x->f);
+		put_string(x->f, event->name);
+		fputc(',', x->f);
+	}
+
+	/* Microseconds, to the nanosecond. */
+	fprintf(x->f, "\"ph\":\"%c\",\"ts\":%s%llu.%03u,\"pid\":%ld,\"tid\":%u%s}", event->phase,
+		(event->time < 0) ? "-" : "", (unsigned long long)(ns / 1000), (unsigned)(ns % 1000), x->pid,
+		(unsigned)(event->thread), (event->phase == 'i') ? ",\"s\":\"t\"" : "");
+}
+
+/** \fn bool timespec_trace_export(struct timespec_trace *t, FILE *f)
+ *  \brief Drains the trace and writes it to f in the Chrome trace format.
+ *
+ * Writes one JSON object with a "traceEvents" array, which chrome://tracing
+ * and Perfetto open. Timestamps are the clock's in microseconds and threads
+ * are numbered in the order they registered, with any names given as
+ * metadata events. Returns false if writing failed.
+*/
+bool timespec_trace_export(struct timespec_trace *t, FILE *f)
+{
+	struct exporter x = { .f = f, .pid = (long)(getpid()), .first = true };
+
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", f);
+
+	pthread_mutex_lock(&t->lock);
+
+	for(uint32_t i = 0; i < t->count; ++i)
+	{
+		if(t->buffers[i]->name != NULL)
+		{
+			put_separator(&x);
+			fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%u,\"args\":{\"name\":", x.pid,
+				(unsigned)(t->buffers[i]->thread));
+			put_string(f, t->buffers[i]->name);
+			fputs("}}", f);
+		}
+	}
+
+	pthread_mutex_unlock(&t->lock);
+
+	timespec_trace_drain(t, export_event, &x);
+
+	fputs("\n]}\n", f);
+
+	return fflush(f) == 0 && !ferror(f);
+}
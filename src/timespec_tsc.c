@@ -0,0 +1,542 @@
+/**
+ * @file timespec_tsc.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Timestamps from the CPU's cycle counter, calibrated against a POSIX clock.
+ *
+ * Reading the time stamp counter (or the generic timer on ARM) costs a few
+ * nanoseconds and no system call, so a hot path can record raw counts and
+ * convert them later. A count c converts to nanoseconds as
+ *
+ *     base_ns + (c - base_cycles) * mult / 2^32
+ *
+ * where mult is the length of a cycle in 32.32 fixed point. The parameters
+ * are published under a sequence lock so conversions never block.
+ *
+ * Each recalibration samples the counter and the clock together, measures
+ * the counter rate over the interval since the last one, and slews: the new
+ * line starts where the old one had reached, continuing it without a jump,
+ * and its slope is adjusted to remove the error found over the next
+ * interval of the same length. Errors over a millisecond, such as a step of
+ * CLOCK_REALTIME, are corrected at once instead.
+ *
+ * The counter must run at a constant rate through frequency changes and
+ * sleep states and be synchronised across CPUs. On x86 this is reported by
+ * the invariant TSC flag; where it is missing, or on other architectures,
+ * the counter is replaced by the clock itself and conversion is a no-op.
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "timespec.h"
+#include "timespec_clock.h"
+#include "timespec_tsc.h"
+
+/* Time between the two samples of the initial calibration. */
+#define CALIBRATION_NS 10000000
+
+/* Errors larger than this are stepped rather than slewed. */
+#define STEP_NS 1000000
+
+/* Attempts at taking a sample, of which the tightest is kept. */
+#define SAMPLE_TRIES 5
+
+struct timespec_tsc
+{
+	/* Conversion parameters, written under the sequence lock. */
+	uint32_t seq __attribute__((aligned(64)));
+	uint64_t base_cycles;
+	timespec_ns base_ns;
+	uint64_t mult;
+
+	clockid_t clock;
+	bool fallback;
+
+	/* Clock minus converted time at the last recalibration. */
+	timespec_ns error;
+
+	/* Everything below is guarded by lock. */
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	uint64_t last_cycles;
+	timespec_ns last_ns;
+
+	struct timespec period;
+	bool stop;
+	bool threaded;
+	pthread_t thread;
+};
+
+static uint64_t read_counter(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+	uint64_t count;
+
+	__asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(count) : : "memory");
+	return count;
+#else
+	return 0;
+#endif
+}
+
+static bool counter_invariant(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+
+	/* Advanced power management leaf, EDX bit 8: invariant TSC. */
+	if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+	{
+		return false;
+	}
+
+	return (edx & (1u << 8)) != 0;
+#elif defined(__aarch64__)
+	/* The generic timer always runs at a fixed frequency. */
+	return true;
+#else
+	return false;
+#endif
+}
+
+/* Returns cycles * mult / 2^32. */
+static uint64_t scale(uint64_t cycles, uint64_t mult)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 p = (unsigned __int128)(cycles) * mult;
+
+	return (uint64_t)(p >> 32);
+#else
+	uint64_t c_lo = cycles & 0xFFFFFFFF, c_hi = cycles >> 32;
+	uint64_t m_lo = mult & 0xFFFFFFFF, m_hi = mult >> 32;
+
+	return ((c_hi * m_hi) << 32) + c_hi * m_lo + c_lo * m_hi + ((c_lo * m_lo) >> 32);
+#endif
+}
+
+static timespec_ns convert(const struct timespec_tsc *tsc, uint64_t cycles)
+{
+	uint32_t seq;
+	uint64_t base_cycles, mult;
+	timespec_ns base_ns;
+
+	do {
+		seq = __atomic_load_n(&tsc->seq, __ATOMIC_ACQUIRE);
+		base_cycles = __atomic_load_n(&tsc->base_cycles, __ATOMIC_RELAXED);
+		base_ns = __atomic_load_n(&tsc->base_ns, __ATOMIC_RELAXED);
+		mult = __atomic_load_n(&tsc->mult, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while((seq & 1) != 0 || seq != __atomic_load_n(&tsc->seq, __ATOMIC_RELAXED));
+
+	if(cycles >= base_cycles)
+	{
+		return base_ns + (timespec_ns)(scale(cycles - base_cycles, mult));
+	}
+
+	return base_ns - (timespec_ns)(scale(base_cycles - cycles, mult));
+}
+
+/* Only called with the lock held, so there is one writer at a time. */
+static void publish(struct timespec_tsc *tsc, uint64_t base_cycles, timespec_ns base_ns, uint64_t mult)
+{
+	uint32_t seq = tsc->seq;
+
+	__atomic_store_n(&tsc->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	__atomic_store_n(&tsc->base_cycles, base_cycles, __ATOMIC_RELAXED);
+	__atomic_store_n(&tsc->base_ns, base_ns, __ATOMIC_RELAXED);
+	__atomic_store_n(&tsc->mult, mult, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&tsc->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Reads the counter and the clock at as nearly the same moment as possible,
+ * taking the count halfway through the tightest of several clock reads.
+*/
+static bool sample(const struct timespec_tsc *tsc, uint64_t *cycles, timespec_ns *ns)
+{
+	uint64_t best = UINT64_MAX;
+
+	*cycles = 0;
+	*ns = 0;
+	for(int i = 0; i < SAMPLE_TRIES; ++i)
+	{
+		struct timespec ts;
+		uint64_t before = read_counter();
+
+		if(clock_gettime(tsc->clock, &ts) != 0)
+		{
+			return false;
+		}
+
+		uint64_t after = read_counter();
+
+		if(after - before < best)
+		{
+			best = after - before;
+			*cycles = before + best / 2;
+			*ns = timespec_ns_from_timespec(ts);
+		}
+	}
+
+	return true;
+}
+
+/* Recalibrates against a fresh sample. Called with the lock held. */
+static bool calibrate(struct timespec_tsc *tsc)
+{
+	uint64_t cycles;
+	timespec_ns ns;
+
+	if(!sample(tsc, &cycles, &ns))
+	{
+		return false;
+	}
+
+	uint64_t elapsed_cycles = cycles - tsc->last_cycles;
+	timespec_ns elapsed_ns = ns - tsc->last_ns;
+	timespec_ns now = convert(tsc, cycles);
+	timespec_ns error = ns - now;
+	uint64_t mult = tsc->mult;
+	timespec_ns base = ns;
+
+	if(elapsed_cycles != 0 && elapsed_ns > 0)
+	{
+		double slope = (double)(elapsed_ns) * 4294967296.0 / (double)(elapsed_cycles);
+
+		if(error > -STEP_NS && error < STEP_NS)
+		{
+			/* Aim to have caught up by the next recalibration. */
+			slope += (double)(error) * 4294967296.0 / (double)(elapsed_cycles);
+			base = now;
+		}
+
+		if(slope >= 1.0 && slope < 18446744073709551616.0)
+		{
+			mult = (uint64_t)(slope + 0.5);
+		}
+	}
+
+	publish(tsc, cycles, base, mult);
+	__atomic_store_n(&tsc->error, error, __ATOMIC_RELAXED);
+	tsc->last_cycles = cycles;
+	tsc->last_ns = ns;
+
+	return true;
+}
+
+static void *recalibrate_main(void *arg)
+{
+	struct timespec_tsc *tsc = arg;
+	struct timespec next;
+
+	pthread_mutex_lock(&tsc->lock);
+
+	next = timespec_add(timespec_now(CLOCK_MONOTONIC), tsc->period);
+	while(!tsc->stop)
+	{
+		if(pthread_cond_timedwait(&tsc->wake, &tsc->lock, &next) == ETIMEDOUT)
+		{
+			calibrate(tsc);
+
+			/* Keep to the schedule, unless it has fallen behind. */
+			struct timespec now = timespec_now(CLOCK_MONOTONIC);
+			next = timespec_add(next, tsc->period);
+			if(timespec_lt(next, now))
+			{
+				next = timespec_add(now, tsc->period);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&tsc->lock);
+
+	return NULL;
+}
+
+static int start_thread(struct timespec_tsc *tsc)
+{
+	pthread_condattr_t attr;
+	int err;
+
+	err = pthread_condattr_init(&attr);
+	if(err == 0)
+	{
+		err = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	}
+	if(err == 0)
+	{
+		err = pthread_cond_init(&tsc->wake, &attr);
+		pthread_condattr_destroy(&attr);
+	}
+	if(err != 0)
+	{
+		return err;
+	}
+
+	err = pthread_create(&tsc->thread, NULL, recalibrate_main, tsc);
+	if(err != 0)
+	{
+		pthread_cond_destroy(&tsc->wake);
+		return err;
+	}
+
+	tsc->threaded = true;
+
+	return 0;
+}
+
+/* Takes the initial calibration, falling back to the clock if the counter
+ * does not behave.
+*/
+static void first_calibration(struct timespec_tsc *tsc)
+{
+	struct timespec wait = { .tv_sec = 0, .tv_nsec = CALIBRATION_NS };
+	uint64_t c0, c1;
+	timespec_ns t0, t1;
+
+	tsc->fallback = !counter_invariant();
+	if(tsc->fallback || !sample(tsc, &c0, &t0))
+	{
+		tsc->fallback = true;
+		return;
+	}
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, 0, &wait, &wait) == EINTR)
+	{
+	}
+
+	if(!sample(tsc, &c1, &t1) || c1 <= c0 || t1 <= t0)
+	{
+		tsc->fallback = true;
+		return;
+	}
+
+	/* Between 1ps and 1us a cycle, or something is wrong with the counter. */
+	double slope = (double)(t1 - t0) * 4294967296.0 / (double)(c1 - c0);
+	if(slope < 4294967296.0 / 1000.0 || slope > 4294967296.0 * 1000.0)
+	{
+		tsc->fallback = true;
+		return;
+	}
+
+	tsc->last_cycles = c1;
+	tsc->last_ns = t1;
+	publish(tsc, c1, t1, (uint64_t)(slope + 0.5));
+}
+
+/** \fn struct timespec_tsc *timespec_tsc_create(clockid_t clock, struct timespec recalibrate_period)
+ *  \brief Calibrates the cycle counter against clock.
+ *
+ * Takes about 10ms. If recalibrate_period is positive a background thread
+ * recalibrates that often, bounding the drift between the two; one second
+ * is a reasonable choice. If it is zero, call timespec_tsc_recalibrate()
+ * periodically instead.
+ *
+ * If the CPU has no invariant counter the clock is read instead, which is
+ * slower but still correct; see timespec_tsc_fallback(). Returns NULL and
+ * sets errno on failure, including EINVAL if the clock cannot be read or the
+ * period is negative.
+*/
+struct timespec_tsc *timespec_tsc_create(clockid_t clock, struct timespec recalibrate_period)
+{
+	struct timespec_tsc *tsc;
+	struct timespec ts;
+	void *mem;
+	int err;
+
+	recalibrate_period = timespec_normalise(recalibrate_period);
+	if(clock_gettime(clock, &ts) != 0 || recalibrate_period.tv_sec < 0 || recalibrate_period.tv_nsec < 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if(posix_memalign(&mem, 64, sizeof(*tsc)) != 0)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+	tsc = mem;
+
+	tsc->seq = 0;
+	tsc->base_cycles = 0;
+	tsc->base_ns = 0;
+	tsc->mult = 0;
+	tsc->clock = clock;
+	tsc->error = 0;
+	tsc->last_cycles = 0;
+	tsc->last_ns = 0;
+	tsc->period = recalibrate_period;
+	tsc->stop = false;
+	tsc->threaded = false;
+
+	err = pthread_mutex_init(&tsc->lock, NULL);
+	if(err != 0)
+	{
+		free(tsc);
+		errno = err;
+		return NULL;
+	}
+
+	first_calibration(tsc);
+
+	if(!tsc->fallback && (recalibrate_period.tv_sec > 0 || recalibrate_period.tv_nsec > 0))
+	{
+		err = start_thread(tsc);
+		if(err != 0)
+		{
+			pthread_mutex_destroy(&tsc->lock);
+			free(tsc);
+			errno = err;
+			return NULL;
+		}
+	}
+
+	return tsc;
+}
+
+/** \fn void timespec_tsc_destroy(struct timespec_tsc *tsc)
+ *  \brief Stops recalibration and frees a calibrated counter. NULL is ignored.
+*/
+void timespec_tsc_destroy(struct timespec_tsc *tsc)
+{
+	if(tsc == NULL)
+	{
+		return;
+	}
+
+	if(tsc->threaded)
+	{
+		pthread_mutex_lock(&tsc->lock);
+		tsc->stop = true;
+		pthread_cond_signal(&tsc->wake);
+		pthread_mutex_unlock(&tsc->lock);
+
+		pthread_join(tsc->thread, NULL);
+		pthread_cond_destroy(&tsc->wake);
+	}
+
+	pthread_mutex_destroy(&tsc->lock);
+	free(tsc);
+}
+
+/** \fn bool timespec_tsc_fallback(const struct timespec_tsc *tsc)
+ *  \brief Returns true if the clock is being read in place of the counter.
+*/
+bool timespec_tsc_fallback(const struct timespec_tsc *tsc)
+{
+	return tsc->fallback;
+}
+
+/** \fn uint64_t timespec_tsc_cycles(const struct timespec_tsc *tsc)
+ *  \brief Reads the raw counter, for converting later.
+ *
+ * Counts are only meaningful to the timespec_tsc they were read through. In
+ * fallback mode this reads the clock.
+*/
+uint64_t timespec_tsc_cycles(const struct timespec_tsc *tsc)
+{
+	if(tsc->fallback)
+	{
+		return (uint64_t)(timespec_ns_from_timespec(timespec_now(tsc->clock)));
+	}
+
+	return read_counter();
+}
+
+/** \fn timespec_ns timespec_tsc_to_ns(const struct timespec_tsc *tsc, uint64_t cycles)
+ *  \brief Converts a count from timespec_tsc_cycles() to a time of the clock.
+ *
+ * Counts read before the latest recalibration are converted with the
+ * latest parameters, which differ from the ones in force when they were
+ * read by no more than the error reported by timespec_tsc_error().
+*/
+timespec_ns timespec_tsc_to_ns(const struct timespec_tsc *tsc, uint64_t cycles)
+{
+	if(tsc->fallback)
+	{
+		return (timespec_ns)(cycles);
+	}
+
+	return convert(tsc, cycles);
+}
+
+/** \fn struct timespec timespec_tsc_to_timespec(const struct timespec_tsc *tsc, uint64_t cycles)
+ *  \brief Converts a count from timespec_tsc_cycles() to a timespec.
+*/
+struct timespec timespec_tsc_to_timespec(const struct timespec_tsc *tsc, uint64_t cycles)
+{
+	return timespec_ns_to_timespec(timespec_tsc_to_ns(tsc, cycles));
+}
+
+/** \fn struct timespec timespec_tsc_now(const struct timespec_tsc *tsc)
+ *  \brief Returns the current time of the calibrated clock.
+*/
+struct timespec timespec_tsc_now(const struct timespec_tsc *tsc)
+{
+	return timespec_tsc_to_timespec(tsc, timespec_tsc_cycles(tsc));
+}
+
+/** \fn bool timespec_tsc_recalibrate(struct timespec_tsc *tsc)
+ *  \brief Recalibrates the counter against the clock.
+ *
+ * Safe to call at any time from any thread, including while others convert.
+ * Does nothing in fallback mode. Returns false if the clock could not be
+ * read.
+*/
+bool timespec_tsc_recalibrate(struct timespec_tsc *tsc)
+{
+	if(tsc->fallback)
+	{
+		return true;
+	}
+
+	pthread_mutex_lock(&tsc->lock);
+	bool ok = calibrate(tsc);
+	pthread_mutex_unlock(&tsc->lock);
+
+	return ok;
+}
+
+/** \fn struct timespec timespec_tsc_error(const struct timespec_tsc *tsc)
+ *  \brief Returns the error found by the last recalibration.
+ *
+ * This is the clock's time less the converted time, so positive when the
+ * counter had fallen behind. Zero before the first recalibration and in
+ * fallback mode.
+*/
+struct timespec timespec_tsc_error(const struct timespec_tsc *tsc)
+{
+	return timespec_ns_to_timespec(__atomic_load_n(&tsc->error, __ATOMIC_RELAXED));
+}
+
+/** \fn double timespec_tsc_frequency(const struct timespec_tsc *tsc)
+ *  \brief Returns the counter frequency in Hz as currently calibrated.
+ *
+ * Includes any slew being applied. In fallback mode the "counter" is the
+ * clock in nanoseconds, so this is 1e9.
+*/
+double timespec_tsc_frequency(const struct timespec_tsc *tsc)
+{
+	if(tsc->fallback)
+	{
+		return 1e9;
+	}
+
+	return 4294967296.0e9 / (double)(__atomic_load_n(&tsc->mult, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,347 @@
+/**
+ * @file timespec_wheel.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Hierarchical timing wheel keyed by struct timespec deadlines.
+ *
+ * Time is divided into ticks of a fixed length from a start time. Timers due
+ * within the next 256 ticks sit in the first level, one slot per tick; each
+ * further level covers 256 times the span of the one below, so the five
+ * levels reach 2^40 ticks ahead. Whenever the first level wraps, the due slot
+ * of the next level is cascaded down. Insertion and cancellation are O(1),
+ * and expiry is O(1) per timer plus amortised cascading.
+ *
+ * Timers never fire early: a timer fires on the first tick boundary at or
+ * after its deadline, so it may fire up to one tick late.
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_wheel.h"
+
+#define WHEEL_BITS   8
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 5
+#define WHEEL_SPAN   ((uint64_t)(1) << (WHEEL_BITS * WHEEL_LEVELS))
+
+struct timespec_wheel
+{
+	struct timespec_timer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+
+	/* Occupied slots of the first level, so runs of empty ticks can be
+	 * skipped without visiting them.
+	*/
+	uint64_t occupied[WHEEL_SLOTS / 64];
+
+	timespec_ns start;
+	timespec_ns tick_ns;
+
+	/* Next tick to be processed. */
+	uint64_t tick;
+	size_t count;
+};
+
+static bool in_first_level(const struct timespec_wheel *wheel, struct timespec_timer **head)
+{
+	uintptr_t p = (uintptr_t)(head);
+
+	return p >= (uintptr_t)(&wheel->slots[0][0]) && p < (uintptr_t)(&wheel->slots[0][WHEEL_SLOTS]);
+}
+
+static void link_timer(struct timespec_wheel *wheel, struct timespec_timer *timer)
+{
+	uint64_t expires = timer->expires;
+	uint64_t delta;
+	int level = 0;
+
+	if(expires < wheel->tick)
+	{
+		/* Already due, fire on the next tick processed. */
+		expires = wheel->tick;
+	}
+
+	delta = expires - wheel->tick;
+	if(delta >= WHEEL_SPAN)
+	{
+		expires = wheel->tick + WHEEL_SPAN - 1;
+		delta = WHEEL_SPAN - 1;
+	}
+
+	while(delta >= WHEEL_SLOTS)
+	{
+		delta >>= WHEEL_BITS;
+		++level;
+	}
+
+	unsigned slot = (unsigned)(expires >> (level * WHEEL_BITS)) & WHEEL_MASK;
+	struct timespec_timer **head = &wheel->slots[level][slot];
+
+	timer->next = *head;
+	if(timer->next != NULL)
+	{
+		timer->next->pprev = &timer->next;
+	}
+	*head = timer;
+	timer->pprev = head;
+
+	if(level == 0)
+	{
+		wheel->occupied[slot / 64] |= (uint64_t)(1) << (slot % 64);
+	}
+}
+
+static void unlink_timer(struct timespec_wheel *wheel, struct timespec_timer *timer)
+{
+	struct timespec_timer **pprev = timer->pprev;
+
+	*pprev = timer->next;
+	if(timer->next != NULL)
+	{
+		timer->next->pprev = pprev;
+	}
+	else if(*pprev == NULL && in_first_level(wheel, pprev))
+	{
+		size_t slot = (size_t)(pprev - &wheel->slots[0][0]);
+		wheel->occupied[slot / 64] &= ~((uint64_t)(1) << (slot % 64));
+	}
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/* Moves every timer in a slot of a higher level down to where it now belongs.
+ * Returns the slot index, which is zero when the next level is also due.
+*/
+static unsigned cascade(struct timespec_wheel *wheel, int level)
+{
+	unsigned slot = (unsigned)(wheel->tick >> (level * WHEEL_BITS)) & WHEEL_MASK;
+	struct timespec_timer *timer = wheel->slots[level][slot];
+
+	wheel->slots[level][slot] = NULL;
+	while(timer != NULL)
+	{
+		struct timespec_timer *next = timer->next;
+		link_timer(wheel, timer);
+		timer = next;
+	}
+
+	return slot;
+}
+
+/* Returns the first occupied first-level slot after index, or WHEEL_SLOTS. */
+static unsigned next_occupied(const struct timespec_wheel *wheel, unsigned index)
+{
+	for(unsigned slot = index + 1; slot < WHEEL_SLOTS; slot = (slot | 63) + 1)
+	{
+		uint64_t bits = wheel->occupied[slot / 64] >> (slot % 64);
+
+		if(bits != 0)
+		{
+			return slot + (unsigned)(__builtin_ctzll(bits));
+		}
+	}
+
+	return WHEEL_SLOTS;
+}
+
+/* Returns the first tick at or after ts, or 0 if ts is before the start. */
+static uint64_t tick_ceil(const struct timespec_wheel *wheel, struct timespec ts)
+{
+	timespec_ns rel = timespec_ns_sub(timespec_ns_from_timespec(ts), wheel->start);
+
+	if(rel <= 0)
+	{
+		return 0;
+	}
+
+	return (uint64_t)(rel / wheel->tick_ns) + (rel % wheel->tick_ns != 0);
+}
+
+/** \fn struct timespec_wheel *timespec_wheel_create(struct timespec start, struct timespec tick)
+ *  \brief Creates an empty timing wheel.
+ *
+ * start is the time of tick zero, normally the current time of the clock
+ * that will be passed to timespec_wheel_advance(). tick is the granularity
+ * and must be positive. Returns NULL and sets errno on failure.
+*/
+struct timespec_wheel *timespec_wheel_create(struct timespec start, struct timespec tick)
+{
+	timespec_ns tick_ns = timespec_ns_from_timespec(tick);
+	struct timespec_wheel *wheel;
+
+	if(tick_ns <= 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	wheel = calloc(1, sizeof(*wheel));
+	if(wheel == NULL)
+	{
+		return NULL;
+	}
+
+	wheel->start = timespec_ns_from_timespec(start);
+	wheel->tick_ns = tick_ns;
+
+	return wheel;
+}
+
+/** \fn void timespec_wheel_destroy(struct timespec_wheel *wheel)
+ *  \brief Frees a timing wheel. NULL is ignored.
+ *
+ * Pending timers are not touched and are left in an undefined state; cancel
+ * them first if they will be reused.
+*/
+void timespec_wheel_destroy(struct timespec_wheel *wheel)
+{
+	free(wheel);
+}
+
+/** \fn void timespec_timer_init(struct timespec_timer *timer, void (*callback)(struct timespec_timer *timer))
+ *  \brief Initialises a timer node which will call callback when it expires.
+*/
+void timespec_timer_init(struct timespec_timer *timer, void (*callback)(struct timespec_timer *timer))
+{
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->expires = 0;
+	timer->callback = callback;
+}
+
+/** \fn bool timespec_timer_pending(const struct timespec_timer *timer)
+ *  \brief Returns true if the timer is in a wheel and has not yet expired.
+*/
+bool timespec_timer_pending(const struct timespec_timer *timer)
+{
+	return timer->pprev != NULL;
+}
+
+/** \fn void timespec_wheel_add(struct timespec_wheel *wheel, struct timespec_timer *timer, struct timespec deadline)
+ *  \brief Arms a timer to expire at deadline.
+ *
+ * A timer which is already pending is re-armed. Deadlines which have passed
+ * expire on the next call to timespec_wheel_advance(), and deadlines more
+ * than 2^40 ticks ahead are clamped to that range. May be called from a
+ * timer callback.
+*/
+void timespec_wheel_add(struct timespec_wheel *wheel, struct timespec_timer *timer, struct timespec deadline)
+{
+	if(timespec_timer_pending(timer))
+	{
+		unlink_timer(wheel, timer);
+	}
+	else
+	{
+		++(wheel->count);
+	}
+
+	timer->expires = tick_ceil(wheel, deadline);
+	link_timer(wheel, timer);
+}
+
+/** \fn bool timespec_wheel_cancel(struct timespec_wheel *wheel, struct timespec_timer *timer)
+ *  \brief Cancels a timer. Returns false if it was not pending.
+ *
+ * May be called from a timer callback.
+*/
+bool timespec_wheel_cancel(struct timespec_wheel *wheel, struct timespec_timer *timer)
+{
+	if(!timespec_timer_pending(timer))
+	{
+		return false;
+	}
+
+	unlink_timer(wheel, timer);
+	--(wheel->count);
+
+	return true;
+}
+
+/** \fn size_t timespec_wheel_advance(struct timespec_wheel *wheel, struct timespec now)
+ *  \brief Advances the wheel to now, running the callback of every timer due.
+ *
+ * Returns the number of timers which expired. now should not go backwards;
+ * if it does nothing is done.
+*/
+size_t timespec_wheel_advance(struct timespec_wheel *wheel, struct timespec now)
+{
+	timespec_ns rel = timespec_ns_sub(timespec_ns_from_timespec(now), wheel->start);
+	size_t expired = 0;
+
+	if(rel < 0)
+	{
+		return 0;
+	}
+
+	uint64_t end = (uint64_t)(rel / wheel->tick_ns) + 1;
+
+	while(wheel->tick < end)
+	{
+		if(wheel->count == 0)
+		{
+			wheel->tick = end;
+			break;
+		}
+
+		unsigned index = (unsigned)(wheel->tick) & WHEEL_MASK;
+
+		if(index == 0)
+		{
+			for(int level = 1; level < WHEEL_LEVELS && cascade(wheel, level) == 0; ++level)
+			{
+			}
+		}
+
+		if(wheel->slots[0][index] == NULL)
+		{
+			/* Skip straight to the next occupied slot or the next cascade. */
+			uint64_t next = wheel->tick - index + next_occupied(wheel, index);
+			wheel->tick = (next < end) ? next : end;
+			continue;
+		}
+
+		++(wheel->tick);
+
+		/* Detach the slot before running any callback. A callback re-arming
+		 * a timer a multiple of 256 ticks ahead links it into this same
+		 * slot, and it must wait for the slot's next turn rather than fire
+		 * in this pass. The detached timers stay pending, so callbacks can
+		 * still cancel or re-arm them.
+		*/
+		struct timespec_timer *due = wheel->slots[0][index];
+		struct timespec_timer *timer;
+
+		wheel->slots[0][index] = NULL;
+		wheel->occupied[index / 64] &= ~((uint64_t)(1) << (index % 64));
+		due->pprev = &due;
+
+		while((timer = due) != NULL)
+		{
+			unlink_timer(wheel, timer);
+			--(wheel->count);
+			++expired;
+
+			timer->callback(timer);
+		}
+	}
+
+	return expired;
+}
+
+/** \fn size_t timespec_wheel_count(const struct timespec_wheel *wheel)
+ *  \brief Returns the number of pending timers.
+*/
+size_t timespec_wheel_count(const struct timespec_wheel *wheel)
+{
+	return wheel->count;
+}
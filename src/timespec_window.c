@@ -0,0 +1,401 @@
+/**
+ * @file timespec_window.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Sliding window event counter with fixed memory.
+ *
+ * Time is divided into buckets of a fixed width, numbered by floor division of
+ * the timestamp in nanoseconds, and a power-of-two ring keeps the most recent
+ * buckets. Instead of a count, each bucket holds the running total of every
+ * event recorded up to the end of that bucket, so the sum over any window is
+ * the difference of two slots regardless of its length. An event in the newest
+ * bucket updates one slot. Moving into a new bucket copies the total forward
+ * into every bucket skipped over, at most the ring, which is paid for by the
+ * time that passed. A late event updates each bucket from its own to the
+ * newest, so it costs time in proportion to how late it is, up to the whole
+ * ring. Late events are rare, and keeping their cost constant as well would
+ * make queries of long windows slower.
+ *
+ * A window has one writer. For many threads give each its own window and
+ * merge them into another when querying, like the latency histogram. Updates
+ * are published under a sequence lock, so merges and queries from other
+ * threads always see a consistent ring and never block the writer.
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "timespec.h"
+#include "timespec_window.h"
+
+/* Bucket number of an empty window. */
+#define EMPTY INT64_MIN
+
+struct slot
+{
+	uint64_t total;
+};
+
+struct timespec_window
+{
+	uint32_t seq;
+
+	/* Newest bucket, the time it starts and the running total at its end. */
+	int64_t head;
+	timespec_ns head_start;
+	uint64_t total;
+
+	timespec_ns width;
+	uint32_t buckets;
+	uint32_t mask;
+
+	/* Per-bucket counts read from the source of a merge. */
+	uint64_t *scratch;
+
+	struct slot slots[];
+};
+
+static inline struct slot *slot_of(const struct timespec_window *w, int64_t epoch)
+{
+	return (struct slot*)(&w->slots[(uint64_t)(epoch) & w->mask]);
+}
+
+static inline int64_t epoch_of(const struct timespec_window *w, timespec_ns now)
+{
+	/* Most times fall in the newest bucket, which needs no division. */
+	int64_t head = __atomic_load_n(&w->head, __ATOMIC_RELAXED);
+	timespec_ns start = __atomic_load_n(&w->head_start, __ATOMIC_RELAXED);
+
+	if(head != EMPTY && now >= start && now - start < w->width)
+	{
+		return head;
+	}
+
+	int64_t e = now / w->width;
+
+	return (now % w->width < 0) ? e - 1 : e;
+}
+
+/* The writer updates fields with relaxed atomic stores between these, and
+ * readers retry if the sequence number was odd or changed while they read.
+*/
+static void write_begin(struct timespec_window *w)
+{
+	__atomic_store_n(&w->seq, w->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(struct timespec_window *w)
+{
+	__atomic_store_n(&w->seq, w->seq + 1, __ATOMIC_RELEASE);
+}
+
+static uint32_t read_begin(const struct timespec_window *w)
+{
+	return __atomic_load_n(&w->seq, __ATOMIC_ACQUIRE);
+}
+
+static bool read_retry(const struct timespec_window *w, uint32_t seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return (seq & 1) != 0 || seq != __atomic_load_n(&w->seq, __ATOMIC_RELAXED);
+}
+
+/* Makes epoch the newest bucket if it is later than the current one, carrying
+ * the running total into every bucket in between. The slots of an empty
+ * window are all zero already, so only the new bucket is written then.
+*/
+static void advance(struct timespec_window *w, int64_t epoch)
+{
+	int64_t from;
+
+	if(w->head == EMPTY)
+	{
+		from = epoch;
+	}
+	else if(epoch <= w->head)
+	{
+		return;
+	}
+	else
+	{
+		from = (epoch - w->head > w->mask) ? epoch - w->mask : w->head + 1;
+	}
+
+	for(int64_t e = from; e <= epoch; ++e)
+	{
+		struct slot *s = slot_of(w, e);
+
+		__atomic_store_n(&s->total, w->total, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&w->head, epoch, __ATOMIC_RELAXED);
+	__atomic_store_n(&w->head_start, epoch * w->width, __ATOMIC_RELAXED);
+}
+
+/** \fn struct timespec_window *timespec_window_create(struct timespec bucket_width, uint32_t buckets)
+ *  \brief Creates an empty sliding window counter.
+ *
+ * Counts are kept per bucket_width, and windows of up to buckets buckets can
+ * be queried. Memory is fixed at creation, at 16 bytes per bucket rounded up
+ * to a power of two. Returns NULL and sets errno on failure.
+*/
+struct timespec_window *timespec_window_create(struct timespec bucket_width, uint32_t buckets)
+{
+	timespec_ns width = timespec_ns_from_timespec(bucket_width);
+	timespec_ns span;
+	struct timespec_window *w;
+	uint32_t slots = 2;
+
+	if(width <= 0 || buckets == 0 || buckets > (UINT32_C(1) << 30))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if(width == TIMESPEC_NS_MAX || __builtin_mul_overflow(width, (timespec_ns)(buckets), &span))
+	{
+		errno = ERANGE;
+		return NULL;
+	}
+
+	/* One more slot than the longest window, to hold the running total
+	 * from before it.
+	*/
+	while(slots < buckets + 1)
+	{
+		slots *= 2;
+	}
+
+	w = calloc(1, sizeof(*w) + slots * (sizeof(struct slot) + sizeof(uint64_t)));
+	if(w == NULL)
+	{
+		return NULL;
+	}
+
+	w->head = EMPTY;
+	w->width = width;
+	w->buckets = buckets;
+	w->mask = slots - 1;
+	w->scratch = (uint64_t*)(&w->slots[slots]);
+
+	return w;
+}
+
+/** \fn void timespec_window_destroy(struct timespec_window *w)
+ *  \brief Frees a sliding window counter. NULL is ignored.
+*/
+void timespec_window_destroy(struct timespec_window *w)
+{
+	free(w);
+}
+
+/** \fn struct timespec timespec_window_span(const struct timespec_window *w)
+ *  \brief Returns the longest window which can be queried.
+*/
+struct timespec timespec_window_span(const struct timespec_window *w)
+{
+	return timespec_ns_to_timespec(w->width * w->buckets);
+}
+
+/** \fn bool timespec_window_record(struct timespec_window *w, struct timespec now, uint64_t n)
+ *  \brief Records n events (or bytes, or any other quantity) at time now.
+ *
+ * Times need not be in order, but events older than the window span behind
+ * the newest recorded are dropped and false is returned. Only one thread may
+ * record into a window.
+ *
+ * Takes constant time for an event in the newest bucket. Moving to a later
+ * bucket also carries the total over each bucket skipped, up to the span, and
+ * a late event updates every bucket from its own to the newest, so in the
+ * worst case recording is O(window) rather than O(1).
+*/
+bool timespec_window_record(struct timespec_window *w, struct timespec now, uint64_t n)
+{
+	return timespec_window_record_ns(w, timespec_ns_from_timespec(now), n);
+}
+
+/** \fn bool timespec_window_record_ns(struct timespec_window *w, timespec_ns now, uint64_t n)
+ *  \brief Records n events at time now given as a timespec_ns.
+*/
+bool timespec_window_record_ns(struct timespec_window *w, timespec_ns now, uint64_t n)
+{
+	int64_t epoch = epoch_of(w, now);
+
+	if(w->head != EMPTY && epoch < w->head - w->mask + 1)
+	{
+		return false;
+	}
+
+	write_begin(w);
+
+	advance(w, epoch);
+
+	for(int64_t e = epoch; e <= w->head; ++e)
+	{
+		struct slot *s = slot_of(w, e);
+
+		__atomic_store_n(&s->total, s->total + n, __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&w->total, w->total + n, __ATOMIC_RELAXED);
+
+	write_end(w);
+
+	return true;
+}
+
+/** \fn uint64_t timespec_window_sum(const struct timespec_window *w, struct timespec now, struct timespec window)
+ *  \brief Returns the number of events recorded in the window ending at now.
+ *
+ * The window is rounded up to whole buckets and limited to the span, and
+ * always includes all of the bucket containing now. Runs in constant time.
+*/
+uint64_t timespec_window_sum(const struct timespec_window *w, struct timespec now, struct timespec window)
+{
+	return timespec_window_sum_ns(w, timespec_ns_from_timespec(now), timespec_ns_from_timespec(window));
+}
+
+/** \fn uint64_t timespec_window_sum_ns(const struct timespec_window *w, timespec_ns now, timespec_ns window)
+ *  \brief Returns the number of events in a window given as timespec_ns values.
+*/
+uint64_t timespec_window_sum_ns(const struct timespec_window *w, timespec_ns now, timespec_ns window)
+{
+	int64_t buckets = (window <= 0) ? 0 : (window - 1) / w->width + 1;
+	uint64_t sum;
+	uint32_t seq;
+
+	if(buckets == 0)
+	{
+		return 0;
+	}
+	else if(buckets > w->buckets)
+	{
+		buckets = w->buckets;
+	}
+
+	do {
+		seq = read_begin(w);
+
+		int64_t head = __atomic_load_n(&w->head, __ATOMIC_RELAXED);
+		int64_t epoch = epoch_of(w, now);
+		int64_t from = epoch - buckets;
+
+		sum = 0;
+
+		/* Buckets before the oldest in the ring are no longer known. */
+		if(head != EMPTY && epoch > head - w->mask && from < head)
+		{
+			uint64_t to_total = (epoch >= head)
+				? __atomic_load_n(&w->total, __ATOMIC_RELAXED)
+				: __atomic_load_n(&slot_of(w, epoch)->total, __ATOMIC_RELAXED);
+
+			if(from < head - w->mask)
+			{
+				from = head - w->mask;
+			}
+
+			sum = to_total - __atomic_load_n(&slot_of(w, from)->total, __ATOMIC_RELAXED);
+		}
+	} while(read_retry(w, seq));
+
+	return sum;
+}
+
+/** \fn double timespec_window_rate(const struct timespec_window *w, struct timespec now, struct timespec window)
+ *  \brief Returns the events per second over the window ending at now.
+ *
+ * The sum is divided by the window length after rounding it to whole buckets.
+*/
+double timespec_window_rate(const struct timespec_window *w, struct timespec now, struct timespec window)
+{
+	timespec_ns window_ns = timespec_ns_from_timespec(window);
+	timespec_ns buckets = (window_ns <= 0) ? 0 : (window_ns - 1) / w->width + 1;
+
+	if(buckets == 0)
+	{
+		return 0;
+	}
+	else if(buckets > w->buckets)
+	{
+		buckets = w->buckets;
+	}
+
+	return (double)(timespec_window_sum_ns(w, timespec_ns_from_timespec(now), window_ns))
+		/ timespec_ns_to_double(buckets * w->width);
+}
+
+/** \fn bool timespec_window_merge(struct timespec_window *dst, const struct timespec_window *src)
+ *  \brief Adds the events in src to dst.
+ *
+ * Both windows must have the same bucket width and span, otherwise errno is
+ * set to EINVAL and false is returned. src may be recorded into by another
+ * thread meanwhile; dst must not be. The time taken is proportional to the
+ * number of buckets, not events.
+*/
+bool timespec_window_merge(struct timespec_window *dst, const struct timespec_window *src)
+{
+	int64_t src_head;
+	uint32_t seq;
+
+	if(dst->width != src->width || dst->buckets != src->buckets || dst == src)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	/* Take the count of every bucket but the oldest in src, which is only
+	 * known as a running total.
+	*/
+	do {
+		seq = read_begin(src);
+
+		src_head = __atomic_load_n(&src->head, __ATOMIC_RELAXED);
+		if(src_head != EMPTY)
+		{
+			uint64_t before = __atomic_load_n(&slot_of(src, src_head - src->mask)->total, __ATOMIC_RELAXED);
+
+			for(int64_t e = src_head - src->mask + 1; e <= src_head; ++e)
+			{
+				uint64_t total = __atomic_load_n(&slot_of(src, e)->total, __ATOMIC_RELAXED);
+
+				dst->scratch[(uint64_t)(e) & dst->mask] = total - before;
+				before = total;
+			}
+		}
+	} while(read_retry(src, seq));
+
+	if(src_head == EMPTY)
+	{
+		return true;
+	}
+
+	write_begin(dst);
+
+	advance(dst, src_head);
+
+	uint64_t added = 0;
+
+	for(int64_t e = dst->head - dst->mask; e <= dst->head; ++e)
+	{
+		struct slot *s = slot_of(dst, e);
+
+		if(e > src_head - src->mask && e <= src_head)
+		{
+			added += dst->scratch[(uint64_t)(e) & dst->mask];
+		}
+
+		__atomic_store_n(&s->total, s->total + added, __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&dst->total, dst->total + added, __ATOMIC_RELAXED);
+
+	write_end(dst);
+
+	return true;
+}
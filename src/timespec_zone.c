@@ -0,0 +1,932 @@
+/**
+ * @file timespec_zone.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ *
+ * Conversion of timespecs to the local time of a time zone, from zoneinfo
+ * (TZif) files.
+ *
+ * localtime_r() takes a process-wide lock in glibc and checks TZ on every
+ * call, so threads converting times in parallel queue behind one another.
+ * Here a zone is loaded once into a table which is never modified again,
+ * so any number of threads can convert with it at once without locking.
+ *
+ * The table is the zone's transitions, the UTC times at which its offset or
+ * abbreviation change, each with the local time type that starts there. A
+ * conversion finds the last transition at or before the time by binary
+ * search, adds that type's offset, and splits the local seconds into a date
+ * with integer arithmetic on days since the epoch.
+ *
+ * TZif files give times after their last transition by a POSIX TZ rule such
+ * as "EST5EDT,M3.2.0,M11.1.0" in their footer. The rule's transitions are
+ * added to the table through 2100 when a zone is loaded, and later times
+ * work out the rule's transitions for their year as they are converted.
+ * The TZ environment variable may also be such a rule, with no file.
+ *
+ * Zones under "right/" count leap seconds in time_t, as their transition
+ * times do. Their leap second records give the correction to take off before
+ * splitting into a date, and an inserted leap second shows as second 60, as
+ * localtime_r() does.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "timespec_zone.h"
+
+#define SEC_PER_DAY    INT64_C(86400)
+#define NSEC_PER_SEC   1000000000L
+#define HEADER_SIZE    44
+#define MAX_FILE_SIZE  (1 << 20)
+#define MAX_RULE       256
+#define MAX_NAME       16
+#define ZONEINFO       "/usr/share/zoneinfo"
+
+/* Last year whose rule transitions are put in the table. */
+#define EXPAND_UNTIL   2100
+
+/* Converted times are limited to those whose year fits in a struct tm, which
+ * also keeps the date arithmetic within 64 bits.
+*/
+#define MAX_SECONDS    (INT64_C(2000000000) * INT64_C(31556952))
+
+struct zone_type
+{
+	int32_t utc_offset;
+	bool is_dst;
+	const char *abbrev;
+};
+
+/* A day of the year in a POSIX TZ rule, and the local time of day on it at
+ * which a transition happens.
+*/
+struct rule_date
+{
+	/* 'J' for Julian day 1-365 never counting February 29th, 'D' for day
+	 * 0-365 counting it, or 'M' for the week'th weekday of the month.
+	*/
+	char kind;
+	int day;
+	int week;
+	int month;
+	int32_t time;
+};
+
+struct zone_rule
+{
+	int32_t std_offset;
+	int32_t dst_offset;
+	bool has_dst;
+	uint16_t std_type;
+	uint16_t dst_type;
+	struct rule_date start;
+	struct rule_date end;
+};
+
+/* A leap second record: the total correction from time on. */
+struct zone_leap
+{
+	int64_t time;
+	int32_t correction;
+};
+
+struct timespec_zone
+{
+	/* Transition times in UTC seconds, ascending, and the type from each. */
+	size_t count;
+	int64_t *times;
+	uint16_t *type_of;
+
+	size_t type_count;
+	struct zone_type *types;
+	char *abbrevs;
+
+	/* Governs times from the last transition on when set. */
+	bool has_rule;
+	struct zone_rule rule;
+
+	/* Leap second records, ascending. */
+	size_t leap_count;
+	struct zone_leap *leaps;
+};
+
+/* The counts from a TZif header, and where the data they describe starts. */
+struct tzif_block
+{
+	const unsigned char *data;
+	size_t time_size;
+	uint32_t isut_count;
+	uint32_t isstd_count;
+	uint32_t leap_count;
+	uint32_t time_count;
+	uint32_t type_count;
+	uint32_t char_count;
+};
+
+static uint32_t read_be32(const unsigned char *p)
+{
+	return (uint32_t)(p[0]) << 24 | (uint32_t)(p[1]) << 16 | (uint32_t)(p[2]) << 8 | (uint32_t)(p[3]);
+}
+
+static int64_t read_time(const unsigned char *p, size_t time_size)
+{
+	if(time_size == 4)
+	{
+		return (int32_t)(read_be32(p));
+	}
+
+	return (int64_t)((uint64_t)(read_be32(p)) << 32 | read_be32(p + 4));
+}
+
+static size_t block_size(const struct tzif_block *b)
+{
+	return b->time_count * (b->time_size + 1) + b->type_count * 6 + b->char_count
+		+ b->leap_count * (b->time_size + 4) + b->isstd_count + b->isut_count;
+}
+
+/* Reads the header at p into b, returning its version or 0 if it is not a
+ * valid header followed by at least the data it describes.
+*/
+static char read_header(const unsigned char *p, size_t len, size_t time_size, struct tzif_block *b)
+{
+	if(len < HEADER_SIZE || memcmp(p, "TZif", 4) != 0)
+	{
+		return 0;
+	}
+
+	b->data = p + HEADER_SIZE;
+	b->time_size = time_size;
+	b->isut_count = read_be32(p + 20);
+	b->isstd_count = read_be32(p + 24);
+	b->leap_count = read_be32(p + 28);
+	b->time_count = read_be32(p + 32);
+	b->type_count = read_be32(p + 36);
+	b->char_count = read_be32(p + 40);
+
+	/* The limits keep block_size() from overflowing. */
+	if(b->time_count > MAX_FILE_SIZE || b->leap_count > MAX_FILE_SIZE || b->char_count > MAX_FILE_SIZE
+		|| b->type_count == 0 || b->type_count > 256
+		|| (b->isut_count != 0 && b->isut_count != b->type_count)
+		|| (b->isstd_count != 0 && b->isstd_count != b->type_count)
+		|| block_size(b) > len - HEADER_SIZE)
+	{
+		return 0;
+	}
+
+	return (p[4] == '\0') ? '1' : (char)(p[4]);
+}
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+	return a / b - (a % b < 0);
+}
+
+static bool is_leap(int64_t year)
+{
+	return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+/* Days from 1970-01-01 to a date in the proleptic Gregorian calendar, by
+ * counting from March of year 0 in 400 year eras.
+*/
+static int64_t days_from_civil(int64_t year, int month, int day)
+{
+	year -= (month <= 2);
+
+	int64_t era = floor_div(year, 400);
+	int64_t yoe = year - era * 400;
+	int64_t doy = (153 * ((month > 2) ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+/* The inverse of days_from_civil(). */
+static void civil_from_days(int64_t days, int64_t *year, int *month, int *day)
+{
+	days += 719468;
+
+	int64_t era = floor_div(days, 146097);
+	int64_t doe = days - era * 146097;
+	int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	int64_t mp = (5 * doy + 2) / 153;
+
+	*day = (int)(doy - (153 * mp + 2) / 5 + 1);
+	*month = (int)((mp < 10) ? mp + 3 : mp - 9);
+	*year = yoe + era * 400 + (*month <= 2);
+}
+
+/* Day of the week from days since the epoch, a Thursday, with Sunday 0. */
+static int weekday(int64_t days)
+{
+	return (int)((days % 7 + 11) % 7);
+}
+
+static int64_t year_of(int64_t seconds)
+{
+	int64_t year;
+	int month, day;
+
+	civil_from_days(floor_div(seconds, SEC_PER_DAY), &year, &month, &day);
+
+	return year;
+}
+
+/* UTC time of a rule's transition in a year, given the offset in effect
+ * before it.
+*/
+static int64_t rule_transition(const struct rule_date *d, int64_t year, int32_t offset)
+{
+	int64_t day = days_from_civil(year, 1, 1);
+
+	if(d->kind == 'J')
+	{
+		day += d->day - 1 + (d->day >= 60 && is_leap(year));
+	}
+	else if(d->kind == 'D')
+	{
+		day += d->day;
+	}
+	else
+	{
+		int64_t first = days_from_civil(year, d->month, 1);
+		int64_t next = (d->month == 12) ? days_from_civil(year + 1, 1, 1) : days_from_civil(year, d->month + 1, 1);
+
+		day = first + (d->day - weekday(first) + 7) % 7 + (d->week - 1) * 7;
+
+		/* Week 5 is the last, which may be the fourth. */
+		while(day >= next)
+		{
+			day -= 7;
+		}
+	}
+
+	return day * SEC_PER_DAY + d->time - offset;
+}
+
+static uint16_t rule_type(const struct zone_rule *rule, int64_t t)
+{
+	if(!rule->has_dst)
+	{
+		return rule->std_type;
+	}
+
+	int64_t year = year_of(t + rule->std_offset);
+	int64_t start = rule_transition(&rule->start, year, rule->std_offset);
+	int64_t end = rule_transition(&rule->end, year, rule->dst_offset);
+
+	/* In the southern hemisphere daylight saving spans the new year. */
+	bool dst = (start < end) ? (t >= start && t < end) : (t >= start || t < end);
+
+	return dst ? rule->dst_type : rule->std_type;
+}
+
+static const struct zone_type *find_type(const struct timespec_zone *zone, int64_t t)
+{
+	size_t n = zone->count;
+
+	if(zone->has_rule && (n == 0 || t >= zone->times[n - 1]))
+	{
+		return &zone->types[rule_type(&zone->rule, t)];
+	}
+	else if(n == 0 || t < zone->times[0])
+	{
+		return &zone->types[0];
+	}
+
+	/* The last transition at or before t, without branching on the comparisons. */
+	const int64_t *base = zone->times;
+
+	while(n > 1)
+	{
+		size_t half = n / 2;
+
+		base += (base[half] <= t) ? half : 0;
+		n -= half;
+	}
+
+	return &zone->types[zone->type_of[base - zone->times]];
+}
+
+/* Returns the leap second correction at t, setting hit to 1 if t is an
+ * inserted leap second. There are few records, and times are mostly recent,
+ * so they are searched from the end.
+*/
+static int32_t find_leap(const struct timespec_zone *zone, int64_t t, int *hit)
+{
+	size_t i = zone->leap_count;
+
+	while(i > 0 && t < zone->leaps[i - 1].time)
+	{
+		--i;
+	}
+
+	if(i == 0)
+	{
+		return 0;
+	}
+
+	const struct zone_leap *leap = &zone->leaps[i - 1];
+
+	*hit = t == leap->time && leap->correction > ((i > 1) ? leap[-1].correction : 0);
+
+	return leap->correction;
+}
+
+/* Parses a decimal number from min to max, returning the end of it or NULL. */
+static const char *parse_number(const char *s, int min, int max, int *value)
+{
+	int v = 0;
+
+	if(*s < '0' || *s > '9')
+	{
+		return NULL;
+	}
+
+	for(; *s >= '0' && *s <= '9'; ++s)
+	{
+		v = v * 10 + (*s - '0');
+		if(v > max)
+		{
+			return NULL;
+		}
+	}
+
+	if(v < min)
+	{
+		return NULL;
+	}
+
+	*value = v;
+
+	return s;
+}
+
+/* Parses [+|-]hh[:mm[:ss]] with hours up to max_hours into seconds. */
+static const char *parse_hms(const char *s, int max_hours, int32_t *seconds)
+{
+	int sign = 1, h, m = 0, sec = 0;
+
+	if(*s == '+' || *s == '-')
+	{
+		sign = (*s++ == '-') ? -1 : 1;
+	}
+
+	s = parse_number(s, 0, max_hours, &h);
+	if(s == NULL)
+	{
+		return NULL;
+	}
+
+	if(*s == ':')
+	{
+		s = parse_number(s + 1, 0, 59, &m);
+		if(s != NULL && *s == ':')
+		{
+			s = parse_number(s + 1, 0, 59, &sec);
+		}
+	}
+
+	*seconds = sign * (h * 3600 + m * 60 + sec);
+
+	return s;
+}
+
+/* Parses an abbreviation, alphabetic or quoted in <>, of at least 3 characters. */
+static const char *parse_name(const char *s, char *name)
+{
+	size_t len = 0;
+
+	if(*s == '<')
+	{
+		for(++s; *s != '>'; ++s, ++len)
+		{
+			if(*s == '\0' || len == MAX_NAME - 1 || !(*s == '+' || *s == '-' || (*s >= '0' && *s <= '9')
+				|| (*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z')))
+			{
+				return NULL;
+			}
+			name[len] = *s;
+		}
+		++s;
+	}
+	else
+	{
+		for(; (*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z'); ++s, ++len)
+		{
+			if(len == MAX_NAME - 1)
+			{
+				return NULL;
+			}
+			name[len] = *s;
+		}
+	}
+
+	name[len] = '\0';
+
+	return (len >= 3) ? s : NULL;
+}
+
+static const char *parse_date(const char *s, struct rule_date *d)
+{
+	d->time = 2 * 3600;
+
+	if(*s == 'J')
+	{
+		d->kind = 'J';
+		s = parse_number(s + 1, 1, 365, &d->day);
+	}
+	else if(*s == 'M')
+	{
+		d->kind = 'M';
+		s = parse_number(s + 1, 1, 12, &d->month);
+		s = (s != NULL && *s == '.') ? parse_number(s + 1, 1, 5, &d->week) : NULL;
+		s = (s != NULL && *s == '.') ? parse_number(s + 1, 0, 6, &d->day) : NULL;
+	}
+	else
+	{
+		d->kind = 'D';
+		s = parse_number(s, 0, 365, &d->day);
+	}
+
+	if(s != NULL && *s == '/')
+	{
+		s = parse_hms(s + 1, 167, &d->time);
+	}
+
+	return s;
+}
+
+/* Parses a POSIX TZ rule such as "EST5EDT,M3.2.0,M11.1.0" or "<+0530>-5:30".
+ * Offsets in the rule are west of UTC; those stored are east.
+*/
+static bool parse_rule(const char *s, struct zone_rule *rule, char *std_name, char *dst_name)
+{
+	int32_t offset;
+
+	memset(rule, 0, sizeof(*rule));
+
+	s = parse_name(s, std_name);
+	s = (s != NULL) ? parse_hms(s, 24, &offset) : NULL;
+	if(s == NULL)
+	{
+		return false;
+	}
+
+	rule->std_offset = -offset;
+	rule->dst_offset = rule->std_offset + 3600;
+
+	if(*s == '\0')
+	{
+		return true;
+	}
+
+	rule->has_dst = true;
+	s = parse_name(s, dst_name);
+	if(s != NULL && *s != ',' && *s != '\0')
+	{
+		s = parse_hms(s, 24, &offset);
+		rule->dst_offset = -offset;
+	}
+
+	if(s != NULL && *s == '\0')
+	{
+		/* The US rules, as the POSIX default. */
+		rule->start = (struct rule_date){ .kind = 'M', .month = 3, .week = 2, .day = 0, .time = 2 * 3600 };
+		rule->end = (struct rule_date){ .kind = 'M', .month = 11, .week = 1, .day = 0, .time = 2 * 3600 };
+		return true;
+	}
+
+	s = (s != NULL && *s == ',') ? parse_date(s + 1, &rule->start) : NULL;
+	s = (s != NULL && *s == ',') ? parse_date(s + 1, &rule->end) : NULL;
+
+	return s != NULL && *s == '\0';
+}
+
+/* Index of a type with the given fields, adding it if there is none. */
+static uint16_t add_type(struct timespec_zone *zone, size_t *chars, int32_t utc_offset, bool is_dst,
+	const char *abbrev)
+{
+	for(size_t i = 0; i < zone->type_count; ++i)
+	{
+		if(zone->types[i].utc_offset == utc_offset && zone->types[i].is_dst == is_dst
+			&& strcmp(zone->types[i].abbrev, abbrev) == 0)
+		{
+			return (uint16_t)(i);
+		}
+	}
+
+	strcpy(zone->abbrevs + *chars, abbrev);
+	zone->types[zone->type_count] = (struct zone_type){ .utc_offset = utc_offset, .is_dst = is_dst,
+		.abbrev = zone->abbrevs + *chars };
+	*chars += strlen(abbrev) + 1;
+
+	return (uint16_t)(zone->type_count++);
+}
+
+static void add_transition(struct timespec_zone *zone, int64_t t, uint16_t type)
+{
+	if(t > zone->times[zone->count - 1] && type != zone->type_of[zone->count - 1])
+	{
+		zone->times[zone->count] = t;
+		zone->type_of[zone->count] = type;
+		++(zone->count);
+	}
+}
+
+/* Years of rule transitions to add after the last transition in the file,
+ * or 0 if they would not save working them out on conversion.
+*/
+static size_t expand_years(const struct tzif_block *b, const struct zone_rule *rule)
+{
+	if(!rule->has_dst || b->time_count == 0)
+	{
+		return 0;
+	}
+
+	int64_t year = year_of(read_time(b->data + (b->time_count - 1) * b->time_size, b->time_size));
+
+	return (year >= 1900 && year <= EXPAND_UNTIL) ? (size_t)(EXPAND_UNTIL - year + 1) : 0;
+}
+
+/* Builds a zone from the data of a TZif block and a TZ rule, either of which
+ * may be empty.
+*/
+static struct timespec_zone *build(const struct tzif_block *b, const char *rule_string)
+{
+	const unsigned char *indices = b->data + b->time_count * b->time_size;
+	const unsigned char *infos = indices + b->time_count;
+	const char *chars = (const char *)(infos + b->type_count * 6);
+	const unsigned char *leaps = (const unsigned char *)(chars + b->char_count);
+	size_t leap_size = b->time_size + 4;
+	char std_name[MAX_NAME], dst_name[MAX_NAME];
+	struct zone_rule rule;
+	bool has_rule = *rule_string != '\0';
+	struct timespec_zone *zone;
+	size_t years, used;
+
+	memset(&rule, 0, sizeof(rule));
+
+	if(has_rule && !parse_rule(rule_string, &rule, std_name, dst_name))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if((b->type_count == 0 && !has_rule) || (b->char_count > 0 && chars[b->char_count - 1] != '\0'))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	for(uint32_t i = 0; i < b->type_count; ++i)
+	{
+		if(infos[i * 6 + 5] >= b->char_count || read_be32(infos + i * 6) == 0x80000000)
+		{
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	for(uint32_t i = 0; i < b->time_count; ++i)
+	{
+		if(indices[i] >= b->type_count
+			|| (i > 0 && read_time(b->data + i * b->time_size, b->time_size)
+				<= read_time(b->data + (i - 1) * b->time_size, b->time_size)))
+		{
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	for(uint32_t i = 1; i < b->leap_count; ++i)
+	{
+		if(read_time(leaps + i * leap_size, b->time_size) <= read_time(leaps + (i - 1) * leap_size, b->time_size))
+		{
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	years = has_rule ? expand_years(b, &rule) : 0;
+
+	zone = calloc(1, sizeof(*zone));
+	if(zone == NULL)
+	{
+		return NULL;
+	}
+
+	zone->times = malloc((b->time_count + 2 * years + 1) * sizeof(*zone->times));
+	zone->type_of = malloc((b->time_count + 2 * years + 1) * sizeof(*zone->type_of));
+	zone->types = malloc((b->type_count + 2) * sizeof(*zone->types));
+	zone->abbrevs = malloc(b->char_count + 2 * MAX_NAME);
+	zone->leaps = malloc((b->leap_count + 1) * sizeof(*zone->leaps));
+	if(zone->times == NULL || zone->type_of == NULL || zone->types == NULL || zone->abbrevs == NULL
+		|| zone->leaps == NULL)
+	{
+		timespec_zone_destroy(zone);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	memcpy(zone->abbrevs, chars, b->char_count);
+	for(uint32_t i = 0; i < b->type_count; ++i)
+	{
+		zone->types[i] = (struct zone_type){ .utc_offset = (int32_t)(read_be32(infos + i * 6)),
+			.is_dst = infos[i * 6 + 4] != 0, .abbrev = zone->abbrevs + infos[i * 6 + 5] };
+	}
+	zone->type_count = b->type_count;
+
+	for(uint32_t i = 0; i < b->time_count; ++i)
+	{
+		zone->times[i] = read_time(b->data + i * b->time_size, b->time_size);
+		zone->type_of[i] = indices[i];
+	}
+	zone->count = b->time_count;
+
+	for(uint32_t i = 0; i < b->leap_count; ++i)
+	{
+		zone->leaps[i] = (struct zone_leap){ .time = read_time(leaps + i * leap_size, b->time_size),
+			.correction = (int32_t)(read_be32(leaps + i * leap_size + b->time_size)) };
+	}
+	zone->leap_count = b->leap_count;
+
+	if(has_rule)
+	{
+		used = b->char_count;
+		rule.std_type = add_type(zone, &used, rule.std_offset, false, std_name);
+		rule.dst_type = rule.has_dst ? add_type(zone, &used, rule.dst_offset, true, dst_name) : rule.std_type;
+
+		zone->has_rule = true;
+		zone->rule = rule;
+	}
+
+	for(int64_t year = EXPAND_UNTIL - (int64_t)(years) + 1; year <= EXPAND_UNTIL; ++year)
+	{
+		int64_t start = rule_transition(&rule.start, year, rule.std_offset);
+		int64_t end = rule_transition(&rule.end, year, rule.dst_offset);
+
+		if(start < end)
+		{
+			add_transition(zone, start, rule.dst_type);
+			add_transition(zone, end, rule.std_type);
+		}
+		else
+		{
+			add_transition(zone, end, rule.std_type);
+			add_transition(zone, start, rule.dst_type);
+		}
+	}
+
+	return zone;
+}
+
+/** \fn struct timespec_zone *timespec_zone_parse(const void *buf, size_t len)
+ *  \brief Loads a time zone from the contents of a TZif file.
+ *
+ * The buffer is not referenced once this returns. Returns NULL and sets
+ * errno on failure, EINVAL if the data is not a valid TZif file.
+*/
+struct timespec_zone *timespec_zone_parse(const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	char rule[MAX_RULE];
+	struct tzif_block b;
+	char version = read_header(p, len, 4, &b);
+
+	rule[0] = '\0';
+
+	/* Version 2 and later repeat the data with 64 bit times, then give the rule between newlines. */
+	if(version >= '2')
+	{
+		size_t skip = HEADER_SIZE + block_size(&b);
+		const char *footer, *end;
+
+		version = read_header(p + skip, len - skip, 8, &b);
+		footer = (version != 0) ? (const char *)(b.data + block_size(&b)) : (const char *)(p) + len;
+		end = (footer < (const char *)(p) + len && *footer == '\n')
+			? memchr(footer + 1, '\n', len - (size_t)(footer + 1 - (const char *)(p))) : NULL;
+
+		if(end == NULL || end - footer > MAX_RULE)
+		{
+			errno = EINVAL;
+			return NULL;
+		}
+
+		memcpy(rule, footer + 1, (size_t)(end - footer - 1));
+		rule[end - footer - 1] = '\0';
+	}
+
+	if(version == 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return build(&b, rule);
+}
+
+static struct timespec_zone *load_file(const char *path)
+{
+	struct timespec_zone *zone;
+	struct stat st;
+	void *map;
+	int fd, err;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	if(fstat(fd, &st) != 0)
+	{
+		err = errno;
+		close(fd);
+		errno = err;
+		return NULL;
+	}
+
+	if(!S_ISREG(st.st_mode) || st.st_size == 0 || st.st_size > MAX_FILE_SIZE)
+	{
+		close(fd);
+		errno = S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+		return NULL;
+	}
+
+	map = mmap(NULL, (size_t)(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	err = errno;
+	close(fd);
+	if(map == MAP_FAILED)
+	{
+		errno = err;
+		return NULL;
+	}
+
+	zone = timespec_zone_parse(map, (size_t)(st.st_size));
+	err = errno;
+	munmap(map, (size_t)(st.st_size));
+	errno = err;
+
+	return zone;
+}
+
+/** \fn struct timespec_zone *timespec_zone_load(const char *name)
+ *  \brief Loads a time zone by name, such as "Europe/London".
+ *
+ * A name starting with '/' is the path of a TZif file, and others are looked
+ * up under TZDIR, or /usr/share/zoneinfo if it is not set. A name which is no
+ * file is taken as a POSIX TZ rule, such as "EST5EDT,M3.2.0,M11.1.0".
+ *
+ * NULL loads the zone localtime() uses: TZ if set, with any leading ':'
+ * removed and UTC if it is empty, or else /etc/localtime. The environment is
+ * only read here, so later changes to TZ do not affect the zone.
+ *
+ * Returns NULL and sets errno on failure, ENOENT if there is no such zone.
+*/
+struct timespec_zone *timespec_zone_load(const char *name)
+{
+	struct timespec_zone *zone;
+	struct tzif_block empty;
+	char path[PATH_MAX];
+	const char *dir;
+
+	if(name == NULL)
+	{
+		name = getenv("TZ");
+		name = (name != NULL) ? name : "/etc/localtime";
+	}
+
+	name = (*name == ':') ? name + 1 : name;
+	name = (*name == '\0') ? "UTC0" : name;
+
+	if(*name == '/')
+	{
+		return load_file(name);
+	}
+
+	dir = getenv("TZDIR");
+	dir = (dir != NULL && *dir != '\0') ? dir : ZONEINFO;
+
+	/* A name must not climb out of the zoneinfo directory. */
+	if(strstr(name, "..") == NULL)
+	{
+		if(snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)(sizeof(path)))
+		{
+			errno = ENAMETOOLONG;
+			return NULL;
+		}
+
+		zone = load_file(path);
+		if(zone != NULL || (errno != ENOENT && errno != ENOTDIR && errno != EISDIR))
+		{
+			return zone;
+		}
+	}
+
+	memset(&empty, 0, sizeof(empty));
+	empty.data = (const unsigned char *)("");
+	zone = (strlen(name) < MAX_RULE) ? build(&empty, name) : NULL;
+	if(zone == NULL && errno == EINVAL)
+	{
+		errno = ENOENT;
+	}
+
+	return zone;
+}
+
+/** \fn void timespec_zone_destroy(struct timespec_zone *zone)
+ *  \brief Frees a time zone. NULL is ignored.
+*/
+void timespec_zone_destroy(struct timespec_zone *zone)
+{
+	if(zone != NULL)
+	{
+		free(zone->times);
+		free(zone->type_of);
+		free(zone->types);
+		free(zone->abbrevs);
+		free(zone->leaps);
+		free(zone);
+	}
+}
+
+/** \fn bool timespec_zone_to_local(const struct timespec_zone *zone, struct timespec ts, struct timespec_local *out)
+ *  \brief Converts a time to the wall clock time of a zone.
+ *
+ * Fills out as localtime_r() would, with the nanoseconds, the offset from
+ * UTC and the zone abbreviation in effect. Safe to call from any number of
+ * threads at once. Returns false and sets errno to EOVERFLOW if the year
+ * does not fit in a struct tm.
+*/
+bool timespec_zone_to_local(const struct timespec_zone *zone, struct timespec ts, struct timespec_local *out)
+{
+	int64_t sec = ts.tv_sec;
+	long nsec = ts.tv_nsec % NSEC_PER_SEC;
+
+	if(sec < -MAX_SECONDS || sec > MAX_SECONDS)
+	{
+		errno = EOVERFLOW;
+		return false;
+	}
+
+	/* Carry tv_nsec into whole seconds and a fraction of one from 0, as the
+	 * clock shows a negative tv_nsec in the second before.
+	*/
+	sec += ts.tv_nsec / NSEC_PER_SEC;
+	if(nsec < 0)
+	{
+		sec -= 1;
+		nsec += NSEC_PER_SEC;
+	}
+
+	const struct zone_type *type = find_type(zone, sec);
+	int hit = 0;
+	int64_t local = sec - find_leap(zone, sec, &hit) + type->utc_offset;
+	int64_t days = floor_div(local, SEC_PER_DAY);
+	int64_t seconds = local - days * SEC_PER_DAY;
+	int64_t year;
+
+	memset(&out->tm, 0, sizeof(out->tm));
+	civil_from_days(days, &year, &out->tm.tm_mon, &out->tm.tm_mday);
+
+	out->tm.tm_year = (int)(year - 1900);
+	out->tm.tm_mon -= 1;
+	out->tm.tm_yday = (int)(days - days_from_civil(year, 1, 1));
+	out->tm.tm_wday = weekday(days);
+	out->tm.tm_hour = (int)(seconds / 3600);
+	out->tm.tm_min = (int)(seconds / 60 % 60);
+	out->tm.tm_sec = (int)(seconds % 60) + hit;
+	out->tm.tm_isdst = type->is_dst;
+	out->nsec = nsec;
+	out->utc_offset = type->utc_offset;
+	out->abbrev = type->abbrev;
+
+	return true;
+}
+
+/** \fn int32_t timespec_zone_offset(const struct timespec_zone *zone, struct timespec ts)
+ *  \brief Returns the offset of a zone's wall clock from UTC at a time, in seconds east.
+*/
+int32_t timespec_zone_offset(const struct timespec_zone *zone, struct timespec ts)
+{
+	int64_t sec = (ts.tv_sec < -MAX_SECONDS) ? -MAX_SECONDS : (ts.tv_sec > MAX_SECONDS) ? MAX_SECONDS : ts.tv_sec;
+
+	sec += ts.tv_nsec / NSEC_PER_SEC - (ts.tv_nsec % NSEC_PER_SEC < 0);
+	sec = (sec < -MAX_SECONDS) ? -MAX_SECONDS : (sec > MAX_SECONDS) ? MAX_SECONDS : sec;
+
+	return find_type(zone, sec)->utc_offset;
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+#include <timespec_array.h>
+
+#define ELEMENTS 1037
+
+static struct timespec random_timespec(int normalised)
+{
+	static const long secs[]  = { 0, 1, -1, 2, -2, 1000000, -1000000 };
+	static const long nsecs[] = { 0, 1, -1, 999999999, -999999999, 500000000, -500000000,
+		1000000000, -1000000000, 2500000000L, -2500000000L };
+
+	struct timespec ts = {
+		.tv_sec  = (rand() % 4) ? secs[rand() % 7] : (long)(rand()) - RAND_MAX / 2,
+		.tv_nsec = (rand() % 4) ? nsecs[rand() % 7] : (long)(rand() % 2000000000) - 1000000000,
+	};
+
+	if(!normalised && rand() % 8 == 0)
+	{
+		ts.tv_nsec = nsecs[rand() % 11];
+	}
+
+	return normalised ? timespec_normalise(ts) : ts;
+}
+
+#define CHECK_TS(what, i, got, expect) { \
+	if((got).tv_sec != (expect).tv_sec || (got).tv_nsec != (expect).tv_nsec) \
+	{ \
+		printf("%s (impl %d) element %zu returned wrong values\n", what, (int)(impl), (size_t)(i)); \
+		printf("    Expected: {%ld, %ld}\n", (long)((expect).tv_sec), (long)((expect).tv_nsec)); \
+		printf("    Got:      {%ld, %ld}\n", (long)((got).tv_sec), (long)((got).tv_nsec)); \
+		result = 1; \
+	} \
+}
+
+static struct timespec in1[ELEMENTS];
+static struct timespec in2[ELEMENTS];
+static struct timespec out[ELEMENTS];
+static uint64_t mask[(ELEMENTS + 63) / 64];
+
+int main()
+{
+    int result = 0;
+    int tested = 0;
+
+    srand(1);
+
+    for(int impl = TIMESPEC_ARRAY_SCALAR; impl <= TIMESPEC_ARRAY_AVX2; ++impl)
+    {
+        if(!timespec_array_set_impl((enum timespec_array_impl)(impl)))
+        {
+            printf("Implementation %d not supported, skipped\n", impl);
+            continue;
+        }
+        ++tested;
+
+        for(int round = 0; round < 20; ++round)
+        {
+            /* Even rounds use only normalised inputs so the vector paths are taken throughout. */
+            int normalised = (round % 2 == 0);
+            size_t n = ELEMENTS - (size_t)(round);
+            struct timespec offset = random_timespec(normalised && round % 4 == 0);
+
+            for(size_t i = 0; i < n; ++i)
+            {
+                in1[i] = random_timespec(normalised);
+                in2[i] = random_timespec(normalised);
+            }
+
+            // timespec_add_array
+
+            timespec_add_array(out, in1, n, offset);
+            for(size_t i = 0; i < n; ++i)
+            {
+                CHECK_TS("timespec_add_array", i, out[i], timespec_add(in1[i], offset));
+            }
+
+            // timespec_sub_array
+
+            timespec_sub_array(out, in1, n, offset);
+            for(size_t i = 0; i < n; ++i)
+            {
+                CHECK_TS("timespec_sub_array", i, out[i], timespec_sub(in1[i], offset));
+            }
+
+            // timespec_diff_array
+
+            timespec_diff_array(out, in1, in2, n);
+            for(size_t i = 0; i < n; ++i)
+            {
+                CHECK_TS("timespec_diff_array", i, out[i], timespec_sub(in1[i], in2[i]));
+            }
+
+            // timespec_lt_mask
+
+            for(size_t i = 0; i < n; i += 3)
+            {
+                in1[i] = offset;
+                in1[i].tv_nsec += (long)(i % 3) - 1;
+            }
+            for(size_t i = 0; i < (n + 63) / 64; ++i)
+            {
+                mask[i] = ~(uint64_t)(0);
+            }
+
+            timespec_lt_mask(mask, in1, n, offset);
+            for(size_t i = 0; i < n; ++i)
+            {
+                bool got = (mask[i / 64] >> (i % 64)) & 1;
+                if(got != timespec_lt(in1[i], offset))
+                {
+                    printf("timespec_lt_mask (impl %d) element %zu returned %s\n", impl, i, got ? "TRUE" : "FALSE");
+                    result = 1;
+                }
+            }
+            if(n % 64 != 0 && (mask[n / 64] >> (n % 64)) != 0)
+            {
+                printf("timespec_lt_mask (impl %d) left bits set past element %zu\n", impl, n);
+                result = 1;
+            }
+
+            // In-place operation
+
+            for(size_t i = 0; i < n; ++i)
+            {
+                in2[i] = in1[i];
+            }
+            timespec_add_array(in1, in1, n, offset);
+            for(size_t i = 0; i < n; ++i)
+            {
+                CHECK_TS("timespec_add_array in place", i, in1[i], timespec_add(in2[i], offset));
+            }
+        }
+    }
+
+    if(tested == 0)
+    {
+        printf("No implementations tested\n");
+        result = 1;
+    }
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file timespecAtomicTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+#include <timespec_atomic.h>
+
+#define THREADS     4
+#define PER_THREAD  200000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static struct timespec ts(long sec, long nsec)
+{
+	struct timespec ts = { .tv_sec = sec, .tv_nsec = nsec };
+	return ts;
+}
+
+static struct timespec_atomic shared;
+static bool stop;
+
+/* Two values differing in both fields, so a torn read would be neither. */
+static const struct timespec values[2] = { { 1000000000, 999999999 }, { 2000000000, 1 } };
+
+struct reader
+{
+	pthread_t thread;
+	long reads;
+	long torn;
+};
+
+static void *writer_main(void *arg)
+{
+	(void)(arg);
+
+	for(long i = 0; i < THREADS * PER_THREAD; ++i)
+	{
+		timespec_atomic_store(&shared, values[i & 1]);
+	}
+	__atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+static void *reader_main(void *arg)
+{
+	struct reader *r = arg;
+
+	while(!__atomic_load_n(&stop, __ATOMIC_ACQUIRE))
+	{
+		struct timespec t = timespec_atomic_load(&shared);
+
+		r->torn += !timespec_eq(t, values[0]) && !timespec_eq(t, values[1]);
+		++(r->reads);
+	}
+
+	return NULL;
+}
+
+static void *max_main(void *arg)
+{
+	unsigned int seed = (unsigned int)(size_t)(arg);
+	struct timespec *largest = arg;
+
+	*largest = ts(0, 0);
+	for(long i = 0; i < PER_THREAD; ++i)
+	{
+		struct timespec t = ts(rand_r(&seed) % 1000000, rand_r(&seed) % 1000000000);
+		struct timespec old = timespec_atomic_fetch_max(&shared, t);
+
+		if(timespec_gt(t, *largest))
+		{
+			*largest = t;
+		}
+
+		/* The watermark never moves backwards. */
+		if(timespec_lt(timespec_atomic_load(&shared), old) || timespec_lt(timespec_atomic_load(&shared), t))
+		{
+			*largest = ts(-1, 0);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void *add_main(void *arg)
+{
+	(void)(arg);
+
+	for(long i = 0; i < PER_THREAD; ++i)
+	{
+		timespec_atomic_fetch_add(&shared, ts(0, 3));
+	}
+
+	return NULL;
+}
+
+int main()
+{
+    struct timespec_atomic a;
+    int result = 0;
+
+    /* Single-threaded semantics */
+
+    timespec_atomic_init(&a, ts(5, 1500000000));
+    CHECK(timespec_eq(timespec_atomic_load(&a), ts(6, 500000000)), "init does not normalise");
+    CHECK(timespec_atomic_load_ns(&a) == 6500000000LL, "load_ns is wrong");
+
+    timespec_atomic_store(&a, ts(-1, -5));
+    CHECK(timespec_eq(timespec_atomic_load(&a), ts(-1, -5)), "store of a negative time is wrong");
+
+    timespec_atomic_store_ns(&a, 42);
+    CHECK(timespec_eq(timespec_atomic_exchange(&a, ts(1, 0)), ts(0, 42)), "exchange returned the wrong old value");
+    CHECK(timespec_eq(timespec_atomic_load(&a), ts(1, 0)), "exchange did not store");
+
+    struct timespec expected = ts(0, 1000000000);
+    CHECK(timespec_atomic_compare_exchange(&a, &expected, ts(2, 0)), "compare_exchange of an equal value failed");
+    expected = ts(1, 0);
+    CHECK(!timespec_atomic_compare_exchange(&a, &expected, ts(3, 0)) && timespec_eq(expected, ts(2, 0))
+        && timespec_eq(timespec_atomic_load(&a), ts(2, 0)), "compare_exchange of a different value is wrong");
+
+    CHECK(timespec_eq(timespec_atomic_fetch_max(&a, ts(1, 0)), ts(2, 0)), "fetch_max returned the wrong value");
+    CHECK(timespec_eq(timespec_atomic_load(&a), ts(2, 0)), "fetch_max lowered the value");
+    timespec_atomic_fetch_max(&a, ts(2, 1));
+    CHECK(timespec_eq(timespec_atomic_load(&a), ts(2, 1)), "fetch_max did not raise the value");
+
+    CHECK(timespec_eq(timespec_atomic_fetch_min(&a, ts(3, 0)), ts(2, 1)), "fetch_min returned the wrong value");
+    CHECK(timespec_eq(timespec_atomic_load(&a), ts(2, 1)), "fetch_min raised the value");
+    timespec_atomic_fetch_min(&a, ts(-2, 0));
+    CHECK(timespec_eq(timespec_atomic_load(&a), ts(-2, 0)), "fetch_min did not lower the value");
+
+    CHECK(timespec_eq(timespec_atomic_fetch_add(&a, ts(0, -500000000)), ts(-2, 0)), "fetch_add returned the wrong value");
+    CHECK(timespec_atomic_load_ns(&a) == -2500000000LL, "fetch_add result is wrong");
+
+    timespec_atomic_store_ns(&a, TIMESPEC_NS_MAX - 1);
+    timespec_atomic_fetch_add(&a, ts(1, 0));
+    CHECK(timespec_atomic_load_ns(&a) == TIMESPEC_NS_MAX, "fetch_add does not saturate");
+
+    /* Loads are never torn */
+
+    struct reader readers[THREADS - 1] = { { 0 } };
+    pthread_t writer;
+
+    timespec_atomic_init(&shared, values[0]);
+    for(int i = 0; i < THREADS - 1; ++i)
+    {
+        pthread_create(&readers[i].thread, NULL, reader_main, &readers[i]);
+    }
+    pthread_create(&writer, NULL, writer_main, NULL);
+
+    pthread_join(writer, NULL);
+    for(int i = 0; i < THREADS - 1; ++i)
+    {
+        pthread_join(readers[i].thread, NULL);
+        CHECK(readers[i].torn == 0, "reader %d saw %ld torn values in %ld reads", i, readers[i].torn,
+            readers[i].reads);
+    }
+
+    /* Concurrent maximum */
+
+    pthread_t threads[THREADS];
+    struct timespec largest[THREADS];
+    struct timespec overall = ts(0, 0);
+
+    timespec_atomic_init(&shared, ts(0, 0));
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_create(&threads[i], NULL, max_main, &largest[i]);
+    }
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        CHECK(timespec_ge(largest[i], ts(0, 0)), "thread %d saw the maximum move backwards", i);
+        if(timespec_gt(largest[i], overall))
+        {
+            overall = largest[i];
+        }
+    }
+    CHECK(timespec_eq(timespec_atomic_load(&shared), overall), "concurrent maximum is wrong");
+
+    /* Concurrent addition */
+
+    timespec_atomic_init(&shared, ts(10, 0));
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_create(&threads[i], NULL, add_main, NULL);
+    }
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK(timespec_atomic_load_ns(&shared) == 10000000000LL + 3LL * THREADS * PER_THREAD,
+        "concurrent additions were lost");
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <stdio.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static void sleep_ms(long ms)
+{
+	struct timespec ts = timespec_from_ms(ms);
+	while(nanosleep(&ts, &ts) != 0 && errno == EINTR)
+	{
+	}
+}
+
+int main()
+{
+    int result = 0;
+
+    // timespec_now
+
+    struct timespec t1 = timespec_now(CLOCK_MONOTONIC);
+    struct timespec t2 = timespec_now(CLOCK_MONOTONIC);
+    CHECK(timespec_le(t1, t2), "timespec_now(CLOCK_MONOTONIC) went backwards");
+    CHECK(timespec_eq(t1, timespec_normalise(t1)), "timespec_now returned a non-normalised value");
+
+    struct timespec zero = timespec_now((clockid_t)(-12345));
+    CHECK(zero.tv_sec == 0 && zero.tv_nsec == 0, "timespec_now on an invalid clock did not return zero");
+
+    // Ticker mode
+
+    struct timespec_cached_clock *cc = timespec_cached_clock_create(CLOCK_MONOTONIC, TIMESPEC_CLOCK_TICKER,
+        timespec_from_ms(1));
+    CHECK(cc != NULL, "timespec_cached_clock_create(TICKER) failed");
+    if(cc != NULL)
+    {
+        struct timespec before = timespec_cached_clock_now(cc);
+        sleep_ms(50);
+        struct timespec after  = timespec_cached_clock_now(cc);
+        struct timespec real   = timespec_now(CLOCK_MONOTONIC);
+        struct timespec stale  = timespec_cached_clock_staleness(cc);
+
+        CHECK(timespec_gt(after, before), "ticker did not advance the cached time");
+        CHECK(timespec_le(after, real), "cached time is ahead of the clock");
+        CHECK(timespec_ge(stale, timespec_from_ms(1)), "staleness bound is below the resolution");
+        CHECK(timespec_le(timespec_sub(real, after), timespec_add(stale, timespec_from_ms(50))),
+            "cached time lags the clock by more than the staleness bound");
+        CHECK(timespec_cached_clock_now_ns(cc) >= timespec_ns_from_timespec(after),
+            "timespec_cached_clock_now_ns went backwards");
+
+        timespec_cached_clock_destroy(cc);
+    }
+
+    // Coarse mode
+
+    cc = timespec_cached_clock_create(CLOCK_MONOTONIC, TIMESPEC_CLOCK_COARSE, timespec_from_ms(0));
+    CHECK(cc != NULL, "timespec_cached_clock_create(COARSE) failed");
+    if(cc != NULL)
+    {
+        struct timespec stale = timespec_cached_clock_staleness(cc);
+        struct timespec coarse = timespec_cached_clock_now(cc);
+        struct timespec real   = timespec_now(CLOCK_MONOTONIC);
+
+        CHECK(timespec_gt(stale, timespec_from_ms(0)), "coarse staleness bound is zero");
+        CHECK(timespec_le(timespec_sub(real, coarse), timespec_add(stale, timespec_from_ms(50))),
+            "coarse time lags the clock by more than the staleness bound");
+
+        timespec_cached_clock_destroy(cc);
+    }
+
+    // Invalid arguments
+
+    errno = 0;
+    cc = timespec_cached_clock_create(CLOCK_MONOTONIC, TIMESPEC_CLOCK_TICKER, timespec_from_ms(0));
+    CHECK(cc == NULL && errno == EINVAL, "zero ticker resolution was accepted");
+    cc = timespec_cached_clock_create(CLOCK_PROCESS_CPUTIME_ID, TIMESPEC_CLOCK_COARSE, timespec_from_ms(1));
+    CHECK(cc == NULL && errno == EINVAL, "coarse mode accepted a clock with no coarse variant");
+    timespec_cached_clock_destroy(NULL);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file timespecCodecTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_codec.h>
+
+#define N 20000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static struct timespec ts(long sec, long nsec)
+{
+	struct timespec ts = { .tv_sec = sec, .tv_nsec = nsec };
+	return ts;
+}
+
+static long random_range(long lo, long hi)
+{
+	unsigned long r = ((unsigned long)(rand()) << 31) ^ (unsigned long)(rand());
+	return lo + (long)(r % (unsigned long)(hi - lo + 1));
+}
+
+/* Fills in with one of several kinds of sequence. */
+static void generate(struct timespec *in, size_t n, int kind)
+{
+	struct timespec t = ts(1792240496, 0);
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		switch(kind)
+		{
+			case 0: /* Exactly periodic */
+				t = timespec_add(t, timespec_from_ms(1));
+				in[i] = t;
+				break;
+
+			case 1: /* Periodic with jitter */
+				t = timespec_add(t, ts(0, 1000000 + random_range(-20000, 20000)));
+				in[i] = t;
+				break;
+
+			case 2: /* Random, unordered and mixed sign */
+				in[i] = ts(random_range(-9000000000L, 9000000000L), random_range(-999999999, 999999999));
+				break;
+
+			default: /* Not normalised */
+				in[i] = ts(random_range(-100, 100), random_range(-5000000000L, 5000000000L));
+				break;
+		}
+	}
+}
+
+int main()
+{
+    static struct timespec in[N], out[N];
+    static timespec_ns out_ns[N];
+    int result = 0;
+
+    srand(1);
+
+    CHECK(timespec_codec_create(0) == NULL && errno == EINVAL, "zero block size accepted");
+
+    for(int kind = 0; kind < 4; ++kind)
+    {
+        for(uint32_t block_size = 1; block_size <= 4096; block_size *= 8)
+        {
+            struct timespec_codec *codec = timespec_codec_create(block_size);
+            generate(in, N, kind);
+
+            for(size_t i = 0; i < N; ++i)
+            {
+                if(!timespec_codec_append(codec, in[i]))
+                {
+                    printf("append %zu failed\n", i);
+                    result = 1;
+                    break;
+                }
+            }
+
+            CHECK(timespec_codec_count(codec) == N, "count is wrong");
+            CHECK(timespec_codec_blocks(codec) == (N + block_size - 1) / block_size, "block count is wrong");
+
+            // Sequential decode of the whole stream
+
+            memset(out, 0, sizeof(out));
+            CHECK(timespec_codec_decode(codec, 0, out, N + 10) == N, "decode returned the wrong count");
+            for(size_t i = 0; i < N; ++i)
+            {
+                if(!timespec_eq(out[i], timespec_normalise(in[i])) || !timespec_eq(out[i], timespec_normalise(out[i])))
+                {
+                    printf("kind %d block %u: stamp %zu decoded as {%ld, %ld}, expected {%ld, %ld}\n",
+                        kind, (unsigned)(block_size), i, (long)(out[i].tv_sec), out[i].tv_nsec,
+                        (long)(in[i].tv_sec), in[i].tv_nsec);
+                    result = 1;
+                    break;
+                }
+            }
+
+            // Block decode and random access
+
+            size_t b = timespec_codec_blocks(codec) / 2;
+            size_t got = timespec_codec_decode_block_ns(codec, b, out_ns);
+            CHECK(got == block_size || b == timespec_codec_blocks(codec) - 1, "block decode returned %zu", got);
+            CHECK(out_ns[0] == timespec_ns_from_timespec(in[b * block_size]), "block decode is wrong");
+            CHECK(timespec_codec_decode_block(codec, timespec_codec_blocks(codec), out) == 0,
+                "decoding a block past the end succeeded");
+
+            for(int i = 0; i < 100; ++i)
+            {
+                size_t index = (size_t)(random_range(0, N - 1));
+                struct timespec one;
+
+                CHECK(timespec_codec_get(codec, index, &one) && timespec_eq(one, timespec_normalise(in[index])),
+                    "random access to %zu is wrong", index);
+            }
+
+            struct timespec one;
+            CHECK(!timespec_codec_get(codec, N, &one), "random access past the end succeeded");
+            CHECK(timespec_codec_decode(codec, N - 5, out, 10) == 5, "decode past the end returned the wrong count");
+
+            // Reload from bytes and carry on appending
+
+            size_t len;
+            const void *data = timespec_codec_data(codec, &len);
+            struct timespec_codec *copy = timespec_codec_load(data, len);
+
+            CHECK(copy != NULL, "reload failed");
+            if(copy != NULL)
+            {
+                CHECK(timespec_codec_count(copy) == N, "reload count is wrong");
+                CHECK(timespec_codec_append(codec, ts(1,0)) && timespec_codec_append(copy, ts(1,0))
+                    && timespec_codec_append(codec, ts(2,5)) && timespec_codec_append(copy, ts(2,5)),
+                    "append after reload failed");
+
+                size_t copy_len;
+                data = timespec_codec_data(codec, &len);
+                const void *copy_data = timespec_codec_data(copy, &copy_len);
+                CHECK(len == copy_len && memcmp(data, copy_data, len) == 0,
+                    "appending to a reloaded stream encoded differently");
+
+                timespec_codec_destroy(copy);
+            }
+
+            // Compression
+
+            if(kind == 0 && block_size >= 512)
+            {
+                CHECK(len < N / 4, "periodic stamps took %zu bytes", len);
+            }
+            else if(kind == 1 && block_size >= 512)
+            {
+                CHECK(len < N * 3, "jittered stamps took %zu bytes", len);
+            }
+
+            timespec_codec_destroy(codec);
+        }
+    }
+
+    // Extremes
+
+    struct timespec_codec *codec = timespec_codec_create(16);
+    timespec_ns extremes[] = { TIMESPEC_NS_MAX, TIMESPEC_NS_MIN, 0, TIMESPEC_NS_MAX, -1, TIMESPEC_NS_MIN, 1 };
+    for(size_t i = 0; i < sizeof(extremes) / sizeof(*extremes); ++i)
+    {
+        timespec_codec_append_ns(codec, extremes[i]);
+    }
+    CHECK(timespec_codec_decode_block_ns(codec, 0, out_ns) == sizeof(extremes) / sizeof(*extremes)
+        && memcmp(out_ns, extremes, sizeof(extremes)) == 0, "extreme values did not round trip");
+
+    errno = 0;
+    CHECK(!timespec_codec_append(codec, ts(9300000000L, 0)) && errno == ERANGE, "out of range stamp accepted");
+    CHECK(timespec_codec_count(codec) == sizeof(extremes) / sizeof(*extremes), "rejected stamp was counted");
+
+    // Corrupt streams are rejected
+
+    size_t len;
+    unsigned char *bytes = malloc(N * 16);
+    memcpy(bytes, timespec_codec_data(codec, &len), len);
+
+    CHECK(timespec_codec_load(bytes, len - 1) == NULL && errno == EINVAL, "truncated stream accepted");
+    bytes[0] = 'X';
+    CHECK(timespec_codec_load(bytes, len) == NULL, "bad magic accepted");
+    bytes[0] = 'T';
+    bytes[8] = 200;
+    CHECK(timespec_codec_load(bytes, len) == NULL, "oversized block accepted");
+
+    struct timespec_codec *padded = timespec_codec_create(16);
+    for(int i = 1; i <= 4; ++i)
+    {
+        /* The first stamp is in the header, then 15 bits and 1 each: 17 bits of payload. */
+        timespec_codec_append_ns(padded, i * 1000);
+    }
+    memcpy(bytes, timespec_codec_data(padded, &len), len);
+    bytes[len - 1] |= 1;
+    CHECK(timespec_codec_load(bytes, len) == NULL && errno == EINVAL, "set padding bits accepted");
+    timespec_codec_destroy(padded);
+
+    for(int i = 0; i < 2000; ++i)
+    {
+        /* Random corruption must never crash or read out of bounds. */
+        memcpy(bytes, timespec_codec_data(codec, &len), len);
+        bytes[random_range(8, (long)(len) - 1)] ^= (unsigned char)(1 << random_range(0, 7));
+        timespec_codec_destroy(timespec_codec_load(bytes, len));
+    }
+
+    free(bytes);
+    timespec_codec_destroy(codec);
+    timespec_codec_destroy(NULL);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file timespecConverterTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+#include <timespec_converter.h>
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static struct timespec ts(long sec, long nsec)
+{
+	struct timespec ts = { .tv_sec = sec, .tv_nsec = nsec };
+	return ts;
+}
+
+static int ts_is(struct timespec got, long sec, long nsec)
+{
+	return got.tv_sec == sec && got.tv_nsec == nsec;
+}
+
+int main()
+{
+    static const uint32_t rates[][2] = {
+        { 1, 1 }, { 1000, 1 }, { 1000000, 1 }, { 90000, 1 }, { 30000, 1001 }, { 48000, 1 },
+        { 2400000000U, 1 }, { 4294967295U, 1 }, { 1, 4294967295U }, { 3, 7 }, { 1073741824, 4 },
+    };
+
+    struct timespec_converter conv;
+    int result = 0;
+
+    // Initialisation
+
+    CHECK(!timespec_converter_init(&conv, 0, 1), "zero numerator accepted");
+    CHECK(!timespec_converter_init(&conv, 1, 0), "zero denominator accepted");
+    CHECK(!timespec_converter_init(&conv, 4294967295U, 4294967295U), "oversized ratio accepted");
+
+    // Known values
+
+    timespec_converter_init(&conv, 90000, 1);
+    CHECK(timespec_converter_to_ticks(&conv, ts(1,500000000)) == 135000, "90kHz 1.5s is wrong");
+    CHECK(timespec_converter_to_ticks(&conv, ts(0,11111)) == 0, "90kHz below one tick is not zero");
+    CHECK(timespec_converter_to_ticks(&conv, ts(0,11112)) == 1, "90kHz one tick is wrong");
+    CHECK(timespec_converter_to_ticks(&conv, ts(-1,-500000000)) == -135000, "90kHz -1.5s is wrong");
+    CHECK(timespec_converter_to_ticks(&conv, ts(-2,500000000)) == -135000, "90kHz unnormalised is wrong");
+    CHECK(ts_is(timespec_converter_from_ticks(&conv, 1), 0,11111), "90kHz from one tick is wrong");
+    CHECK(ts_is(timespec_converter_from_ticks(&conv, -135001), -1,-500011111), "90kHz from negative is wrong");
+
+    timespec_converter_init(&conv, 30000, 1001);
+    CHECK(timespec_converter_to_ticks(&conv, ts(1001,0)) == 30000, "NTSC 1001s is wrong");
+    CHECK(ts_is(timespec_converter_from_ticks(&conv, 1), 0,33366666), "NTSC one frame is wrong");
+
+#if (64 <= __WORDSIZE)
+    timespec_converter_init(&conv, 4294967295U, 1);
+    CHECK(timespec_converter_to_ticks(&conv, ts(9223372036854775807L,0)) == INT64_MAX, "to ticks did not saturate");
+    CHECK(timespec_converter_to_ticks(&conv, ts(-9223372036854775807L,0)) == -INT64_MAX,
+        "to ticks did not saturate negative");
+
+    timespec_converter_init(&conv, 1, 4294967295U);
+    CHECK(ts_is(timespec_converter_from_ticks(&conv, INT64_MAX), 9223372036854775807L,999999999),
+        "from ticks did not saturate");
+#endif
+
+#ifdef __SIZEOF_INT128__
+    /* Random values at every rate against a direct 128-bit computation. */
+
+    __extension__ typedef __int128 i128;
+
+    srand(1);
+    for(size_t r = 0; r < sizeof(rates) / sizeof(*rates); ++r)
+    {
+        int64_t num = rates[r][0], den = rates[r][1];
+
+        CHECK(timespec_converter_init(&conv, rates[r][0], rates[r][1]), "%lld/%lld rejected",
+            (long long)(num), (long long)(den));
+
+        for(int i = 0; i < 100000; ++i)
+        {
+            long sec = (long)(((unsigned long)(rand()) << 16 ^ (unsigned long)(rand())) % 2000000001) - 1000000000;
+            long nsec = (sec < 0 ? -1 : 1) * (long)(rand() % 1000000000);
+            int64_t ticks = ((int64_t)(rand()) << 32 ^ rand()) - ((int64_t)(RAND_MAX) << 31);
+
+            i128 expect_ticks = ((i128)(sec) * 1000000000 + nsec) * num / ((i128)(den) * 1000000000);
+            i128 expect_ns = (i128)(ticks) * den * 1000000000 / num;
+
+            if(expect_ticks > INT64_MAX || expect_ticks < -INT64_MAX || expect_ns / 1000000000 > INT64_MAX
+                || expect_ns / 1000000000 < -INT64_MAX)
+            {
+                continue;
+            }
+
+            int64_t got_ticks = timespec_converter_to_ticks(&conv, ts(sec,nsec));
+            struct timespec got_ts = timespec_converter_from_ticks(&conv, ticks);
+
+            if(got_ticks != expect_ticks)
+            {
+                printf("%lld/%lld: {%ld, %ld} converted to %lld ticks, expected %lld\n",
+                    (long long)(num), (long long)(den), sec, nsec, (long long)(got_ticks),
+                    (long long)(expect_ticks));
+                result = 1;
+                break;
+            }
+
+            if((i128)(got_ts.tv_sec) * 1000000000 + got_ts.tv_nsec != expect_ns
+                || !ts_is(timespec_normalise(got_ts), got_ts.tv_sec, got_ts.tv_nsec))
+            {
+                printf("%lld/%lld: %lld ticks converted to {%ld, %ld}\n", (long long)(num), (long long)(den),
+                    (long long)(ticks), (long)(got_ts.tv_sec), got_ts.tv_nsec);
+                result = 1;
+                break;
+            }
+        }
+    }
+#endif
+
+    // Arrays
+
+    {
+        struct timespec in[3] = { ts(0,0), ts(1,0), ts(-2,-500000) };
+        int64_t ticks[3];
+        struct timespec back[3];
+
+        timespec_converter_init(&conv, 1000, 1);
+        timespec_converter_to_ticks_array(&conv, ticks, in, 3);
+        timespec_converter_from_ticks_array(&conv, back, ticks, 3);
+
+        CHECK(ticks[0] == 0 && ticks[1] == 1000 && ticks[2] == -2000, "array to ticks is wrong");
+        CHECK(ts_is(back[1], 1,0) && ts_is(back[2], -2,0), "array from ticks is wrong");
+    }
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,153 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+#include <timespec_histogram.h>
+
+#define THREADS     4
+#define PER_THREAD  200000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+/* True if got is no smaller than expect and within 1/128 above it. */
+static int close_to(struct timespec got, timespec_ns expect)
+{
+	timespec_ns ns = timespec_ns_from_timespec(got);
+	return ns >= expect && ns - expect <= expect / 128;
+}
+
+static struct timespec_histogram global;
+static struct timespec_histogram local[THREADS];
+
+static void *recorder(void *arg)
+{
+	struct timespec_histogram *h = arg;
+
+	for(long i = 1; i <= PER_THREAD; ++i)
+	{
+		struct timespec start = { .tv_sec = 100, .tv_nsec = 0 };
+		struct timespec end = timespec_add(start, timespec_ns_to_timespec(i * 1000));
+		timespec_histogram_record(h, timespec_sub(end, start));
+	}
+
+	return NULL;
+}
+
+int main()
+{
+    static struct timespec_histogram h, copy;
+    static unsigned char buf[TIMESPEC_HISTOGRAM_SERIALISED_MAX];
+    int result = 0;
+
+    // Empty histogram
+
+    timespec_histogram_init(&h);
+    CHECK(timespec_histogram_count(&h) == 0, "empty histogram has a count");
+    CHECK(timespec_ns_from_timespec(timespec_histogram_percentile(&h, 50)) == 0, "empty p50 is not zero");
+    CHECK(timespec_ns_from_timespec(timespec_histogram_max(&h)) == 0, "empty max is not zero");
+
+    // Uniform 1us..10ms
+
+    for(long i = 1; i <= 10000; ++i)
+    {
+        timespec_histogram_record_ns(&h, i * 1000);
+    }
+
+    CHECK(timespec_histogram_count(&h) == 10000, "count is %llu, expected 10000",
+        (unsigned long long)(timespec_histogram_count(&h)));
+    CHECK(close_to(timespec_histogram_percentile(&h, 50), 5000000), "p50 is wrong");
+    CHECK(close_to(timespec_histogram_percentile(&h, 99), 9900000), "p99 is wrong");
+    CHECK(close_to(timespec_histogram_percentile(&h, 99.9), 9990000), "p99.9 is wrong");
+    CHECK(timespec_ns_from_timespec(timespec_histogram_percentile(&h, 100)) == 10000000, "p100 is not the max");
+    CHECK(timespec_ns_from_timespec(timespec_histogram_percentile(&h, 0)) == 1000, "p0 is not the min");
+    CHECK(timespec_ns_from_timespec(timespec_histogram_max(&h)) == 10000000, "max is wrong");
+    CHECK(timespec_ns_from_timespec(timespec_histogram_min(&h)) == 1000, "min is wrong");
+
+    // Small values are exact, negative values count as zero, huge values keep an exact max
+
+    timespec_histogram_init(&h);
+    timespec_histogram_record_ns(&h, 3);
+    timespec_histogram_record_ns(&h, -50);
+    timespec_histogram_record(&h, timespec_from_double(36000.0));
+    CHECK(timespec_ns_from_timespec(timespec_histogram_percentile(&h, 50)) == 3, "small value is not exact");
+    CHECK(timespec_ns_from_timespec(timespec_histogram_min(&h)) == 0, "negative duration did not count as zero");
+    CHECK(timespec_eq(timespec_histogram_max(&h), timespec_from_double(36000.0)), "huge max is not exact");
+
+    // Serialisation round trip
+
+    for(long i = 1; i <= 10000; i += 7)
+    {
+        timespec_histogram_record_ns(&h, i * i * 1000);
+    }
+
+    size_t len = timespec_histogram_serialise(&h, buf, sizeof(buf));
+    CHECK(len > 0, "timespec_histogram_serialise failed");
+    CHECK(timespec_histogram_serialise(&h, buf, len - 1) == 0, "serialise into a short buffer succeeded");
+    len = timespec_histogram_serialise(&h, buf, sizeof(buf));
+    CHECK(timespec_histogram_deserialise(&copy, buf, len), "timespec_histogram_deserialise failed");
+    CHECK(timespec_histogram_count(&copy) == timespec_histogram_count(&h), "round trip changed the count");
+    for(double p = 0; p <= 100; p += 0.5)
+    {
+        CHECK(timespec_eq(timespec_histogram_percentile(&copy, p), timespec_histogram_percentile(&h, p)),
+            "round trip changed p%g", p);
+    }
+    CHECK(timespec_eq(timespec_histogram_min(&copy), timespec_histogram_min(&h)), "round trip changed min");
+    CHECK(timespec_eq(timespec_histogram_max(&copy), timespec_histogram_max(&h)), "round trip changed max");
+    CHECK(!timespec_histogram_deserialise(&copy, buf, len - 1), "truncated snapshot was accepted");
+    buf[0] = 'X';
+    CHECK(!timespec_histogram_deserialise(&copy, buf, len), "bad magic was accepted");
+
+    // Per-thread recording drained concurrently into a global view
+
+    pthread_t threads[THREADS];
+    timespec_histogram_init(&global);
+    for(int i = 0; i < THREADS; ++i)
+    {
+        timespec_histogram_init(&local[i]);
+        pthread_create(&threads[i], NULL, recorder, &local[i]);
+    }
+
+    for(int round = 0; round < 20; ++round)
+    {
+        for(int i = 0; i < THREADS; ++i)
+        {
+            timespec_histogram_drain(&global, &local[i]);
+        }
+    }
+
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        timespec_histogram_drain(&global, &local[i]);
+        CHECK(timespec_histogram_count(&local[i]) == 0, "drained histogram is not empty");
+    }
+
+    CHECK(timespec_histogram_count(&global) == (uint64_t)(THREADS) * PER_THREAD,
+        "global count is %llu, expected %llu", (unsigned long long)(timespec_histogram_count(&global)),
+        (unsigned long long)(THREADS) * PER_THREAD);
+    CHECK(close_to(timespec_histogram_percentile(&global, 50), PER_THREAD / 2 * 1000), "global p50 is wrong");
+
+    // Merge leaves the source intact
+
+    timespec_histogram_init(&h);
+    timespec_histogram_merge(&h, &global);
+    timespec_histogram_merge(&h, &global);
+    CHECK(timespec_histogram_count(&h) == 2 * timespec_histogram_count(&global), "merge count is wrong");
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
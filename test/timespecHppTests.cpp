@@ -0,0 +1,153 @@
+/**
+ * @file timespecHppTests.cpp
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+#include <timespec.hpp>
+#include <timespec_clock.h>
+
+#define TRIALS 1000000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+using dan::timespec_value;
+using namespace std::chrono;
+
+/* Everything must fold at compile time. */
+static_assert(timespec_value(1, 1500000000) == timespec_value(2, 500000000), "normalise carries");
+static_assert(timespec_value(1, -500000000).nsec() == 500000000, "normalise borrows");
+static_assert(timespec_value(-1, 500000000).sec() == 0, "normalise gives back");
+static_assert(timespec_value(0, 999999999) + timespec_value(0, 1) == timespec_value(1, 0), "addition carries");
+static_assert(timespec_value(1, 0) - timespec_value(2, 500000000) == timespec_value(-1, -500000000),
+	"subtraction crosses zero");
+static_assert(-timespec_value(1, 5) == timespec_value(-1, -5), "negation");
+static_assert(timespec_value(-1, -500000000) < timespec_value(0, -500000000), "ordering of negatives");
+static_assert(timespec_value(0, -1) < timespec_value(0, 0) && timespec_value(0, 0) <= timespec_value(0, 0)
+	&& timespec_value(1, 0) > timespec_value(0, 999999999) && timespec_value(1, 0) != timespec_value(0, 0),
+	"comparison");
+static_assert(timespec_value(milliseconds(1500)) == timespec_value(1, 500000000), "from duration");
+static_assert(timespec_value(duration<double>(-0.25)) == timespec_value(0, -250000000), "from floating duration");
+static_assert(timespec_value(1, 999999999).to_duration<milliseconds>() == milliseconds(1999), "to duration");
+static_assert(timespec_value(seconds(1) + milliseconds(250)).to_ns() == 1250000000, "to_ns");
+static_assert(timespec_value(INT64_MAX, 0).to_ns() == TIMESPEC_NS_MAX, "to_ns saturates");
+static_assert(timespec_value::from_ns(-1500000000) == timespec_value(-1, -500000000), "from_ns");
+static_assert(timespec_value::from_timeval(timeval{ 2, -1 }).to_timeval().tv_usec == 999999, "timeval");
+static_assert(timespec_value(1, 0).to_time_point<system_clock>().time_since_epoch() == seconds(1), "time_point");
+
+#ifdef TIMESPEC_THREE_WAY_COMPARISON
+static_assert((timespec_value(0, -1) <=> timespec_value(0, 0)) < 0, "three way comparison");
+#endif
+
+static constexpr timespec_value period = timespec_value(0, 250000000) + milliseconds(10) - microseconds(5);
+static_assert(period.nsec() == 259995000, "constant folding");
+
+static long random_field(unsigned int *seed)
+{
+	/* A mix of normalised values, values with whole seconds in tv_nsec and
+	 * mixed signs.
+	*/
+	switch(rand_r(seed) % 4)
+	{
+		case 0:  return rand_r(seed) % 1000000000;
+		case 1:  return -(rand_r(seed) % 1000000000);
+		case 2:  return static_cast<long>(rand_r(seed)) * 3;
+		default: return -static_cast<long>(rand_r(seed)) * 3;
+	}
+}
+
+static struct timespec random_timespec(unsigned int *seed)
+{
+	struct timespec ts{};
+
+	ts.tv_sec  = (rand_r(seed) % 2001) - 1000;
+	ts.tv_nsec = random_field(seed);
+
+	return ts;
+}
+
+static bool same(struct timespec ts1, struct timespec ts2)
+{
+	return ts1.tv_sec == ts2.tv_sec && ts1.tv_nsec == ts2.tv_nsec;
+}
+
+int main()
+{
+    unsigned int seed = 1;
+    int result = 0;
+
+    /* Agrees with the C library */
+
+    bool normalise = true, add = true, sub = true, compare = true, timeval = true, ns = true;
+
+    for(int i = 0; i < TRIALS; ++i)
+    {
+        struct timespec ts1 = random_timespec(&seed);
+        struct timespec ts2 = random_timespec(&seed);
+        timespec_value v1(ts1), v2(ts2);
+
+        normalise &= same(v1, timespec_normalise(ts1));
+        add &= same(v1 + v2, timespec_add(ts1, ts2));
+        sub &= same(v1 - v2, timespec_sub(ts1, ts2));
+
+        compare &= (v1 == v2) == timespec_eq(timespec_normalise(ts1), timespec_normalise(ts2));
+        compare &= (v1 < v2) == timespec_lt(timespec_normalise(ts1), timespec_normalise(ts2));
+        compare &= (v1 <= v2) == timespec_le(timespec_normalise(ts1), timespec_normalise(ts2));
+        compare &= (v1 > v2) == timespec_gt(timespec_normalise(ts1), timespec_normalise(ts2));
+        compare &= (v1 >= v2) == timespec_ge(timespec_normalise(ts1), timespec_normalise(ts2));
+
+        struct timeval tv = timespec_to_timeval(ts1);
+        timeval &= tv.tv_sec == v1.to_timeval().tv_sec && tv.tv_usec == v1.to_timeval().tv_usec;
+        timeval &= timespec_value::from_timeval(tv) == timespec_from_timeval(tv);
+
+        ns &= v1.to_ns() == timespec_ns_from_timespec(ts1);
+        ns &= timespec_value::from_ns(v1.to_ns()) == v1;
+        ns &= v1.to_duration().count() == v1.to_ns();
+        ns &= timespec_value(v1.to_duration()) == v1;
+    }
+
+    CHECK(normalise, "normalisation differs from timespec_normalise()");
+    CHECK(add, "addition differs from timespec_add()");
+    CHECK(sub, "subtraction differs from timespec_sub()");
+    CHECK(compare, "comparison differs from the C functions");
+    CHECK(timeval, "timeval conversion differs from the C functions");
+    CHECK(ns, "nanosecond conversion is wrong");
+
+    /* Clock epochs */
+
+    timespec_value before = timespec_now(CLOCK_REALTIME);
+    timespec_value now = system_clock::now();
+    timespec_value after = timespec_now(CLOCK_REALTIME);
+    CHECK(before - microseconds(1) <= now && now <= after + microseconds(1),
+        "system_clock does not match CLOCK_REALTIME");
+
+    before = timespec_now(CLOCK_MONOTONIC);
+    now = steady_clock::now();
+    after = timespec_now(CLOCK_MONOTONIC);
+    CHECK(before - microseconds(1) <= now && now <= after + microseconds(1),
+        "steady_clock does not match CLOCK_MONOTONIC");
+
+    CHECK(timespec_value(now.to_time_point<steady_clock>()) == now, "time_point round trip failed");
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
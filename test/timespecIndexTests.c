@@ -0,0 +1,176 @@
+/**
+ * @file timespecIndexTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_index.h>
+
+#define QUERIES 2000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static size_t reference(const struct timespec *a, size_t n, struct timespec ts, bool upper)
+{
+	size_t lo = 0, hi = n;
+
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if(upper ? timespec_le(a[mid], ts) : timespec_lt(a[mid], ts))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/* Sorted values with runs of duplicates, from start in random steps. */
+static void make_array(struct timespec *a, size_t n, timespec_ns start, timespec_ns max_step, unsigned int *seed)
+{
+	timespec_ns t = start;
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		t += (rand_r(seed) % 3 == 0) ? 0 : (timespec_ns)(rand_r(seed)) % max_step;
+		a[i] = timespec_ns_to_timespec(t);
+	}
+}
+
+static struct timespec query(const struct timespec *a, size_t n, unsigned int *seed)
+{
+	struct timespec ts = (n > 0) ? a[(size_t)(rand_r(seed)) % n] : timespec_ns_to_timespec(0);
+
+	switch(rand_r(seed) % 5)
+	{
+		case 0:
+			return ts;
+
+		case 1:
+			return timespec_add(ts, timespec_ns_to_timespec(1));
+
+		case 2:
+			return timespec_sub(ts, timespec_ns_to_timespec(1));
+
+		case 3:
+			return timespec_add(ts, timespec_ns_to_timespec((timespec_ns)(rand_r(seed)) - RAND_MAX / 2));
+
+		default:
+			return timespec_normalise((struct timespec){ .tv_sec = (rand_r(seed) % 2) ? INT64_MAX : INT64_MIN,
+				.tv_nsec = rand_r(seed) % 1000000000 });
+	}
+}
+
+static int check_index(const struct timespec *a, size_t n, unsigned int *seed, const char *name)
+{
+	struct timespec_index *idx = timespec_index_create(a, n);
+	struct timespec queries[QUERIES];
+	size_t batch[QUERIES];
+	bool lower = true, upper = true, range = true, batched = true;
+	int result = 0;
+
+	CHECK(idx != NULL && timespec_index_size(idx) == n, "%s %zu: create failed", name, n);
+	if(idx == NULL)
+	{
+		return result;
+	}
+
+	for(size_t i = 0; i < QUERIES; ++i)
+	{
+		queries[i] = query(a, n, seed);
+	}
+
+	timespec_index_lower_bound_batch(idx, queries, QUERIES, batch);
+
+	for(size_t i = 0; i < QUERIES; ++i)
+	{
+		struct timespec to = query(a, n, seed);
+		size_t expected_lower = reference(a, n, queries[i], false);
+		size_t expected_to = reference(a, n, to, false);
+		size_t first = SIZE_MAX;
+		size_t count = timespec_index_range(idx, queries[i], to, &first);
+
+		lower &= timespec_index_lower_bound(idx, queries[i]) == expected_lower;
+		upper &= timespec_index_upper_bound(idx, queries[i]) == reference(a, n, queries[i], true);
+		range &= first == expected_lower && count == ((expected_to > expected_lower) ? expected_to - expected_lower : 0);
+		batched &= batch[i] == expected_lower;
+	}
+
+	CHECK(lower, "%s %zu: lower bound is wrong", name, n);
+	CHECK(upper, "%s %zu: upper bound is wrong", name, n);
+	CHECK(range, "%s %zu: range is wrong", name, n);
+	CHECK(batched, "%s %zu: batched lower bound is wrong", name, n);
+
+	timespec_index_destroy(idx);
+
+	return result;
+}
+
+int main()
+{
+    /* Around the node size and the sizes at which the tree gains a layer. */
+    size_t sizes[] = { 0, 1, 2, 15, 16, 17, 100, 16 * 17, 16 * 17 + 1, 16 * 17 * 17 + 5, 100000 };
+    struct timespec *a = malloc(100000 * sizeof(*a));
+    unsigned int seed = 1;
+    int result = 0;
+
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s)
+    {
+        /* Capture times now, times around zero with negative tv_nsec, and
+         * steps of a second or more.
+        */
+        make_array(a, sizes[s], INT64_C(1700000000000000000), 5000, &seed);
+        result |= check_index(a, sizes[s], &seed, "recent");
+
+        make_array(a, sizes[s], -1000000 * (timespec_ns)(sizes[s]), 2000000, &seed);
+        result |= check_index(a, sizes[s], &seed, "around zero");
+
+        make_array(a, sizes[s], 0, INT64_C(3000000000), &seed);
+        result |= check_index(a, sizes[s], &seed, "seconds");
+    }
+
+    /* Spans too long for 64 bit keys fall back to binary search. */
+    make_array(a, 1000, 0, INT64_C(3000000000), &seed);
+    a[0] = (struct timespec){ .tv_sec = INT64_MIN + 1, .tv_nsec = -5 };
+    a[999] = (struct timespec){ .tv_sec = INT64_MAX - 1, .tv_nsec = 5 };
+    result |= check_index(a, 1000, &seed, "wide");
+    a[1] = a[999];
+    result |= check_index(a, 2, &seed, "wide");
+
+    a[0] = timespec_ns_to_timespec(5);
+    a[1] = timespec_ns_to_timespec(4);
+    CHECK(timespec_index_create(a, 2) == NULL && errno == EINVAL, "unsorted array accepted");
+
+    timespec_index_destroy(NULL);
+    free(a);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
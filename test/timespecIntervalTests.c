@@ -0,0 +1,396 @@
+/**
+ * @file timespecIntervalTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_interval.h>
+
+#define N        5000
+#define QUERIES  2000
+
+/* Sets are checked against a bitmap of this many nanoseconds. */
+#define DOMAIN   2048
+#define SET_OPS  3000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+struct entry
+{
+	struct timespec_interval interval;
+	bool present;
+};
+
+static struct entry entries[N];
+
+/* Sum of visited ids, to compare what the tree found with a linear search. */
+struct tally
+{
+	size_t count;
+	uint64_t sum;
+	size_t stop_after;
+	struct timespec last_start;
+	bool ordered;
+};
+
+static struct timespec ns(long n)
+{
+	return timespec_ns_to_timespec(n);
+}
+
+static struct timespec_interval interval(long start, long end)
+{
+	struct timespec_interval iv = { ns(start), ns(end) };
+	return iv;
+}
+
+static bool tally_visit(struct timespec_interval iv, void *data, void *arg)
+{
+	struct tally *t = arg;
+	size_t id = (size_t)((struct entry *)(data) - entries);
+
+	if(timespec_lt(iv.start, t->last_start) || !timespec_eq(iv.start, entries[id].interval.start)
+		|| !timespec_eq(iv.end, entries[id].interval.end))
+	{
+		t->ordered = false;
+	}
+	t->last_start = iv.start;
+
+	++(t->count);
+	t->sum += id * 2654435761u;
+
+	return t->count != t->stop_after;
+}
+
+static long random_below(long n)
+{
+	return (long)((((unsigned long)(rand()) << 31) ^ (unsigned long)(rand())) % (unsigned long)(n));
+}
+
+/* Fills bits with the contents of a set. */
+static void set_bits(const struct timespec_interval_set *set, bool *bits)
+{
+	memset(bits, 0, DOMAIN);
+	for(size_t i = 0; i < timespec_interval_set_count(set); ++i)
+	{
+		struct timespec_interval iv = timespec_interval_set_get(set, i);
+
+		for(timespec_ns t = timespec_ns_from_timespec(iv.start); t < timespec_ns_from_timespec(iv.end); ++t)
+		{
+			bits[t] = true;
+		}
+	}
+}
+
+/* Checks that a set is canonical: ordered, non-empty, non-touching intervals. */
+static bool set_canonical(const struct timespec_interval_set *set)
+{
+	for(size_t i = 0; i < timespec_interval_set_count(set); ++i)
+	{
+		struct timespec_interval iv = timespec_interval_set_get(set, i);
+
+		if(!timespec_lt(iv.start, iv.end))
+		{
+			return false;
+		}
+
+		if(i > 0 && !timespec_lt(timespec_interval_set_get(set, i - 1).end, iv.start))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void random_set(struct timespec_interval_set *set, bool *bits)
+{
+	memset(bits, 0, DOMAIN);
+	for(int i = 0; i < 40; ++i)
+	{
+		long start = random_below(DOMAIN), end = start + random_below(100);
+
+		if(end > DOMAIN)
+		{
+			end = DOMAIN;
+		}
+
+		timespec_interval_set_add(set, interval(start, end));
+		for(long t = start; t < end; ++t)
+		{
+			bits[t] = true;
+		}
+	}
+}
+
+int main()
+{
+    static bool expected[DOMAIN], actual[DOMAIN], other[DOMAIN];
+    int result = 0;
+
+    srand(1);
+
+    /* Tree against a linear search */
+
+    struct timespec_interval_tree *tree = timespec_interval_tree_create();
+
+    CHECK(!timespec_interval_tree_insert(tree, interval(5, 5), NULL) && errno == EINVAL, "empty interval inserted");
+    {
+        struct timespec huge = { .tv_sec = INT64_MAX / 1000, .tv_nsec = 0 };
+        struct timespec_interval iv = { ns(0), huge };
+        CHECK(!timespec_interval_tree_insert(tree, iv, NULL) && errno == ERANGE, "unrepresentable interval inserted");
+    }
+
+    for(int i = 0; i < N; ++i)
+    {
+        long start = random_below(1000000000L);
+        long length = (i % 10 == 0) ? random_below(100000000L) : 1 + random_below(1000000L);
+
+        /* Some exact duplicates, which are told apart by their data. */
+        entries[i].interval = (i % 100 == 1) ? entries[i - 1].interval : interval(start, start + length + 1);
+        entries[i].present = true;
+
+        CHECK(timespec_interval_tree_insert(tree, entries[i].interval, &entries[i]), "insert %d failed", i);
+    }
+
+    /* Remove a third, including one of each duplicate pair. */
+    for(int i = 0; i < N; i += 3)
+    {
+        CHECK(timespec_interval_tree_remove(tree, entries[i].interval, &entries[i]), "remove %d failed", i);
+        entries[i].present = false;
+    }
+    CHECK(!timespec_interval_tree_remove(tree, entries[0].interval, &entries[0]), "removed an interval twice");
+    CHECK(!timespec_interval_tree_remove(tree, entries[1].interval, &entries[0]), "removed with the wrong data");
+
+    /* Reinsert a few into freed nodes. */
+    for(int i = 0; i < N; i += 30)
+    {
+        CHECK(timespec_interval_tree_insert(tree, entries[i].interval, &entries[i]), "reinsert %d failed", i);
+        entries[i].present = true;
+    }
+
+    size_t present = 0;
+    for(int i = 0; i < N; ++i)
+    {
+        present += entries[i].present;
+    }
+    CHECK(timespec_interval_tree_count(tree) == present, "tree has %zu intervals, expected %zu",
+        timespec_interval_tree_count(tree), present);
+
+    for(int q = 0; q < QUERIES; ++q)
+    {
+        timespec_ns qs = random_below(1100000000L) - 50000000;
+        timespec_ns qe = qs + ((q % 2 == 0) ? 1 : random_below(5000000L));
+        struct tally t = { 0, 0, 0, ns(-1), true };
+        struct tally s = { 0, 0, 0, ns(-1), true };
+        size_t count = 0, stab_count = 0;
+        uint64_t sum = 0, stab_sum = 0;
+
+        for(int i = 0; i < N; ++i)
+        {
+            timespec_ns start = timespec_ns_from_timespec(entries[i].interval.start);
+            timespec_ns end = timespec_ns_from_timespec(entries[i].interval.end);
+
+            if(entries[i].present && start < qe && end > qs)
+            {
+                ++count;
+                sum += (uint64_t)(i) * 2654435761u;
+            }
+
+            if(entries[i].present && start <= qs && end > qs)
+            {
+                ++stab_count;
+                stab_sum += (uint64_t)(i) * 2654435761u;
+            }
+        }
+
+        size_t visited = timespec_interval_tree_overlap(tree, interval(qs, qe), tally_visit, &t);
+        CHECK(visited == count && t.count == count && t.sum == sum && t.ordered,
+            "overlap of %lld..%lld found %zu intervals, expected %zu", (long long)(qs), (long long)(qe), t.count,
+            count);
+
+        visited = timespec_interval_tree_stab(tree, ns(qs), tally_visit, &s);
+        CHECK(visited == stab_count && s.sum == stab_sum && s.ordered, "stab of %lld found %zu intervals, expected %zu",
+            (long long)(qs), s.count, stab_count);
+
+        CHECK(timespec_interval_tree_overlap(tree, interval(qs, qe), NULL, NULL) == count,
+            "counting overlaps without a visitor is wrong");
+
+        if(count > 2)
+        {
+            struct tally stop = { 0, 0, 2, ns(-1), true };
+            CHECK(timespec_interval_tree_overlap(tree, interval(qs, qe), tally_visit, &stop) == 2,
+                "visitor could not stop the query");
+        }
+    }
+
+    /* Touching is not overlapping. */
+    CHECK(timespec_interval_tree_overlap(tree, entries[1].interval, NULL, NULL) >= 1,
+        "an interval does not overlap itself");
+    {
+        struct timespec_interval_tree *small = timespec_interval_tree_create();
+        timespec_interval_tree_insert(small, interval(10, 20), NULL);
+        CHECK(timespec_interval_tree_overlap(small, interval(20, 30), NULL, NULL) == 0, "touching intervals overlap");
+        CHECK(timespec_interval_tree_overlap(small, interval(0, 10), NULL, NULL) == 0, "touching intervals overlap");
+        CHECK(timespec_interval_tree_overlap(small, interval(19, 30), NULL, NULL) == 1, "overlap missed");
+        CHECK(timespec_interval_tree_stab(small, ns(20), NULL, NULL) == 0, "end of an interval is inside it");
+        CHECK(timespec_interval_tree_stab(small, ns(10), NULL, NULL) == 1, "start of an interval is outside it");
+        timespec_interval_tree_destroy(small);
+    }
+
+    for(int i = 0; i < N; ++i)
+    {
+        if(entries[i].present)
+        {
+            timespec_interval_tree_remove(tree, entries[i].interval, &entries[i]);
+        }
+    }
+    CHECK(timespec_interval_tree_count(tree) == 0, "tree not empty after removing everything");
+    CHECK(timespec_interval_tree_stab(tree, ns(500000000), NULL, NULL) == 0, "empty tree stabbed");
+
+    timespec_interval_tree_destroy(tree);
+    timespec_interval_tree_destroy(NULL);
+
+    /* Set against a bitmap */
+
+    struct timespec_interval_set *set = timespec_interval_set_create();
+
+    memset(expected, 0, sizeof(expected));
+    for(int op = 0; op < SET_OPS; ++op)
+    {
+        long start = random_below(DOMAIN), end = start + random_below(64);
+
+        if(end > DOMAIN)
+        {
+            end = DOMAIN;
+        }
+
+        bool add = random_below(3) != 0;
+        bool ok = add ? timespec_interval_set_add(set, interval(start, end))
+            : timespec_interval_set_remove(set, interval(start, end));
+
+        CHECK(ok, "set operation %d failed", op);
+        for(long t = start; t < end; ++t)
+        {
+            expected[t] = add;
+        }
+    }
+
+    set_bits(set, actual);
+    CHECK(memcmp(actual, expected, DOMAIN) == 0, "set does not hold the expected times");
+    CHECK(set_canonical(set), "set intervals are not disjoint and ordered");
+
+    bool contains_ok = true;
+    for(long t = -1; t <= DOMAIN; ++t)
+    {
+        bool in = (t >= 0 && t < DOMAIN) ? expected[t] : false;
+        contains_ok &= timespec_interval_set_contains(set, ns(t)) == in;
+    }
+    CHECK(contains_ok, "set_contains disagrees with the bitmap");
+
+    /* Union and intersection */
+
+    for(int round = 0; round < 20; ++round)
+    {
+        struct timespec_interval_set *a = timespec_interval_set_create();
+        struct timespec_interval_set *b = timespec_interval_set_create();
+
+        random_set(a, expected);
+        random_set(b, other);
+
+        struct timespec_interval_set *u = timespec_interval_set_union(a, b);
+        struct timespec_interval_set *x = timespec_interval_set_intersection(a, b);
+        bool both[DOMAIN], either[DOMAIN];
+
+        for(int t = 0; t < DOMAIN; ++t)
+        {
+            either[t] = expected[t] || other[t];
+            both[t] = expected[t] && other[t];
+        }
+
+        set_bits(u, actual);
+        CHECK(memcmp(actual, either, DOMAIN) == 0 && set_canonical(u), "union is wrong");
+        set_bits(x, actual);
+        CHECK(memcmp(actual, both, DOMAIN) == 0 && set_canonical(x), "intersection is wrong");
+
+        timespec_interval_set_destroy(x);
+        timespec_interval_set_destroy(u);
+        timespec_interval_set_destroy(b);
+        timespec_interval_set_destroy(a);
+    }
+
+    /* Coalescing an array, with unnormalised and empty intervals mixed in */
+
+    {
+        struct timespec_interval intervals[200];
+        size_t n = 0;
+
+        memset(expected, 0, sizeof(expected));
+        for(int i = 0; i < 200; ++i)
+        {
+            long start = random_below(DOMAIN), end = start + random_below(40) - 5;
+
+            if(end > DOMAIN)
+            {
+                end = DOMAIN;
+            }
+
+            intervals[n] = interval(start, end);
+            if(i % 7 == 0)
+            {
+                intervals[n].end.tv_sec -= 1;
+                intervals[n].end.tv_nsec += 1000000000;
+            }
+            ++n;
+
+            for(long t = start; t < end; ++t)
+            {
+                expected[t] = true;
+            }
+        }
+
+        n = timespec_interval_coalesce(intervals, n);
+
+        struct timespec_interval_set *s = timespec_interval_set_create();
+        bool disjoint = true;
+
+        for(size_t i = 0; i < n; ++i)
+        {
+            disjoint &= timespec_lt(intervals[i].start, intervals[i].end);
+            disjoint &= (i == 0 || timespec_lt(intervals[i - 1].end, intervals[i].start));
+            timespec_interval_set_add(s, intervals[i]);
+        }
+
+        set_bits(s, actual);
+        CHECK(disjoint && timespec_interval_set_count(s) == n, "coalesced intervals are not disjoint and ordered");
+        CHECK(memcmp(actual, expected, DOMAIN) == 0, "coalesced intervals do not cover the same times");
+        timespec_interval_set_destroy(s);
+    }
+
+    timespec_interval_set_destroy(set);
+    timespec_interval_set_destroy(NULL);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file timespecLogTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <timespec.h>
+#include <timespec_log.h>
+
+#define N         20000
+#define PAGE      4096
+#define MAX_DATA  (PAGE - 16)
+#define QUERIES   2000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static timespec_ns times[2 * N];
+static uint32_t sizes[2 * N];
+
+static unsigned char payload_byte(size_t index, size_t offset)
+{
+	return (unsigned char)((index * 31 + offset) & 0xff);
+}
+
+/* Appends record index of the expected sequence. */
+static bool append(struct timespec_log_writer *writer, size_t index)
+{
+	static unsigned char data[MAX_DATA];
+
+	for(size_t j = 0; j < sizes[index]; ++j)
+	{
+		data[j] = payload_byte(index, j);
+	}
+
+	return timespec_log_append(writer, timespec_ns_to_timespec(times[index]), data, sizes[index]);
+}
+
+static bool record_matches(const struct timespec_log_record *record, size_t index)
+{
+	if(record->time != times[index] || record->size != sizes[index] || ((uintptr_t)(record->data) & 15) != 0)
+	{
+		return false;
+	}
+
+	for(size_t j = 0; j < record->size; ++j)
+	{
+		if(record->data[j] != payload_byte(index, j))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Returns the index of the first expected record at or after (or after) ns. */
+static size_t reference_bound(size_t n, timespec_ns ns, bool strict)
+{
+	size_t i = 0;
+
+	while(i < n && (strict ? times[i] <= ns : times[i] < ns))
+	{
+		++i;
+	}
+
+	return i;
+}
+
+/* Returns the index of a record in the log, by walking from the start. */
+static size_t index_of(const struct timespec_log_reader *reader, const struct timespec_log_record *record)
+{
+	size_t i = 0;
+
+	for(const struct timespec_log_record *r = timespec_log_first(reader); r != record && r != NULL;
+		r = timespec_log_next(reader, r))
+	{
+		++i;
+	}
+
+	return i;
+}
+
+struct writer_args
+{
+	struct timespec_log_writer *writer;
+	size_t from, to;
+};
+
+static void *writer_main(void *arg)
+{
+	struct writer_args *args = arg;
+
+	for(size_t i = args->from; i < args->to; ++i)
+	{
+		append(args->writer, i);
+	}
+
+	return NULL;
+}
+
+int main()
+{
+    char path[] = "/tmp/timespeclogXXXXXX";
+    int result = 0;
+
+    int fd = mkstemp(path);
+    if(fd < 0)
+    {
+        printf("Could not create a temporary file\n");
+        return 1;
+    }
+    close(fd);
+
+    srand(1);
+
+    /* Times rising in random steps with runs of duplicates, and sizes from
+     * empty to the largest that fits a page, so many pages end in padding.
+    */
+    times[0] = timespec_ns_from_timespec(timespec_from_ms(1792240496000L));
+    for(size_t i = 0; i < 2 * N; ++i)
+    {
+        if(i > 0)
+        {
+            times[i] = times[i - 1] + ((rand() % 4 == 0) ? 0 : rand() % 5000000);
+        }
+
+        switch(rand() % 8)
+        {
+            case 0:  sizes[i] = 0; break;
+            case 1:  sizes[i] = MAX_DATA - (uint32_t)(rand() % 64); break;
+            default: sizes[i] = (uint32_t)(rand() % 700); break;
+        }
+    }
+
+    CHECK(timespec_log_writer_open(path, 1000) == NULL && errno == EINVAL, "page size 1000 accepted");
+    CHECK(timespec_log_writer_open(path, 128) == NULL && errno == EINVAL, "page size 128 accepted");
+
+    struct timespec_log_writer *writer = timespec_log_writer_open(path, PAGE);
+    CHECK(writer != NULL, "writer_open failed: %s", strerror(errno));
+    if(writer == NULL)
+    {
+        unlink(path);
+        return 1;
+    }
+
+    CHECK(timespec_log_writer_open(path, PAGE) == NULL && errno == EBUSY, "second writer was not refused");
+
+    /* Empty log */
+
+    struct timespec_log_reader *reader = timespec_log_reader_open(path);
+    const struct timespec_log_record *begin, *end;
+
+    CHECK(reader != NULL, "reader_open failed: %s", strerror(errno));
+    CHECK(timespec_log_first(reader) == NULL, "empty log has a first record");
+    CHECK(timespec_log_lower_bound(reader, timespec_from_ms(0)) == NULL, "empty log has a lower bound");
+    CHECK(!timespec_log_range(reader, timespec_from_ms(0), timespec_from_ms(1), &begin, &end) && begin == end,
+        "empty log has a range");
+
+    /* Fill, then read back */
+
+    for(size_t i = 0; i < N; ++i)
+    {
+        if(!append(writer, i))
+        {
+            printf("append %zu failed: %s\n", i, strerror(errno));
+            result = 1;
+            break;
+        }
+    }
+
+    CHECK(!timespec_log_append_ns(writer, times[N - 1] - 1, "", 0) && errno == EINVAL, "out of order time accepted");
+    CHECK(!timespec_log_append_ns(writer, times[N - 1], "", MAX_DATA + 1) && errno == EINVAL,
+        "oversized record accepted");
+    CHECK(!timespec_log_append(writer, timespec_from_ms(9000000000000000L), "", 0) && errno == ERANGE,
+        "unrepresentable time accepted");
+
+    CHECK(timespec_log_first(reader) == NULL, "reader saw records before refresh");
+    CHECK(timespec_log_reader_refresh(reader), "refresh failed: %s", strerror(errno));
+
+    size_t count = 0;
+    for(const struct timespec_log_record *r = timespec_log_first(reader); r != NULL; r = timespec_log_next(reader, r))
+    {
+        if(count >= N || !record_matches(r, count))
+        {
+            printf("record %zu does not match\n", count);
+            result = 1;
+            break;
+        }
+
+        ++count;
+    }
+    CHECK(count == N, "read %zu records, expected %d", count, N);
+
+    /* Range queries against a linear search */
+
+    for(int q = 0; q < QUERIES; ++q)
+    {
+        timespec_ns span = times[N - 1] - times[0];
+        timespec_ns from, to;
+
+        if(q % 4 == 0)
+        {
+            /* An existing time, to exercise duplicates. */
+            from = times[rand() % N];
+        }
+        else
+        {
+            from = times[0] - span / 10 + (timespec_ns)(rand()) % (span + span / 5);
+        }
+        to = from + (timespec_ns)(rand() % 4 == 0 ? 0 : rand() % 100000000);
+
+        if(q % 50 == 0)
+        {
+            /* Reversed */
+            timespec_ns t = from;
+            from = to + 1;
+            to = t;
+        }
+
+        size_t lo = reference_bound(N, from, false);
+        size_t hi = reference_bound(N, to, true);
+        bool found = timespec_log_range(reader, timespec_ns_to_timespec(from), timespec_ns_to_timespec(to),
+            &begin, &end);
+
+        const struct timespec_log_record *lower = timespec_log_lower_bound(reader, timespec_ns_to_timespec(from));
+        const struct timespec_log_record *upper = timespec_log_upper_bound(reader, timespec_ns_to_timespec(to));
+
+        CHECK(lower == NULL ? lo == N : index_of(reader, lower) == lo, "lower_bound of %lld is wrong",
+            (long long)(from));
+        CHECK(upper == NULL ? hi == N : index_of(reader, upper) == hi, "upper_bound of %lld is wrong",
+            (long long)(to));
+
+        if(lo >= hi)
+        {
+            CHECK(!found && begin == end, "range %lld..%lld should be empty", (long long)(from), (long long)(to));
+            continue;
+        }
+
+        size_t i = lo;
+        for(const struct timespec_log_record *r = begin; r != end && r != NULL; r = timespec_log_next(reader, r))
+        {
+            if(i >= hi || !record_matches(r, i))
+            {
+                break;
+            }
+            ++i;
+        }
+        CHECK(found && i == hi, "range %lld..%lld returned the wrong records", (long long)(from), (long long)(to));
+    }
+
+    CHECK(timespec_log_upper_bound(reader, timespec_ns_to_timespec(times[N - 1])) == NULL,
+        "upper bound of the last time is not the end");
+    CHECK(timespec_log_lower_bound(reader, timespec_from_ms(0)) == timespec_log_first(reader),
+        "lower bound of an early time is not the first record");
+
+    /* Reopen the writer and carry on while the reader follows */
+
+    timespec_log_writer_close(writer);
+    writer = timespec_log_writer_open(path, 0);
+    CHECK(writer != NULL, "reopening the writer failed: %s", strerror(errno));
+    if(writer == NULL)
+    {
+        unlink(path);
+        return 1;
+    }
+    CHECK(!timespec_log_append_ns(writer, times[N - 1] - 1, "", 0) && errno == EINVAL,
+        "reopened writer accepted an out of order time");
+
+    struct writer_args args = { writer, N, 2 * N };
+    pthread_t thread;
+    pthread_create(&thread, NULL, writer_main, &args);
+
+    size_t seen = N;
+    while(seen < 2 * N)
+    {
+        if(!timespec_log_reader_refresh(reader))
+        {
+            printf("refresh failed: %s\n", strerror(errno));
+            result = 1;
+            break;
+        }
+
+        /* Everything visible must be complete and in order. */
+        count = 0;
+        for(const struct timespec_log_record *r = timespec_log_first(reader); r != NULL;
+            r = timespec_log_next(reader, r))
+        {
+            if(count >= 2 * N || !record_matches(r, count))
+            {
+                printf("record %zu does not match while writing\n", count);
+                result = 1;
+                break;
+            }
+            ++count;
+        }
+
+        if(count < seen)
+        {
+            printf("reader went from %zu records to %zu\n", seen, count);
+            result = 1;
+            break;
+        }
+        seen = count;
+    }
+
+    pthread_join(thread, NULL);
+    CHECK(timespec_log_writer_sync(writer), "sync failed: %s", strerror(errno));
+    timespec_log_writer_close(writer);
+
+    struct timespec_log_reader *second = timespec_log_reader_open(path);
+    CHECK(second != NULL && index_of(second, NULL) == 2 * N, "a new reader does not see every record");
+    timespec_log_reader_close(second);
+
+    timespec_log_reader_close(reader);
+    timespec_log_reader_close(NULL);
+    timespec_log_writer_close(NULL);
+
+    /* Not a log */
+
+    FILE *f = fopen(path, "w");
+    fputs("not a timestamp log, just some text which is long enough to hold a header", f);
+    fclose(f);
+
+    CHECK(timespec_log_reader_open(path) == NULL && errno == EINVAL, "reader accepted a file which is not a log");
+    CHECK(timespec_log_writer_open(path, 0) == NULL && errno == EINVAL, "writer accepted a file which is not a log");
+
+    unlink(path);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,278 @@
+/**
+ * @file timespecMergeTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_merge.h>
+
+#define STREAMS 13
+#define RECORDS 5000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+/* Packed so the key is unaligned. */
+struct record
+{
+	char tag;
+	struct timespec time;
+	uint32_t stream;
+	uint32_t seq;
+} __attribute__((packed));
+
+static struct timespec time_of(const struct record *r)
+{
+	struct timespec t;
+
+	memcpy(&t, &r->time, sizeof(t));
+
+	return t;
+}
+
+/* Orders by time then stream, then position, the order a stable merge gives. */
+static int compare_records(const void *a, const void *b)
+{
+	const struct record *x = a, *y = b;
+
+	if(timespec_lt(time_of(x), time_of(y)))
+	{
+		return -1;
+	}
+	else if(timespec_gt(time_of(x), time_of(y)))
+	{
+		return 1;
+	}
+	else if(x->stream != y->stream)
+	{
+		return (x->stream < y->stream) ? -1 : 1;
+	}
+
+	return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+/* Sorted records with many equal times across streams, some negative. */
+static struct record *make_stream(uint32_t stream, size_t n, unsigned int *seed)
+{
+	struct record *records = malloc(n * sizeof(*records));
+	timespec_ns t = -1000000;
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		t += (rand_r(seed) % 4 == 0) ? 0 : rand_r(seed) % 3000;
+
+		struct timespec ts = timespec_ns_to_timespec(t);
+
+		records[i].tag = 'r';
+		memcpy(&records[i].time, &ts, sizeof(ts));
+		records[i].stream = stream;
+		records[i].seq = (uint32_t)(i);
+	}
+
+	return records;
+}
+
+/* A stream generated on the fly rather than held in memory. */
+struct counter
+{
+	struct record current;
+	uint32_t left;
+	uint32_t step;
+};
+
+static const void *counter_next(void *arg)
+{
+	struct counter *c = arg;
+	struct timespec t = time_of(&c->current);
+
+	if(c->left == 0)
+	{
+		return NULL;
+	}
+
+	--(c->left);
+	++(c->current.seq);
+	t = timespec_add(t, timespec_ns_to_timespec(c->step));
+	memcpy(&c->current.time, &t, sizeof(t));
+
+	return &c->current;
+}
+
+int main()
+{
+    struct timespec_merge_input inputs[STREAMS];
+    size_t sizes[STREAMS], total = 0;
+    unsigned int seed = 1;
+    int result = 0;
+
+    for(uint32_t i = 0; i < STREAMS; ++i)
+    {
+        /* Include an empty stream and one much longer than the rest. */
+        sizes[i] = (i == 3) ? 0 : (i == 7) ? RECORDS * 4 : (size_t)(rand_r(&seed) % RECORDS);
+        inputs[i].records = make_stream(i, sizes[i], &seed);
+        inputs[i].count = sizes[i];
+        total += sizes[i];
+    }
+
+    struct record *expected = malloc(total * sizeof(*expected));
+    struct record *out = malloc(total * sizeof(*out));
+    size_t n = 0;
+
+    for(size_t i = 0; i < STREAMS; ++i)
+    {
+        memcpy(expected + n, inputs[i].records, sizes[i] * sizeof(*expected));
+        n += sizes[i];
+    }
+    qsort(expected, total, sizeof(*expected), compare_records);
+
+    /* Serial merge of arrays */
+
+    struct timespec_merge *m = timespec_merge_create_arrays(inputs, STREAMS, sizeof(struct record),
+        offsetof(struct record, time), NULL, NULL);
+    const struct record *r;
+    size_t stream;
+    bool same = true, streams_right = true;
+
+    CHECK(m != NULL, "create_arrays failed");
+    for(n = 0; m != NULL && (r = timespec_merge_next(m, &stream)) != NULL; ++n)
+    {
+        same &= n < total && memcmp(r, &expected[n], sizeof(*r)) == 0;
+        streams_right &= stream == r->stream;
+    }
+    CHECK(n == total, "merged %zu records of %zu", n, total);
+    CHECK(same, "merged order differs from a stable sort");
+    CHECK(streams_right, "wrong stream index returned");
+    CHECK(m == NULL || timespec_merge_next(m, NULL) == NULL, "records after the end");
+    timespec_merge_destroy(m);
+
+    /* Time ranges */
+
+    struct timespec from = time_of(&expected[total / 3]), to = time_of(&expected[2 * total / 3]);
+    size_t first = 0, last = 0;
+
+    while(timespec_lt(time_of(&expected[first]), from))
+    {
+        ++first;
+    }
+    while(timespec_lt(time_of(&expected[last]), to))
+    {
+        ++last;
+    }
+
+    m = timespec_merge_create_arrays(inputs, STREAMS, sizeof(struct record), offsetof(struct record, time), &from, &to);
+    same = true;
+    for(n = first; (r = timespec_merge_next(m, NULL)) != NULL; ++n)
+    {
+        same &= n < last && memcmp(r, &expected[n], sizeof(*r)) == 0;
+    }
+    CHECK(same && n == last, "range merge is wrong");
+    timespec_merge_destroy(m);
+
+    m = timespec_merge_create_arrays(inputs, STREAMS, sizeof(struct record), offsetof(struct record, time), &to, &from);
+    CHECK(timespec_merge_next(m, NULL) == NULL, "empty range has records");
+    timespec_merge_destroy(m);
+
+    /* Splitting into balanced ranges */
+
+    for(size_t parts = 1; parts <= 9; ++parts)
+    {
+        struct timespec bounds[8];
+        bool balanced = true, ordered = true;
+
+        timespec_merge_split(inputs, STREAMS, sizeof(struct record), offsetof(struct record, time), bounds, parts);
+        for(size_t p = 0; p + 1 < parts; ++p)
+        {
+            size_t below = 0;
+
+            while(below < total && timespec_lt(time_of(&expected[below]), bounds[p]))
+            {
+                ++below;
+            }
+
+            /* Off the ideal only by runs of equal times. */
+            balanced &= below + 16 >= total * (p + 1) / parts && below <= total * (p + 1) / parts + 16;
+            ordered &= p == 0 || timespec_le(bounds[p - 1], bounds[p]);
+        }
+        CHECK(balanced, "%zu ranges are unbalanced", parts);
+        CHECK(ordered, "%zu range bounds are out of order", parts);
+    }
+
+    /* Parallel merge gives the same output as serial */
+
+    for(unsigned threads = 1; threads <= 8; ++threads)
+    {
+        memset(out, 0, total * sizeof(*out));
+        CHECK(timespec_merge_parallel(out, inputs, STREAMS, sizeof(struct record), offsetof(struct record, time),
+            threads), "parallel merge with %u threads failed", threads);
+        CHECK(memcmp(out, expected, total * sizeof(*out)) == 0, "parallel merge with %u threads is wrong", threads);
+    }
+
+    CHECK(!timespec_merge_parallel(out, inputs, STREAMS, 8, 1, 2) && errno == EINVAL, "key past the record accepted");
+    CHECK(timespec_merge_create_arrays(inputs, STREAMS, 20, 5, NULL, NULL) == NULL && errno == EINVAL,
+        "key past the record accepted");
+
+    /* Streams generated on the fly */
+
+    struct counter counters[3];
+    struct timespec_merge_stream streams[3];
+
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        struct timespec start = { .tv_sec = 0, .tv_nsec = i };
+
+        memset(&counters[i], 0, sizeof(counters[i]));
+        memcpy(&counters[i].current.time, &start, sizeof(start));
+        counters[i].current.stream = i;
+        counters[i].left = 1000;
+        counters[i].step = 3 * (i + 1);
+        streams[i].next = counter_next;
+        streams[i].arg = &counters[i];
+    }
+
+    struct timespec previous = { .tv_sec = 0, .tv_nsec = 0 };
+    bool ordered = true;
+
+    m = timespec_merge_create(streams, 3, offsetof(struct record, time));
+    for(n = 0; (r = timespec_merge_next(m, &stream)) != NULL; ++n)
+    {
+        ordered &= timespec_le(previous, time_of(r)) && r->stream == stream;
+        previous = time_of(r);
+    }
+    CHECK(n == 3000 && ordered, "merge of generated streams is wrong");
+    timespec_merge_destroy(m);
+
+    m = timespec_merge_create(streams, 0, 0);
+    CHECK(m != NULL && timespec_merge_next(m, NULL) == NULL, "merge of no streams has records");
+    timespec_merge_destroy(m);
+    timespec_merge_destroy(NULL);
+
+    for(size_t i = 0; i < STREAMS; ++i)
+    {
+        free((void*)(inputs[i].records));
+    }
+    free(expected);
+    free(out);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file timespecRateLimiterTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <timespec.h>
+#include <timespec_rate_limiter.h>
+
+#define THREADS     4
+#define PER_THREAD  100000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static struct timespec ms(long milliseconds)
+{
+	return timespec_from_ms(milliseconds);
+}
+
+static struct timespec_rate_limiter shared;
+static long granted[THREADS];
+
+/* Hammers the shared limiter at a fixed instant, so exactly the burst can be granted in total. */
+static void *acquirer(void *arg)
+{
+	long *count = arg;
+
+	for(long i = 0; i < PER_THREAD; ++i)
+	{
+		if(timespec_rate_limiter_try_acquire(&shared, ms(5000), 1))
+		{
+			++(*count);
+		}
+	}
+
+	return NULL;
+}
+
+int main()
+{
+    struct timespec_rate_limiter rl;
+    int result = 0;
+
+    // Initialisation
+
+    CHECK(!timespec_rate_limiter_init(&rl, ms(0), 1, ms(0)), "zero interval accepted");
+    CHECK(!timespec_rate_limiter_init(&rl, ms(-1), 1, ms(0)), "negative interval accepted");
+    CHECK(!timespec_rate_limiter_init(&rl, ms(1), 0, ms(0)), "zero burst accepted");
+
+    // One token every 10ms, bursts of 5, starting full
+
+    CHECK(timespec_rate_limiter_init(&rl, ms(10), 5, ms(1000)), "init failed");
+    CHECK(timespec_rate_limiter_available(&rl, ms(1000)) == 5, "bucket does not start full");
+    CHECK(timespec_rate_limiter_try_acquire(&rl, ms(1000), 3), "could not take 3 of 5");
+    CHECK(timespec_rate_limiter_try_acquire(&rl, ms(1000), 2), "could not take the last 2");
+    CHECK(!timespec_rate_limiter_try_acquire(&rl, ms(1000), 1), "took a token from an empty bucket");
+    CHECK(timespec_rate_limiter_available(&rl, ms(1000)) == 0, "empty bucket has tokens");
+    CHECK(timespec_eq(timespec_rate_limiter_wait(&rl, ms(1000), 1), ms(10)), "wait for one token is wrong");
+    CHECK(timespec_eq(timespec_rate_limiter_wait(&rl, ms(1000), 2), ms(20)), "wait for two tokens is wrong");
+
+    // Refill
+
+    CHECK(!timespec_rate_limiter_try_acquire(&rl, ms(1009), 1), "token available early");
+    CHECK(timespec_rate_limiter_try_acquire(&rl, ms(1010), 1), "token not available on time");
+    CHECK(!timespec_rate_limiter_try_acquire(&rl, ms(1019), 1), "second token available early");
+    CHECK(timespec_rate_limiter_available(&rl, ms(1040)) == 3, "refill after 30ms is wrong");
+
+    // Idle time does not accumulate more than the burst
+
+    CHECK(timespec_rate_limiter_available(&rl, ms(60000)) == 5, "idle bucket overflowed the burst");
+    CHECK(timespec_rate_limiter_try_acquire(&rl, ms(60000), 5), "could not take a full burst after idling");
+    CHECK(!timespec_rate_limiter_try_acquire(&rl, ms(60000), 1), "took more than the burst after idling");
+    CHECK(timespec_eq(timespec_rate_limiter_wait(&rl, ms(60000), 0), ms(0)), "waiting for nothing takes time");
+
+    // Requests larger than the burst never succeed, and rejected requests take nothing
+
+    CHECK(timespec_rate_limiter_init(&rl, ms(10), 5, ms(0)), "init failed");
+    CHECK(!timespec_rate_limiter_try_acquire(&rl, ms(0), 6), "took more than the burst");
+    CHECK(!timespec_rate_limiter_try_acquire(&rl, ms(100000), 6), "took more than the burst after idling");
+    CHECK(timespec_rate_limiter_available(&rl, ms(0)) == 5, "rejected request took tokens");
+    CHECK(timespec_rate_limiter_wait(&rl, ms(0), 6).tv_sec > 1000000000, "impossible request has a finite wait");
+
+    // Sub-millisecond intervals as timespec_div() of a period: 1000 per second
+
+    CHECK(timespec_rate_limiter_init(&rl, timespec_div(ms(1000), 1000), 1, ms(0)), "init failed");
+    long taken = 0;
+    for(long us = 0; us < 1000000; us += 250)
+    {
+        taken += timespec_rate_limiter_try_acquire_ns(&rl, us * 1000, 1);
+    }
+    CHECK(taken == 1000, "took %ld tokens in one second at 1000 per second", taken);
+
+    // Concurrent acquisition grants exactly the burst in total
+
+    pthread_t threads[THREADS];
+    timespec_rate_limiter_init(&shared, ms(1), 1000, ms(5000));
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_create(&threads[i], NULL, acquirer, &granted[i]);
+    }
+
+    long total = 0;
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        total += granted[i];
+    }
+    CHECK(total == 1000, "threads were granted %ld tokens, expected 1000", total);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file timespecSleepTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_sleep.h>
+
+/* Generous, so the tests do not fail on a loaded machine. */
+#define MAX_LATE_MS 50
+
+/* Long enough that an idle machine rarely misses a period. */
+#define PERIOD_MS   10
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+int main()
+{
+    int result = 0;
+
+    // Slack
+
+    struct timespec original = timespec_sleep_get_slack();
+    CHECK(timespec_gt(original, timespec_from_ms(0)), "default slack is not positive");
+
+    timespec_sleep_set_slack(timespec_from_double(0.000123));
+    CHECK(timespec_eq(timespec_sleep_get_slack(), timespec_from_double(0.000123)), "slack did not round trip");
+    timespec_sleep_set_slack(timespec_from_ms(-5));
+    CHECK(timespec_eq(timespec_sleep_get_slack(), timespec_from_ms(0)), "negative slack was not taken as zero");
+
+    // Sleeping with and without spinning never wakes early
+
+    for(int spin = 0; spin < 2; ++spin)
+    {
+        timespec_sleep_set_slack(spin ? timespec_from_ms(1) : timespec_from_ms(0));
+
+        for(int i = 0; i < 10; ++i)
+        {
+            struct timespec deadline = timespec_add(timespec_now(CLOCK_MONOTONIC), timespec_from_ms(2));
+
+            CHECK(timespec_sleep_until(CLOCK_MONOTONIC, deadline) == 0, "timespec_sleep_until failed");
+
+            struct timespec late = timespec_sub(timespec_now(CLOCK_MONOTONIC), deadline);
+            CHECK(late.tv_sec >= 0 && late.tv_nsec >= 0, "woke %ldns early", -late.tv_nsec);
+            CHECK(timespec_lt(late, timespec_from_ms(MAX_LATE_MS)), "woke %ldns late", late.tv_nsec);
+        }
+    }
+
+    struct timespec before = timespec_now(CLOCK_MONOTONIC);
+    CHECK(timespec_sleep_until(CLOCK_MONOTONIC, timespec_sub(before, timespec_from_ms(100))) == 0,
+        "sleeping until the past failed");
+    CHECK(timespec_lt(timespec_sub(timespec_now(CLOCK_MONOTONIC), before), timespec_from_ms(MAX_LATE_MS)),
+        "sleeping until the past did not return promptly");
+
+    CHECK(timespec_sleep_until((clockid_t)(-12345), before) == EINVAL, "invalid clock did not fail");
+
+    // Calibration
+
+    struct timespec slack = timespec_sleep_calibrate(CLOCK_MONOTONIC, 20);
+    CHECK(timespec_gt(slack, timespec_from_ms(0)), "calibrated slack is not positive");
+    /* Only a sanity bound: wake-up latency under load can be far above MAX_LATE_MS. */
+    CHECK(timespec_lt(slack, timespec_from_ms(1000)), "calibrated slack is implausibly large");
+    CHECK(timespec_eq(slack, timespec_sleep_get_slack()), "calibration did not set the slack");
+
+    errno = 0;
+    CHECK(timespec_sleep_calibrate((clockid_t)(-12345), 5).tv_sec == 0 && errno == EINVAL,
+        "calibrating an invalid clock did not fail");
+    CHECK(timespec_eq(slack, timespec_sleep_get_slack()), "failed calibration changed the slack");
+
+    // Periodic loop
+
+    struct timespec_periodic p;
+    CHECK(timespec_periodic_init(&p, CLOCK_MONOTONIC, timespec_from_ms(0)) == EINVAL, "zero period accepted");
+    CHECK(timespec_periodic_init(&p, CLOCK_MONOTONIC, timespec_from_ms(PERIOD_MS)) == 0,
+        "timespec_periodic_init failed");
+
+    /* A loaded machine may miss periods; those must be counted, and every
+     * deadline must stay on the original grid.
+    */
+    struct timespec first = p.next;
+    uint64_t missed = 0;
+    for(int i = 0; i < 10; ++i)
+    {
+        struct timespec deadline = p.next;
+
+        missed += timespec_periodic_wait(&p);
+        CHECK(timespec_ge(timespec_now(CLOCK_MONOTONIC), deadline), "periodic wait woke early");
+    }
+    CHECK(missed == p.overruns, "missed periods were not all counted");
+    CHECK(timespec_eq(p.next, timespec_add(first, timespec_from_ms(PERIOD_MS * (10 + (long)(p.overruns))))),
+        "periodic deadlines drifted");
+
+    /* Overrun by several periods; the missed deadlines are skipped, not replayed. */
+
+    uint64_t overruns = p.overruns;
+    struct timespec stall = timespec_add(p.next, timespec_from_ms(PERIOD_MS * 3 + PERIOD_MS / 2));
+    timespec_sleep_until(CLOCK_MONOTONIC, stall);
+
+    missed = timespec_periodic_wait(&p);
+    CHECK(missed >= 4, "overrun of 4 periods reported %llu missed", (unsigned long long)(missed));
+    CHECK(p.overruns - overruns == missed, "overrun count is wrong");
+    CHECK(timespec_gt(timespec_now(CLOCK_MONOTONIC), stall), "periodic wait did not skip ahead");
+    CHECK(timespec_ns_from_timespec(timespec_sub(p.next, first)) % (PERIOD_MS * 1000000) == 0,
+        "deadlines are no longer multiples of the period");
+
+    timespec_sleep_set_slack(original);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file timespecSortTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_sort.h>
+
+#define LARGE 300000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+/* Packed so the key is unaligned. */
+struct record
+{
+	char tag;
+	struct timespec time;
+	uint32_t seq;
+} __attribute__((packed));
+
+enum shape
+{
+	RANDOM,      /* Seconds anywhere in +/- 2^32 */
+	NARROW,      /* Within a few milliseconds, so few radix passes */
+	DUPLICATES,  /* Only eight distinct values */
+	SORTED,
+	REVERSED,
+	JITTER,      /* Sorted with repeats, apart from a few values slightly late */
+	OUTLIER,     /* Sorted apart from a huge first value */
+	WIDE,        /* Seconds from INT64_MIN to INT64_MAX */
+	SHAPES,
+};
+
+static const char *shape_names[SHAPES] = {
+	"random", "narrow", "duplicates", "sorted", "reversed", "jitter", "outlier", "wide",
+};
+
+static struct timespec make_time(enum shape shape, size_t i, size_t n, unsigned int *seed)
+{
+	timespec_ns ns;
+
+	switch(shape)
+	{
+		case RANDOM:
+			return timespec_normalise((struct timespec){
+				.tv_sec = (time_t)(((int64_t)(rand_r(seed)) << 2) - (INT64_C(1) << 32)),
+				.tv_nsec = rand_r(seed) % 1999999999 - 999999999 });
+
+		case NARROW:
+			return timespec_ns_to_timespec(INT64_C(1700000000000000000) + rand_r(seed) % 5000000);
+
+		case DUPLICATES:
+			return timespec_ns_to_timespec(rand_r(seed) % 8 - 4);
+
+		case SORTED:
+			return timespec_ns_to_timespec((timespec_ns)(i) * 1000);
+
+		case REVERSED:
+			return timespec_ns_to_timespec((timespec_ns)(n - i) * 1000);
+
+		case JITTER:
+			ns = (timespec_ns)(i / 3) * 1000 - ((rand_r(seed) % 100 == 0) ? rand_r(seed) % 20 * 1000 : 0);
+			return timespec_ns_to_timespec(ns);
+
+		case OUTLIER:
+			return (i == 0) ? timespec_ns_to_timespec(TIMESPEC_NS_MAX) : timespec_ns_to_timespec((timespec_ns)(i));
+
+		default:
+			if(rand_r(seed) % 4 == 0)
+			{
+				return (rand_r(seed) % 2)
+					? (struct timespec){ .tv_sec = INT64_MAX, .tv_nsec = rand_r(seed) % 1000000000 }
+					: (struct timespec){ .tv_sec = INT64_MIN, .tv_nsec = -(rand_r(seed) % 1000000000) };
+			}
+			return timespec_normalise((struct timespec){ .tv_sec = rand_r(seed) % 100 - 50,
+				.tv_nsec = rand_r(seed) % 1000000000 });
+	}
+}
+
+static int compare_times(const void *a, const void *b)
+{
+	const struct timespec *x = a, *y = b;
+
+	return timespec_lt(*x, *y) ? -1 : timespec_gt(*x, *y);
+}
+
+static struct timespec time_of(const struct record *r)
+{
+	struct timespec t;
+
+	memcpy(&t, &r->time, sizeof(t));
+
+	return t;
+}
+
+/* Orders by time then original position, the order a stable sort gives. */
+static int compare_records(const void *a, const void *b)
+{
+	const struct record *x = a, *y = b;
+	struct timespec tx = time_of(x), ty = time_of(y);
+	int c = compare_times(&tx, &ty);
+
+	return (c != 0) ? c : (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+static bool same_times(const struct timespec *a, const struct timespec *b, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+	{
+		if(!timespec_eq(a[i], b[i]) || a[i].tv_nsec != b[i].tv_nsec)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main()
+{
+    struct timespec *times = malloc(LARGE * sizeof(*times));
+    struct timespec *expected_times = malloc(LARGE * sizeof(*times));
+    struct record *records = malloc(LARGE * sizeof(*records));
+    struct record *expected = malloc(LARGE * sizeof(*records));
+    size_t sizes[] = { 0, 1, 2, 3, 100, 5000, LARGE };
+    unsigned int seed = 1;
+    int result = 0;
+
+    for(int shape = 0; shape < SHAPES; ++shape)
+    {
+        for(size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s)
+        {
+            size_t n = sizes[s];
+
+            for(size_t i = 0; i < n; ++i)
+            {
+                times[i] = make_time((enum shape)(shape), i, n, &seed);
+                records[i].tag = 'r';
+                memcpy(&records[i].time, &times[i], sizeof(times[i]));
+                records[i].seq = (uint32_t)(i);
+            }
+
+            memcpy(expected_times, times, n * sizeof(*times));
+            qsort(expected_times, n, sizeof(*times), compare_times);
+            memcpy(expected, records, n * sizeof(*records));
+            qsort(expected, n, sizeof(*records), compare_records);
+
+            /* Plain arrays, serial and parallel */
+
+            struct timespec *copy = malloc((n + 1) * sizeof(*copy));
+
+            memcpy(copy, times, n * sizeof(*copy));
+            CHECK(timespec_sort(copy, n), "%s %zu: sort failed", shape_names[shape], n);
+            CHECK(same_times(copy, expected_times, n), "%s %zu: sort is wrong", shape_names[shape], n);
+            CHECK(timespec_sorted_until(copy, n) == n && timespec_descents(copy, n) == 0,
+                "%s %zu: sorted array not recognised", shape_names[shape], n);
+
+            for(unsigned threads = 1; threads <= 5; threads += 2)
+            {
+                memcpy(copy, times, n * sizeof(*copy));
+                CHECK(timespec_sort_parallel(copy, n, threads), "%s %zu: parallel sort failed", shape_names[shape], n);
+                CHECK(same_times(copy, expected_times, n), "%s %zu: parallel sort with %u threads is wrong",
+                    shape_names[shape], n, threads);
+            }
+            free(copy);
+
+            /* Records are sorted stably */
+
+            struct record *rcopy = malloc((n + 1) * sizeof(*rcopy));
+
+            memcpy(rcopy, records, n * sizeof(*rcopy));
+            CHECK(timespec_sort_records(rcopy, n, sizeof(*rcopy), offsetof(struct record, time)),
+                "%s %zu: record sort failed", shape_names[shape], n);
+            CHECK(memcmp(rcopy, expected, n * sizeof(*rcopy)) == 0, "%s %zu: record sort is wrong",
+                shape_names[shape], n);
+            CHECK(timespec_records_sorted_until(rcopy, n, sizeof(*rcopy), offsetof(struct record, time)) == n,
+                "%s %zu: sorted records not recognised", shape_names[shape], n);
+
+            for(unsigned threads = 2; threads <= 6; threads += 2)
+            {
+                memcpy(rcopy, records, n * sizeof(*rcopy));
+                CHECK(timespec_sort_records_parallel(rcopy, n, sizeof(*rcopy), offsetof(struct record, time), threads),
+                    "%s %zu: parallel record sort failed", shape_names[shape], n);
+                CHECK(memcmp(rcopy, expected, n * sizeof(*rcopy)) == 0,
+                    "%s %zu: parallel record sort with %u threads is wrong", shape_names[shape], n, threads);
+            }
+            free(rcopy);
+        }
+    }
+
+    /* Sortedness */
+
+    struct timespec runs[] = {
+        { 1, 0 }, { 1, 5 }, { 2, 0 }, { 1, 999999999 }, { 1, 999999999 }, { 3, 0 }, { 0, 0 }, { 0, 1 },
+    };
+
+    CHECK(timespec_sorted_until(runs, 8) == 3, "sorted prefix is %zu", timespec_sorted_until(runs, 8));
+    CHECK(timespec_descents(runs, 8) == 2, "%zu descents", timespec_descents(runs, 8));
+    CHECK(timespec_sorted_until(runs, 0) == 0 && timespec_descents(runs, 1) == 0, "short arrays not sorted");
+
+    CHECK(!timespec_sort_records(records, 10, 8, 0) && errno == EINVAL, "key past the record accepted");
+    CHECK(!timespec_sort_records_parallel(records, 10, sizeof(*records), 6, 2) && errno == EINVAL,
+        "key past the record accepted");
+
+    free(times);
+    free(expected_times);
+    free(records);
+    free(expected);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -7,6 +7,9 @@
 
 #include <timespec.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #define TEST_NORMALISE(ts_sec, ts_nsec, expect_sec, expect_nsec) { \
 	struct timespec in  = { .tv_sec = ts_sec, .tv_nsec = ts_nsec }; \
@@ -48,6 +51,34 @@
 	} \
 }
 
+#define TEST_ADD_NORMALISED(ts1_sec, ts1_nsec, ts2_sec, ts2_nsec, expect_sec, expect_nsec) { \
+	struct timespec ts1 = { .tv_sec = ts1_sec, .tv_nsec = ts1_nsec }; \
+	struct timespec ts2 = { .tv_sec = ts2_sec, .tv_nsec = ts2_nsec }; \
+	struct timespec got = timespec_add_normalised(ts1, ts2); \
+	if(got.tv_sec != expect_sec || got.tv_nsec != expect_nsec) \
+	{ \
+		printf("timespec_add_normalised({%ld, %ld}, {%ld, %ld}) returned wrong values\n", \
+			(long)(ts1_sec), (long)(ts1_nsec), (long)(ts2_sec), (long)(ts2_nsec)); \
+		printf("    Expected: {%ld, %ld}\n", (long)(expect_sec), (long)(expect_nsec)); \
+		printf("    Got:      {%ld, %ld}\n", (long)(got.tv_sec), (long)(got.tv_nsec)); \
+		result = 1; \
+	} \
+}
+
+#define TEST_SUB_NORMALISED(ts1_sec, ts1_nsec, ts2_sec, ts2_nsec, expect_sec, expect_nsec) { \
+	struct timespec ts1 = { .tv_sec = ts1_sec, .tv_nsec = ts1_nsec }; \
+	struct timespec ts2 = { .tv_sec = ts2_sec, .tv_nsec = ts2_nsec }; \
+	struct timespec got = timespec_sub_normalised(ts1, ts2); \
+	if(got.tv_sec != expect_sec || got.tv_nsec != expect_nsec) \
+	{ \
+		printf("timespec_sub_normalised({%ld, %ld}, {%ld, %ld}) returned wrong values\n", \
+			(long)(ts1_sec), (long)(ts1_nsec), (long)(ts2_sec), (long)(ts2_nsec)); \
+		printf("    Expected: {%ld, %ld}\n", (long)(expect_sec), (long)(expect_nsec)); \
+		printf("    Got:      {%ld, %ld}\n", (long)(got.tv_sec), (long)(got.tv_nsec)); \
+		result = 1; \
+	} \
+}
+
 #define TEST_TEST_FUNC(func, ts1_sec, ts1_nsec, ts2_sec, ts2_nsec, expect) { \
 	struct timespec ts1 = { .tv_sec = ts1_sec, .tv_nsec = ts1_nsec }; \
 	struct timespec ts2 = { .tv_sec = ts2_sec, .tv_nsec = ts2_nsec }; \
@@ -59,6 +90,17 @@
 	} \
 }
 
+#define TEST_CMP(ts1_sec, ts1_nsec, ts2_sec, ts2_nsec, expect) { \
+	struct timespec ts1 = { .tv_sec = ts1_sec, .tv_nsec = ts1_nsec }; \
+	struct timespec ts2 = { .tv_sec = ts2_sec, .tv_nsec = ts2_nsec }; \
+	int got = timespec_cmp(ts1, ts2); \
+	if(got != expect) { \
+		printf("timespec_cmp({%ld, %ld}, {%ld, %ld}) returned %d, expected %d\n", \
+			(long)(ts1_sec), (long)(ts1_nsec), (long)(ts2_sec), (long)(ts2_nsec), got, expect); \
+		result = 1; \
+	} \
+}
+
 #define TEST_FROM_DOUBLE(d_secs, expect_sec, expect_nsec) { \
 	struct timespec got = timespec_from_double(d_secs);  \
 	if(got.tv_sec != expect_sec || got.tv_nsec != expect_nsec) \
@@ -127,6 +169,87 @@
 	} \
 }
 
+#define TEST_NS(expr, expect) { \
+	timespec_ns got = (expr); \
+	if(got != (timespec_ns)(expect)) { \
+		printf(#expr " returned wrong value\n"); \
+		printf("    Expected: %lld\n", (long long)(expect)); \
+		printf("    Got:      %lld\n", (long long)(got)); \
+		result = 1; \
+	} \
+}
+
+#define TEST_NS_TO_TIMESPEC(ns, expect_sec, expect_nsec) { \
+	struct timespec got = timespec_ns_to_timespec(ns); \
+	if(got.tv_sec != expect_sec || got.tv_nsec != expect_nsec) \
+	{ \
+		printf("timespec_ns_to_timespec(%lld) returned wrong values\n", (long long)(ns)); \
+		printf("    Expected: {%ld, %ld}\n", (long)(expect_sec), (long)(expect_nsec)); \
+		printf("    Got:      {%ld, %ld}\n", (long)(got.tv_sec), (long)(got.tv_nsec)); \
+		result = 1; \
+	} \
+}
+
+#define TEST_NS_TO_TIMEVAL(ns, expect_sec, expect_usec) { \
+	struct timeval got = timespec_ns_to_timeval(ns); \
+	if(got.tv_sec != expect_sec || got.tv_usec != expect_usec) \
+	{ \
+		printf("timespec_ns_to_timeval(%lld) returned wrong values\n", (long long)(ns)); \
+		printf("    Expected: {%ld, %ld}\n", (long)(expect_sec), (long)(expect_usec)); \
+		printf("    Got:      {%ld, %ld}\n", (long)(got.tv_sec), (long)(got.tv_usec)); \
+		result = 1; \
+	} \
+}
+
+#define TEST_RFC3339(ts_sec, ts_nsec, precision, expect) { \
+	struct timespec in = { .tv_sec = ts_sec, .tv_nsec = ts_nsec }; \
+	char got[TIMESPEC_RFC3339_MAX]; \
+	size_t len = timespec_to_rfc3339(in, precision, got, sizeof(got)); \
+	if(len != strlen(expect) || strcmp(got, expect) != 0) \
+	{ \
+		printf("timespec_to_rfc3339({%ld, %ld}, %d) returned wrong value\n", \
+			(long)(ts_sec), (long)(ts_nsec), (int)(precision)); \
+		printf("    Expected: %s\n", expect); \
+		printf("    Got:      %s (%zu)\n", len ? got : "", len); \
+		result = 1; \
+	} \
+}
+
+#define TEST_PARSE(fn, str, expect_len, expect_sec, expect_nsec) { \
+	struct timespec got = { .tv_sec = -7, .tv_nsec = -7 }; \
+	size_t len = fn(str, strlen(str), &got); \
+	if(len != (size_t)(expect_len) || (len != 0 && (got.tv_sec != expect_sec || got.tv_nsec != expect_nsec))) \
+	{ \
+		printf(#fn "(\"%s\") returned wrong values\n", str); \
+		printf("    Expected: %zu {%ld, %ld}\n", (size_t)(expect_len), (long)(expect_sec), (long)(expect_nsec)); \
+		printf("    Got:      %zu {%ld, %ld}\n", len, (long)(got.tv_sec), (long)(got.tv_nsec)); \
+		result = 1; \
+	} \
+}
+
+#define TEST_SCALE(expr, expect_sec, expect_nsec) { \
+	struct timespec got = (expr); \
+	if(got.tv_sec != expect_sec || got.tv_nsec != expect_nsec) \
+	{ \
+		printf(#expr " returned wrong values\n"); \
+		printf("    Expected: {%ld, %ld}\n", (long)(expect_sec), (long)(expect_nsec)); \
+		printf("    Got:      {%ld, %ld}\n", (long)(got.tv_sec), (long)(got.tv_nsec)); \
+		result = 1; \
+	} \
+}
+
+static struct timespec ts(long sec, long nsec)
+{
+	struct timespec ts = { .tv_sec = sec, .tv_nsec = nsec };
+	return ts;
+}
+
+static struct timeval tv(long sec, long usec)
+{
+	struct timeval tv = { .tv_sec = sec, .tv_usec = usec };
+	return tv;
+}
+
 int main()
 {
     int result = 0;
@@ -159,6 +282,25 @@ int main()
     TEST_SUB(1,0,         1,500000000, 0,-500000000);
     TEST_SUB(1,0,         1,499999999, 0,-499999999);
 
+    // timespec_add_normalised
+
+    TEST_ADD_NORMALISED(0,0,          0,0,          0,0);
+    TEST_ADD_NORMALISED(1,500000000,  1,500000000,  3,0);
+    TEST_ADD_NORMALISED(1,999999999,  1,999999999,  3,999999998);
+    TEST_ADD_NORMALISED(5,500000000,  -3,-700000000, 1,800000000);
+    TEST_ADD_NORMALISED(-1,-500000000, -1,-500000000, -3,0);
+    TEST_ADD_NORMALISED(-1,-999999999, 0,-999999999, -2,-999999998);
+    TEST_ADD_NORMALISED(0,-500000000, 1,0,          0,500000000);
+
+    // timespec_sub_normalised
+
+    TEST_SUB_NORMALISED(0,0,          0,0,          0,0);
+    TEST_SUB_NORMALISED(5,500000000,  2,999999999,  2,500000001);
+    TEST_SUB_NORMALISED(0,0,          1,500000000,  -1,-500000000);
+    TEST_SUB_NORMALISED(1,0,          1,499999999,  0,-499999999);
+    TEST_SUB_NORMALISED(-1,-999999999, 1,999999999, -3,-999999998);
+    TEST_SUB_NORMALISED(0,-500000000, -1,0,         0,500000000);
+
     // timespec_eq
 
     TEST_TEST_FUNC(timespec_eq, 0,0,    0,0,    true);
@@ -220,6 +362,20 @@ int main()
     TEST_TEST_FUNC(timespec_le, 0,0, -1,0, false);
     TEST_TEST_FUNC(timespec_le, 0,0, 0,-1, false);
 
+    // timespec_cmp
+
+    TEST_CMP(0,0,   0,0,    0);
+    TEST_CMP(1,1,   1,1,    0);
+    TEST_CMP(-1,-1, -1,-1,  0);
+    TEST_CMP(0,0,   1,0,    -1);
+    TEST_CMP(0,0,   0,1,    -1);
+    TEST_CMP(0,-1,  0,0,    -1);
+    TEST_CMP(-1,0,  0,-999999999, -1);
+    TEST_CMP(1,0,   0,999999999,  1);
+    TEST_CMP(0,1,   0,0,    1);
+    TEST_CMP(5,0,   4,999999999, 1);
+    TEST_CMP(0,0,   -1,0,   1);
+
     // timespec_from_double
 
     TEST_FROM_DOUBLE(0.0,   0,0);
@@ -340,8 +496,288 @@ int main()
 
     TEST_NORMALISE(-1,500000000,  0,-500000000);
     TEST_NORMALISE(-1,499999999,  0,-500000001);
+
+    /* Huge nanosecond counts must be flattened in one step. */
+    TEST_NORMALISE(0,3000000000000000L,       3000000,0);
+    TEST_NORMALISE(0,3000000000123456789L,    3000000000,123456789);
+    TEST_NORMALISE(0,-3000000000123456789L,   -3000000000,-123456789);
+    TEST_NORMALISE(-5,3000000000123456789L,   2999999995,123456789);
+    TEST_NORMALISE(5,-3000000000123456789L,   -2999999995,-123456789);
+    TEST_NORMALISE(-3000000001L,3000000000123456789L,  0,-876543211);
+    TEST_NORMALISE(0,9223372036854775807L,    9223372036,854775807);
+    TEST_NORMALISE(0,(-9223372036854775807L - 1), -9223372036,-854775808);
 #endif
 
+#if (64 <= __WORDSIZE)
+    /* timespec_ns tests use values which need 64-bit time_t and long. */
+
+    // timespec_ns_add / timespec_ns_sub
+
+    TEST_NS(timespec_ns_add(0, 0),                                 0);
+    TEST_NS(timespec_ns_add(1500000000, -2000000000),              -500000000);
+    TEST_NS(timespec_ns_add(TIMESPEC_NS_MAX, 1),                   TIMESPEC_NS_MAX);
+    TEST_NS(timespec_ns_add(TIMESPEC_NS_MIN, -1),                  TIMESPEC_NS_MIN);
+    TEST_NS(timespec_ns_add(TIMESPEC_NS_MAX, TIMESPEC_NS_MIN),     -1);
+    TEST_NS(timespec_ns_sub(5, 7),                                 -2);
+    TEST_NS(timespec_ns_sub(TIMESPEC_NS_MIN, 1),                   TIMESPEC_NS_MIN);
+    TEST_NS(timespec_ns_sub(TIMESPEC_NS_MAX, -1),                  TIMESPEC_NS_MAX);
+    TEST_NS(timespec_ns_sub(0, TIMESPEC_NS_MIN),                   TIMESPEC_NS_MAX);
+
+    // timespec_ns_from_timespec
+
+    TEST_NS(timespec_ns_from_timespec(ts(0,0)),                    0);
+    TEST_NS(timespec_ns_from_timespec(ts(1,500000000)),            1500000000);
+    TEST_NS(timespec_ns_from_timespec(ts(1,-500000000)),           500000000);
+    TEST_NS(timespec_ns_from_timespec(ts(-1,500000000)),           -500000000);
+    TEST_NS(timespec_ns_from_timespec(ts(-1,-500000000)),          -1500000000);
+    TEST_NS(timespec_ns_from_timespec(ts(0,2500000000L)),          2500000000L);
+    TEST_NS(timespec_ns_from_timespec(ts(9223372036L,854775807)),  TIMESPEC_NS_MAX);
+    TEST_NS(timespec_ns_from_timespec(ts(9223372036L,854775808)),  TIMESPEC_NS_MAX);
+    TEST_NS(timespec_ns_from_timespec(ts(-9223372036L,-854775808)), TIMESPEC_NS_MIN);
+    TEST_NS(timespec_ns_from_timespec(ts(-9223372037L,0)),         TIMESPEC_NS_MIN);
+    TEST_NS(timespec_ns_from_timespec(ts(10000000000L,0)),         TIMESPEC_NS_MAX);
+
+    // timespec_ns_to_timespec
+
+    TEST_NS_TO_TIMESPEC(0,                0,0);
+    TEST_NS_TO_TIMESPEC(1500000000,       1,500000000);
+    TEST_NS_TO_TIMESPEC(-500000000,       0,-500000000);
+    TEST_NS_TO_TIMESPEC(-1500000000,      -1,-500000000);
+    TEST_NS_TO_TIMESPEC(TIMESPEC_NS_MAX,  9223372036L,854775807);
+    TEST_NS_TO_TIMESPEC(TIMESPEC_NS_MIN,  -9223372036L,-854775808);
+
+    // timespec_ns_from_double / timespec_ns_to_double
+
+    TEST_NS(timespec_ns_from_double(0.0),        0);
+    TEST_NS(timespec_ns_from_double(10.5),       10500000000L);
+    TEST_NS(timespec_ns_from_double(-10.5),      -10500000000L);
+    TEST_NS(timespec_ns_from_double(-0.5),       -500000000);
+    TEST_NS(timespec_ns_from_double(1e300),      TIMESPEC_NS_MAX);
+    TEST_NS(timespec_ns_from_double(-1e300),     TIMESPEC_NS_MIN);
+    TEST_NS(timespec_ns_from_double(0.0 / 0.0),  0);
+
+    if(timespec_ns_to_double(10500000000L) != 10.5 || timespec_ns_to_double(-500000000) != -0.5)
+    {
+        printf("timespec_ns_to_double returned wrong value\n");
+        result = 1;
+    }
+
+    // timespec_ns_from_timeval / timespec_ns_to_timeval
+
+    TEST_NS(timespec_ns_from_timeval(tv(1,1)),        1000001000);
+    TEST_NS(timespec_ns_from_timeval(tv(1,-1)),       999999000);
+    TEST_NS(timespec_ns_from_timeval(tv(-1,-1000)),   -1001000000);
+
+    TEST_NS_TO_TIMEVAL(1000001999,   1,1);
+    TEST_NS_TO_TIMEVAL(-1000001999,  -1,-1);
+    TEST_NS_TO_TIMEVAL(999,          0,0);
+
+    // timespec_ns_from_ms / timespec_ns_to_ms
+
+    TEST_NS(timespec_ns_from_ms(1500),                  1500000000);
+    TEST_NS(timespec_ns_from_ms(-1),                    -1000000);
+    TEST_NS(timespec_ns_from_ms(9223372036855L),        TIMESPEC_NS_MAX);
+    TEST_NS(timespec_ns_from_ms(-9223372036855L),       TIMESPEC_NS_MIN);
+    TEST_NS(timespec_ns_to_ms(10500000000L),            10500);
+    TEST_NS(timespec_ns_to_ms(-10500000000L),           -10500);
+    TEST_NS(timespec_ns_to_ms(999999),                  0);
+#endif
+
+    // timespec_mul / timespec_div / timespec_scale
+
+    TEST_SCALE(timespec_mul(ts(1,500000000), 3),                   4,500000000);
+    TEST_SCALE(timespec_mul(ts(1,500000000), -3),                  -4,-500000000);
+    TEST_SCALE(timespec_mul(ts(-1,-500000000), -3),                4,500000000);
+    TEST_SCALE(timespec_mul(ts(0,999999999), 1000000000),          999999999,0);
+    TEST_SCALE(timespec_mul(ts(0,1), 0),                           0,0);
+    TEST_SCALE(timespec_mul(ts(0,3000000000L), 2),                 6,0);
+    TEST_SCALE(timespec_div(ts(1,0), 3),                           0,333333333);
+    TEST_SCALE(timespec_div(ts(-1,0), 3),                          0,-333333333);
+    TEST_SCALE(timespec_div(ts(10,1), 10),                         1,0);
+    TEST_SCALE(timespec_div(ts(10,0), -4),                         -2,-500000000);
+    TEST_SCALE(timespec_scale(ts(1,0), 1001, 30000),               0,33366666);
+    TEST_SCALE(timespec_scale(ts(3600,0), 90000, 90000),           3600,0);
+    TEST_SCALE(timespec_scale(ts(0,0), 1, 0),                      0,0);
+
+#if (64 <= __WORDSIZE)
+    TEST_SCALE(timespec_mul(ts(9223372036854775807L,0), 2),         9223372036854775807L,999999999);
+    TEST_SCALE(timespec_mul(ts(9223372036854775807L,0), -2),        -9223372036854775807L,-999999999);
+    TEST_SCALE(timespec_div(ts(1,0), 0),                            9223372036854775807L,999999999);
+    TEST_SCALE(timespec_div(ts(-1,0), 0),                           -9223372036854775807L,-999999999);
+    TEST_SCALE(timespec_scale(ts(9223372036854775807L,999999999), INT64_MAX, INT64_MAX),
+        9223372036854775807L,999999999);
+    TEST_SCALE(timespec_scale(ts(9223372036854775807L,0), 3, 4),    6917529027641081855L,250000000);
+    TEST_SCALE(timespec_scale(ts(-9223372036854775807L - 1,0), 1, -2), 4611686018427387904L,0);
+#endif
+
+#ifdef __SIZEOF_INT128__
+    /* Random values against a direct 128-bit computation. */
+
+    srand(1);
+    for(int i = 0; i < 100000; ++i)
+    {
+        __extension__ typedef __int128 i128;
+
+        long sec  = (long)(rand() % 2000001) - 1000000;
+        long nsec = (sec < 0 ? -1 : 1) * (long)(rand() % 1000000000);
+        int64_t num = (int64_t)(rand()) - RAND_MAX / 2;
+        int64_t den = (int64_t)(rand() % 1000000) + 1;
+
+        i128 total = ((i128)(sec) * 1000000000 + nsec) * num / den;
+        struct timespec got = timespec_scale(ts(sec,nsec), num, den);
+
+        if((i128)(got.tv_sec) * 1000000000 + got.tv_nsec != total || timespec_normalise(got).tv_nsec != got.tv_nsec)
+        {
+            printf("timespec_scale({%ld, %ld}, %lld, %lld) returned wrong value\n",
+                sec, nsec, (long long)(num), (long long)(den));
+            result = 1;
+            break;
+        }
+    }
+#endif
+
+    // timespec_to_rfc3339
+
+    TEST_RFC3339(0,0,                      0,  "1970-01-01T00:00:00Z");
+    TEST_RFC3339(0,0,                      3,  "1970-01-01T00:00:00.000Z");
+    TEST_RFC3339(1792240496,123456789,     9,  "2026-10-17T12:34:56.123456789Z");
+    TEST_RFC3339(1792240496,123456789,     6,  "2026-10-17T12:34:56.123456Z");
+    TEST_RFC3339(1792240496,123456789,     1,  "2026-10-17T12:34:56.1Z");
+    TEST_RFC3339(1792240496,123456789,     -1, "2026-10-17T12:34:56Z");
+    TEST_RFC3339(1792240496,123456789,     12, "2026-10-17T12:34:56.123456789Z");
+    TEST_RFC3339(1792240496,999999999,     3,  "2026-10-17T12:34:56.999Z");
+    TEST_RFC3339(1792240495,1123456789,    3,  "2026-10-17T12:34:56.123Z");
+    TEST_RFC3339(951782400,0,              0,  "2000-02-29T00:00:00Z");
+    TEST_RFC3339(4107542399L,0,            0,  "2100-02-28T23:59:59Z");
+    TEST_RFC3339(-1,0,                     3,  "1969-12-31T23:59:59.000Z");
+    TEST_RFC3339(-1,-500000000,            3,  "1969-12-31T23:59:58.500Z");
+    TEST_RFC3339(0,-1,                     9,  "1969-12-31T23:59:59.999999999Z");
+    TEST_RFC3339(-62167219200L,0,          0,  "0000-01-01T00:00:00Z");
+    TEST_RFC3339(253402300799L,999999999,  2,  "9999-12-31T23:59:59.99Z");
+
+    {
+        char buf[TIMESPEC_RFC3339_MAX];
+
+        if(timespec_to_rfc3339(ts(-62167219201L,0), 0, buf, sizeof(buf)) != 0
+            || timespec_to_rfc3339(ts(253402300800L,0), 0, buf, sizeof(buf)) != 0
+            || timespec_to_rfc3339(ts(0,0), 3, buf, 24) != 0
+            || timespec_to_rfc3339(ts(0,0), 3, buf, 25) != 24
+            || timespec_to_rfc3339(ts(253402300800L,0), 0, buf, sizeof(buf)) != 0
+            || timespec_to_rfc3339(ts(0,0), 0, buf, sizeof(buf)) != 20
+            || strcmp(buf, "1970-01-01T00:00:00Z") != 0)
+        {
+            printf("timespec_to_rfc3339 mishandled an out of range year or short buffer\n");
+            result = 1;
+        }
+    }
+
+    /* Every day from 1900 to 2200 at a varying time of day, checked against
+     * gmtime_r() and strftime().
+    */
+
+    for(long day = -25567; day < 84006; ++day)
+    {
+        time_t sec = (time_t)(day) * 86400 + (day * 7919) % 86400;
+        struct tm tm;
+        char expect[TIMESPEC_RFC3339_MAX], got[TIMESPEC_RFC3339_MAX];
+
+        gmtime_r(&sec, &tm);
+        strftime(expect, sizeof(expect), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+        if(timespec_to_rfc3339(ts(sec,0), 0, got, sizeof(got)) != 20 || strcmp(got, expect) != 0)
+        {
+            printf("timespec_to_rfc3339({%ld, 0}, 0) returned %s, expected %s\n", (long)(sec), got, expect);
+            result = 1;
+            break;
+        }
+    }
+
+    // timespec_to_rfc3339_array
+
+    {
+        struct timespec in[3] = { ts(0,0), ts(0,250000000), ts(86400,0) };
+        char buf[3 * 25];
+
+        if(timespec_to_rfc3339_array(in, 3, 3, buf, sizeof(buf)) != sizeof(buf)
+            || strcmp(buf, "1970-01-01T00:00:00.000Z") != 0
+            || strcmp(buf + 25, "1970-01-01T00:00:00.250Z") != 0
+            || strcmp(buf + 50, "1970-01-02T00:00:00.000Z") != 0
+            || timespec_to_rfc3339_array(in, 3, 3, buf, sizeof(buf) - 1) != 0)
+        {
+            printf("timespec_to_rfc3339_array returned wrong values\n");
+            result = 1;
+        }
+    }
+
+    // timespec_parse_rfc3339
+
+    TEST_PARSE(timespec_parse_rfc3339, "1970-01-01T00:00:00Z",                  20, 0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17T12:34:56.123456789Z",        30, 1792240496,123456789);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17t12:34:56.5z",                22, 1792240496,500000000);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17 12:34:56.12345678901Z",      32, 1792240496,123456789);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17T14:34:56.1+02:00",           27, 1792240496,100000000);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17T07:04:56-05:30 trailing",    25, 1792240496,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2016-12-31T23:59:60Z",                  20, 1483228800,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2000-02-29T00:00:00Z",                  20, 951782400,0);
+    TEST_PARSE(timespec_parse_rfc3339, "1969-12-31T23:59:58.5Z",                22, -1,-500000000);
+    TEST_PARSE(timespec_parse_rfc3339, "0000-01-01T00:00:00Z",                  20, -62167219200L,0);
+    TEST_PARSE(timespec_parse_rfc3339, "9999-12-31T23:59:59.999999999Z",        30, 253402300799L,999999999);
+    TEST_PARSE(timespec_parse_rfc3339, "2100-02-29T00:00:00Z",                  0,  0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-13-01T00:00:00Z",                  0,  0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-04-31T00:00:00Z",                  0,  0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17T24:00:00Z",                  0,  0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17T12:34:56",                   0,  0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17T12:34:56.Z",                 0,  0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-10-17T12:34:56+0200",              0,  0,0);
+    TEST_PARSE(timespec_parse_rfc3339, "2026-1O-17T12:34:56Z",                  0,  0,0);
+
+    /* Round trip through timespec_to_rfc3339(). */
+
+    for(long i = 0; i < 100000; ++i)
+    {
+        struct timespec in = ts(-62167219200L + i * 3155378L, (i * 987654321) % 1000000000);
+        struct timespec got;
+        char buf[TIMESPEC_RFC3339_MAX];
+
+        size_t len = timespec_to_rfc3339(in, 9, buf, sizeof(buf));
+        if(len == 0 || timespec_parse_rfc3339(buf, len, &got) != len || !timespec_eq(timespec_normalise(in), got))
+        {
+            printf("timespec_parse_rfc3339(\"%s\") did not round trip {%ld, %ld}\n",
+                buf, (long)(in.tv_sec), (long)(in.tv_nsec));
+            result = 1;
+            break;
+        }
+    }
+
+    // timespec_parse_duration
+
+    TEST_PARSE(timespec_parse_duration, "1.5s",                 4,  1,500000000);
+    TEST_PARSE(timespec_parse_duration, "250ms",                5,  0,250000000);
+    TEST_PARSE(timespec_parse_duration, "1h30m",                5,  5400,0);
+    TEST_PARSE(timespec_parse_duration, "1.5h",                 4,  5400,0);
+    TEST_PARSE(timespec_parse_duration, "2m0.000000001s",       14, 120,1);
+    TEST_PARSE(timespec_parse_duration, "-1.5s",                5,  -1,-500000000);
+    TEST_PARSE(timespec_parse_duration, "+10us",                5,  0,10000);
+    TEST_PARSE(timespec_parse_duration, "10\xC2\xB5s",          5,  0,10000);
+    TEST_PARSE(timespec_parse_duration, "1500000000ns",         12, 1,500000000);
+    TEST_PARSE(timespec_parse_duration, "1.9ns",                5,  0,1);
+    TEST_PARSE(timespec_parse_duration, "0.0000000019s",        13, 0,1);
+    TEST_PARSE(timespec_parse_duration, "1234567.123456ms",     16, 1234,567123456);
+    TEST_PARSE(timespec_parse_duration, "999999999ms999ms",     16, 1000000,998000000);
+    TEST_PARSE(timespec_parse_duration, "0",                    1,  0,0);
+    TEST_PARSE(timespec_parse_duration, "0, then more",         1,  0,0);
+    TEST_PARSE(timespec_parse_duration, "5s and more",          2,  5,0);
+    TEST_PARSE(timespec_parse_duration, "5",                    0,  0,0);
+    TEST_PARSE(timespec_parse_duration, "1h30",                 0,  0,0);
+    TEST_PARSE(timespec_parse_duration, "",                     0,  0,0);
+    TEST_PARSE(timespec_parse_duration, "-",                    0,  0,0);
+    TEST_PARSE(timespec_parse_duration, "5d",                   0,  0,0);
+    TEST_PARSE(timespec_parse_duration, ".s",                   0,  0,0);
+    TEST_PARSE(timespec_parse_duration, "1.s",                  0,  0,0);
+    TEST_PARSE(timespec_parse_duration, "1h2.m",                0,  0,0);
+    TEST_PARSE(timespec_parse_duration, "5s.",                  2,  5,0);
+    TEST_PARSE(timespec_parse_duration, "1234567890123456789s", 0,  0,0);
+
     if(result > 0)
     {
         printf("%d tests failed\n", result);
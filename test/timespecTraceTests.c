@@ -0,0 +1,294 @@
+/**
+ * @file timespecTraceTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timespec.h>
+#include <timespec_trace.h>
+
+#define THREADS 4
+#define SPANS   20000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+/* Drained events, and per-thread checks that spans balance and time runs forwards. */
+struct collected
+{
+	struct timespec_trace_event events[64];
+	size_t count;
+	int depth[THREADS + 2];
+	timespec_ns last[THREADS + 2];
+	bool balanced;
+	bool ordered;
+};
+
+static void collect(const struct timespec_trace_event *event, void *arg)
+{
+	struct collected *c = arg;
+
+	if(c->count < sizeof(c->events) / sizeof(*c->events))
+	{
+		c->events[c->count] = event[0];
+	}
+	++(c->count);
+
+	if(event->thread < THREADS + 2)
+	{
+		c->depth[event->thread] += (event->phase == 'B') ? 1 : (event->phase == 'E') ? -1 : 0;
+		c->balanced &= c->depth[event->thread] >= 0;
+		c->ordered &= event->time >= c->last[event->thread];
+		c->last[event->thread] = event->time;
+	}
+	else{
+		c->balanced = false;
+	}
+}
+
+static void reset(struct collected *c)
+{
+	memset(c, 0, sizeof(*c));
+	c->balanced = true;
+	c->ordered = true;
+}
+
+static bool phases(const struct collected *c, const char *expected)
+{
+	if(c->count != strlen(expected))
+	{
+		return false;
+	}
+
+	for(size_t i = 0; i < c->count; ++i)
+	{
+		if(c->events[i].phase != expected[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int scoped(struct timespec_trace *t, int n)
+{
+	TIMESPEC_TRACE_SCOPE(t, "scoped");
+
+	if(n > 0)
+	{
+		TIMESPEC_TRACE_SCOPE(t, "inner");
+		return n;
+	}
+
+	return 0;
+}
+
+static struct timespec_trace *shared_trace;
+
+static void *worker_main(void *arg)
+{
+	timespec_trace_name_thread(shared_trace, arg);
+
+	for(int i = 0; i < SPANS; ++i)
+	{
+		timespec_trace_begin(shared_trace, "outer");
+		timespec_trace_begin(shared_trace, "inner");
+		timespec_trace_end(shared_trace);
+		timespec_trace_instant(shared_trace, "mark");
+		timespec_trace_end(shared_trace);
+	}
+
+	return NULL;
+}
+
+int main()
+{
+    struct collected c;
+    int result = 0;
+
+    CHECK(timespec_trace_create(CLOCK_MONOTONIC, 0) == NULL && errno == EINVAL, "empty ring accepted");
+    CHECK(timespec_trace_create(CLOCK_MONOTONIC, (UINT32_C(1) << 30) + 1) == NULL && errno == EINVAL,
+        "huge ring accepted");
+
+    /* Nesting and instants */
+
+    struct timespec_trace *t = timespec_trace_create(CLOCK_MONOTONIC, 64);
+
+    CHECK(timespec_trace_begin(t, "outer"), "begin dropped");
+    CHECK(timespec_trace_begin(t, "inner"), "begin dropped");
+    CHECK(timespec_trace_instant(t, "mark"), "instant dropped");
+    timespec_trace_end(t);
+    timespec_trace_end(t);
+    timespec_trace_end(t);
+
+    reset(&c);
+    CHECK(timespec_trace_drain(t, collect, &c) == 5, "drained %zu events", c.count);
+    CHECK(phases(&c, "BBiEE"), "wrong phases");
+    CHECK(strcmp(c.events[0].name, "outer") == 0 && strcmp(c.events[1].name, "inner") == 0
+        && strcmp(c.events[2].name, "mark") == 0 && c.events[3].name == NULL, "wrong names");
+    CHECK(c.events[0].thread == 1 && c.events[4].thread == 1, "wrong thread");
+    CHECK(c.balanced && c.ordered, "events unbalanced or out of order");
+    CHECK(timespec_trace_drain(t, collect, &c) == 0, "events drained twice");
+
+    /* Scopes end on every path */
+
+    reset(&c);
+    CHECK(scoped(t, 1) == 1 && scoped(t, 0) == 0, "scoped function broken");
+    timespec_trace_drain(t, collect, &c);
+    CHECK(phases(&c, "BBEEBE") && c.balanced, "scoped spans not ended");
+
+    /* A full ring drops begins but never the end of a recorded one */
+
+    for(int i = 0; i < 40; ++i)
+    {
+        timespec_trace_begin(t, "deep");
+    }
+    CHECK(!timespec_trace_instant(t, "full"), "instant recorded into a full ring");
+    for(int i = 0; i < 40; ++i)
+    {
+        timespec_trace_end(t);
+    }
+
+    reset(&c);
+    timespec_trace_drain(t, collect, &c);
+    CHECK(c.count == 64 && c.balanced && c.depth[1] == 0, "full ring left %zu events, depth %d", c.count, c.depth[1]);
+    CHECK(timespec_trace_dropped(t) == 9, "%llu events dropped", (unsigned long long)(timespec_trace_dropped(t)));
+
+    /* A span inside a dropped one is kept once there is room */
+
+    for(int i = 0; i < 63; ++i)
+    {
+        timespec_trace_instant(t, "fill");
+    }
+    CHECK(!timespec_trace_begin(t, "dropped"), "begin recorded into a full ring");
+    timespec_trace_drain(t, NULL, NULL);
+    CHECK(timespec_trace_begin(t, "kept"), "begin dropped from an empty ring");
+    timespec_trace_end(t);
+    timespec_trace_end(t);
+
+    reset(&c);
+    timespec_trace_drain(t, collect, &c);
+    CHECK(phases(&c, "BE") && strcmp(c.events[0].name, "kept") == 0, "wrong spans kept");
+
+    /* Spans deeper than 64 are dropped, with their ends */
+
+    timespec_trace_destroy(t);
+    t = timespec_trace_create(CLOCK_MONOTONIC, 1024);
+    for(int i = 0; i < 70; ++i)
+    {
+        timespec_trace_begin(t, "deep");
+    }
+    for(int i = 0; i < 71; ++i)
+    {
+        timespec_trace_end(t);
+    }
+
+    reset(&c);
+    timespec_trace_drain(t, collect, &c);
+    CHECK(c.count == 128 && c.balanced && c.depth[1] == 0, "deep nesting left %zu events", c.count);
+    CHECK(timespec_trace_dropped(t) == 6, "deep nesting dropped %llu",
+        (unsigned long long)(timespec_trace_dropped(t)));
+
+    /* Export */
+
+    char *json = NULL;
+    size_t json_len = 0;
+    FILE *f = open_memstream(&json, &json_len);
+
+    timespec_trace_name_thread(t, "main \"thread\"");
+    timespec_trace_begin(t, "a\\b");
+    timespec_trace_instant(t, "tab\there");
+    timespec_trace_end(t);
+
+    CHECK(timespec_trace_export(t, f), "export failed");
+    fclose(f);
+    CHECK(strncmp(json, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", 40) == 0, "bad JSON start: %s", json);
+    CHECK(json_len > 4 && strcmp(json + json_len - 4, "\n]}\n") == 0, "bad JSON end: %s", json);
+    CHECK(strstr(json, "\"name\":\"thread_name\",\"ph\":\"M\"") != NULL
+        && strstr(json, "\"args\":{\"name\":\"main \\\"thread\\\"\"}") != NULL, "no thread name: %s", json);
+    CHECK(strstr(json, "{\"name\":\"a\\\\b\",\"ph\":\"B\",\"ts\":") != NULL, "no begin event: %s", json);
+    CHECK(strstr(json, "{\"name\":\"tab\\u0009here\",\"ph\":\"i\",\"ts\":") != NULL
+        && strstr(json, ",\"s\":\"t\"}") != NULL, "no instant event: %s", json);
+    CHECK(strstr(json, "{\"ph\":\"E\",\"ts\":") != NULL, "no end event: %s", json);
+    CHECK(strstr(json, "}{") == NULL && strstr(json, ",\n]") == NULL, "events not separated: %s", json);
+    free(json);
+
+    /* A trace created after another is destroyed registers threads afresh */
+
+    timespec_trace_destroy(t);
+    t = timespec_trace_create(CLOCK_MONOTONIC, 16);
+    timespec_trace_instant(t, "new");
+
+    reset(&c);
+    timespec_trace_drain(t, collect, &c);
+    CHECK(phases(&c, "i") && c.events[0].thread == 1, "stale buffer used");
+    timespec_trace_destroy(t);
+
+    CHECK(!timespec_trace_begin(NULL, "off") && !timespec_trace_instant(NULL, "off"), "NULL trace recorded");
+    timespec_trace_end(NULL);
+    timespec_trace_destroy(NULL);
+
+    /* Threads record while the collector drains */
+
+    const char *names[THREADS] = { "w1", "w2", "w3", "w4" };
+    pthread_t threads[THREADS];
+    size_t total = 0;
+
+    shared_trace = timespec_trace_create(CLOCK_MONOTONIC, 256);
+    reset(&c);
+
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_create(&threads[i], NULL, worker_main, (void*)(names[i]));
+    }
+    for(int i = 0; i < 1000; ++i)
+    {
+        total += timespec_trace_drain(shared_trace, collect, &c);
+    }
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    total += timespec_trace_drain(shared_trace, collect, &c);
+
+    uint64_t dropped = timespec_trace_dropped(shared_trace);
+    bool closed = true;
+
+    for(int i = 1; i <= THREADS; ++i)
+    {
+        closed &= c.depth[i] == 0;
+    }
+
+    CHECK(c.balanced && closed, "concurrent spans unbalanced");
+    CHECK(c.ordered, "concurrent events out of order");
+    CHECK(total == c.count && c.depth[THREADS + 1] == 0, "drain count wrong");
+
+    /* Each iteration is 5 events; a dropped outer begin also drops its inner span. */
+    CHECK(total + dropped <= (size_t)(THREADS) * SPANS * 5 && total + dropped * 5 >= (size_t)(THREADS) * SPANS * 5,
+        "%zu events drained and %llu dropped", total, (unsigned long long)(dropped));
+
+    timespec_trace_destroy(shared_trace);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file timespecTscTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <timespec.h>
+#include <timespec_clock.h>
+#include <timespec_tsc.h>
+
+/* Generous, as virtual machines can be descheduled between any two reads. */
+#define TOLERANCE_NS 200000
+
+#define READS 1000000
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+/* Returns how far outside the surrounding clock reads a converted time falls,
+ * the lowest of a few tries so a badly timed preemption does not count.
+*/
+static timespec_ns clock_error(const struct timespec_tsc *tsc, clockid_t clock)
+{
+	timespec_ns best = INT64_MAX;
+
+	for(int i = 0; i < 5; ++i)
+	{
+		timespec_ns before = timespec_ns_from_timespec(timespec_now(clock));
+		timespec_ns t = timespec_ns_from_timespec(timespec_tsc_now(tsc));
+		timespec_ns after = timespec_ns_from_timespec(timespec_now(clock));
+		timespec_ns error = (t < before) ? before - t : (t > after) ? t - after : 0;
+
+		if(error < best)
+		{
+			best = error;
+		}
+	}
+
+	return best;
+}
+
+static void sleep_ms(long ms)
+{
+	struct timespec ts = timespec_from_ms(ms);
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR)
+	{
+	}
+}
+
+int main()
+{
+    struct timespec zero = { .tv_sec = 0, .tv_nsec = 0 };
+    struct timespec negative = { .tv_sec = -1, .tv_nsec = 0 };
+    int result = 0;
+
+    CHECK(timespec_tsc_create((clockid_t)(-12345), zero) == NULL && errno == EINVAL, "invalid clock accepted");
+    CHECK(timespec_tsc_create(CLOCK_MONOTONIC, negative) == NULL && errno == EINVAL, "negative period accepted");
+
+    clockid_t clocks[] = { CLOCK_MONOTONIC, CLOCK_REALTIME };
+
+    for(int c = 0; c < 2; ++c)
+    {
+        struct timespec_tsc *tsc = timespec_tsc_create(clocks[c], zero);
+        CHECK(tsc != NULL, "create failed for clock %d", (int)(clocks[c]));
+        if(tsc == NULL)
+        {
+            continue;
+        }
+
+        double frequency = timespec_tsc_frequency(tsc);
+        CHECK(frequency > 1e6 && frequency < 1e12, "implausible counter frequency %g", frequency);
+
+        timespec_ns error = clock_error(tsc, clocks[c]);
+        CHECK(error < TOLERANCE_NS, "converted time is %lldns from the clock after calibration", (long long)(error));
+
+        /* Conversion is monotonic, including across recalibration. */
+        uint64_t last_cycles = timespec_tsc_cycles(tsc);
+        timespec_ns last = timespec_tsc_to_ns(tsc, last_cycles);
+        bool monotonic = true, consistent = true;
+
+        for(long i = 0; i < READS; ++i)
+        {
+            if(i % (READS / 10) == 0)
+            {
+                CHECK(timespec_tsc_recalibrate(tsc), "recalibrate failed");
+            }
+
+            uint64_t cycles = timespec_tsc_cycles(tsc);
+            timespec_ns ns = timespec_tsc_to_ns(tsc, cycles);
+
+            monotonic &= (ns >= last) || clocks[c] == CLOCK_REALTIME;
+            consistent &= timespec_eq(timespec_tsc_to_timespec(tsc, cycles), timespec_ns_to_timespec(ns));
+            last = ns;
+        }
+        CHECK(monotonic, "converted times went backwards");
+        CHECK(consistent, "to_timespec and to_ns disagree");
+
+        /* Drift stays bounded with recalibration. */
+        for(int i = 0; i < 5; ++i)
+        {
+            sleep_ms(40);
+            timespec_tsc_recalibrate(tsc);
+        }
+
+        error = timespec_ns_from_timespec(timespec_tsc_error(tsc));
+        CHECK(error > -TOLERANCE_NS && error < TOLERANCE_NS, "recalibration found an error of %lldns",
+            (long long)(error));
+
+        error = clock_error(tsc, clocks[c]);
+        CHECK(error < TOLERANCE_NS, "converted time is %lldns from the clock after recalibrating", (long long)(error));
+
+        if(timespec_tsc_fallback(tsc))
+        {
+            CHECK(timespec_tsc_frequency(tsc) == 1e9, "fallback frequency is not 1GHz");
+        }
+
+        timespec_tsc_destroy(tsc);
+    }
+
+    /* Background recalibration */
+
+    struct timespec_tsc *tsc = timespec_tsc_create(CLOCK_MONOTONIC, timespec_from_ms(10));
+    CHECK(tsc != NULL, "create with a recalibration period failed");
+    if(tsc != NULL)
+    {
+        sleep_ms(100);
+
+        timespec_ns error = clock_error(tsc, CLOCK_MONOTONIC);
+        CHECK(error < TOLERANCE_NS, "converted time is %lldns from the clock with background recalibration",
+            (long long)(error));
+
+        struct timespec start = timespec_now(CLOCK_MONOTONIC);
+        timespec_tsc_destroy(tsc);
+        struct timespec stopped = timespec_sub(timespec_now(CLOCK_MONOTONIC), start);
+        CHECK(timespec_lt(stopped, timespec_from_ms(50)), "destroy took %gs", timespec_to_double(stopped));
+    }
+
+    timespec_tsc_destroy(NULL);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+#include <timespec_wheel.h>
+
+#define TIMERS 5000
+
+struct test_timer
+{
+	struct timespec_timer node;
+	struct timespec deadline;
+	int fired;
+	int cancelled;
+};
+
+static struct test_timer timers[TIMERS];
+static struct timespec current;
+static int result = 0;
+
+static void on_expire(struct timespec_timer *node)
+{
+	struct test_timer *t = (struct test_timer*)((char*)(node) - offsetof(struct test_timer, node));
+
+	if(t->fired || t->cancelled)
+	{
+		printf("timer %ld fired twice or after being cancelled\n", (long)(t - timers));
+		result = 1;
+	}
+	if(timespec_lt(current, t->deadline))
+	{
+		printf("timer %ld fired early: deadline {%ld, %ld}, now {%ld, %ld}\n", (long)(t - timers),
+			(long)(t->deadline.tv_sec), t->deadline.tv_nsec, (long)(current.tv_sec), current.tv_nsec);
+		result = 1;
+	}
+	t->fired = 1;
+}
+
+static struct timespec rearm_deadline;
+static struct timespec_wheel *rearm_wheel;
+
+static void on_expire_rearm(struct timespec_timer *node)
+{
+	static int rearms = 0;
+
+	if(++rearms < 3)
+	{
+		rearm_deadline = timespec_add(current, timespec_from_ms(10));
+		timespec_wheel_add(rearm_wheel, node, rearm_deadline);
+	}
+}
+
+/* Re-arms from the callback a multiple of the first level's 256 ticks ahead,
+ * which lands in the slot being expired.
+*/
+static const long span_multiples[] = { 256, 512, 768, 65536 };
+static struct timespec span_deadline;
+static size_t span_fires;
+
+static void on_expire_span(struct timespec_timer *node)
+{
+	if(timespec_lt(current, span_deadline))
+	{
+		printf("timer re-armed %ld ticks ahead fired early: deadline {%ld, %ld}, now {%ld, %ld}\n",
+			span_multiples[span_fires - 1], (long)(span_deadline.tv_sec), span_deadline.tv_nsec,
+			(long)(current.tv_sec), current.tv_nsec);
+		result = 1;
+	}
+
+	if(span_fires < sizeof(span_multiples) / sizeof(*span_multiples))
+	{
+		span_deadline = timespec_add(span_deadline, timespec_from_ms(span_multiples[span_fires]));
+		timespec_wheel_add(rearm_wheel, node, span_deadline);
+	}
+	++span_fires;
+}
+
+int main()
+{
+    struct timespec start = { .tv_sec = 1000, .tv_nsec = 0 };
+    struct timespec tick = timespec_from_ms(1);
+    struct timespec_wheel *wheel = timespec_wheel_create(start, tick);
+
+    srand(1);
+    current = start;
+
+    if(timespec_wheel_create(start, timespec_from_ms(0)) != NULL)
+    {
+        printf("timespec_wheel_create accepted a zero tick\n");
+        result = 1;
+    }
+
+    // Timers spread over several wheel levels, some not aligned to a tick
+
+    for(int i = 0; i < TIMERS; ++i)
+    {
+        long span_ms = (i % 4 == 0) ? 200 : (i % 4 == 1) ? 60000 : (i % 4 == 2) ? 3000000 : 20000000;
+        timespec_ns offset = timespec_ns_from_ms(rand() % span_ms);
+
+        if(i % 3 == 0)
+        {
+            offset += rand() % 1000000;
+        }
+
+        timespec_timer_init(&timers[i].node, on_expire);
+        timers[i].deadline = timespec_add(start, timespec_ns_to_timespec(offset));
+        timespec_wheel_add(wheel, &timers[i].node, timers[i].deadline);
+    }
+
+    /* Deadlines already in the past fire on the next advance. */
+    timespec_wheel_add(wheel, &timers[0].node, timespec_sub(start, timespec_from_ms(5)));
+    timers[0].deadline = start;
+
+    if(timespec_wheel_count(wheel) != TIMERS)
+    {
+        printf("timespec_wheel_count returned %zu, expected %d\n", timespec_wheel_count(wheel), TIMERS);
+        result = 1;
+    }
+
+    // Cancel every seventh timer
+
+    for(int i = 7; i < TIMERS; i += 7)
+    {
+        if(!timespec_wheel_cancel(wheel, &timers[i].node) || timespec_timer_pending(&timers[i].node))
+        {
+            printf("timespec_wheel_cancel failed for timer %d\n", i);
+            result = 1;
+        }
+        timers[i].cancelled = 1;
+    }
+
+    if(timespec_wheel_cancel(wheel, &timers[7].node))
+    {
+        printf("timespec_wheel_cancel succeeded twice\n");
+        result = 1;
+    }
+
+    // Advance in uneven steps and check nothing is more than one tick late
+
+    struct timespec end = timespec_add(start, timespec_from_ms(20000000 + 10));
+    while(timespec_lt(current, end))
+    {
+        long step_ms = (rand() % 2) ? rand() % 5 : rand() % 50000;
+        current = timespec_add(current, timespec_from_ms(step_ms));
+        if(rand() % 2)
+        {
+            current = timespec_add(current, timespec_ns_to_timespec(rand() % 1000000));
+        }
+
+        timespec_wheel_advance(wheel, current);
+
+        struct timespec limit = timespec_sub(current, tick);
+        for(int i = 0; i < TIMERS; ++i)
+        {
+            if(!timers[i].fired && !timers[i].cancelled && timespec_lt(timers[i].deadline, limit))
+            {
+                printf("timer %d with deadline {%ld, %ld} did not fire by {%ld, %ld}\n", i,
+                    (long)(timers[i].deadline.tv_sec), timers[i].deadline.tv_nsec,
+                    (long)(current.tv_sec), current.tv_nsec);
+                result = 1;
+                timers[i].cancelled = 1;
+            }
+        }
+    }
+
+    for(int i = 0; i < TIMERS; ++i)
+    {
+        if(!timers[i].fired && !timers[i].cancelled)
+        {
+            printf("timer %d never fired\n", i);
+            result = 1;
+        }
+    }
+
+    if(timespec_wheel_count(wheel) != 0)
+    {
+        printf("timespec_wheel_count returned %zu after all timers expired\n", timespec_wheel_count(wheel));
+        result = 1;
+    }
+
+    // Re-arming from a callback
+
+    struct timespec_timer rearm;
+    rearm_wheel = wheel;
+    timespec_timer_init(&rearm, on_expire_rearm);
+    timespec_wheel_add(wheel, &rearm, timespec_add(current, timespec_from_ms(10)));
+
+    size_t fired = 0;
+    for(int i = 0; i < 100; ++i)
+    {
+        current = timespec_add(current, tick);
+        fired += timespec_wheel_advance(wheel, current);
+    }
+
+    if(fired != 3 || timespec_timer_pending(&rearm))
+    {
+        printf("re-armed timer fired %zu times, expected 3\n", fired);
+        result = 1;
+    }
+
+    // Re-arming from a callback into the slot being expired
+
+    struct timespec_timer span;
+    timespec_timer_init(&span, on_expire_span);
+    current.tv_nsec -= current.tv_nsec % 1000000;
+    span_deadline = timespec_add(current, timespec_from_ms(3));
+    timespec_wheel_add(wheel, &span, span_deadline);
+
+    fired = 0;
+    for(int i = 0; i < 3 + 256 + 512 + 768 + 65536 + 10; ++i)
+    {
+        current = timespec_add(current, tick);
+        fired += timespec_wheel_advance(wheel, current);
+    }
+
+    if(fired != 5 || span_fires != 5 || timespec_timer_pending(&span))
+    {
+        printf("timer re-armed by whole wheel spans fired %zu times, expected 5\n", fired);
+        result = 1;
+    }
+
+    timespec_wheel_destroy(wheel);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,275 @@
+/**
+ * @file timespecWindowTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <timespec.h>
+#include <timespec_window.h>
+
+#define BUCKET_NS   1000000
+#define BUCKETS     100
+#define EVENTS      20000
+#define THREADS     4
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+static int64_t floor_div(timespec_ns a, timespec_ns b)
+{
+	return a / b - (a % b < 0);
+}
+
+/* Counts events the slow way: every event whose bucket is within the window
+ * and still held by a ring whose newest bucket is head.
+*/
+static uint64_t brute_sum(const timespec_ns *times, const uint64_t *counts, size_t n, int64_t head, timespec_ns now,
+	timespec_ns window)
+{
+	int64_t to = floor_div(now, BUCKET_NS);
+	int64_t buckets = (window - 1) / BUCKET_NS + 1;
+	int64_t from = to - ((buckets > BUCKETS) ? BUCKETS : buckets);
+	int64_t oldest = head - 127;
+	uint64_t sum = 0;
+
+	if(from < oldest)
+	{
+		from = oldest;
+	}
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		int64_t e = floor_div(times[i], BUCKET_NS);
+
+		sum += (e > from && e <= to) ? counts[i] : 0;
+	}
+
+	return sum;
+}
+
+struct shard
+{
+	pthread_t thread;
+	struct timespec_window *window;
+	unsigned int seed;
+};
+
+static timespec_ns shard_time(long i)
+{
+	return (timespec_ns)(i) * 1000 - 40000000;
+}
+
+static void *shard_main(void *arg)
+{
+	struct shard *s = arg;
+
+	for(long i = 0; i < EVENTS; ++i)
+	{
+		timespec_window_record_ns(s->window, shard_time(i), (uint64_t)(rand_r(&s->seed) % 3));
+	}
+
+	return NULL;
+}
+
+static struct timespec_window *shared;
+static bool stop;
+
+static void *writer_main(void *arg)
+{
+	(void)(arg);
+
+	for(long i = 0; i < 100 * EVENTS; ++i)
+	{
+		timespec_window_record_ns(shared, 5 * BUCKET_NS / 2, 1);
+	}
+	__atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+int main()
+{
+    struct timespec width = timespec_ns_to_timespec(BUCKET_NS);
+    struct timespec zero = { .tv_sec = 0, .tv_nsec = 0 };
+    int result = 0;
+
+    CHECK(timespec_window_create(zero, 10) == NULL && errno == EINVAL, "zero bucket width accepted");
+    CHECK(timespec_window_create(width, 0) == NULL && errno == EINVAL, "zero buckets accepted");
+
+    struct timespec_window *w = timespec_window_create(width, BUCKETS);
+    CHECK(w != NULL, "create failed");
+    if(w == NULL)
+    {
+        return 1;
+    }
+
+    CHECK(timespec_eq(timespec_window_span(w), timespec_from_ms(100)), "span is wrong");
+    CHECK(timespec_window_sum_ns(w, 0, BUCKET_NS * 10) == 0, "empty window has events");
+
+    /* Bucket boundaries, including negative times */
+
+    CHECK(timespec_window_record_ns(w, -1, 1), "record failed");
+    CHECK(timespec_window_record_ns(w, 0, 2), "record failed");
+    CHECK(timespec_window_record_ns(w, BUCKET_NS - 1, 4), "record failed");
+    CHECK(timespec_window_record_ns(w, BUCKET_NS, 8), "record failed");
+
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS, 1) == 8, "current bucket sum is wrong");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS, BUCKET_NS) == 8, "one bucket sum is wrong");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS, BUCKET_NS + 1) == 14, "two bucket sum is wrong");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS, 3 * BUCKET_NS) == 15, "three bucket sum is wrong");
+    CHECK(timespec_window_sum_ns(w, 0, BUCKET_NS) == 6, "sum in the past is wrong");
+    CHECK(timespec_window_sum_ns(w, -1, BUCKET_NS) == 1, "sum of a negative bucket is wrong");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS, 0) == 0, "empty window has events");
+    CHECK(timespec_window_sum_ns(w, 3 * BUCKET_NS, 2 * BUCKET_NS) == 0, "window after the events has events");
+    CHECK(timespec_window_sum_ns(w, 3 * BUCKET_NS, 3 * BUCKET_NS) == 8, "window reaching back is wrong");
+
+    struct timespec now = timespec_ns_to_timespec(BUCKET_NS);
+    double rate = timespec_window_rate(w, now, timespec_from_ms(2));
+    CHECK(rate > 6999.0 && rate < 7001.0, "rate is %g", rate);
+
+    /* Time moving on past the span */
+
+    CHECK(timespec_window_record_ns(w, BUCKET_NS * 1000, 16), "record after a gap failed");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS * 1000, BUCKET_NS * 1000) == 16, "old events not expired");
+    CHECK(!timespec_window_record_ns(w, 0, 1), "event older than the ring accepted");
+    CHECK(timespec_window_record_ns(w, BUCKET_NS * 950, 32), "late event within the span rejected");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS * 1000, BUCKET_NS * 1000) == 48, "late event not counted");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS * 999, BUCKET_NS * 10) == 0, "late event counted in the wrong bucket");
+    CHECK(timespec_window_sum_ns(w, BUCKET_NS * 1200, BUCKET_NS * 1000) == 0, "events seen after the span");
+
+    timespec_window_destroy(w);
+
+    /* Random events against counting every timestamp */
+
+    timespec_ns *times = malloc(EVENTS * sizeof(*times));
+    uint64_t *counts = malloc(EVENTS * sizeof(*counts));
+    unsigned int seed = 1;
+    int64_t head = INT64_MIN;
+    size_t kept = 0;
+    bool matches = true;
+
+    w = timespec_window_create(width, BUCKETS);
+    for(long i = 0; i < EVENTS; ++i)
+    {
+        /* Mostly in order with some late arrivals. */
+        timespec_ns t = i * 20000 - (timespec_ns)(rand_r(&seed) % 5000000);
+        uint64_t n = (uint64_t)(rand_r(&seed) % 10);
+
+        if(timespec_window_record_ns(w, t, n))
+        {
+            times[kept] = t;
+            counts[kept++] = n;
+            head = (floor_div(t, BUCKET_NS) > head) ? floor_div(t, BUCKET_NS) : head;
+        }
+        else
+        {
+            matches &= floor_div(t, BUCKET_NS) <= head - 127;
+        }
+
+        if(i % 97 == 0)
+        {
+            timespec_ns at = t + (timespec_ns)(rand_r(&seed) % 80000000) - 60000000;
+            timespec_ns window = (timespec_ns)(rand_r(&seed) % (BUCKETS * BUCKET_NS * 2)) + 1;
+
+            matches &= timespec_window_sum_ns(w, at, window) == brute_sum(times, counts, kept, head, at, window);
+        }
+    }
+    CHECK(matches, "sums differ from counting timestamps");
+
+    /* Per-thread shards merge to the same counts as one window */
+
+    struct shard shards[THREADS];
+    struct timespec_window *merged = timespec_window_create(width, BUCKETS);
+    struct timespec_window *single = timespec_window_create(width, BUCKETS);
+
+    for(int i = 0; i < THREADS; ++i)
+    {
+        shards[i].window = timespec_window_create(width, BUCKETS);
+        shards[i].seed = (unsigned int)(i + 1);
+        pthread_create(&shards[i].thread, NULL, shard_main, &shards[i]);
+    }
+    for(int i = 0; i < THREADS; ++i)
+    {
+        pthread_join(shards[i].thread, NULL);
+        CHECK(timespec_window_merge(merged, shards[i].window), "merge failed");
+
+        /* Replay the same events into one window. */
+        seed = (unsigned int)(i + 1);
+        for(long j = 0; j < EVENTS; ++j)
+        {
+            timespec_window_record_ns(single, shard_time(j), (uint64_t)(rand_r(&seed) % 3));
+        }
+    }
+
+    matches = true;
+    for(timespec_ns at = -50000000; at < 0; at += 333333)
+    {
+        for(timespec_ns window = 1; window < BUCKETS * BUCKET_NS; window += 7777777)
+        {
+            matches &= timespec_window_sum_ns(merged, at, window) == timespec_window_sum_ns(single, at, window);
+        }
+    }
+    CHECK(matches, "merged shards differ from a single window");
+    CHECK(timespec_window_sum_ns(merged, shard_time(EVENTS - 1), BUCKET_NS * 10) > 0, "merged window is empty");
+
+    struct timespec_window *other = timespec_window_create(width, BUCKETS + 1);
+    CHECK(!timespec_window_merge(merged, other) && errno == EINVAL, "merged windows of different spans");
+    CHECK(!timespec_window_merge(merged, merged) && errno == EINVAL, "merged a window into itself");
+
+    timespec_window_destroy(other);
+    for(int i = 0; i < THREADS; ++i)
+    {
+        timespec_window_destroy(shards[i].window);
+    }
+    timespec_window_destroy(single);
+    timespec_window_destroy(merged);
+
+    /* Queries from another thread see consistent counts */
+
+    pthread_t writer;
+    uint64_t last = 0;
+    bool consistent = true;
+
+    shared = timespec_window_create(width, BUCKETS);
+    pthread_create(&writer, NULL, writer_main, NULL);
+    while(!__atomic_load_n(&stop, __ATOMIC_ACQUIRE))
+    {
+        uint64_t sum = timespec_window_sum_ns(shared, 5 * BUCKET_NS / 2, BUCKET_NS);
+
+        consistent &= sum >= last && sum <= 100 * EVENTS;
+        last = sum;
+    }
+    pthread_join(writer, NULL);
+    /* The loop may stop before reading the writer's last events. */
+    last = timespec_window_sum_ns(shared, 5 * BUCKET_NS / 2, BUCKET_NS);
+    CHECK(consistent, "a concurrent query saw an inconsistent window");
+    CHECK(last == 100 * EVENTS, "concurrent query ended with %llu events", (unsigned long long)(last));
+
+    timespec_window_destroy(shared);
+
+    timespec_window_destroy(w);
+    timespec_window_destroy(NULL);
+    free(times);
+    free(counts);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,337 @@
+/**
+ * @file timespecZoneTests.c
+ *
+ * @copyright (C)2019 Red Lion Controls, Inc. All rights reserved. Red Lion, the Red Lion logo and Sixnet are registered
+ * trademarks of Red Lion Controls, Inc. All other company and product names are trademarks of their respective owners.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <timespec.h>
+#include <timespec_zone.h>
+
+#define SEC_PER_DAY INT64_C(86400)
+#define FROM_1850   INT64_C(-3786825600)
+#define RANDOM      20000
+#define THREADS     4
+
+#define CHECK(cond, ...) { \
+	if(!(cond)) \
+	{ \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		result = 1; \
+	} \
+}
+
+/* System zones with unusual offsets or rules, as names for TZ and for timespec_zone_load(). */
+static const char *zones[] = {
+	"America/New_York", "Europe/London", "Europe/Dublin", "Australia/Lord_Howe", "Australia/Sydney",
+	"Asia/Kolkata", "Asia/Tehran", "Pacific/Chatham", "Pacific/Apia", "America/Sao_Paulo", "America/St_Johns",
+	"Africa/Casablanca", "Antarctica/Troll", "UTC",
+};
+
+/* POSIX TZ rules with no file, each of the three kinds of date, and transitions outside 0-24 hours. */
+static const char *rules[] = {
+	"XST-5:30", "<-03>3<-02>,M10.1.0/0,M2.3.0/0", "NZST-12NZDT,M9.5.0,M4.1.0/3", "IST-1GMT0,M10.5.0,M3.5.0/1",
+	"AAA3BBB,J60,J300/25", "CCC-2DDD-3,59/-1,300/26",
+};
+
+static struct timespec_zone *shared;
+static struct timespec times[RANDOM];
+static struct timespec_local expected[RANDOM];
+
+static int64_t next_random(unsigned int *seed)
+{
+	return ((int64_t)(rand_r(seed)) << 31 | rand_r(seed)) % (INT64_C(1) << 34) - (INT64_C(1) << 33);
+}
+
+/* Compares a conversion with localtime_r() under TZ, printing the first few differences. */
+static bool compare(const struct timespec_zone *zone, const char *name, time_t t, int *failures)
+{
+	struct timespec_local local;
+	struct tm tm;
+
+	if(localtime_r(&t, &tm) == NULL)
+	{
+		return true;
+	}
+
+	bool converted = timespec_zone_to_local(zone, (struct timespec){ .tv_sec = t, .tv_nsec = 0 }, &local);
+
+	if(converted && local.tm.tm_year == tm.tm_year && local.tm.tm_mon == tm.tm_mon && local.tm.tm_mday == tm.tm_mday
+		&& local.tm.tm_hour == tm.tm_hour && local.tm.tm_min == tm.tm_min && local.tm.tm_sec == tm.tm_sec
+		&& local.tm.tm_wday == tm.tm_wday && local.tm.tm_yday == tm.tm_yday && local.tm.tm_isdst == tm.tm_isdst
+		&& local.utc_offset == tm.tm_gmtoff && strcmp(local.abbrev, tm.tm_zone) == 0
+		&& timespec_zone_offset(zone, (struct timespec){ .tv_sec = t, .tv_nsec = 0 }) == tm.tm_gmtoff)
+	{
+		return true;
+	}
+
+	if(++(*failures) <= 5)
+	{
+		printf("%s at %lld: %04d-%02d-%02d %02d:%02d:%02d %+d %s, expected %04d-%02d-%02d %02d:%02d:%02d %+ld %s\n",
+			name, (long long)(t), local.tm.tm_year + 1900, local.tm.tm_mon + 1, local.tm.tm_mday, local.tm.tm_hour,
+			local.tm.tm_min, local.tm.tm_sec, local.utc_offset, converted ? local.abbrev : "", tm.tm_year + 1900,
+			tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_gmtoff, tm.tm_zone);
+	}
+
+	return false;
+}
+
+/* Checks a zone against localtime_r() daily from a time to 2450, around
+ * each change of offset, and at random times after it up to 2242.
+*/
+static int check_zone(const char *name, time_t from, unsigned int *seed)
+{
+	struct timespec_zone *zone = timespec_zone_load(name);
+	int failures = 0, result = 0;
+	char tz[64];
+
+	CHECK(zone != NULL, "%s: load failed: %s", name, strerror(errno));
+	if(zone == NULL)
+	{
+		return result;
+	}
+
+	snprintf(tz, sizeof(tz), "%s%s", (strchr(name, '/') != NULL) ? ":" : "", name);
+	setenv("TZ", tz, 1);
+	tzset();
+
+	time_t last = from;
+	int32_t last_offset = timespec_zone_offset(zone, (struct timespec){ .tv_sec = last, .tv_nsec = 0 });
+
+	for(time_t t = last; t < INT64_C(15148684800); t += SEC_PER_DAY)
+	{
+		int32_t offset = timespec_zone_offset(zone, (struct timespec){ .tv_sec = t, .tv_nsec = 0 });
+
+		compare(zone, name, t, &failures);
+
+		/* Find the second the offset changed. */
+		if(offset != last_offset)
+		{
+			time_t lo = last, hi = t;
+
+			while(hi - lo > 1)
+			{
+				time_t mid = lo + (hi - lo) / 2;
+
+				if(timespec_zone_offset(zone, (struct timespec){ .tv_sec = mid, .tv_nsec = 0 }) == last_offset)
+					lo = mid;
+				else
+					hi = mid;
+			}
+
+			compare(zone, name, hi - 1, &failures);
+			compare(zone, name, hi, &failures);
+		}
+
+		last = t;
+		last_offset = offset;
+	}
+
+	for(int i = 0; i < RANDOM; ++i)
+	{
+		time_t t = next_random(seed);
+
+		if(t >= from)
+		{
+			compare(zone, name, t, &failures);
+		}
+	}
+
+	CHECK(failures == 0, "%s: %d conversions differ from localtime_r()", name, failures);
+
+	timespec_zone_destroy(zone);
+
+	return result;
+}
+
+static void *convert_main(void *arg)
+{
+	bool *same = arg;
+	struct timespec_local local;
+
+	for(int i = 0; i < RANDOM; ++i)
+	{
+		*same &= timespec_zone_to_local(shared, times[i], &local)
+			&& memcmp(&local.tm, &expected[i].tm, sizeof(local.tm)) == 0 && local.nsec == expected[i].nsec
+			&& local.utc_offset == expected[i].utc_offset && local.abbrev == expected[i].abbrev;
+	}
+
+	return NULL;
+}
+
+int main()
+{
+    struct timespec_local local;
+    unsigned int seed = 1;
+    int result = 0;
+
+    /* Zone files shipped with the system */
+
+    struct timespec_zone *zone = timespec_zone_load("Europe/London");
+
+    if(zone == NULL && errno == ENOENT)
+    {
+        printf("No zoneinfo files, skipping the tests of them\n");
+    }
+    else
+    {
+        for(size_t i = 0; i < sizeof(zones) / sizeof(*zones); ++i)
+        {
+            result |= check_zone(zones[i], FROM_1850, &seed);
+        }
+    }
+
+    /* Zones counting leap seconds, when installed, from the first leap second and a minute around the last */
+
+    struct timespec_zone *right = timespec_zone_load("right/UTC");
+
+    if(right == NULL && errno == ENOENT)
+    {
+        printf("No right/ zoneinfo files, skipping the tests of leap seconds\n");
+    }
+    else
+    {
+        int failures = 0;
+
+        result |= check_zone("right/UTC", 78796800 - 100 * SEC_PER_DAY, &seed);
+        result |= check_zone("right/America/New_York", 78796800 - 100 * SEC_PER_DAY, &seed);
+
+        setenv("TZ", ":right/UTC", 1);
+        tzset();
+        for(time_t t = 1483228800 - 30; t < 1483228800 + 60; ++t)
+        {
+            compare(right, "right/UTC", t, &failures);
+        }
+        CHECK(failures == 0, "right/UTC: %d conversions around the 2016 leap second differ from localtime_r()",
+            failures);
+    }
+    timespec_zone_destroy(right);
+
+    /* POSIX TZ rules, from 1970 as glibc applies them to earlier years wrongly */
+
+    for(size_t i = 0; i < sizeof(rules) / sizeof(*rules); ++i)
+    {
+        result |= check_zone(rules[i], 0, &seed);
+    }
+
+    /* Fractions of a second, before and after the epoch */
+
+    struct timespec_zone *utc = timespec_zone_load("UTC0");
+
+    CHECK(utc != NULL, "UTC0 did not load");
+    if(utc != NULL)
+    {
+        CHECK(timespec_zone_to_local(utc, (struct timespec){ .tv_sec = -1, .tv_nsec = -500 }, &local)
+            && local.tm.tm_year == 69 && local.tm.tm_mon == 11 && local.tm.tm_mday == 31 && local.tm.tm_hour == 23
+            && local.tm.tm_min == 59 && local.tm.tm_sec == 58 && local.nsec == 999999500,
+            "-1.0000005s is not 1969-12-31 23:59:58.9999995");
+        CHECK(timespec_zone_to_local(utc, (struct timespec){ .tv_sec = -1, .tv_nsec = 500000000 }, &local)
+            && local.tm.tm_year == 69 && local.tm.tm_sec == 59 && local.nsec == 500000000
+            && timespec_zone_to_local(utc, (struct timespec){ .tv_sec = 1, .tv_nsec = -1500000000 }, &local)
+            && local.tm.tm_year == 69 && local.tm.tm_sec == 59 && local.nsec == 500000000,
+            "-0.5s not normalised is not 1969-12-31 23:59:59.5");
+        CHECK(timespec_zone_to_local(utc, (struct timespec){ .tv_sec = 0, .tv_nsec = 999999999 }, &local)
+            && local.tm.tm_year == 70 && local.tm.tm_sec == 0 && local.nsec == 999999999
+            && local.utc_offset == 0 && strcmp(local.abbrev, "UTC") == 0,
+            "0.999999999s is not 1970-01-01 00:00:00.999999999 UTC");
+        CHECK(timespec_zone_to_local(utc, (struct timespec){ .tv_sec = 253402300799, .tv_nsec = 0 }, &local)
+            && local.tm.tm_year == 8099 && local.tm.tm_yday == 364 && local.tm.tm_wday == 5,
+            "9999-12-31 is not a Friday");
+        CHECK(!timespec_zone_to_local(utc, (struct timespec){ .tv_sec = INT64_MAX, .tv_nsec = 0 }, &local)
+            && errno == EOVERFLOW, "a time past the years of a struct tm converted");
+        CHECK(timespec_zone_offset(utc, (struct timespec){ .tv_sec = INT64_MIN, .tv_nsec = 0 }) == 0,
+            "offset at the earliest time is not 0");
+    }
+
+    /* Loading */
+
+    setenv("TZ", "", 1);
+    struct timespec_zone *tz = timespec_zone_load(NULL);
+
+    CHECK(tz != NULL && timespec_zone_to_local(tz, timespec_ns_to_timespec(0), &local) && local.utc_offset == 0,
+        "empty TZ is not UTC");
+    timespec_zone_destroy(tz);
+
+    setenv("TZ", "XST-5:30", 1);
+    tz = timespec_zone_load(NULL);
+
+    CHECK(tz != NULL && timespec_zone_offset(tz, timespec_ns_to_timespec(0)) == 19800
+        && timespec_zone_to_local(tz, timespec_ns_to_timespec(0), &local) && strcmp(local.abbrev, "XST") == 0,
+        "TZ rule not loaded");
+    timespec_zone_destroy(tz);
+
+    CHECK(timespec_zone_load("No/Such_Zone") == NULL && errno == ENOENT, "missing zone loaded");
+    CHECK(timespec_zone_load("../../../etc/passwd") == NULL && errno == ENOENT, "zone outside zoneinfo loaded");
+    CHECK(timespec_zone_load("EST5EDT,M3.2.0") == NULL && errno == ENOENT, "incomplete rule loaded");
+    CHECK(timespec_zone_load("EST5EDT,M13.2.0,M11.1.0") == NULL && errno == ENOENT, "rule in month 13 loaded");
+    CHECK(timespec_zone_parse("TZif2", 5) == NULL && errno == EINVAL, "truncated header parsed");
+
+    if(zone != NULL)
+    {
+        FILE *f = fopen("/usr/share/zoneinfo/Europe/London", "rb");
+        static unsigned char buf[1 << 16];
+        size_t len = (f != NULL) ? fread(buf, 1, sizeof(buf), f) : 0;
+        bool truncated = true;
+
+        struct timespec_zone *parsed = timespec_zone_parse(buf, len);
+
+        CHECK(parsed != NULL && timespec_zone_offset(parsed, timespec_ns_to_timespec(INT64_C(1720000000000000000)))
+            == 3600, "Europe/London not parsed from memory");
+        timespec_zone_destroy(parsed);
+
+        for(size_t cut = 0; cut < len; cut += 7)
+        {
+            truncated &= timespec_zone_parse(buf, cut) == NULL && errno == EINVAL;
+        }
+        CHECK(truncated, "truncated file parsed");
+        if(f != NULL)
+            fclose(f);
+    }
+
+    /* Threads converting at once get the same results as one alone */
+
+    shared = (zone != NULL) ? zone : utc;
+    if(shared != NULL)
+    {
+        pthread_t threads[THREADS];
+        bool same[THREADS];
+
+        for(int i = 0; i < RANDOM; ++i)
+        {
+            times[i] = timespec_ns_to_timespec((timespec_ns)(next_random(&seed)) * 1000000000);
+            timespec_zone_to_local(shared, times[i], &expected[i]);
+        }
+
+        for(int i = 0; i < THREADS; ++i)
+        {
+            same[i] = true;
+            pthread_create(&threads[i], NULL, convert_main, &same[i]);
+        }
+        for(int i = 0; i < THREADS; ++i)
+        {
+            pthread_join(threads[i], NULL);
+            CHECK(same[i], "thread %d converted differently", i);
+        }
+    }
+
+    timespec_zone_destroy(zone);
+    timespec_zone_destroy(utc);
+    timespec_zone_destroy(NULL);
+
+    if(result > 0)
+    {
+        printf("%d tests failed\n", result);
+    }
+    else{
+        printf("All tests passed\n");
+    }
+
+    return result;
+}